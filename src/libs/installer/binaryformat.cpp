@@ -149,6 +149,16 @@ void Resource::setName(const QByteArray &name)
     m_name = name;
 }
 
+/*!
+    Returns the path of the file that contains the resource data.
+
+    \sa segment()
+*/
+QString Resource::path() const
+{
+    return m_file.fileName();
+}
+
 /*!
     Opens a resource in QIODevice::ReadOnly mode. The function returns \c true
     if successful.
@@ -67,6 +67,7 @@ public:
     QByteArray name() const;
     void setName(const QByteArray &name);
 
+    QString path() const;
     Range<qint64> segment() const { return m_segment; }
     void setSegment(const Range<qint64> &segment) { m_segment = segment; }
 
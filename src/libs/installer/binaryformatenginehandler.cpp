@@ -109,4 +109,23 @@ BinaryFormatEngineHandler::registerResource(const QString &fileName, const QStri
         resourceName)));
 }
 
+/*!
+    Returns the resource registered for \a fileName, or a null pointer if there is none. The file
+    name \a fileName must be in the form of \c {installer://}, followed by the collection name and
+    resource name separated by a forward slash.
+*/
+QSharedPointer<Resource> BinaryFormatEngineHandler::resource(const QString &fileName) const
+{
+    static const QChar sep = QChar::fromLatin1('/');
+    static const QString prefix = QString::fromLatin1("installer://");
+    if (!fileName.startsWith(prefix, Qt::CaseInsensitive))
+        return QSharedPointer<Resource>();
+
+    const QString path = fileName.mid(prefix.length());
+    const QByteArray collectionName = path.section(sep, 0, 0).toUtf8();
+    if (!m_resources.contains(collectionName))
+        return QSharedPointer<Resource>();
+    return m_resources.value(collectionName).resourceByName(path.section(sep, 1, 1).toUtf8());
+}
+
 } // namespace QInstaller
@@ -33,6 +33,7 @@
 #include "globals.h"
 #include "lib7z_facade.h"
 #include "messageboxhandler.h"
+#include "metadatastore.h"
 #include "packagemanagercore.h"
 #include "remoteclient.h"
 #include "settings.h"
@@ -73,6 +74,18 @@ static const QLatin1String scCheckable("Checkable");
 static const QLatin1String scExpandedByDefault("ExpandedByDefault");
 static const QLatin1String scUnstable("Unstable");
 
+// Same as matching "([<=>]+)(.*)" and taking the second capture, without the regular expression.
+static QString versionWithoutComparator(const QString &version)
+{
+    int i = 0;
+    for (; i < version.size(); ++i) {
+        const QChar c = version.at(i);
+        if (c != QLatin1Char('<') && c != QLatin1Char('=') && c != QLatin1Char('>'))
+            break;
+    }
+    return version.mid(i);
+}
+
 /*!
     \enum Component::UnstableError
 
@@ -420,13 +433,33 @@ void Component::setValue(const QString &key, const QString &value)
     if (d->m_vars.value(key) == normalizedValue)
         return;
 
-    if (key == scName)
+    if (key == scName) {
         d->m_componentName = normalizedValue;
+        d->m_core->invalidateComponentIndex();
+    }
     if (key == scCheckable)
         this->setCheckable(normalizedValue.toLower() == scTrue);
     if (key == scExpandedByDefault)
         this->setExpandedByDefault(normalizedValue.toLower() == scTrue);
 
+    if (key == scVersion)
+        d->m_version = KDUpdater::Version(normalizedValue);
+    if (key == scInstalledVersion)
+        d->m_installedVersion = KDUpdater::Version(versionWithoutComparator(normalizedValue));
+    if (key == scDependencies) {
+        const QList<Dependency> previous = d->m_parsedDependencies;
+        d->m_dependencies = normalizedValue.split(QInstaller::commaRegExp(), QString::SkipEmptyParts);
+        d->m_parsedDependencies = Dependency::fromRequirements(d->m_dependencies);
+        d->m_core->dependenciesChanged(this, previous);
+    }
+    if (key == scAutoDependOn) {
+        d->m_autoDependencies = normalizedValue.split(QInstaller::commaRegExp(),
+            QString::SkipEmptyParts);
+        d->m_parsedAutoDependencies = Dependency::fromRequirements(d->m_autoDependencies);
+    }
+    if (key == scCurrentState || key == scInstalledVersion || key == scAutoDependOn)
+        d->m_core->calculationInputChanged();
+
     d->m_vars[key] = normalizedValue;
     emit valueChanged(key, normalizedValue);
 }
@@ -472,6 +505,7 @@ void Component::appendComponent(Component *component)
         parent->removeComponent(component);
     component->d->m_parentComponent = this;
     setTristate(d->m_childComponents.count() > 0);
+    d->m_core->invalidateComponentIndex();
 }
 
 /*!
@@ -484,6 +518,7 @@ void Component::removeComponent(Component *component)
         component->d->m_parentComponent = 0;
         d->m_childComponents.removeAll(component);
         d->m_allChildComponents.removeAll(component);
+        d->m_core->invalidateComponentIndex();
     }
 }
 
@@ -522,6 +557,23 @@ QString Component::displayName() const
     return d->m_vars.value(scDisplayName);
 }
 
+/*!
+    Returns the version of this component, parsed once whenever the \c Version value changes.
+*/
+KDUpdater::Version Component::version() const
+{
+    return d->m_version;
+}
+
+/*!
+    Returns the installed version of this component without a leading comparator, parsed once
+    whenever the \c InstalledVersion value changes.
+*/
+KDUpdater::Version Component::installedVersion() const
+{
+    return d->m_installedVersion;
+}
+
 /*!
     Loads the component script into the script engine.
 */
@@ -589,11 +641,11 @@ void Component::languageChanged()
 */
 void Component::loadTranslations(const QDir &directory, const QStringList &qms)
 {
-    QDirIterator it(directory.path(), qms, QDir::Files);
+    const MetadataStore *const store = MetadataStore::instance();
     const QStringList translations = d->m_core->settings().translations();
     const QString uiLanguage = QLocale().uiLanguages().value(0, QLatin1String("en"));
-    while (it.hasNext()) {
-        const QString filename = it.next();
+    foreach (const QString &entry, store->entryList(directory.path(), qms)) {
+        const QString filename = directory.filePath(entry);
         const QString basename = QFileInfo(filename).baseName();
         if (!uiLanguage.startsWith(QFileInfo(filename).baseName(), Qt::CaseInsensitive))
             continue; // do not load the file if it does not match the UI language
@@ -607,7 +659,17 @@ void Component::loadTranslations(const QDir &directory, const QStringList &qms)
         }
 
         QScopedPointer<QTranslator> translator(new QTranslator(this));
-        if (translator->load(filename)) {
+        bool loaded = false;
+        if (store->contains(filename)) {
+            // QTranslator does not copy the data, keep it alive as long as the component
+            const QByteArray data = store->file(filename);
+            d->m_translationData.append(data);
+            loaded = translator->load(reinterpret_cast<const uchar *>(data.constData()),
+                data.size(), directory.path());
+        } else {
+            loaded = translator->load(filename);
+        }
+        if (loaded) {
             // Do not throw if translator returns false as it may just be an intentionally
             // empty file. See also QTBUG-31031
             qApp->installTranslator(translator.take());
@@ -624,21 +686,21 @@ void Component::loadUserInterfaces(const QDir &directory, const QStringList &uis
     if (qobject_cast<QApplication*> (qApp) == 0)
         return;
 
-    QDirIterator it(directory.path(), uis, QDir::Files);
-    while (it.hasNext()) {
-        QFile file(it.next());
-        if (!file.open(QIODevice::ReadOnly)) {
+    foreach (const QString &fileName, MetadataStore::instance()->entryList(directory.path(), uis)) {
+        const std::unique_ptr<QIODevice> file
+            = MetadataStore::instance()->open(directory.filePath(fileName));
+        if (!file->open(QIODevice::ReadOnly)) {
             throw Error(tr("Cannot open the requested UI file \"%1\": %2").arg(
-                            it.fileName(), file.errorString()));
+                            fileName, file->errorString()));
         }
 
         static QUiLoader loader;
         loader.setTranslationEnabled(true);
         loader.setLanguageChangeEnabled(true);
-        QWidget *const widget = loader.load(&file, 0);
+        QWidget *const widget = loader.load(file.get(), 0);
         if (!widget) {
             throw Error(tr("Cannot load the requested UI file \"%1\": %2").arg(
-                            it.fileName(), loader.errorString()));
+                            fileName, loader.errorString()));
         }
         d->scriptEngine()->newQObject(widget);
         d->m_userInterfaces.insert(widget->objectName(), widget);
@@ -672,7 +734,7 @@ void Component::loadLicenses(const QString &directory, const QHash<QString, QVar
 
             auto fInfo = std::find_if(fileCandidates.constBegin(), fileCandidates.constEnd(),
                                       [](const QFileInfo &file) {
-                                           return file.exists();
+                                           return MetadataStore::instance()->exists(file.filePath());
                                        });
             if (fInfo != fileCandidates.constEnd()) {
                 fileInfo = *fInfo;
@@ -680,12 +742,12 @@ void Component::loadLicenses(const QString &directory, const QHash<QString, QVar
             }
         }
 
-        QFile file(fileInfo.filePath());
-        if (!file.open(QIODevice::ReadOnly)) {
+        const std::unique_ptr<QIODevice> file = MetadataStore::instance()->open(fileInfo.filePath());
+        if (!file->open(QIODevice::ReadOnly)) {
             throw Error(tr("Cannot open the requested license file \"%1\": %2").arg(
-                            file.fileName(), file.errorString()));
+                            fileInfo.filePath(), file->errorString()));
         }
-        QTextStream stream(&file);
+        QTextStream stream(file.get());
         stream.setCodec("UTF-8");
         d->m_licenses.insert(it.key(), qMakePair(fileName, stream.readAll()));
     }
@@ -1246,7 +1308,18 @@ void Component::addDependency(const QString &newDependency)
 
 QStringList Component::dependencies() const
 {
-    return d->m_vars.value(scDependencies).split(QInstaller::commaRegExp(), QString::SkipEmptyParts);
+    return d->m_dependencies;
+}
+
+/*!
+    Returns the dependencies of this component, parsed once whenever the list changes.
+    Entries listed more than once are returned only once.
+
+    \sa dependencies
+*/
+QList<Dependency> Component::parsedDependencies() const
+{
+    return d->m_parsedDependencies;
 }
 
 /*!
@@ -1267,7 +1340,18 @@ void Component::addAutoDependOn(const QString &newDependOn)
 
 QStringList Component::autoDependencies() const
 {
-    return d->m_vars.value(scAutoDependOn).split(QInstaller::commaRegExp(), QString::SkipEmptyParts);
+    return d->m_autoDependencies;
+}
+
+/*!
+    Returns the automatic depend-on list of this component, parsed once whenever the list
+    changes. Entries listed more than once are returned only once.
+
+    \sa autoDependencies
+*/
+QList<Dependency> Component::parsedAutoDependencies() const
+{
+    return d->m_parsedAutoDependencies;
 }
 
 /*!
@@ -1286,10 +1370,28 @@ void Component::setInstalled()
     \sa {component::isAutoDependOn}{component.isAutoDependOn}
 */
 bool Component::isAutoDependOn(const QSet<QString> &componentsToInstall) const
+{
+    if (autoDependencies().isEmpty())
+        return false;
+
+    QSet<QString> installedComponents;
+    if (!packageManagerCore()->foundEssentialUpdate())
+        installedComponents = d->m_core->localInstalledPackages().keys().toSet();
+    return isAutoDependOn(componentsToInstall, installedComponents);
+}
+
+/*!
+    \overload
+
+    Uses \a installedComponents as the names of the installed components instead of reading them
+    from the core, so that callers checking many components can read them once.
+*/
+bool Component::isAutoDependOn(const QSet<QString> &componentsToInstall,
+    const QSet<QString> &installedComponents) const
 {
     // If there is no auto depend on value or the value is empty, we have nothing todo. The component does
     // not need to be installed as an auto dependency.
-    QStringList autoDependOnList = autoDependencies();
+    const QStringList autoDependOnList = autoDependencies();
     if (autoDependOnList.isEmpty())
         return false;
 
@@ -1298,28 +1400,20 @@ bool Component::isAutoDependOn(const QSet<QString> &componentsToInstall) const
     // essential updates needs to be installed first, otherwise non-essential components
     // will be installed
     if (packageManagerCore()->foundEssentialUpdate()) {
-        const QSet<QString> autoDependOnSet = autoDependOnList.toSet();
-        if (autoDependOnSet.intersects(componentsToInstall)) {
-            return true;
+        foreach (const QString &component, autoDependOnList) {
+            if (componentsToInstall.contains(component))
+                return true;
         }
         return false;
     }
 
-    QSet<QString> components = componentsToInstall;
-    const QStringList installedPackages = d->m_core->localInstalledPackages().keys();
-    foreach (const QString &name, installedPackages)
-        components.insert(name);
-
-    foreach (const QString &component, components) {
-        autoDependOnList.removeAll(component);
-        if (autoDependOnList.isEmpty()) {
-            // If all components in the isAutoDependOn field are already installed or selected for
-            // installation, this component needs to be installed as well.
-            return true;
-        }
+    // If all components in the isAutoDependOn field are already installed or selected for
+    // installation, this component needs to be installed as well.
+    foreach (const QString &component, autoDependOnList) {
+        if (!componentsToInstall.contains(component) && !installedComponents.contains(component))
+            return false;
     }
-
-    return false;
+    return true;
 }
 
 bool Component::isDefault() const
@@ -1384,7 +1478,20 @@ bool Component::isSelectedForInstallation() const
 */
 void Component::setUpdateAvailable(bool isUpdateAvailable)
 {
+    if (d->m_updateIsAvailable == isUpdateAvailable)
+        return;
     d->m_updateIsAvailable = isUpdateAvailable;
+    d->m_core->calculationInputChanged();
+}
+
+/*!
+    Returns whether the core found an update for this component.
+
+    \sa setUpdateAvailable()
+*/
+bool Component::isUpdateAvailable() const
+{
+    return d->m_updateIsAvailable;
 }
 
 /*!
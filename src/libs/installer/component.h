@@ -31,6 +31,7 @@
 
 #include "constants.h"
 #include "component_p.h"
+#include "dependency.h"
 #include "qinstallerglobal.h"
 #include "packagemanagercore.h"
 
@@ -155,6 +156,8 @@ public:
 
     QString name() const;
     QString displayName() const;
+    KDUpdater::Version version() const;
+    KDUpdater::Version installedVersion() const;
     quint64 updateUncompressedSize();
 
     QUrl repositoryUrl() const;
@@ -162,8 +165,10 @@ public:
 
     Q_INVOKABLE void addDependency(const QString &newDependency);
     QStringList dependencies() const;
+    QList<Dependency> parsedDependencies() const;
     Q_INVOKABLE void addAutoDependOn(const QString &newDependOn);
     QStringList autoDependencies() const;
+    QList<Dependency> parsedAutoDependencies() const;
 
     void languageChanged();
     QString localTempPath() const;
@@ -173,6 +178,8 @@ public:
 
     Q_INVOKABLE bool isDefault() const;
     Q_INVOKABLE bool isAutoDependOn(const QSet<QString> &componentsToInstall) const;
+    bool isAutoDependOn(const QSet<QString> &componentsToInstall,
+        const QSet<QString> &installedComponents) const;
 
     Q_INVOKABLE void setInstalled();
     Q_INVOKABLE bool isInstalled(const QString version = QString()) const;
@@ -186,6 +193,7 @@ public:
     Q_INVOKABLE bool isFromOnlineRepository() const;
 
     Q_INVOKABLE void setUpdateAvailable(bool isUpdateAvailable);
+    bool isUpdateAvailable() const;
     Q_INVOKABLE bool updateRequested();
 
     Q_INVOKABLE bool componentChangeRequested();
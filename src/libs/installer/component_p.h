@@ -29,7 +29,9 @@
 #ifndef COMPONENT_P_H
 #define COMPONENT_P_H
 
+#include "dependency.h"
 #include "qinstallerglobal.h"
+#include "version.h"
 
 #include <QJSValue>
 #include <QPointer>
@@ -68,6 +70,12 @@ public:
     QString m_componentName;
     QUrl m_repositoryUrl;
     QString m_localTempPath;
+    KDUpdater::Version m_version;
+    KDUpdater::Version m_installedVersion;
+    QStringList m_dependencies;
+    QStringList m_autoDependencies;
+    QList<Dependency> m_parsedDependencies;
+    QList<Dependency> m_parsedAutoDependencies;
     QJSValue m_scriptContext;
     QHash<QString, QString> m_vars;
     QList<Component*> m_childComponents;
@@ -78,6 +86,7 @@ public:
 
     // < display name, < file name, file content > >
     QHash<QString, QPair<QString, QString> > m_licenses;
+    QList<QByteArray> m_translationData;
     QList<QPair<QString, bool> > m_pathsForUninstallation;
 };
 
@@ -0,0 +1,154 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "dependency.h"
+
+#include "packagemanagercore.h"
+
+#include <QSet>
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::Dependency
+    \brief The Dependency class holds a parsed entry of a component's dependency list.
+
+    An entry names a component and optionally a version requirement, separated by \c{:} or
+    \c{-}, as in \c{org.qt-project.sdk.qt:>=4.5}. The requirement can be prefixed by the
+    comparators '>', '>=', '<', '<=' and '='; without a comparator, the exact version is
+    required. Components parse their dependency lists once, whenever the list changes, so
+    resolving dependencies does not need to split strings for every edge.
+*/
+
+/*!
+    Creates a dependency from the list entry \a requirement.
+*/
+Dependency::Dependency(const QString &requirement)
+    : m_requirement(requirement)
+{
+    PackageManagerCore::parseNameAndVersion(requirement, &m_name, &m_version);
+    parseVersion();
+}
+
+/*!
+    Creates a dependency on the component \a name with the version requirement \a version.
+*/
+Dependency::Dependency(const QString &name, const QString &version)
+    : m_requirement(version.isEmpty() ? name : name + QLatin1Char(':') + version)
+    , m_name(name)
+    , m_version(version)
+{
+    parseVersion();
+}
+
+/*!
+    Parses the list entries \a requirements. Entries listed more than once are only returned
+    the first time.
+*/
+QList<Dependency> Dependency::fromRequirements(const QStringList &requirements)
+{
+    QList<Dependency> dependencies;
+    QSet<QString> seen;
+    foreach (const QString &requirement, requirements) {
+        if (seen.contains(requirement))
+            continue;
+        seen.insert(requirement);
+        dependencies.append(Dependency(requirement));
+    }
+    return dependencies;
+}
+
+/*!
+    \fn QString QInstaller::Dependency::requirement() const
+
+    Returns the list entry the dependency was parsed from.
+*/
+
+/*!
+    \fn QString QInstaller::Dependency::name() const
+
+    Returns the name of the required component.
+*/
+
+/*!
+    \fn QString QInstaller::Dependency::version() const
+
+    Returns the version requirement including its comparator, or an empty string if any
+    version of the component satisfies the dependency.
+*/
+
+/*!
+    \fn QString QInstaller::Dependency::comparator() const
+
+    Returns the comparator of the version requirement, \c{=} if none was given.
+*/
+
+/*!
+    \fn KDUpdater::Version QInstaller::Dependency::requiredVersion() const
+
+    Returns the version of the version requirement without its comparator.
+*/
+
+/*!
+    Returns \c true if \a version satisfies the version requirement, see
+    PackageManagerCore::versionMatches().
+*/
+bool Dependency::matches(const KDUpdater::Version &version) const
+{
+    const bool allowEqual = m_comparator.contains(QLatin1Char('='));
+    const bool allowLess = m_comparator.contains(QLatin1Char('<'));
+    const bool allowMore = m_comparator.contains(QLatin1Char('>'));
+
+    if (allowEqual && version.toString() == m_requiredVersion.toString())
+        return true;
+
+    if (allowLess && m_requiredVersion > version)
+        return true;
+
+    if (allowMore && m_requiredVersion < version)
+        return true;
+
+    return false;
+}
+
+// Same as matching "([<=>]+)(.*)", without the regular expression.
+void Dependency::parseVersion()
+{
+    int i = 0;
+    for (; i < m_version.size(); ++i) {
+        const QChar c = m_version.at(i);
+        if (c != QLatin1Char('<') && c != QLatin1Char('=') && c != QLatin1Char('>'))
+            break;
+    }
+    m_comparator = i > 0 ? m_version.left(i) : QString(QLatin1Char('='));
+    m_requiredVersion = KDUpdater::Version(m_version.mid(i));
+}
+
+} // namespace QInstaller
@@ -0,0 +1,72 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef DEPENDENCY_H
+#define DEPENDENCY_H
+
+#include "installer_global.h"
+
+#include "version.h"
+
+#include <QList>
+#include <QStringList>
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT Dependency
+{
+public:
+    Dependency() = default;
+    explicit Dependency(const QString &requirement);
+    Dependency(const QString &name, const QString &version);
+
+    static QList<Dependency> fromRequirements(const QStringList &requirements);
+
+    QString requirement() const { return m_requirement; }
+    QString name() const { return m_name; }
+    QString version() const { return m_version; }
+    QString comparator() const { return m_comparator; }
+    KDUpdater::Version requiredVersion() const { return m_requiredVersion; }
+
+    bool matches(const KDUpdater::Version &version) const;
+
+private:
+    void parseVersion();
+
+private:
+    QString m_requirement;
+    QString m_name;
+    QString m_version;
+    QString m_comparator;
+    KDUpdater::Version m_requiredVersion;
+};
+
+} // namespace QInstaller
+
+#endif // DEPENDENCY_H
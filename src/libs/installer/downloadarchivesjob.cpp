@@ -42,6 +42,35 @@
 using namespace QInstaller;
 using namespace KDUpdater;
 
+static const int scDefaultMaxConcurrentDownloads = 6;
+static const int scDefaultMaxConcurrentDownloadsPerHost = 4;
+
+static int positiveEnvironmentValue(const char *name, int defaultValue)
+{
+    const QByteArray value = qgetenv(name);
+    if (!value.isEmpty()) {
+        const int number = QString::fromLocal8Bit(value).toInt();
+        if (number > 0)
+            return number;
+    }
+    return defaultValue;
+}
+
+/*!
+    \class QInstaller::DownloadArchivesJob
+    \inmodule QtInstallerFramework
+    \brief The DownloadArchivesJob class downloads the archives of the components to install.
+
+    Up to maxConcurrentDownloads() archives are downloaded at the same time, with at most
+    maxConcurrentDownloadsPerHost() of them from the same host. The hash file of an archive is
+    fetched alongside the archive itself, so that a single archive costs one round-trip instead
+    of two. The limits can be preset with the \c IFW_MAX_CONCURRENT_DOWNLOADS and
+    \c IFW_MAX_CONCURRENT_DOWNLOADS_PER_HOST environment variables.
+
+    Each archive is registered in the installer's file system as soon as it is verified, and
+    archiveDownloaded() is emitted, so that the installation of a component can start while the
+    archives of the following components are still downloading.
+*/
 
 /*!
     Creates a new DownloadArchivesJob with \a parent.
@@ -49,11 +78,15 @@ using namespace KDUpdater;
 DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
     : Job(core)
     , m_core(core)
-    , m_downloader(nullptr)
     , m_archivesDownloaded(0)
     , m_archivesToDownloadCount(0)
+    , m_maxConcurrentDownloads(positiveEnvironmentValue("IFW_MAX_CONCURRENT_DOWNLOADS",
+        scDefaultMaxConcurrentDownloads))
+    , m_maxConcurrentDownloadsPerHost(positiveEnvironmentValue("IFW_MAX_CONCURRENT_DOWNLOADS_PER_HOST",
+        scDefaultMaxConcurrentDownloadsPerHost))
     , m_canceled(false)
-    , m_lastFileProgress(0)
+    , m_finished(false)
+    , m_askingToRetry(false)
     , m_progressChangedTimerId(0)
 {
     setCapabilities(Cancelable);
@@ -64,8 +97,7 @@ DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
 */
 DownloadArchivesJob::~DownloadArchivesJob()
 {
-    if (m_downloader)
-        m_downloader->deleteLater();
+    releaseAllArchiveDownloads();
 }
 
 /*!
@@ -78,13 +110,31 @@ void DownloadArchivesJob::setArchivesToDownload(const QList<QPair<QString, QStri
     m_archivesToDownloadCount = archives.count();
 }
 
+/*!
+    Sets the maximum number of archives downloaded at the same time to \a count.
+*/
+void DownloadArchivesJob::setMaxConcurrentDownloads(int count)
+{
+    m_maxConcurrentDownloads = qMax(1, count);
+}
+
+/*!
+    Sets the maximum number of archives downloaded at the same time from a single host to \a count.
+*/
+void DownloadArchivesJob::setMaxConcurrentDownloadsPerHost(int count)
+{
+    m_maxConcurrentDownloadsPerHost = qMax(1, count);
+}
+
 /*!
     \reimp
 */
 void DownloadArchivesJob::doStart()
 {
     m_archivesDownloaded = 0;
-    fetchNextArchiveHash();
+    m_downloadedArchives.clear();
+    m_finished = false;
+    scheduleDownloads();
 }
 
 /*!
@@ -93,98 +143,130 @@ void DownloadArchivesJob::doStart()
 void DownloadArchivesJob::doCancel()
 {
     m_canceled = true;
-    if (m_downloader != nullptr)
-        m_downloader->cancelDownload();
+    m_finished = true;
+    releaseAllArchiveDownloads();
 }
 
-void DownloadArchivesJob::fetchNextArchiveHash()
+/*!
+    Starts downloads of pending archives until either the concurrency limit is reached or all
+    remaining archives are hosted on servers that already have their maximum number of downloads
+    running. Finishes the job once nothing is left to download.
+*/
+void DownloadArchivesJob::scheduleDownloads()
 {
-    if (m_core->testChecksum()) {
-        if (m_canceled) {
-            finishWithError(tr("Canceled"));
-            return;
-        }
+    if (m_finished)
+        return;
 
-        if (m_archivesToDownload.isEmpty()) {
-            emitFinished();
-            return;
+    int i = 0;
+    while (m_activeDownloads.count() < m_maxConcurrentDownloads && i < m_archivesToDownload.count()) {
+        const QString host = QUrl(m_archivesToDownload.at(i).second).host();
+        if (m_activeDownloadsPerHost.value(host) >= m_maxConcurrentDownloadsPerHost) {
+            ++i;
+            continue;
         }
+        // Archives we cannot set up a downloader for are skipped, just as before.
+        startArchiveDownload(m_archivesToDownload.takeAt(i));
+    }
+
+    if (m_activeDownloads.isEmpty() && m_archivesToDownload.isEmpty()) {
+        m_finished = true;
+        emitFinished();
+    }
+}
 
-        if (m_downloader)
-            m_downloader->deleteLater();
+void DownloadArchivesJob::startArchiveDownload(const QPair<QString, QString> &archive)
+{
+    ArchiveDownload *download = new ArchiveDownload;
+    download->archive = archive;
+    download->host = QUrl(archive.second).host();
 
-        m_downloader = setupDownloader(QLatin1String(".sha1"));
-        if (!m_downloader) {
-            m_archivesToDownload.removeFirst();
-            QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
+    if (m_core->testChecksum()) {
+        download->hashDownloader = setupDownloader(archive, QLatin1String(".sha1"));
+        if (!download->hashDownloader) {
+            delete download;
             return;
         }
-
-        connect(m_downloader, &FileDownloader::downloadCompleted,
+        m_downloaderToArchive.insert(download->hashDownloader, download);
+        connect(download->hashDownloader, &FileDownloader::downloadCompleted,
                 this, &DownloadArchivesJob::finishedHashDownload, Qt::QueuedConnection);
-        m_downloader->download();
     } else {
-        QMetaObject::invokeMethod(this, "fetchNextArchive", Qt::QueuedConnection);
+        download->hashDownloaded = true;
+    }
+
+    download->downloader = setupDownloader(archive, QString(), m_core->value(scUrlQueryString));
+    if (!download->downloader) {
+        releaseArchiveDownload(download);
+        return;
     }
+    m_downloaderToArchive.insert(download->downloader, download);
+    connect(download->downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
+    connect(download->downloader, &FileDownloader::downloadCompleted,
+            this, &DownloadArchivesJob::finishedArchiveDownload, Qt::QueuedConnection);
+
+    m_activeDownloads.append(download);
+    ++m_activeDownloadsPerHost[download->host];
+
+    if (download->hashDownloader)
+        download->hashDownloader->download();
+    download->downloader->download();
 }
 
 void DownloadArchivesJob::finishedHashDownload()
 {
-    Q_ASSERT(m_downloader != nullptr);
+    ArchiveDownload *download = archiveDownloadForSender();
+    if (!download || m_finished)
+        return;
 
-    QFile sha1HashFile(m_downloader->downloadedFileName());
+    QFile sha1HashFile(download->hashDownloader->downloadedFileName());
     if (sha1HashFile.open(QFile::ReadOnly)) {
-        m_currentHash = sha1HashFile.readAll();
-        fetchNextArchive();
+        download->hash = sha1HashFile.readAll();
+        download->hashDownloaded = true;
+        if (download->archiveDownloaded)
+            registerFile(download);
     } else {
-        finishWithError(tr("Downloading hash signature failed."));
+        finishWithError(tr("Downloading hash signature failed."),
+            download->hashDownloader->url().toString());
     }
 }
 
-/*!
-    Fetches the next archive and registers it in the installer.
-*/
-void DownloadArchivesJob::fetchNextArchive()
+void DownloadArchivesJob::finishedArchiveDownload()
 {
-    if (m_canceled) {
-        finishWithError(tr("Canceled"));
-        return;
-    }
-
-    if (m_archivesToDownload.isEmpty()) {
-        emitFinished();
+    ArchiveDownload *download = archiveDownloadForSender();
+    if (!download || m_finished)
         return;
-    }
-
-    if (m_downloader != nullptr)
-        m_downloader->deleteLater();
-
-    m_downloader = setupDownloader(QString(), m_core->value(scUrlQueryString));
-    if (!m_downloader) {
-        m_archivesToDownload.removeFirst();
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-        return;
-    }
 
-    emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-    connect(m_downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
-    connect(m_downloader, &FileDownloader::downloadCompleted,
-            this, &DownloadArchivesJob::registerFile, Qt::QueuedConnection);
-
-    m_downloader->download();
+    download->archiveDownloaded = true;
+    download->progress = 1;
+    if (download->hashDownloaded)
+        registerFile(download);
 }
 
 /*!
-    Emits the global download progress during a single download in a lazy way (uses a timer to reduce to
-    much processChanged).
+    Emits the global download progress during the downloads in a lazy way (uses a timer to reduce
+    too many progressChanged signals).
 */
 void DownloadArchivesJob::emitDownloadProgress(double progress)
 {
-    m_lastFileProgress = progress;
+    ArchiveDownload *download = archiveDownloadForSender();
+    if (!download)
+        return;
+
+    download->progress = progress;
     if (!m_progressChangedTimerId)
         m_progressChangedTimerId = startTimer(5);
 }
 
+/*!
+    Forwards the download status of the oldest running download only, so that concurrent
+    downloads do not override each other's status line.
+*/
+void DownloadArchivesJob::emitDownloadStatus(const QString &status)
+{
+    const ArchiveDownload *download = archiveDownloadForSender();
+    if (download && !m_activeDownloads.isEmpty() && m_activeDownloads.first() == download)
+        emit downloadStatusChanged(status);
+}
+
 /*!
     This is used to reduce the progressChanged signals.
 */
@@ -193,93 +275,191 @@ void DownloadArchivesJob::timerEvent(QTimerEvent *event)
     if (event->timerId() == m_progressChangedTimerId) {
         killTimer(m_progressChangedTimerId);
         m_progressChangedTimerId = 0;
-        emit progressChanged((double(m_archivesDownloaded) + m_lastFileProgress) / m_archivesToDownloadCount);
+        emit progressChanged(currentProgress());
     }
 }
 
 /*!
-    Registers the just downloaded file in the installer's file system.
+    Verifies the downloaded archive of \a download and registers it in the installer's file system.
 */
-void DownloadArchivesJob::registerFile()
+void DownloadArchivesJob::registerFile(ArchiveDownload *download)
 {
-    Q_ASSERT(m_downloader != nullptr);
-
     if (m_canceled)
         return;
 
-    if (m_core->testChecksum() && m_currentHash != m_downloader->sha1Sum().toHex()) {
+    if (m_core->testChecksum() && download->hash != download->downloader->sha1Sum().toHex()) {
         //TODO: Maybe we should try to download the file again automatically
-        const QMessageBox::Button res =
-            MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
+        download->hashMismatch = true;
+        askToRetryFailedDownload(download);
+        return;
+    }
+
+    ++m_archivesDownloaded;
+    const QString name = download->archive.first;
+    BinaryFormatEngineHandler::instance()->registerResource(name,
+        download->downloader->downloadedFileName());
+    m_downloadedArchives.insert(name);
+    releaseArchiveDownload(download);
+
+    if (m_progressChangedTimerId) {
+        killTimer(m_progressChangedTimerId);
+        m_progressChangedTimerId = 0;
+    }
+    emit progressChanged(currentProgress());
+    emit archiveDownloaded(name);
+
+    scheduleDownloads();
+}
+
+/*!
+    Asks whether to download the archive of the failed \a download again. As the other downloads
+    keep running while the message box is shown, only one is shown at a time: downloads failing
+    meanwhile are queued and get the same answer.
+*/
+void DownloadArchivesJob::askToRetryFailedDownload(ArchiveDownload *download)
+{
+    // Both the hash and the archive download can fail, ask only once.
+    if (m_failedDownloads.contains(download))
+        return;
+
+    m_failedDownloads.append(download);
+    if (m_askingToRetry)
+        return;
+
+    m_askingToRetry = true;
+    QMessageBox::StandardButton answer;
+    if (download->hashMismatch) {
+        answer = MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
             QLatin1String("DownloadError"), tr("Download Error"), tr("Hash verification while "
             "downloading failed. This is a temporary error, please retry."),
             QMessageBox::Retry | QMessageBox::Cancel, QMessageBox::Cancel);
+    } else {
+        answer = MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
+            QLatin1String("archiveDownloadError"), tr("Download Error"),
+            tr("Cannot download archive %1: %2").arg(download->archive.second, download->error),
+            QMessageBox::Retry | QMessageBox::Cancel);
+    }
+    m_askingToRetry = false;
 
-        // If run from command line instance, do not continue if hash verification failed.
-        // Same download is tried again and again causing infinite loop if hash not
-        // fixed to repositories.
-        if (res == QMessageBox::Cancel || m_core->isCommandLineInstance()) {
-            finishWithError(tr("Cannot verify Hash"));
-            return;
-        }
+    const QList<ArchiveDownload *> failedDownloads = m_failedDownloads;
+    m_failedDownloads.clear();
+    if (m_finished)
+        return;
+
+    // Do not retry when using command line instance, installer tries to download the same
+    // archive again and again causing infinite loop if it is not fixed in the repositories.
+    if (answer == QMessageBox::Retry && !m_core->isCommandLineInstance()) {
+        // Retried archives are prepended, keep them in the order they were queued in.
+        for (int i = failedDownloads.count() - 1; i >= 0; --i)
+            retryArchiveDownload(failedDownloads.at(i));
+    } else if (download->hashMismatch) {
+        finishWithError(tr("Cannot verify Hash"), download->downloader->url().toString());
     } else {
-        ++m_archivesDownloaded;
-        if (m_progressChangedTimerId) {
-            killTimer(m_progressChangedTimerId);
-            m_progressChangedTimerId = 0;
-            emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-        }
+        m_finished = true;
+        emitFinishedWithError(Job::Canceled, download->downloader->errorString());
+        releaseAllArchiveDownloads();
+    }
+}
 
-        const QPair<QString, QString> pair = m_archivesToDownload.takeFirst();
-        BinaryFormatEngineHandler::instance()->registerResource(pair.first,
-            m_downloader->downloadedFileName());
+/*!
+    Drops the current downloaders of \a download and queues its archive to be downloaded next.
+*/
+void DownloadArchivesJob::retryArchiveDownload(ArchiveDownload *download)
+{
+    m_archivesToDownload.prepend(download->archive);
+    releaseArchiveDownload(download);
+    QMetaObject::invokeMethod(this, "scheduleDownloads", Qt::QueuedConnection);
+}
+
+void DownloadArchivesJob::releaseArchiveDownload(ArchiveDownload *download)
+{
+    foreach (FileDownloader *downloader, QList<FileDownloader *>() << download->hashDownloader
+            << download->downloader) {
+        if (!downloader)
+            continue;
+        m_downloaderToArchive.remove(downloader);
+        disconnect(downloader, nullptr, this, nullptr);
+        if (!downloader->isDownloaded())
+            downloader->cancelDownload();
+        downloader->deleteLater();
+    }
+
+    m_failedDownloads.removeOne(download);
+    if (m_activeDownloads.removeOne(download)) {
+        if (--m_activeDownloadsPerHost[download->host] <= 0)
+            m_activeDownloadsPerHost.remove(download->host);
     }
-    fetchNextArchiveHash();
+    delete download;
+}
+
+void DownloadArchivesJob::releaseAllArchiveDownloads()
+{
+    while (!m_activeDownloads.isEmpty())
+        releaseArchiveDownload(m_activeDownloads.first());
 }
 
 void DownloadArchivesJob::downloadCanceled()
 {
-    emitFinishedWithError(Job::Canceled, m_downloader->errorString());
+    if (m_finished)
+        return;
+
+    const FileDownloader *const dl = qobject_cast<const FileDownloader*> (sender());
+    m_finished = true;
+    emitFinishedWithError(Job::Canceled, dl ? dl->errorString() : tr("Canceled"));
+    releaseAllArchiveDownloads();
 }
 
 void DownloadArchivesJob::downloadFailed(const QString &error)
 {
-    if (m_canceled)
+    if (m_canceled || m_finished)
+        return;
+
+    ArchiveDownload *download = archiveDownloadForSender();
+    if (!download)
         return;
 
-    const QMessageBox::StandardButton b =
-        MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
-        QLatin1String("archiveDownloadError"), tr("Download Error"), tr("Cannot download archive %1: %2")
-        .arg(m_archivesToDownload.first().second, error), QMessageBox::Retry | QMessageBox::Cancel);
-
-    // Do not call fetchNextArchiveHash when using command line instance,
-    // installer tries to download the same archive causing infinite loop
-    if (b == QMessageBox::Retry && !m_core->isCommandLineInstance())
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-    else
-        downloadCanceled();
+    download->error = error;
+    askToRetryFailedDownload(download);
 }
 
-void DownloadArchivesJob::finishWithError(const QString &error)
+void DownloadArchivesJob::finishWithError(const QString &error, const QString &url)
 {
-    const FileDownloader *const dl = qobject_cast<const FileDownloader*> (sender());
+    if (m_finished)
+        return;
+
+    m_finished = true;
     const QString msg = tr("Cannot fetch archives: %1\nError while loading %2");
-    if (dl != nullptr)
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, dl->url().toString()));
-    else
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, m_downloader->url().toString()));
+    emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, url));
+    releaseAllArchiveDownloads();
+}
+
+DownloadArchivesJob::ArchiveDownload *DownloadArchivesJob::archiveDownloadForSender() const
+{
+    return m_downloaderToArchive.value(qobject_cast<FileDownloader *>(sender()));
+}
+
+double DownloadArchivesJob::currentProgress() const
+{
+    if (m_archivesToDownloadCount == 0)
+        return 1;
+
+    double progress = m_archivesDownloaded;
+    foreach (const ArchiveDownload *download, m_activeDownloads)
+        progress += download->progress;
+    return progress / m_archivesToDownloadCount;
 }
 
-KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &suffix, const QString &queryString)
+KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QPair<QString, QString> &archive,
+    const QString &suffix, const QString &queryString)
 {
     KDUpdater::FileDownloader *downloader = nullptr;
-    const QFileInfo fi = QFileInfo(m_archivesToDownload.first().first);
+    const QFileInfo fi = QFileInfo(archive.first);
     const Component *const component = m_core->componentByName(PackageManagerCore::checkableName(QFileInfo(fi.path()).fileName()));
     if (component) {
         QString fullQueryString;
         if (!queryString.isEmpty())
             fullQueryString = QLatin1String("?") + queryString;
-        const QUrl url(m_archivesToDownload.first().second + suffix + fullQueryString);
+        const QUrl url(archive.second + suffix + fullQueryString);
         const QString &scheme = url.scheme();
         downloader = FileDownloaderFactory::instance().create(scheme, this);
 
@@ -295,7 +475,7 @@ KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &s
             connect(downloader, &FileDownloader::downloadCanceled, this, &DownloadArchivesJob::downloadCanceled);
             connect(downloader, &FileDownloader::downloadAborted, this, &DownloadArchivesJob::downloadFailed,
                 Qt::QueuedConnection);
-            connect(downloader, &FileDownloader::downloadStatus, this, &DownloadArchivesJob::downloadStatusChanged);
+            connect(downloader, &FileDownloader::downloadStatus, this, &DownloadArchivesJob::emitDownloadStatus);
 
             if (FileDownloaderFactory::isSupportedScheme(scheme)) {
                 downloader->setDownloadedFileName(component->localTempPath() + QLatin1Char('/')
@@ -31,7 +31,9 @@
 
 #include "job.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QPair>
+#include <QtCore/QSet>
 
 QT_BEGIN_NAMESPACE
 class QTimerEvent;
@@ -55,12 +57,20 @@ public:
     ~DownloadArchivesJob();
 
     int numberOfDownloads() const { return m_archivesDownloaded; }
+    bool isArchiveDownloaded(const QString &name) const { return m_downloadedArchives.contains(name); }
+    bool isFinished() const { return m_finished; }
     void setArchivesToDownload(const QList<QPair<QString, QString> > &archives);
 
+    int maxConcurrentDownloads() const { return m_maxConcurrentDownloads; }
+    void setMaxConcurrentDownloads(int count);
+    int maxConcurrentDownloadsPerHost() const { return m_maxConcurrentDownloadsPerHost; }
+    void setMaxConcurrentDownloadsPerHost(int count);
+
 Q_SIGNALS:
     void progressChanged(double progress);
     void outputTextChanged(const QString &progress);
     void downloadStatusChanged(const QString &status);
+    void archiveDownloaded(const QString &name);
 
 protected:
     void doStart();
@@ -68,29 +78,60 @@ protected:
     void timerEvent(QTimerEvent *event);
 
 protected Q_SLOTS:
-    void registerFile();
+    void scheduleDownloads();
+    void finishedHashDownload();
+    void finishedArchiveDownload();
     void downloadCanceled();
     void downloadFailed(const QString &error);
-    void finishWithError(const QString &error);
-    void fetchNextArchive();
-    void fetchNextArchiveHash();
-    void finishedHashDownload();
     void emitDownloadProgress(double progress);
+    void emitDownloadStatus(const QString &status);
 
 private:
-    KDUpdater::FileDownloader *setupDownloader(const QString &suffix = QString(), const QString &queryString = QString());
+    struct ArchiveDownload
+    {
+        QPair<QString, QString> archive;
+        QString host;
+        KDUpdater::FileDownloader *hashDownloader = nullptr;
+        KDUpdater::FileDownloader *downloader = nullptr;
+        QByteArray hash;
+        QString error;
+        bool hashMismatch = false;
+        bool hashDownloaded = false;
+        bool archiveDownloaded = false;
+        double progress = 0;
+    };
+
+    void startArchiveDownload(const QPair<QString, QString> &archive);
+    void registerFile(ArchiveDownload *download);
+    void askToRetryFailedDownload(ArchiveDownload *download);
+    void retryArchiveDownload(ArchiveDownload *download);
+    void releaseArchiveDownload(ArchiveDownload *download);
+    void releaseAllArchiveDownloads();
+    void finishWithError(const QString &error, const QString &url);
+    ArchiveDownload *archiveDownloadForSender() const;
+    double currentProgress() const;
+
+    KDUpdater::FileDownloader *setupDownloader(const QPair<QString, QString> &archive,
+        const QString &suffix = QString(), const QString &queryString = QString());
 
 private:
     PackageManagerCore *m_core;
-    KDUpdater::FileDownloader *m_downloader;
 
     int m_archivesDownloaded;
     int m_archivesToDownloadCount;
     QList<QPair<QString, QString> > m_archivesToDownload;
+    QSet<QString> m_downloadedArchives;
+
+    int m_maxConcurrentDownloads;
+    int m_maxConcurrentDownloadsPerHost;
+    QList<ArchiveDownload *> m_activeDownloads;
+    QHash<KDUpdater::FileDownloader *, ArchiveDownload *> m_downloaderToArchive;
+    QHash<QString, int> m_activeDownloadsPerHost;
+    QList<ArchiveDownload *> m_failedDownloads;
 
     bool m_canceled;
-    QByteArray m_currentHash;
-    double m_lastFileProgress;
+    bool m_finished;
+    bool m_askingToRetry;
     int m_progressChangedTimerId;
 };
 
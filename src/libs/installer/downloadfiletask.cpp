@@ -41,6 +41,21 @@
 
 namespace QInstaller {
 
+// QNetworkAccessManager opens six connections per host, more requests to one host just queue.
+static const int scDefaultMaxConcurrentDownloads = 16;
+static const int scDefaultMaxConcurrentDownloadsPerHost = 6;
+
+static int positiveEnvironmentValue(const char *name, int defaultValue)
+{
+    const QByteArray value = qgetenv(name);
+    if (!value.isEmpty()) {
+        const int number = QString::fromLocal8Bit(value).toInt();
+        if (number > 0)
+            return number;
+    }
+    return defaultValue;
+}
+
 AuthenticationRequiredException::AuthenticationRequiredException(Type type, const QString &message)
     : TaskException(message)
     , m_type(type)
@@ -49,6 +64,8 @@ AuthenticationRequiredException::AuthenticationRequiredException(Type type, cons
 
 Downloader::Downloader()
     : m_finished(0)
+    , m_maxConcurrentDownloads(scDefaultMaxConcurrentDownloads)
+    , m_maxConcurrentDownloadsPerHost(scDefaultMaxConcurrentDownloadsPerHost)
 {
     connect(&m_timer, &QTimer::timeout, this, &Downloader::onTimeout);
     connect(&m_nam, &QNetworkAccessManager::finished, this, &Downloader::onFinished);
@@ -81,16 +98,26 @@ void Downloader::download(QFutureInterface<FileTaskResult> &fi, const QList<File
     QTimer::singleShot(0, this, &Downloader::doDownload);
 }
 
+void Downloader::setMaxConcurrentDownloads(int count, int countPerHost)
+{
+    m_maxConcurrentDownloads = qMax(1, count);
+    m_maxConcurrentDownloadsPerHost = qMax(1, countPerHost);
+}
+
 void Downloader::doDownload()
 {
     m_timer.start(1000); // Use a timer to check for canceled downloads.
 
     foreach (const FileTaskItem &item, m_items) {
-        if (!startDownload(item))
-            break;
+        const QString host = QUrl(item.source()).host();
+        QList<FileTaskItem> &pending = m_pendingPerHost[host];
+        if (pending.isEmpty())
+            m_pendingHosts.append(host);
+        pending.append(item);
     }
+    scheduleDownloads();
 
-    if (m_items.isEmpty() || m_futureInterface->isCanceled()) {
+    if (m_downloads.empty() || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
         emit finished();    // emit finished, so the event loop can shutdown
     }
@@ -206,9 +233,7 @@ void Downloader::onFinished(QNetworkReply *reply)
                     m_redirects.insertMulti(redirectReply, redirect);
                 m_redirects.insertMulti(redirectReply, url);
 
-                m_downloads.erase(reply);
-                m_redirects.remove(reply);
-                reply->deleteLater();
+                removeDownload(reply);
                 return;
             } else {
                 m_futureInterface->reportException(TaskException(tr("Redirect loop detected for \"%1\".")
@@ -231,14 +256,21 @@ void Downloader::onFinished(QNetworkReply *reply)
         if (expectedCheckSum != data.observer->checkSum().toHex())
             checksumMismatch = true;
     }
-    m_futureInterface->reportResult(FileTaskResult(filename, data.observer->checkSum(), data.taskItem,
-                                                  checksumMismatch));
+    FileTaskResult result(filename, data.observer->checkSum(), data.taskItem, checksumMismatch);
+    if (reply->hasRawHeader("ETag"))
+        result.insert(TaskRole::ETag, reply->rawHeader("ETag"));
+    if (reply->hasRawHeader("Last-Modified"))
+        result.insert(TaskRole::LastModified, reply->rawHeader("Last-Modified"));
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
+        result.insert(TaskRole::NotModified, true);
+    m_futureInterface->reportResult(result);
 
-    m_downloads.erase(reply);
-    m_redirects.remove(reply);
-    reply->deleteLater();
+    removeDownload(reply);
 
     m_finished++;
+    if (!m_futureInterface->isCanceled())
+        scheduleDownloads();    // refill the window
+
     if (m_downloads.empty() || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
         emit finished();    // emit finished, so the event loop can shutdown
@@ -362,6 +394,40 @@ bool Downloader::testCanceled()
     return m_futureInterface->isCanceled();
 }
 
+/*
+    Starts pending downloads until the window of concurrent downloads is full. Free slots are
+    handed out round-robin over the hosts that still have files pending and are below their
+    own limit, so that one slow server does not hold back the files of the others.
+*/
+void Downloader::scheduleDownloads()
+{
+    bool started = true;
+    while (started && int(m_downloads.size()) < m_maxConcurrentDownloads) {
+        started = false;
+        int i = 0;
+        while (i < m_pendingHosts.count() && int(m_downloads.size()) < m_maxConcurrentDownloads) {
+            const QString host = m_pendingHosts.at(i);
+            if (m_activeDownloadsPerHost.value(host) >= m_maxConcurrentDownloadsPerHost) {
+                ++i;
+                continue;
+            }
+
+            QList<FileTaskItem> &pending = m_pendingPerHost[host];
+            const FileTaskItem item = pending.takeFirst();
+            if (pending.isEmpty()) {
+                m_pendingPerHost.remove(host);
+                m_pendingHosts.removeAt(i);
+            } else {
+                ++i;
+            }
+
+            if (!startDownload(item))
+                return;
+            started = true;
+        }
+    }
+}
+
 QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
 {
     QUrl const source = item.source();
@@ -372,8 +438,22 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
         return 0;
     }
 
-    QNetworkReply *reply = m_nam.get(QNetworkRequest(source));
+    QNetworkRequest request(source);
+    const QVariant eTag = item.value(TaskRole::ETag);
+    const QVariant lastModified = item.value(TaskRole::LastModified);
+    if (eTag.isValid() || lastModified.isValid()) {
+        // The caller keeps its own copy, make intermediate caches revalidate with the server.
+        request.setRawHeader("Cache-Control", "no-cache");
+        if (!eTag.toByteArray().isEmpty())
+            request.setRawHeader("If-None-Match", eTag.toByteArray());
+        if (!lastModified.toByteArray().isEmpty())
+            request.setRawHeader("If-Modified-Since", lastModified.toByteArray());
+    }
+
+    QNetworkReply *reply = m_nam.get(request);
     std::unique_ptr<Data> data(new Data(item));
+    data->host = source.host();
+    ++m_activeDownloadsPerHost[data->host];
     m_downloads[reply] = std::move(data);
 
     connect(reply, &QIODevice::readyRead, this, &Downloader::onReadyRead);
@@ -386,15 +466,65 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
     return reply;
 }
 
+void Downloader::removeDownload(QNetworkReply *reply)
+{
+    const QString host = m_downloads[reply]->host;
+    if (--m_activeDownloadsPerHost[host] <= 0)
+        m_activeDownloadsPerHost.remove(host);
+
+    m_downloads.erase(reply);
+    m_redirects.remove(reply);
+    reply->deleteLater();
+}
+
 
 // -- DownloadFileTask
 
-DownloadFileTask::DownloadFileTask(const QList<FileTaskItem> &items)
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::DownloadFileTask
+    \brief The DownloadFileTask class downloads a list of files.
+
+    Files are downloaded through a sliding window: up to maxConcurrentDownloads() requests are
+    in flight, with at most maxConcurrentDownloadsPerHost() of them to the same host, and a new
+    one is started as soon as one completes. The limits can be preset with the
+    \c IFW_MAX_CONCURRENT_DOWNLOADS and \c IFW_MAX_CONCURRENT_DOWNLOADS_PER_HOST environment
+    variables.
+*/
+
+DownloadFileTask::DownloadFileTask()
     : AbstractFileTask()
+    , m_maxConcurrentDownloads(positiveEnvironmentValue("IFW_MAX_CONCURRENT_DOWNLOADS",
+        scDefaultMaxConcurrentDownloads))
+    , m_maxConcurrentDownloadsPerHost(positiveEnvironmentValue(
+        "IFW_MAX_CONCURRENT_DOWNLOADS_PER_HOST", scDefaultMaxConcurrentDownloadsPerHost))
+{
+}
+
+DownloadFileTask::DownloadFileTask(const FileTaskItem &item)
+    : DownloadFileTask()
+{
+    setTaskItem(item);
+}
+
+DownloadFileTask::DownloadFileTask(const QList<FileTaskItem> &items)
+    : DownloadFileTask()
 {
     setTaskItems(items);
 }
 
+DownloadFileTask::DownloadFileTask(const QString &source)
+    : DownloadFileTask()
+{
+    setTaskItem(FileTaskItem(source));
+}
+
+DownloadFileTask::DownloadFileTask(const QString &source, const QString &target)
+    : DownloadFileTask()
+{
+    setTaskItem(FileTaskItem(source, target));
+}
+
 void DownloadFileTask::setTaskItem(const FileTaskItem &item)
 {
     AbstractFileTask::setTaskItem(item);
@@ -425,6 +555,22 @@ void DownloadFileTask::setProxyFactory(KDUpdater::FileDownloaderProxyFactory *fa
     m_proxyFactory.reset(factory);
 }
 
+/*!
+    Sets the maximum number of files downloaded at the same time to \a count.
+*/
+void DownloadFileTask::setMaxConcurrentDownloads(int count)
+{
+    m_maxConcurrentDownloads = qMax(1, count);
+}
+
+/*!
+    Sets the maximum number of files downloaded at the same time from a single host to \a count.
+*/
+void DownloadFileTask::setMaxConcurrentDownloadsPerHost(int count)
+{
+    m_maxConcurrentDownloadsPerHost = qMax(1, count);
+}
+
 void DownloadFileTask::doTask(QFutureInterface<FileTaskResult> &fi)
 {
     QEventLoop el;
@@ -438,6 +584,7 @@ void DownloadFileTask::doTask(QFutureInterface<FileTaskResult> &fi)
                 items[i].insert(TaskRole::Authenticator, QVariant::fromValue(m_authenticator));
         }
     }
+    downloader.setMaxConcurrentDownloads(m_maxConcurrentDownloads, m_maxConcurrentDownloadsPerHost);
     downloader.download(fi, items, (m_proxyFactory.isNull() ? 0 : m_proxyFactory->clone()));
     el.exec();  // That's tricky here, we need to run our own event loop to keep QNAM working.
 }
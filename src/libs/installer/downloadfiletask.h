@@ -40,7 +40,10 @@ namespace QInstaller {
 namespace TaskRole {
 enum
 {
-    Authenticator = TaskRole::TargetFile + 10
+    Authenticator = TaskRole::TargetFile + 10,
+    ETag,
+    LastModified,
+    NotModified
 };
 }
 
@@ -79,15 +82,12 @@ class INSTALLER_EXPORT DownloadFileTask : public AbstractFileTask
     Q_DISABLE_COPY(DownloadFileTask)
 
 public:
-    DownloadFileTask() {}
-    explicit DownloadFileTask(const FileTaskItem &item)
-        : AbstractFileTask(item) {}
+    DownloadFileTask();
+    explicit DownloadFileTask(const FileTaskItem &item);
     explicit DownloadFileTask(const QList<FileTaskItem> &items);
 
-    explicit DownloadFileTask(const QString &source)
-        : AbstractFileTask(source) {}
-    DownloadFileTask(const QString &source, const QString &target)
-        : AbstractFileTask(source, target) {}
+    explicit DownloadFileTask(const QString &source);
+    DownloadFileTask(const QString &source, const QString &target);
 
     void addTaskItem(const FileTaskItem &items);
     void addTaskItems(const QList<FileTaskItem> &items);
@@ -98,12 +98,19 @@ public:
     void setAuthenticator(const QAuthenticator &authenticator);
     void setProxyFactory(KDUpdater::FileDownloaderProxyFactory *factory);
 
+    int maxConcurrentDownloads() const { return m_maxConcurrentDownloads; }
+    void setMaxConcurrentDownloads(int count);
+    int maxConcurrentDownloadsPerHost() const { return m_maxConcurrentDownloadsPerHost; }
+    void setMaxConcurrentDownloadsPerHost(int count);
+
     void doTask(QFutureInterface<FileTaskResult> &fi);
 
 private:
     friend class Downloader;
     QAuthenticator m_authenticator;
     QScopedPointer<KDUpdater::FileDownloaderProxyFactory> m_proxyFactory;
+    int m_maxConcurrentDownloads;
+    int m_maxConcurrentDownloadsPerHost;
 };
 
 }   // namespace QInstaller
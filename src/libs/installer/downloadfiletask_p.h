@@ -63,6 +63,7 @@ struct Data
     {}
 
     FileTaskItem taskItem;
+    QString host;
     std::unique_ptr<QFile> file;
     std::unique_ptr<FileTaskObserver> observer;
 };
@@ -79,6 +80,8 @@ public:
     void download(QFutureInterface<FileTaskResult> &fi, const QList<FileTaskItem> &items,
         QNetworkProxyFactory *networkProxyFactory);
 
+    void setMaxConcurrentDownloads(int count, int countPerHost);
+
 signals:
     void finished();
 
@@ -95,7 +98,9 @@ private slots:
 
 private:
     bool testCanceled();
+    void scheduleDownloads();
     QNetworkReply *startDownload(const FileTaskItem &item);
+    void removeDownload(QNetworkReply *reply);
 
 private:
     QFutureInterface<FileTaskResult> *m_futureInterface;
@@ -104,6 +109,11 @@ private:
     int m_finished;
     QNetworkAccessManager m_nam;
     QList<FileTaskItem> m_items;
+    int m_maxConcurrentDownloads;
+    int m_maxConcurrentDownloadsPerHost;
+    QStringList m_pendingHosts;
+    QHash<QString, QList<FileTaskItem>> m_pendingPerHost;
+    QHash<QString, int> m_activeDownloadsPerHost;
     QMultiHash<QNetworkReply*, QUrl> m_redirects;
     std::unordered_map<QNetworkReply*, std::unique_ptr<Data>> m_downloads;
 };
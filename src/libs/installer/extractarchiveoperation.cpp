@@ -34,10 +34,50 @@
 #include <QEventLoop>
 #include <QThreadPool>
 #include <QFileInfo>
-#include <QDataStream>
+#include <QtConcurrentRun>
+
+#include <algorithm>
 
 namespace QInstaller {
 
+Q_GLOBAL_STATIC(QThreadPool, extractionThreadPool)
+
+/*
+    Returns the pool that writes the extracted files of all archives while they are decoded, or
+    a null pointer to write them on the decoding threads. Writing behind is opt-in, the
+    IFW_WRITE_BEHIND environment variable holds the number of writer threads, \c 0 turns it off
+    again. A non-numeric value uses two of them. All extractions share the threads and the limit
+    for data waiting to be written.
+*/
+QSharedPointer<Lib7z::WriteBehindPool> extractionWriteBehindPool()
+{
+    static const QSharedPointer<Lib7z::WriteBehindPool> pool = []() {
+        if (qEnvironmentVariableIsEmpty("IFW_WRITE_BEHIND"))
+            return QSharedPointer<Lib7z::WriteBehindPool>();
+        bool ok = false;
+        const int count = qEnvironmentVariableIntValue("IFW_WRITE_BEHIND", &ok);
+        if (ok && count <= 0)
+            return QSharedPointer<Lib7z::WriteBehindPool>();
+        return Lib7z::createWriteBehindPool(ok ? count : 2);
+    }();
+    return pool;
+}
+
+static QString normalizedPath(const QString &path)
+{
+    const QString cleanPath = QDir::cleanPath(path);
+#ifdef Q_OS_WIN
+    return cleanPath.toLower();
+#else
+    return cleanPath;
+#endif
+}
+
+static QString itemPath(const QString &targetDir, const Lib7z::File &file)
+{
+    return QFileInfo(targetDir + QLatin1Char('/') + file.path).absoluteFilePath();
+}
+
 ExtractArchiveOperation::ExtractArchiveOperation(PackageManagerCore *core)
     : UpdateOperation(core)
 {
@@ -58,45 +98,69 @@ bool ExtractArchiveOperation::performOperation()
     const QString archivePath = args.at(0);
     const QString targetDir = args.at(1);
 
-    Receiver receiver;
-    Callback callback;
-
-    connect(&callback, &Callback::progressChanged, this, &ExtractArchiveOperation::progressChanged);
+    QFileInfo fileInfo(archivePath);
+    emit outputTextChanged(tr("Extracting \"%1\"").arg(fileInfo.fileName()));
 
-    if (PackageManagerCore *core = packageManager()) {
-        connect(core, &PackageManagerCore::statusChanged, &callback, &Callback::statusChanged);
-    }
+    bool success = false;
+    QString errorString;
+    ExtractedFilesManifest files;
+    BackupFiles backupFiles;
 
-    Runnable *runnable = new Runnable(archivePath, targetDir, &callback);
-    connect(runnable, &Runnable::finished, &receiver, &Receiver::runnableFinished,
-        Qt::QueuedConnection);
+    // a retry extracts the archive again by itself
+    const QSharedPointer<Extraction> extraction = m_extraction;
+    m_extraction.clear();
 
-    QFileInfo fileInfo(archivePath);
-    emit outputTextChanged(tr("Extracting \"%1\"").arg(fileInfo.fileName()));
+    if (extraction) {
+        extraction->startReporting();
+        extraction->waitForFinished();
 
-    QEventLoop loop;
-    connect(&receiver, &Receiver::finished, &loop, &QEventLoop::quit);
-    if (QThreadPool::globalInstance()->tryStart(runnable)) {
-        loop.exec();
+        success = extraction->success();
+        errorString = extraction->errorString();
+        files = extraction->extractedFiles();
+        backupFiles = extraction->backupFiles();
     } else {
-        // HACK: In case there is no availabe thread we should call it directly.
-        runnable->run();
-        receiver.runnableFinished(true, QString());
+        Receiver receiver;
+        Callback callback(targetDir);
+
+        connect(&callback, &Callback::progressChanged, this,
+            &ExtractArchiveOperation::progressChanged);
+
+        if (PackageManagerCore *core = packageManager()) {
+            connect(core, &PackageManagerCore::statusChanged, &callback, &Callback::statusChanged);
+        }
+
+        Runnable *runnable = new Runnable(archivePath, targetDir, &callback);
+        connect(runnable, &Runnable::finished, &receiver, &Receiver::runnableFinished,
+            Qt::QueuedConnection);
+
+        QEventLoop loop;
+        connect(&receiver, &Receiver::finished, &loop, &QEventLoop::quit);
+        if (QThreadPool::globalInstance()->tryStart(runnable)) {
+            loop.exec();
+        } else {
+            // HACK: In case there is no availabe thread we should call it directly.
+            runnable->run();
+            receiver.runnableFinished(true, QString());
+        }
+
+        success = receiver.success();
+        errorString = receiver.errorString();
+        files = callback.extractedFiles();
+        backupFiles = callback.backupFiles();
     }
 
     // Write all file names which belongs to a package to a separate file and only the separate
     // filename to a .dat file. There can be enormous amount of files in a package, which makes
     // the dat file very slow to read and write. The .dat file is read into memory in startup,
     // writing the file names to a separate file we don't need to load all the file names into
-    // memory as we need those only in uninstall. This will save a lot of memory.
+    // memory as we need those only in uninstall. This will save a lot of memory. The file names
+    // are written as a compact manifest, see ExtractedFilesManifest.
     // Parse a file and directorory structure using archivepath syntax
     // installer://<component_name>/<filename>.7z Resulting structure is:
     // -installerResources (dir)
     //   -<component_name> (dir)
     //    -<filename>.txt (file)
 
-    QStringList files = callback.extractedFiles();
-
     QString fileDirectory = targetDir + QLatin1String("/installerResources/") +
             archivePath.section(QLatin1Char('/'), 1, 1, QString::SectionSkipEmpty) + QLatin1Char('/');
     QString archiveFileName = archivePath.section(QLatin1Char('/'), 2, 2, QString::SectionSkipEmpty);
@@ -114,11 +178,10 @@ bool ExtractArchiveOperation::performOperation()
     QFile file(targetDirectoryInfo.absolutePath() + QLatin1Char('/') + fileName);
     if (file.open(QIODevice::WriteOnly)) {
         setDefaultFilePermissions(file.fileName(), DefaultFilePermissions::NonExecutable);
-        QDataStream out (&file);
-        for (int i = 0; i < files.count(); ++i) {
-            files[i] = replacePath(files.at(i), targetDir, QLatin1String(scRelocatable));
+        if (!files.write(&file)) {
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot write file" << file.fileName()
+                << ":" << file.errorString();
         }
-        out << files;
         setValue(QLatin1String("files"), file.fileName());
         file.close();
     } else {
@@ -128,12 +191,12 @@ bool ExtractArchiveOperation::performOperation()
     // TODO: Use backups for rollback, too? Doesn't work for uninstallation though.
 
     // delete all backups we can delete right now, remember the rest
-    foreach (const Backup &i, callback.backupFiles())
+    foreach (const Backup &i, backupFiles)
         deleteFileNowOrLater(i.second);
 
-    if (!receiver.success()) {
+    if (!success) {
         setError(UserDefinedError);
-        setErrorString(receiver.errorString());
+        setErrorString(errorString);
         return false;
     }
     return true;
@@ -145,23 +208,33 @@ bool ExtractArchiveOperation::undoOperation()
 
     // For backward compatibility, check if "files" can be converted to QStringList.
     // If yes, files are listed in .dat instead of in a separate file.
-    bool useStringListType(value(QLatin1String("files")).type() == QVariant::StringList);
+    if (value(QLatin1String("files")).type() == QVariant::StringList) {
+        ExtractedFilesManifest manifest;
+        foreach (const QString &file, value(QLatin1String("files")).toStringList())
+            manifest.append(file);
+        ExtractedFilesManifestReader reader(manifest);
+        startUndoProcess(&reader);
+        return true;
+    }
+
+    // The files are read while they get removed, instead of loading all of them upfront.
     QString targetDir = arguments().at(1);
-    QStringList files;
-    if (useStringListType) {
-        files = value(QLatin1String("files")).toStringList();
-    } else {
-        if (!readDataFileContents(targetDir, &files))
-            return false;
+    QFile file;
+    if (openDataFile(targetDir, &file)) {
+        ExtractedFilesManifestReader reader(&file, targetDir);
+        startUndoProcess(&reader);
+        if (reader.hasError()) {
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot read file" << file.fileName()
+                << ":" << reader.errorString();
+        }
+        file.close();
     }
-    startUndoProcess(files);
-    if (!useStringListType)
-        deleteDataFile(m_relocatedDataFileName);
+    deleteDataFile(m_relocatedDataFileName);
 
     return true;
 }
 
-void ExtractArchiveOperation::startUndoProcess(const QStringList &files)
+void ExtractArchiveOperation::startUndoProcess(ExtractedFilesManifestReader *files)
 {
     WorkerThread *const thread = new WorkerThread(this, files);
     connect(thread, &WorkerThread::currentFileChanged, this,
@@ -199,28 +272,429 @@ bool ExtractArchiveOperation::testOperation()
 }
 
 bool ExtractArchiveOperation::readDataFileContents(QString &targetDir, QStringList *resultList)
+{
+    resultList->clear();
+    QFile file;
+    if (openDataFile(targetDir, &file)) {
+        ExtractedFilesManifestReader reader(&file, targetDir);
+        QString path;
+        while (reader.readNext(&path))
+            resultList->append(path);
+        if (reader.hasError()) {
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot read file" << file.fileName()
+                << ":" << reader.errorString();
+        }
+    }
+    return true;
+}
+
+// Opens the file listing the extracted files, written by performOperation(). Adjusts \a targetDir
+// to the directory the listed paths are relative to.
+bool ExtractArchiveOperation::openDataFile(QString &targetDir, QFile *file)
 {
     const QString filePath = value(QLatin1String("files")).toString();
     // Does not change target on non macOS platforms.
     if (QInstaller::isInBundle(targetDir, &targetDir))
         targetDir = QDir::cleanPath(targetDir + QLatin1String("/.."));
     m_relocatedDataFileName = replacePath(filePath, QLatin1String(scRelocatable), targetDir);
-    QFile file(m_relocatedDataFileName);
+    file->setFileName(m_relocatedDataFileName);
 
-    if (file.open(QIODevice::ReadOnly)) {
-        QDataStream in(&file);
-        in >> *resultList;
-        for (int i = 0; i < resultList->count(); ++i)
-            resultList->replace(i, replacePath(resultList->at(i),  QLatin1String(scRelocatable), targetDir));
+    if (file->open(QIODevice::ReadOnly))
+        return true;
 
-    } else {
-        // We should not be here. Either user has manually deleted the installer related
-        // files or same component is installed several times.
-        qCWarning(QInstaller::lcGeneral) << "Cannot open file " << file.fileName() << " for reading:"
-                << file.errorString() << ". Component is already uninstalled "
-                << "or file is manually deleted.";
+    // We should not be here. Either user has manually deleted the installer related
+    // files or same component is installed several times.
+    qCWarning(QInstaller::lcGeneral) << "Cannot open file " << file->fileName() << " for reading:"
+            << file->errorString() << ". Component is already uninstalled "
+            << "or file is manually deleted.";
+    return false;
+}
+
+
+/*
+    Extracts the archives of \a extractions on \a pool. The archives, and the independent solid
+    blocks inside each of them, are extracted in parallel. As that only works if the result does
+    not depend on the order of extraction, the archives are extracted one after the other instead
+    if any of them cannot be listed or if two of them contain the same file.
+*/
+void ExtractArchiveOperation::Extraction::extract(
+    const QList<QSharedPointer<Extraction> > &extractions, PackageManagerCore *core,
+    QThreadPool *pool)
+{
+    QVector<QVector<Lib7z::File> > listings;
+    QHash<QString, int> owners;
+    bool parallel = true;
+    for (int i = 0; parallel && i < extractions.count(); ++i) {
+        const QSharedPointer<Extraction> &extraction = extractions.at(i);
+        QFile archive(extraction->m_archivePath);
+        if (!archive.open(QIODevice::ReadOnly)) {
+            parallel = false;
+            break;
+        }
+        try {
+            listings.append(Lib7z::listArchive(&archive));
+        } catch (...) {
+            parallel = false; // the extraction itself reports the error
+            break;
+        }
+
+        foreach (const Lib7z::File &file, listings.last()) {
+            if (file.isDirectory)
+                continue;
+            const QString path = normalizedPath(itemPath(extraction->m_targetDir, file));
+            if (owners.value(path, i) != i) {
+                parallel = false;
+                break;
+            }
+            owners.insert(path, i);
+        }
     }
-    return true;
+
+    if (!parallel) {
+        foreach (const QSharedPointer<Extraction> &extraction, extractions) {
+            extraction->m_parts.resize(1);
+            extraction->start(core, nullptr);
+        }
+        return;
+    }
+
+    // No two archives write the same file, so the directories created are empty for all of them.
+    QSet<QString> existing;
+    QSet<QString> created;
+    for (int i = 0; i < extractions.count(); ++i) {
+        extractions.at(i)->createDirectories(listings.at(i), &existing, &created);
+        extractions.at(i)->splitIntoParts(listings.at(i), pool->maxThreadCount());
+    }
+    foreach (const QSharedPointer<Extraction> &extraction, extractions)
+        extraction->start(core, pool, created);
+}
+
+/*
+    Creates the directories the items of \a files get extracted to and remembers the ones that did
+    not exist, like Lib7z does while extracting. Doing it upfront and in the order of the archives
+    makes sure a directory always belongs to the same archive, no matter which of the archives
+    extracted in parallel gets there first. \a existing caches the directories known to exist,
+    \a created collects the directories created.
+*/
+void ExtractArchiveOperation::Extraction::createDirectories(const QVector<Lib7z::File> &files,
+    QSet<QString> *existing, QSet<QString> *created)
+{
+    // Lib7z creates the parent of the target directory without remembering it
+    QDir().mkpath(QFileInfo(m_targetDir).absolutePath());
+
+    // directory items are remembered when they get extracted
+    QSet<QString> directoryItems;
+    foreach (const Lib7z::File &file, files) {
+        if (file.isDirectory)
+            directoryItems.insert(itemPath(m_targetDir, file));
+    }
+
+    foreach (const Lib7z::File &file, files) {
+        const QString path = itemPath(m_targetDir, file);
+        QString directory = file.isDirectory ? path : QFileInfo(path).absolutePath();
+
+        QStringList toCreate;
+        while (!existing->contains(directory)) {
+            existing->insert(directory);
+            if (QFileInfo(directory).isDir())
+                break;
+            toCreate.prepend(directory);
+            const QString parent = QFileInfo(directory).absolutePath();
+            if (parent == directory)
+                break;
+            directory = parent;
+        }
+        if (toCreate.isEmpty())
+            continue;
+
+        QDir().mkpath(toCreate.last());
+        foreach (const QString &directory, toCreate) {
+            created->insert(directory);
+            if (!directoryItems.contains(directory))
+                m_extractedFiles.append(directory);
+        }
+    }
+}
+
+/*
+    Splits the items of \a files into at most \a maxParts parts to extract in parallel. The items
+    of a solid block stay together, so that every block still gets decoded only once, and the
+    blocks are spread over the parts by their uncompressed size.
+*/
+void ExtractArchiveOperation::Extraction::splitIntoParts(const QVector<Lib7z::File> &files,
+    int maxParts)
+{
+    QMap<int, QVector<quint32> > blocks;
+    QMap<int, quint64> blockSizes;
+    QSet<QString> paths;
+    foreach (const Lib7z::File &file, files) {
+        // items of nested archives and items overwriting each other need the whole archive
+        const QString path = normalizedPath(file.path);
+        if (file.archiveIndex.x() != 0 || paths.contains(path)) {
+            blocks.clear();
+            break;
+        }
+        paths.insert(path);
+        blocks[file.block].append(quint32(file.archiveIndex.y()));
+        blockSizes[file.block] += file.uncompressedSize;
+    }
+
+    const int partCount = qMin(blocks.count(), maxParts);
+    if (partCount <= 1) {
+        m_parts.resize(1);
+        return;
+    }
+
+    QList<int> ordered = blocks.keys();
+    std::stable_sort(ordered.begin(), ordered.end(), [&blockSizes](int lhs, int rhs) {
+        return blockSizes.value(lhs) > blockSizes.value(rhs);
+    });
+
+    m_parts.resize(partCount);
+    QVector<quint64> partSizes(partCount, 0);
+    foreach (int block, ordered) {
+        const int part = std::min_element(partSizes.constBegin(), partSizes.constEnd())
+            - partSizes.constBegin();
+        partSizes[part] += blockSizes.value(block);
+        m_parts[part].items += blocks.value(block);
+    }
+    for (int i = 0; i < m_parts.count(); ++i)
+        std::sort(m_parts[i].items.begin(), m_parts[i].items.end());
+}
+
+/*
+    Starts extracting the parts on \a pool, or extracts them one after the other if there is
+    no pool. \a emptyDirectories are passed on to the callbacks, see
+    Lib7z::ExtractCallback::setEmptyDirectories().
+*/
+void ExtractArchiveOperation::Extraction::start(PackageManagerCore *core, QThreadPool *pool,
+    const QSet<QString> &emptyDirectories)
+{
+    m_runningParts = m_parts.count();
+    for (int i = 0; i < m_parts.count(); ++i) {
+        Part &part = m_parts[i];
+        part.callback.reset(new Callback(m_targetDir, core));
+        part.callback->setEmptyDirectories(emptyDirectories);
+        QObject::connect(part.callback.data(), &Callback::progressChanged, [this, i](double value) {
+            setPartProgress(i, value);
+        });
+
+        Runnable *runnable = new Runnable(m_archivePath, m_targetDir, part.callback.data(),
+            part.items);
+        QObject::connect(runnable, &Runnable::finished, [this, i](bool ok, const QString &msg) {
+            partFinished(i, ok, msg);
+        });
+
+        if (pool) {
+            pool->start(runnable);
+        } else {
+            runnable->run();
+            delete runnable;
+        }
+    }
+}
+
+void ExtractArchiveOperation::Extraction::partFinished(int index, bool success,
+    const QString &errorString)
+{
+    QMutexLocker _(&m_mutex);
+    m_parts[index].success = success;
+    m_parts[index].errorString = errorString;
+    if (--m_runningParts > 0)
+        return;
+
+    // Undo removes directories after their files, so the files of the parts simply follow the
+    // directories created upfront. Keeping the order of the parts writes the same manifest for
+    // the same archive.
+    foreach (const Part &part, m_parts)
+        m_extractedFiles.append(part.callback->extractedFiles());
+
+    m_success = true;
+    for (int i = 0; i < m_parts.count(); ++i) {
+        Part &part = m_parts[i];
+        m_backupFiles += part.callback->backupFiles();
+        if (m_success && !part.success) {
+            m_success = false;
+            m_errorString = part.errorString;
+        }
+        part.callback.clear();
+    }
+
+    m_finished = true;
+    m_finishedCondition.wakeAll();
+}
+
+void ExtractArchiveOperation::Extraction::setPartProgress(int index, double progress)
+{
+    QMutexLocker locker(&m_mutex);
+    m_parts[index].progress = progress;
+    if (!m_reporting)
+        return;
+    const double value = this->progress();
+    locker.unlock();
+    emit m_operation->progressChanged(value);
+}
+
+double ExtractArchiveOperation::Extraction::progress() const
+{
+    double sum = 0.0;
+    foreach (const Part &part, m_parts)
+        sum += part.progress;
+    return m_parts.isEmpty() ? 0.0 : sum / m_parts.count();
+}
+
+/*
+    Forwards the progress to the operation from now on. The operation gets connected to the
+    installer only right before it is performed.
+*/
+void ExtractArchiveOperation::Extraction::startReporting()
+{
+    QMutexLocker locker(&m_mutex);
+    m_reporting = true;
+    const double value = progress();
+    locker.unlock();
+    emit m_operation->progressChanged(value);
+}
+
+void ExtractArchiveOperation::Extraction::waitForFinished()
+{
+    QMutexLocker _(&m_mutex);
+    while (!m_finished)
+        m_finishedCondition.wait(&m_mutex);
+}
+
+/*
+    Removes the extracted files and puts back the files they replaced. Used for archives whose
+    operation did not get performed, as nothing is going to undo them.
+*/
+void ExtractArchiveOperation::Extraction::discard()
+{
+    waitForFinished();
+    QStringList directories;
+    ExtractedFilesManifestReader reader(m_extractedFiles);
+    QString file;
+    while (reader.readNext(&file)) {
+        const QFileInfo fi(file);
+        if (fi.isFile() || fi.isSymLink())
+            m_operation->deleteFileNowOrLater(fi.absoluteFilePath());
+        else if (fi.isDir())
+            directories.append(file);
+    }
+
+    // directories are listed before their files, remove the deepest first
+    std::stable_sort(directories.begin(), directories.end(),
+        [](const QString &lhs, const QString &rhs) {
+            return QDir::fromNativeSeparators(lhs).count(QLatin1Char('/'))
+                > QDir::fromNativeSeparators(rhs).count(QLatin1Char('/'));
+        });
+    foreach (const QString &directory, directories) {
+        removeSystemGeneratedFiles(directory);
+        QDir().rmdir(directory);
+    }
+    for (int i = m_backupFiles.count() - 1; i >= 0; --i)
+        QFile::rename(m_backupFiles.at(i).second, m_backupFiles.at(i).first);
+}
+
+bool ExtractArchiveOperation::Extraction::success() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_success;
+}
+
+QString ExtractArchiveOperation::Extraction::errorString() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_errorString;
+}
+
+ExtractedFilesManifest ExtractArchiveOperation::Extraction::extractedFiles() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_extractedFiles;
+}
+
+BackupFiles ExtractArchiveOperation::Extraction::backupFiles() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_backupFiles;
+}
+
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::ConcurrentArchiveExtractor
+    \brief The ConcurrentArchiveExtractor class extracts the archives of consecutive extract
+        operations ahead of performing them.
+
+    A component usually comes with several archives, each extracted by an operation of its own.
+    The operations are still performed one after the other, but once the first of them is about
+    to be performed, the archives of all of them are extracted in parallel. Archives compressed
+    into several solid blocks are split up by block as well. Each operation then only waits for
+    its own archive and records the extracted files and backups as if it had extracted the archive
+    by itself.
+*/
+
+/*!
+    Creates an extractor for \a operations, usually the operations of one component.
+*/
+ConcurrentArchiveExtractor::ConcurrentArchiveExtractor(const OperationList &operations)
+    : m_operations(operations)
+{
+}
+
+/*!
+    Waits for the started extractions to finish. The files of archives whose operation was not
+    performed are removed again, as there is no operation to undo them.
+*/
+ConcurrentArchiveExtractor::~ConcurrentArchiveExtractor()
+{
+    foreach (const QSharedPointer<ExtractArchiveOperation::Extraction> &extraction, m_extractions) {
+        extraction->waitForFinished();
+        ExtractArchiveOperation *const operation = extraction->operation();
+        if (operation->m_extraction == extraction) {
+            operation->m_extraction.clear();
+            extraction->discard();
+        }
+    }
+}
+
+/*!
+    Starts extracting the archives of \a operation and of the extract operations that directly
+    follow it. Call it right before \a operation gets performed. Does nothing if \a operation is
+    no extract operation or if its extraction was started already. Operations that need elevated
+    rights are left to extract their archive by themselves, as are all operations while the
+    installer talks to the privileged server.
+*/
+void ConcurrentArchiveExtractor::start(Operation *operation)
+{
+    if (RemoteClient::instance().isActive())
+        return;
+
+    QList<QSharedPointer<ExtractArchiveOperation::Extraction> > extractions;
+    for (int i = m_operations.indexOf(operation); i >= 0 && i < m_operations.count(); ++i) {
+        ExtractArchiveOperation *const extractOperation
+            = dynamic_cast<ExtractArchiveOperation *>(m_operations.at(i));
+        if (!extractOperation || m_started.contains(extractOperation)
+            || extractOperation->value(QLatin1String("admin")).toBool()
+            || extractOperation->arguments().count() != 2) {
+                break;
+        }
+        m_started.insert(extractOperation);
+
+        const QStringList arguments = extractOperation->arguments();
+        QSharedPointer<ExtractArchiveOperation::Extraction> extraction(
+            new ExtractArchiveOperation::Extraction(extractOperation, arguments.at(0),
+            arguments.at(1)));
+        extractOperation->m_extraction = extraction;
+        extractions.append(extraction);
+    }
+
+    if (extractions.isEmpty())
+        return;
+
+    m_extractions += extractions;
+    QtConcurrent::run(extractionThreadPool(), &ExtractArchiveOperation::Extraction::extract,
+        extractions, extractions.first()->operation()->packageManager(), extractionThreadPool());
 }
 
 } // namespace QInstaller
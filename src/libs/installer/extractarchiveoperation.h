@@ -32,13 +32,22 @@
 #include "qinstallerglobal.h"
 
 #include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+QT_END_NAMESPACE
 
 namespace QInstaller {
 
+class ExtractedFilesManifestReader;
+
 class INSTALLER_EXPORT ExtractArchiveOperation : public QObject, public Operation
 {
     Q_OBJECT
     friend class WorkerThread;
+    friend class ConcurrentArchiveExtractor;
 
 public:
     explicit ExtractArchiveOperation(PackageManagerCore *core);
@@ -55,16 +64,35 @@ Q_SIGNALS:
     void progressChanged(double);
 
 private:
-    void startUndoProcess(const QStringList &files);
+    bool openDataFile(QString &targetDir, QFile *file);
+    void startUndoProcess(ExtractedFilesManifestReader *files);
     void deleteDataFile(const QString &fileName);
 
-private:
-    QString m_relocatedDataFileName;
-
 private:
     class Callback;
     class Runnable;
     class Receiver;
+    class Extraction;
+
+private:
+    QString m_relocatedDataFileName;
+    QSharedPointer<Extraction> m_extraction;
+};
+
+class INSTALLER_EXPORT ConcurrentArchiveExtractor
+{
+    Q_DISABLE_COPY(ConcurrentArchiveExtractor)
+
+public:
+    explicit ConcurrentArchiveExtractor(const OperationList &operations);
+    ~ConcurrentArchiveExtractor();
+
+    void start(Operation *operation);
+
+private:
+    OperationList m_operations;
+    QSet<Operation *> m_started;
+    QList<QSharedPointer<ExtractArchiveOperation::Extraction> > m_extractions;
 };
 
 }
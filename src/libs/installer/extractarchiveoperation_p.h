@@ -30,23 +30,38 @@
 
 #include "extractarchiveoperation.h"
 
+#include "binaryformat.h"
+#include "binaryformatenginehandler.h"
+#include "extractedfilesmanifest.h"
 #include "fileutils.h"
 #include "lib7z_extract.h"
 #include "lib7z_facade.h"
+#include "lib7z_list.h"
 #include "packagemanagercore.h"
+#include "remoteclient.h"
+#include "remotefileoperations.h"
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QQueue>
 #include <QRunnable>
 #include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
 
 namespace QInstaller {
 
+QSharedPointer<Lib7z::WriteBehindPool> extractionWriteBehindPool();
+
 class WorkerThread : public QThread
 {
     Q_OBJECT
     Q_DISABLE_COPY(WorkerThread)
 
 public:
-    WorkerThread(ExtractArchiveOperation *op, const QStringList &files)
+    WorkerThread(ExtractArchiveOperation *op, ExtractedFilesManifestReader *files)
         : m_files(files)
         , m_op(op)
     {
@@ -56,21 +71,68 @@ public:
     void run()
     {
         Q_ASSERT(m_op != 0);
+        if (m_files->count() == 0)
+            return;
 
-        int removedCounter = 0;
-        foreach (const QString &file, m_files) {
-            removedCounter++;
-
-            const QFileInfo fi(file);
-            emit currentFileChanged(QDir::toNativeSeparators(file));
-            emit progressChanged(double(removedCounter) / m_files.count());
-            if (fi.isFile() || fi.isSymLink()) {
-                m_op->deleteFileNowOrLater(fi.absoluteFilePath());
-            } else if (fi.isDir()) {
-                removeSystemGeneratedFiles(file);
-                fi.dir().rmdir(file); // directory may not exist
+        m_timer.start();
+        QThreadPool pool;
+        pool.setMaxThreadCount(qBound(1, m_files->count() / MaxShardSize + 1,
+            QThread::idealThreadCount()));
+        for (int i = 0; i < pool.maxThreadCount(); ++i)
+            pool.start(new Remover(this));
+
+        // Each thread removes the files of one directory at a time, files of the same directory
+        // are likely to be close to each other on disk. The manifest lists the files of a
+        // directory one after the other, so it is read while the threads remove the files
+        // already read instead of being loaded as a whole.
+        QStringList shard;
+        QString shardDirectory;
+        QString path;
+        while (m_files->readNext(&path)) {
+            const int index = qMax(path.lastIndexOf(QLatin1Char('/')),
+                path.lastIndexOf(QLatin1Char('\\')));
+            const QStringRef directory = path.leftRef(index);
+            if (!shard.isEmpty()
+                && (directory != shardDirectory || shard.count() >= MaxShardSize)) {
+                    enqueueShard(shard);
+                    shard.clear();
             }
+            if (shard.isEmpty())
+                shardDirectory = directory.toString();
+            shard.append(path);
+            if (m_timer.elapsed() >= ProgressInterval)
+                reportProgress();
+        }
+        if (!shard.isEmpty())
+            enqueueShard(shard);
+        {
+            QMutexLocker _(&m_mutex);
+            m_allShardsQueued = true;
+            m_shardQueued.wakeAll();
+        }
+
+        while (!pool.waitForDone(ProgressInterval))
+            reportProgress();
+
+        // Files in use get renamed and deleted later, keep that on this thread, as the operation
+        // does not expect to be called from several threads.
+        foreach (const QString &file, m_busyFiles)
+            m_op->deleteFileNowOrLater(file);
+
+        // a directory can only be removed once empty, so remove the deepest first
+        std::stable_sort(m_directories.begin(), m_directories.end(),
+            [](const QString &lhs, const QString &rhs) {
+                return depth(lhs) > depth(rhs);
+            });
+        foreach (const QString &directory, m_directories) {
+            setCurrentFile(directory);
+            removeSystemGeneratedFiles(directory);
+            QDir().rmdir(directory);
+            m_removedCount.fetchAndAddRelaxed(1);
+            if (m_timer.elapsed() >= ProgressInterval)
+                reportProgress();
         }
+        reportProgress();
     }
 
 signals:
@@ -78,27 +140,156 @@ signals:
     void progressChanged(double);
 
 private:
-    QStringList m_files;
+    enum {
+        ProgressInterval = 100, // ms between progress reports
+        MaxShardSize = 256,
+        MaxQueuedShards = 64
+    };
+
+    class Remover : public QRunnable
+    {
+    public:
+        explicit Remover(WorkerThread *thread)
+            : m_thread(thread)
+        {}
+
+        void run() Q_DECL_OVERRIDE
+        {
+            m_thread->removeFiles();
+        }
+
+    private:
+        WorkerThread *const m_thread;
+    };
+
+    // Waits until the removing threads have room for another shard, to keep the memory used
+    // bounded no matter how large the manifest is.
+    void enqueueShard(const QStringList &shard)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_shards.count() >= MaxQueuedShards) {
+            if (!m_shardTaken.wait(&m_mutex, ProgressInterval)) {
+                locker.unlock();
+                reportProgress();
+                locker.relock();
+            }
+        }
+        m_shards.enqueue(shard);
+        m_shardQueued.wakeOne();
+    }
+
+    bool takeShard(QStringList *shard)
+    {
+        QMutexLocker _(&m_mutex);
+        while (m_shards.isEmpty() && !m_allShardsQueued)
+            m_shardQueued.wait(&m_mutex);
+        if (m_shards.isEmpty())
+            return false;
+        *shard = m_shards.dequeue();
+        m_shardTaken.wakeOne();
+        return true;
+    }
+
+    // Removes the files of the queued shards. Only stats what cannot be removed, to tell
+    // directories, which are removed afterwards, from files in use.
+    void removeFiles()
+    {
+        QStringList directories;
+        QStringList busyFiles;
+        QStringList shard;
+        while (takeShard(&shard)) {
+            setCurrentFile(shard.first());
+            foreach (const QString &file, shard) {
+                if (!QFile::remove(file)) {
+                    const QFileInfo fi(file);
+                    if (fi.isDir() && !fi.isSymLink()) {
+                        directories.append(file);
+                        continue;
+                    }
+                    if (fi.exists() || fi.isSymLink())
+                        busyFiles.append(fi.absoluteFilePath());
+                }
+                m_removedCount.fetchAndAddRelaxed(1);
+            }
+        }
+
+        QMutexLocker _(&m_mutex);
+        m_directories += directories;
+        m_busyFiles += busyFiles;
+    }
+
+    void setCurrentFile(const QString &file)
+    {
+        QMutexLocker _(&m_mutex);
+        m_currentFile = file;
+    }
+
+    void reportProgress()
+    {
+        QString currentFile;
+        {
+            QMutexLocker _(&m_mutex);
+            currentFile = m_currentFile;
+        }
+        emit currentFileChanged(QDir::toNativeSeparators(currentFile));
+        emit progressChanged(double(m_removedCount.loadAcquire()) / m_files->count());
+        m_timer.restart();
+    }
+
+    static int depth(const QString &path)
+    {
+        return QDir::fromNativeSeparators(path).count(QLatin1Char('/'));
+    }
+
+private:
+    ExtractedFilesManifestReader *m_files;
     ExtractArchiveOperation *m_op;
+
+    QAtomicInt m_removedCount;
+    QElapsedTimer m_timer;
+
+    QMutex m_mutex;
+    QQueue<QStringList> m_shards;
+    bool m_allShardsQueued = false;
+    QWaitCondition m_shardQueued;
+    QWaitCondition m_shardTaken;
+    QString m_currentFile;
+    QStringList m_directories;
+    QStringList m_busyFiles;
 };
 
 typedef QPair<QString, QString> Backup;
 typedef QVector<Backup> BackupFiles;
 
-class ExtractArchiveOperation::Callback : public QObject, public Lib7z::ExtractCallback
+class ExtractArchiveOperation::Callback : public QObject, public Lib7z::BackupExtractCallback
 {
     Q_OBJECT
     Q_DISABLE_COPY(Callback)
 
 public:
-    Callback() = default;
+    // Pass the core if the status cannot be forwarded to statusChanged(), for example because the
+    // callback lives in a thread without event loop.
+    explicit Callback(const QString &targetDir, PackageManagerCore *core = nullptr)
+        : m_core(core)
+        , m_extractedFiles(targetDir)
+    {}
 
-    BackupFiles backupFiles() const {
-        return m_backupFiles;
+    const ExtractedFilesManifest &extractedFiles() const {
+        return m_extractedFiles;
     }
 
-    QStringList extractedFiles() const {
-        return m_extractedFiles;
+    // Used instead of the Lib7z callbacks when the privileged server extracts the archive.
+    bool reportProgress(double progress)
+    {
+        emit progressChanged(progress);
+        return m_state == S_OK;
+    }
+
+    void setExtractionResult(const QStringList &extractedFiles, const BackupFiles &backupFiles)
+    {
+        foreach (const QString &file, extractedFiles)
+            m_extractedFiles.append(file);
+        setBackupFiles(backupFiles);
     }
 
 public slots:
@@ -122,45 +313,21 @@ signals:
 private:
     void setCurrentFile(const QString &filename) Q_DECL_OVERRIDE
     {
-        m_extractedFiles.prepend(QDir::toNativeSeparators(filename));
-    }
-
-    static QString generateBackupName(const QString &fn)
-    {
-        const QString bfn = fn + QLatin1String(".tmpUpdate");
-        QString res = bfn;
-        int i = 0;
-        while (QFile::exists(res))
-            res = bfn + QString::fromLatin1(".%1").arg(i++);
-        return res;
-    }
-
-    bool prepareForFile(const QString &filename) Q_DECL_OVERRIDE
-    {
-        if (!QFile::exists(filename))
-            return true;
-        const QString backup = generateBackupName(filename);
-        QFile f(filename);
-        const bool renamed = f.rename(backup);
-        if (f.exists() && !renamed) {
-            qCritical("Cannot rename %s to %s: %s", qPrintable(filename), qPrintable(backup),
-                qPrintable(f.errorString()));
-            return false;
-        }
-        m_backupFiles.append(qMakePair(filename, backup));
-        return true;
+        m_extractedFiles.append(filename);
     }
 
     HRESULT setCompleted(quint64 completed, quint64 total) Q_DECL_OVERRIDE
     {
+        if (m_core)
+            statusChanged(m_core->status());
         emit progressChanged(double(completed) / total);
         return m_state;
     }
 
 private:
+    PackageManagerCore *m_core;
     HRESULT m_state = S_OK;
-    BackupFiles m_backupFiles;
-    QStringList m_extractedFiles;
+    ExtractedFilesManifest m_extractedFiles;
 };
 
 class ExtractArchiveOperation::Runnable : public QObject, public QRunnable
@@ -169,24 +336,57 @@ class ExtractArchiveOperation::Runnable : public QObject, public QRunnable
     Q_DISABLE_COPY(Runnable)
 
 public:
+    // An empty list of \a items extracts the whole archive.
     Runnable(const QString &archivePath, const QString &targetDir,
-            ExtractArchiveOperation::Callback *callback)
+            ExtractArchiveOperation::Callback *callback,
+            const QVector<quint32> &items = QVector<quint32>())
         : m_archivePath(archivePath)
         , m_targetDir(targetDir)
         , m_callback(callback)
+        , m_items(items)
     {}
 
     void run()
     {
-        QFile archive(m_archivePath);
-        if (!archive.open(QIODevice::ReadOnly)) {
+        if (m_items.isEmpty() && RemoteClient::instance().isActive()) {
+            // Let the privileged server write the files instead of forwarding every write to it.
+            RemoteFileOperations operations;
+            if (operations.isAvailable()) {
+                extractRemote(&operations);
+                return;
+            }
+        }
+
+        // A resource of the installer binary can only be opened once at a time, and the parts of
+        // an archive are extracted at the same time. Read through a resource of our own instead,
+        // like the privileged server does.
+        QScopedPointer<QIODevice> archive;
+        bool opened = false;
+        const QSharedPointer<Resource> resource
+            = BinaryFormatEngineHandler::instance()->resource(m_archivePath);
+        if (resource) {
+            Resource *const copy = new Resource(resource->path(), resource->segment());
+            archive.reset(copy);
+            opened = copy->open();
+        } else {
+            archive.reset(new QFile(m_archivePath));
+            opened = archive->open(QIODevice::ReadOnly);
+        }
+        if (!opened) {
             emit finished(false, tr("Cannot open archive \"%1\" for reading: %2").arg(m_archivePath,
-                archive.errorString()));
+                archive->errorString()));
             return;
         }
 
         try {
-            Lib7z::extractArchive(&archive, m_targetDir, m_callback);
+            // let closing files, which virus scanners like to slow down, overlap decoding
+            m_callback->setWriteBehind(extractionWriteBehindPool());
+            if (m_items.isEmpty()) {
+                Lib7z::extractArchive(archive.data(), m_archivePath, m_targetDir, m_callback);
+            } else {
+                Lib7z::extractArchive(archive.data(), m_archivePath, m_targetDir, m_items,
+                    m_callback);
+            }
             emit finished(true, QString());
         } catch (const Lib7z::SevenZipException& e) {
             emit finished(false, tr("Error while extracting archive \"%1\": %2").arg(m_archivePath,
@@ -200,10 +400,31 @@ public:
 signals:
     void finished(bool success, const QString &errorString);
 
+private:
+    void extractRemote(RemoteFileOperations *operations)
+    {
+        connect(operations, &RemoteFileOperations::progressChanged, operations,
+            [this, operations](double progress) {
+                if (!m_callback->reportProgress(progress))
+                    operations->cancel();
+            });
+
+        try {
+            const RemoteFileOperations::ExtractResult result
+                = operations->extractArchive(m_archivePath, m_targetDir);
+            m_callback->setExtractionResult(result.extractedFiles, result.backupFiles);
+            emit finished(result.success, result.errorString);
+        } catch (const QInstaller::Error &e) {
+            emit finished(false, tr("Error while extracting archive \"%1\": %2").arg(m_archivePath,
+                e.message()));
+        }
+    }
+
 private:
     QString m_archivePath;
     QString m_targetDir;
     ExtractArchiveOperation::Callback *m_callback;
+    QVector<quint32> m_items;
 };
 
 class ExtractArchiveOperation::Receiver : public QObject
@@ -238,6 +459,76 @@ private:
     QString m_errorString;
 };
 
+// The extraction of one archive started ahead of its operation by ConcurrentArchiveExtractor. The
+// archive is extracted in one or more parts, each with its own callback, and the results of the
+// parts are merged in a fixed order once all of them are done.
+class ExtractArchiveOperation::Extraction
+{
+    Q_DISABLE_COPY(Extraction)
+
+public:
+    Extraction(ExtractArchiveOperation *operation, const QString &archivePath,
+            const QString &targetDir)
+        : m_operation(operation)
+        , m_archivePath(archivePath)
+        , m_targetDir(targetDir)
+        , m_extractedFiles(targetDir)
+    {}
+
+    static void extract(const QList<QSharedPointer<Extraction> > &extractions,
+        PackageManagerCore *core, QThreadPool *pool);
+
+    ExtractArchiveOperation *operation() const {
+        return m_operation;
+    }
+
+    void startReporting();
+    void waitForFinished();
+    void discard();
+
+    bool success() const;
+    QString errorString() const;
+    ExtractedFilesManifest extractedFiles() const;
+    BackupFiles backupFiles() const;
+
+private:
+    struct Part
+    {
+        QVector<quint32> items; // empty for the whole archive
+        QSharedPointer<Callback> callback;
+        bool success = false;
+        QString errorString;
+        double progress = 0.0;
+    };
+
+    void createDirectories(const QVector<Lib7z::File> &files, QSet<QString> *existing,
+        QSet<QString> *created);
+    void splitIntoParts(const QVector<Lib7z::File> &files, int maxParts);
+    void start(PackageManagerCore *core, QThreadPool *pool,
+        const QSet<QString> &emptyDirectories = QSet<QString>());
+    void partFinished(int index, bool success, const QString &errorString);
+    void setPartProgress(int index, double progress);
+    double progress() const;
+
+private:
+    ExtractArchiveOperation *const m_operation;
+    const QString m_archivePath;
+    const QString m_targetDir;
+
+    QVector<Part> m_parts;
+    int m_runningParts = 0;
+    bool m_reporting = false;
+    bool m_finished = false;
+
+    bool m_success = false;
+    QString m_errorString;
+    ExtractedFilesManifest m_extractedFiles;
+    BackupFiles m_backupFiles;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_finishedCondition;
+};
+
 }
 
 #endif // EXTRACTARCHIVEOPERATION_P_H
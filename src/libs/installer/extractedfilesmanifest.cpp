@@ -0,0 +1,322 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "extractedfilesmanifest.h"
+
+#include "constants.h"
+#include "fileutils.h"
+
+#include <QCoreApplication>
+
+#include <climits>
+
+namespace QInstaller {
+
+static const char Magic[] = "QIFM";
+static const int MagicSize = 4;
+static const quint8 Version = 1;
+
+static void writeNumber(QByteArray *data, quint32 value)
+{
+    while (value >= 0x80) {
+        data->append(char(value | 0x80));
+        value >>= 7;
+    }
+    data->append(char(value));
+}
+
+static bool readNumber(QIODevice *device, quint32 *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+        char c;
+        if (!device->getChar(&c))
+            return false;
+        *value |= quint32(uchar(c) & 0x7f) << shift;
+        if (!(uchar(c) & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Reads the entry following \a entry, which holds the previous entry on input.
+static bool readEntry(QIODevice *device, QString *entry)
+{
+    quint32 shared;
+    quint32 size;
+    if (!readNumber(device, &shared) || !readNumber(device, &size))
+        return false;
+    if (shared > quint32(entry->size()))
+        return false;
+
+    const QByteArray suffix = device->read(size);
+    if (quint32(suffix.size()) != size)
+        return false;
+    entry->truncate(int(shared));
+    entry->append(QString::fromUtf8(suffix));
+    return true;
+}
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::ExtractedFilesManifest
+    \brief The ExtractedFilesManifest class records the files extracted from an archive.
+
+    Archives can contain hundreds of thousands of files, and the extract operation needs all of
+    their names again to undo the extraction. Instead of keeping a list of strings, the manifest
+    stores each path as the number of characters it shares with the previous path, followed by
+    the rest of it in UTF-8. As files get extracted directory by directory, that is usually no
+    more than the file name. Paths inside the target directory are stored relative to it, so that
+    the installation can be moved.
+
+    The manifest is written to disk with write() and read back entry by entry with
+    ExtractedFilesManifestReader, which also reads the QDataStream serialized string lists
+    written by older versions.
+*/
+
+/*!
+    Creates an empty manifest for files extracted to \a targetDir.
+*/
+ExtractedFilesManifest::ExtractedFilesManifest(const QString &targetDir)
+    : m_targetDir(targetDir)
+    , m_count(0)
+{
+}
+
+/*!
+    Appends \a path to the manifest.
+*/
+void ExtractedFilesManifest::append(const QString &path)
+{
+    if (m_targetDir.isEmpty())
+        appendEntry(path);
+    else
+        appendEntry(replacePath(path, m_targetDir, QLatin1String(scRelocatable)));
+}
+
+/*!
+    Appends the paths of \a other to the manifest. Only the first path of \a other gets encoded
+    again, the others are copied as they are.
+*/
+void ExtractedFilesManifest::append(const ExtractedFilesManifest &other)
+{
+    if (other.isEmpty())
+        return;
+
+    QBuffer buffer;
+    buffer.setData(other.m_data);
+    buffer.open(QIODevice::ReadOnly);
+    QString first;
+    if (!readEntry(&buffer, &first))
+        return;
+
+    appendEntry(first);
+    m_data.append(other.m_data.mid(int(buffer.pos())));
+    m_lastEntry = other.m_lastEntry;
+    m_count += other.m_count - 1;
+}
+
+/*!
+    Returns the number of paths in the manifest.
+*/
+int ExtractedFilesManifest::count() const
+{
+    return m_count;
+}
+
+/*!
+    Returns \c true if the manifest holds no paths.
+*/
+bool ExtractedFilesManifest::isEmpty() const
+{
+    return m_count == 0;
+}
+
+/*!
+    Writes the manifest to \a device. Returns \c true on success.
+*/
+bool ExtractedFilesManifest::write(QIODevice *device) const
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.writeRawData(Magic, MagicSize);
+    stream << Version << quint32(m_count);
+
+    return device->write(header) == header.size() && device->write(m_data) == m_data.size();
+}
+
+void ExtractedFilesManifest::appendEntry(const QString &entry)
+{
+    const int size = qMin(entry.size(), m_lastEntry.size());
+    int shared = 0;
+    while (shared < size && entry.at(shared) == m_lastEntry.at(shared))
+        ++shared;
+    // do not split a surrogate pair, the rest of the entry gets encoded in UTF-8
+    if (shared > 0 && entry.at(shared - 1).isHighSurrogate())
+        --shared;
+
+    const QByteArray suffix = entry.midRef(shared).toUtf8();
+    writeNumber(&m_data, quint32(shared));
+    writeNumber(&m_data, quint32(suffix.size()));
+    m_data.append(suffix);
+
+    m_lastEntry = entry;
+    ++m_count;
+}
+
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::ExtractedFilesManifestReader
+    \brief The ExtractedFilesManifestReader class reads the paths of an extracted files manifest
+        one by one.
+
+    Only the current path is kept in memory, so even the manifests of huge archives can be read
+    without loading all of their paths at once.
+*/
+
+/*!
+    Creates a reader for the manifest written to \a device, which needs to be open. Paths
+    recorded relative to the target directory are resolved against \a targetDir.
+
+    Files written by older versions of the installer, which hold a QDataStream serialized
+    QStringList, are read as well.
+*/
+ExtractedFilesManifestReader::ExtractedFilesManifestReader(QIODevice *device,
+        const QString &targetDir)
+    : m_device(device)
+    , m_legacy(false)
+    , m_count(0)
+    , m_read(0)
+    , m_targetDir(targetDir)
+{
+    if (device->peek(MagicSize) != QByteArray::fromRawData(Magic, MagicSize)) {
+        m_legacy = true;
+        m_legacyStream.setDevice(device);
+        if (device->atEnd())
+            return;
+
+        quint32 count;
+        m_legacyStream >> count;
+        if (m_legacyStream.status() != QDataStream::Ok || count > quint32(INT_MAX))
+            setError(QCoreApplication::translate("ExtractedFilesManifest", "Invalid file list."));
+        else
+            m_count = int(count);
+        return;
+    }
+
+    device->read(MagicSize);
+    QDataStream stream(device);
+    quint8 version;
+    quint32 count;
+    stream >> version >> count;
+    if (stream.status() != QDataStream::Ok || count > quint32(INT_MAX)) {
+        setError(QCoreApplication::translate("ExtractedFilesManifest",
+            "Invalid extracted files manifest."));
+    } else if (version != Version) {
+        setError(QCoreApplication::translate("ExtractedFilesManifest",
+            "Unsupported extracted files manifest version %1.").arg(version));
+    } else {
+        m_count = int(count);
+    }
+}
+
+/*!
+    Creates a reader for the paths of \a manifest.
+*/
+ExtractedFilesManifestReader::ExtractedFilesManifestReader(const ExtractedFilesManifest &manifest)
+    : m_device(&m_buffer)
+    , m_legacy(false)
+    , m_count(manifest.m_count)
+    , m_read(0)
+    , m_targetDir(manifest.m_targetDir)
+{
+    m_buffer.setData(manifest.m_data);
+    m_buffer.open(QIODevice::ReadOnly);
+}
+
+/*!
+    Returns the number of paths in the manifest.
+*/
+int ExtractedFilesManifestReader::count() const
+{
+    return m_count;
+}
+
+/*!
+    Reads the next path into \a path. Returns \c false once all paths are read or if the
+    manifest is corrupt, see hasError().
+*/
+bool ExtractedFilesManifestReader::readNext(QString *path)
+{
+    if (m_read >= m_count || hasError())
+        return false;
+
+    if (m_legacy) {
+        m_legacyStream >> m_entry;
+        if (m_legacyStream.status() != QDataStream::Ok) {
+            setError(QCoreApplication::translate("ExtractedFilesManifest",
+                "Unexpected end of file list."));
+            return false;
+        }
+    } else if (!readEntry(m_device, &m_entry)) {
+        setError(QCoreApplication::translate("ExtractedFilesManifest",
+            "Invalid entry in extracted files manifest."));
+        return false;
+    }
+
+    ++m_read;
+    if (m_targetDir.isEmpty())
+        *path = m_entry;
+    else
+        *path = replacePath(m_entry, QLatin1String(scRelocatable), m_targetDir);
+    return true;
+}
+
+/*!
+    Returns \c true if the manifest could not be read.
+*/
+bool ExtractedFilesManifestReader::hasError() const
+{
+    return !m_errorString.isEmpty();
+}
+
+/*!
+    Returns a description of the last error.
+*/
+QString ExtractedFilesManifestReader::errorString() const
+{
+    return m_errorString;
+}
+
+void ExtractedFilesManifestReader::setError(const QString &errorString)
+{
+    m_errorString = errorString;
+}
+
+} // namespace QInstaller
@@ -0,0 +1,96 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef EXTRACTEDFILESMANIFEST_H
+#define EXTRACTEDFILESMANIFEST_H
+
+#include "installer_global.h"
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT ExtractedFilesManifest
+{
+public:
+    explicit ExtractedFilesManifest(const QString &targetDir = QString());
+
+    void append(const QString &path);
+    void append(const ExtractedFilesManifest &other);
+
+    int count() const;
+    bool isEmpty() const;
+
+    bool write(QIODevice *device) const;
+
+private:
+    friend class ExtractedFilesManifestReader;
+    void appendEntry(const QString &entry);
+
+private:
+    QString m_targetDir;
+    QString m_lastEntry;
+    QByteArray m_data;
+    int m_count;
+};
+
+class INSTALLER_EXPORT ExtractedFilesManifestReader
+{
+    Q_DISABLE_COPY(ExtractedFilesManifestReader)
+
+public:
+    ExtractedFilesManifestReader(QIODevice *device, const QString &targetDir = QString());
+    explicit ExtractedFilesManifestReader(const ExtractedFilesManifest &manifest);
+
+    int count() const;
+    bool readNext(QString *path);
+
+    bool hasError() const;
+    QString errorString() const;
+
+private:
+    void setError(const QString &errorString);
+
+private:
+    QBuffer m_buffer;
+    QIODevice *m_device;
+    QDataStream m_legacyStream;
+    bool m_legacy;
+    int m_count;
+    int m_read;
+    QString m_entry;
+    QString m_targetDir;
+    QString m_errorString;
+};
+
+} // namespace QInstaller
+
+#endif // EXTRACTEDFILESMANIFEST_H
@@ -33,26 +33,31 @@
 #include <QList>
 #include <QPair>
 #include <QSet>
+#include <QVector>
+
+#include <algorithm>
 
 namespace QInstaller {
 
 template <class T> class Graph
 {
 public:
-    inline Graph() {}
+    inline Graph() : m_csrValid(false), m_hasCycle(false) {}
     explicit Graph(const QList<T> &nodes)
+        : m_csrValid(false)
+        , m_hasCycle(false)
     {
         addNodes(nodes);
     }
 
     const QList<T> nodes() const
     {
-        return m_graph.keys();
+        return m_nodes.toList();
     }
 
     void addNode(const T &node)
     {
-        m_graph.insert(node, QSet<T>());
+        indexOf(node);
     }
 
     void addNodes(const QList<T> &nodes)
@@ -63,12 +68,27 @@ public:
 
     QList<T> edges(const T &node) const
     {
-        return m_graph.value(node).toList();
+        QList<T> result;
+        const int index = m_nodeIndex.value(node, -1);
+        if (index < 0)
+            return result;
+
+        buildAdjacency();
+        for (int i = m_offsets.at(index); i < m_offsets.at(index + 1); ++i)
+            result.append(m_nodes.at(m_targets.at(i)));
+        return result;
     }
 
     void addEdge(const T &node, const T &edge)
     {
-        m_graph[node].insert(edge);
+        const int from = indexOf(node);
+        const int to = indexOf(edge);
+        if (m_edgeKeys.contains(edgeKey(from, to)))
+            return;
+
+        m_edgeKeys.insert(edgeKey(from, to));
+        m_edges.append(qMakePair(from, to));
+        m_csrValid = false;
     }
 
     void addEdges(const T &node, const QList<T> &edges)
@@ -82,20 +102,76 @@ public:
         return m_hasCycle;
     }
 
+    /*
+        Returns the last edge of the detected cycle: the second node is the one that was reached
+        again, the first node is the one that depends on it.
+    */
     QPair<T, T> cycle() const
     {
-        return m_cycle;
+        if (m_cyclePath.isEmpty())
+            return qMakePair(T(), T());
+        return qMakePair(m_cyclePath.last(), m_cyclePath.first());
+    }
+
+    /*
+        Returns all nodes of the detected cycle in edge order, each node has an edge to the next
+        one and the last node has an edge back to the first one.
+    */
+    QList<T> cyclePath() const
+    {
+        return m_cyclePath;
     }
 
+    /*
+        Returns the nodes so that each node comes after all nodes it has edges to. Nodes are
+        visited in the order they were added, the sort stops at the first cycle found.
+    */
     QList<T> sort() const
     {
-        QSet<T> visitedNodes;
+        enum Color : quint8 { White, Gray, Black };
+
+        buildAdjacency();
+        const int count = m_nodes.count();
+        QVector<quint8> colors(count, White);
+        QVector<QPair<int, int> > stack;    // < node, next edge to visit >
         QList<T> resolvedNodes;
+        resolvedNodes.reserve(count);
 
         m_hasCycle = false;
-        m_cycle = qMakePair(T(), T());
-        foreach (const T &node, nodes())
-            visit(node, &resolvedNodes, &visitedNodes);
+        m_cyclePath.clear();
+        for (int root = 0; root < count && !m_hasCycle; ++root) {
+            if (colors.at(root) != White)
+                continue;
+
+            colors[root] = Gray;
+            stack.append(qMakePair(root, m_offsets.at(root)));
+            while (!stack.isEmpty()) {
+                QPair<int, int> &top = stack.last();
+                const int node = top.first;
+                if (top.second == m_offsets.at(node + 1)) {
+                    // all adjacent nodes are resolved, so is this one
+                    colors[node] = Black;
+                    resolvedNodes.append(m_nodes.at(node));
+                    stack.removeLast();
+                    continue;
+                }
+
+                const int adjacency = m_targets.at(top.second++);
+                if (colors.at(adjacency) == White) {
+                    colors[adjacency] = Gray;
+                    stack.append(qMakePair(adjacency, m_offsets.at(adjacency)));
+                } else if (colors.at(adjacency) == Gray) {
+                    // the node is still on the stack, everything above it forms the cycle
+                    int i = stack.count() - 1;
+                    while (stack.at(i).first != adjacency)
+                        --i;
+                    for (; i < stack.count(); ++i)
+                        m_cyclePath.append(m_nodes.at(stack.at(i).first));
+                    m_hasCycle = true;
+                    break;
+                }
+            }
+        }
         return resolvedNodes;
     }
 
@@ -107,38 +183,56 @@ public:
     }
 
 private:
-    void visit(const T &node, QList<T> *const resolvedNodes, QSet<T> *const visitedNodes) const
+    int indexOf(const T &node)
     {
-        if (m_hasCycle)
-            return;
-
-        // if we visited this node already
-        if (visitedNodes->contains(node)) {
-            // and if the node is already in the ordered list
-            if (resolvedNodes->contains(node))
-                return;
-
-            m_hasCycle = true;
-            m_cycle.second = node;
-            return; // if not yet in the ordered list, we detected a cycle
-        }
+        typename QHash<T, int>::const_iterator it = m_nodeIndex.constFind(node);
+        if (it != m_nodeIndex.constEnd())
+            return it.value();
+
+        m_nodeIndex.insert(node, m_nodes.count());
+        m_nodes.append(node);
+        m_csrValid = false;
+        return m_nodes.count() - 1;
+    }
 
-        // mark this node as visited
-        visitedNodes->insert(node);
+    static quint64 edgeKey(int from, int to)
+    {
+        return (quint64(quint32(from)) << 32) | quint32(to);
+    }
 
-        m_cycle.first = node;
-        // recursively visit all adjacency
-        foreach (const T &adjacency, edges(node))
-            visit(adjacency, resolvedNodes, visitedNodes);
+    // Lays out the adjacency of all nodes in one contiguous array, the edges of node i are
+    // m_targets[m_offsets[i]] up to m_targets[m_offsets[i + 1]], in the order they were added.
+    void buildAdjacency() const
+    {
+        if (m_csrValid)
+            return;
 
-        // append this node to the ordered list
-        resolvedNodes->append(node);
+        const int count = m_nodes.count();
+        m_offsets.fill(0, count + 1);
+        for (const QPair<int, int> &edge : m_edges)
+            ++m_offsets[edge.first + 1];
+        for (int i = 0; i < count; ++i)
+            m_offsets[i + 1] += m_offsets.at(i);
+
+        QVector<int> position = m_offsets;
+        m_targets.resize(m_edges.count());
+        for (const QPair<int, int> &edge : m_edges)
+            m_targets[position[edge.first]++] = edge.second;
+        m_csrValid = true;
     }
 
 private:
+    QVector<T> m_nodes;
+    QHash<T, int> m_nodeIndex;
+    QVector<QPair<int, int> > m_edges;
+    QSet<quint64> m_edgeKeys;
+
+    mutable QVector<int> m_offsets;
+    mutable QVector<int> m_targets;
+    mutable bool m_csrValid;
+
     mutable bool m_hasCycle;
-    QHash<T, QSet<T> > m_graph;
-    mutable QPair<T,T> m_cycle;
+    mutable QList<T> m_cyclePath;
 };
 
 }
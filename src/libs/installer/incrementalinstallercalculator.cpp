@@ -0,0 +1,329 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "incrementalinstallercalculator.h"
+
+#include "component.h"
+#include "installercalculator.h"
+#include "packagemanagercore.h"
+
+#include <QPair>
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::IncrementalInstallerCalculator
+    \brief The IncrementalInstallerCalculator class keeps the set of components to install up to
+    date while the user changes the selection.
+
+    InstallerCalculator walks all components whenever it calculates, which is too slow to repeat
+    for every check state change in large component trees. This class instead applies only the
+    difference to the previous selection: it adds the dependencies and automatic dependencies of
+    newly selected components, and for deselected components removes everything that was derived
+    from them before adding back what the remaining selection still requires.
+
+    The result is the same set of components InstallerCalculator returns. It does not know about
+    installation order, install reasons, or errors. For component trees where the result of
+    InstallerCalculator depends on these, for example because of missing dependencies, dependency
+    cycles, available updates, or dependencies that require a newer version of an installed
+    component, isSupported() returns \c false and InstallerCalculator has to be used instead.
+*/
+
+// Returns whether any of the components depends on itself, directly or through other components.
+static bool hasDependencyCycle(const QHash<Component *, QList<Component *> > &dependencies)
+{
+    enum State { Visiting, Visited };
+    QHash<Component *, State> states;
+    for (auto it = dependencies.constBegin(); it != dependencies.constEnd(); ++it) {
+        if (states.contains(it.key()))
+            continue;
+
+        QList<QPair<Component *, int> > stack;
+        stack.append(qMakePair(it.key(), 0));
+        states.insert(it.key(), Visiting);
+        while (!stack.isEmpty()) {
+            Component *const current = stack.last().first;
+            const QList<Component *> next = dependencies.value(current);
+            if (stack.last().second == next.count()) {
+                states.insert(current, Visited);
+                stack.removeLast();
+                continue;
+            }
+
+            Component *const dependency = next.at(stack.last().second++);
+            const auto state = states.constFind(dependency);
+            if (state == states.constEnd()) {
+                states.insert(dependency, Visiting);
+                stack.append(qMakePair(dependency, 0));
+            } else if (state.value() == Visiting) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*!
+    Creates a calculator for \a allComponents, the same list InstallerCalculator is created with.
+*/
+IncrementalInstallerCalculator::IncrementalInstallerCalculator(
+        const QList<Component *> &allComponents)
+    : m_core(allComponents.isEmpty() ? nullptr : allComponents.first()->packageManagerCore())
+    , m_supported(true)
+    , m_foundEssentialUpdate(m_core && m_core->foundEssentialUpdate())
+    , m_installedComponentNamesRead(false)
+{
+    const QHash<QString, QList<Component *> > componentsByName =
+        PackageManagerCore::componentsByName(allComponents);
+    foreach (const QList<Component *> &components, componentsByName) {
+        if (components.count() > 1)
+            m_supported = false;
+    }
+
+    foreach (Component *component, allComponents) {
+        // updateRequested() follows the check state, so the components to walk would change
+        // with the selection
+        if (component->isUpdateAvailable())
+            m_supported = false;
+
+        QList<Component *> &dependencies = m_dependencies[component];
+        foreach (const Dependency &dependency, component->parsedDependencies()) {
+            Component *dependencyComponent =
+                PackageManagerCore::componentByName(dependency, componentsByName);
+            if (!dependencyComponent) {
+                m_supported = false;
+                continue;
+            }
+            // InstallerCalculator checks the depending component against the required version
+            if (!dependency.version().isEmpty()
+                    && !dependencyComponent->value(scInstalledVersion).isEmpty()
+                    && dependency.requiredVersion() > dependencyComponent->installedVersion()) {
+                m_supported = false;
+            }
+            dependencies.append(dependencyComponent);
+            m_dependees[dependencyComponent].append(component);
+        }
+
+        if (!component->autoDependencies().isEmpty())
+            m_autoDependOnComponents.append(component);
+    }
+    m_autoDependees = InstallerCalculator::autoDependeesByName(allComponents);
+
+    if (m_supported)
+        m_supported = !hasDependencyCycle(m_dependencies);
+}
+
+/*!
+    Returns \c true if the calculator gives the same result as InstallerCalculator for the
+    components it was created with.
+*/
+bool IncrementalInstallerCalculator::isSupported() const
+{
+    return m_supported;
+}
+
+/*!
+    Changes the selection to \a components and updates the components to install. Returns
+    \c false without changing anything if the calculator is not supported or \a components
+    contains duplicates, otherwise returns \c true.
+*/
+bool IncrementalInstallerCalculator::setSelectedComponents(const QList<Component *> &components)
+{
+    if (!m_supported)
+        return false;
+
+    const QSet<Component *> selected = components.toSet();
+    if (selected.count() != components.count())
+        return false;
+
+    if (m_core && m_core->foundEssentialUpdate() != m_foundEssentialUpdate) {
+        m_foundEssentialUpdate = !m_foundEssentialUpdate;
+        m_installedComponentNamesRead = false;
+        m_installedComponentNames.clear();
+        reset();
+    }
+
+    // InstallerCalculator does not look for automatic dependencies without a selection
+    if (selected.isEmpty()) {
+        reset();
+        return true;
+    }
+
+    const QSet<Component *> deselected = m_selectedComponents - selected;
+    const QSet<Component *> newlySelected = selected - m_selectedComponents;
+
+    // Components whose automatic dependencies are installed already are added by the first
+    // calculation with a selection, so all of them need a check then.
+    QList<Component *> candidates;
+    if (m_selectedComponents.isEmpty())
+        candidates = m_autoDependOnComponents;
+    m_selectedComponents = selected;
+
+    QList<Component *> added;
+    if (!deselected.isEmpty())
+        removeSelectedComponents(deselected, &added, &candidates);
+    foreach (Component *component, newlySelected)
+        traverse(component, &added);
+    resolveAutoDependencies(added, candidates);
+    return true;
+}
+
+/*!
+    Returns the components to install for the current selection.
+*/
+QSet<Component *> IncrementalInstallerCalculator::componentsToInstall() const
+{
+    return m_toInstallComponents;
+}
+
+void IncrementalInstallerCalculator::reset()
+{
+    m_selectedComponents.clear();
+    m_traversedComponents.clear();
+    m_toInstallComponents.clear();
+    m_toInstallComponentIds.clear();
+}
+
+/*
+    Removes everything that might have been added because of \a components, then adds back the
+    components that are still required. Components added back are appended to \a added,
+    automatic dependencies that need a new check to \a candidates.
+*/
+void IncrementalInstallerCalculator::removeSelectedComponents(const QSet<Component *> &components,
+    QList<Component *> *added, QList<Component *> *candidates)
+{
+    QSet<Component *> removed;
+    QList<Component *> stack = components.toList();
+    while (!stack.isEmpty()) {
+        Component *const component = stack.takeLast();
+        if (removed.contains(component) || !m_traversedComponents.contains(component))
+            continue;
+
+        removed.insert(component);
+        stack.append(m_dependencies.value(component));
+        if (m_toInstallComponents.contains(component))
+            stack.append(m_autoDependees.value(component->name()));
+    }
+
+    foreach (Component *component, removed) {
+        m_traversedComponents.remove(component);
+        m_toInstallComponents.remove(component);
+        m_toInstallComponentIds.remove(component->name());
+    }
+
+    foreach (Component *component, removed) {
+        if (m_selectedComponents.contains(component)) {
+            traverse(component, added);
+            continue;
+        }
+        if (!needsInstallation(component))
+            continue;
+
+        foreach (Component *dependee, m_dependees.value(component)) {
+            if (m_traversedComponents.contains(dependee)) {
+                traverse(component, added);
+                break;
+            }
+        }
+        if (!m_toInstallComponents.contains(component) && !component->autoDependencies().isEmpty())
+            candidates->append(component);
+    }
+}
+
+/*
+    Walks \a component and the dependencies InstallerCalculator would walk from it. Components
+    that were not walked before and need to be installed are appended to \a added.
+*/
+void IncrementalInstallerCalculator::traverse(Component *component, QList<Component *> *added)
+{
+    QList<Component *> stack;
+    stack.append(component);
+    while (!stack.isEmpty()) {
+        Component *const current = stack.takeLast();
+        if (m_traversedComponents.contains(current))
+            continue;
+
+        m_traversedComponents.insert(current);
+        if (needsInstallation(current)) {
+            m_toInstallComponents.insert(current);
+            m_toInstallComponentIds.insert(current->name());
+            added->append(current);
+        }
+        foreach (Component *dependency, m_dependencies.value(current)) {
+            if (needsInstallation(dependency) && !m_traversedComponents.contains(dependency))
+                stack.append(dependency);
+        }
+    }
+}
+
+/*
+    Adds the components that automatically depend on the components to install. Only the
+    \a candidates and the components that automatically depend on one of the \a added components
+    are checked, all others cannot have changed.
+*/
+void IncrementalInstallerCalculator::resolveAutoDependencies(QList<Component *> added,
+    QList<Component *> candidates)
+{
+    forever {
+        foreach (Component *component, added)
+            candidates.append(m_autoDependees.value(component->name()));
+        added.clear();
+        if (candidates.isEmpty())
+            break;
+
+        foreach (Component *component, candidates) {
+            if (!needsInstallation(component)
+                    || m_toInstallComponentIds.contains(component->name())) {
+                continue;
+            }
+            if (component->isAutoDependOn(m_toInstallComponentIds, installedComponentNames()))
+                traverse(component, &added);
+        }
+        candidates.clear();
+    }
+}
+
+// Returns the names of the installed components, read once per calculator.
+const QSet<QString> &IncrementalInstallerCalculator::installedComponentNames()
+{
+    if (!m_installedComponentNamesRead && m_core) {
+        // not needed for essential updates, see Component::isAutoDependOn()
+        if (!m_core->foundEssentialUpdate())
+            m_installedComponentNames = m_core->localInstalledPackages().keys().toSet();
+        m_installedComponentNamesRead = true;
+    }
+    return m_installedComponentNames;
+}
+
+bool IncrementalInstallerCalculator::needsInstallation(Component *component)
+{
+    return !component->isInstalled() || component->updateRequested();
+}
+
+} // namespace QInstaller
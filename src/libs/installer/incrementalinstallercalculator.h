@@ -0,0 +1,82 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef INCREMENTALINSTALLERCALCULATOR_H
+#define INCREMENTALINSTALLERCALCULATOR_H
+
+#include "installer_global.h"
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+namespace QInstaller {
+
+class Component;
+class PackageManagerCore;
+
+class INSTALLER_EXPORT IncrementalInstallerCalculator
+{
+public:
+    IncrementalInstallerCalculator(const QList<Component *> &allComponents);
+
+    bool isSupported() const;
+    bool setSelectedComponents(const QList<Component *> &components);
+    QSet<Component *> componentsToInstall() const;
+
+private:
+    void reset();
+    void removeSelectedComponents(const QSet<Component *> &components, QList<Component *> *added,
+        QList<Component *> *candidates);
+    void traverse(Component *component, QList<Component *> *added);
+    void resolveAutoDependencies(QList<Component *> added, QList<Component *> candidates);
+    const QSet<QString> &installedComponentNames();
+
+    static bool needsInstallation(Component *component);
+
+    PackageManagerCore *m_core;
+    QHash<Component *, QList<Component *> > m_dependencies;
+    QHash<Component *, QList<Component *> > m_dependees;
+    QHash<QString, QList<Component *> > m_autoDependees;
+    QList<Component *> m_autoDependOnComponents;
+    bool m_supported;
+    bool m_foundEssentialUpdate;
+    QSet<QString> m_installedComponentNames;
+    bool m_installedComponentNamesRead;
+
+    QSet<Component *> m_selectedComponents;
+    // the selected components and everything the calculation walks through from them
+    QSet<Component *> m_traversedComponents;
+    QSet<Component *> m_toInstallComponents;
+    QSet<QString> m_toInstallComponentIds;
+};
+
+}
+
+#endif // INCREMENTALINSTALLERCALCULATOR_H
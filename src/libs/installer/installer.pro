@@ -51,6 +51,7 @@ HEADERS += packagemanagercore.h \
     utils.h \
     errors.h \
     component.h \
+    dependency.h \
     scriptengine.h \
     componentmodel.h \
     qinstallerglobal.h \
@@ -62,6 +63,7 @@ HEADERS += packagemanagercore.h \
     simplemovefileoperation.h \
     extractarchiveoperation.h \
     extractarchiveoperation_p.h \
+    extractedfilesmanifest.h \
     globalsettingsoperation.h \
     createshortcutoperation.h \
     createdesktopentryoperation.h \
@@ -107,6 +109,8 @@ HEADERS += packagemanagercore.h \
     runextensions.h \
     metadatajob.h \
     metadatajob_p.h \
+    metadatacache.h \
+    metadatastore.h \
     installer_global.h \
     scriptengine_p.h \
     protocol.h \
@@ -116,12 +120,14 @@ HEADERS += packagemanagercore.h \
     remoteclient_p.h \
     remoteserver_p.h \
     remotefileengine.h \
+    remotefileoperations.h \
     remoteserverconnection.h \
     remoteserverconnection_p.h \
     fileio.h \
     binarycontent.h \
     binarylayout.h \
     installercalculator.h \
+    incrementalinstallercalculator.h \
     uninstallercalculator.h \
     componentchecker.h \
     proxycredentialsdialog.h \
@@ -148,6 +154,7 @@ SOURCES += packagemanagercore.cpp \
     fileutils.cpp \
     utils.cpp \
     component.cpp \
+    dependency.cpp \
     scriptengine.cpp \
     componentmodel.cpp \
     qtpatch.cpp \
@@ -157,6 +164,7 @@ SOURCES += packagemanagercore.cpp \
     copydirectoryoperation.cpp \
     simplemovefileoperation.cpp \
     extractarchiveoperation.cpp \
+    extractedfilesmanifest.cpp \
     globalsettingsoperation.cpp \
     createshortcutoperation.cpp \
     createdesktopentryoperation.cpp \
@@ -195,16 +203,20 @@ SOURCES += packagemanagercore.cpp \
     unziptask.cpp \
     observer.cpp \
     metadatajob.cpp \
+    metadatacache.cpp \
+    metadatastore.cpp \
     protocol.cpp \
     remoteobject.cpp \
     remoteclient.cpp \
     remoteserver.cpp \
     remotefileengine.cpp \
+    remotefileoperations.cpp \
     remoteserverconnection.cpp \
     fileio.cpp \
     binarycontent.cpp \
     binarylayout.cpp \
     installercalculator.cpp \
+    incrementalinstallercalculator.cpp \
     uninstallercalculator.cpp \
     componentchecker.cpp \
     proxycredentialsdialog.cpp \
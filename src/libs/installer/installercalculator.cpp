@@ -35,11 +35,37 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 namespace QInstaller {
 
 InstallerCalculator::InstallerCalculator(const QList<Component *> &allComponents)
     : m_allComponents(allComponents)
+    , m_componentsByName(PackageManagerCore::componentsByName(allComponents))
+    , m_autoDependees(autoDependeesByName(allComponents))
+    , m_autoDependOnChecked(false)
+    , m_installedComponentNamesRead(false)
 {
+    foreach (Component *component, allComponents) {
+        if (!component->autoDependencies().isEmpty()) {
+            m_autoDependOnPositions.insert(component, m_autoDependOnComponents.count());
+            m_autoDependOnComponents.append(component);
+        }
+    }
+}
+
+/*!
+    Returns the components of \a components that automatically depend on a name, by that name.
+*/
+QHash<QString, QList<Component *> > InstallerCalculator::autoDependeesByName(
+    const QList<Component *> &components)
+{
+    QHash<QString, QList<Component *> > autoDependees;
+    foreach (Component *component, components) {
+        foreach (const QString &name, component->autoDependencies().toSet())
+            autoDependees[name].append(component);
+    }
+    return autoDependees;
 }
 
 void InstallerCalculator::insertInstallReason(Component *component,
@@ -94,14 +120,73 @@ QString InstallerCalculator::componentsToInstallError() const
     return m_componentsToInstallError;
 }
 
+// Returns the dependency graph of \a components, each component has edges to the components of
+// the same list that need to be installed before it: its dependencies and the components it
+// automatically depends on. Components not part of the list, for example because they are
+// installed already, are left out.
+Graph<Component*> InstallerCalculator::installationGraph(const QList<Component*> &components) const
+{
+    const QSet<Component*> toInstall = components.toSet();
+    Graph<Component*> graph(components);
+    foreach (Component *component, components) {
+        const QList<Dependency> dependencies = component->parsedDependencies()
+            + component->parsedAutoDependencies();
+        foreach (const Dependency &required, dependencies) {
+            Component *dependency = PackageManagerCore::componentByName(required, m_componentsByName);
+            if (dependency && dependency != component && toInstall.contains(dependency))
+                graph.addEdge(component, dependency);
+        }
+    }
+    return graph;
+}
+
 void InstallerCalculator::realAppendToInstallComponents(Component *component, const QString &version)
 {
     if (!component->isInstalled(version) || component->updateRequested()) {
         m_orderedComponentsToInstall.append(component);
         m_toInstallComponentIds.insert(component->name());
+        m_autoDependOnTriggers.append(component->name());
     }
 }
 
+// Returns the components whose automatic dependencies may have been fulfilled since the last
+// call, in the order of m_allComponents. The first call returns all components with automatic
+// dependencies, as some of them may depend on installed components only.
+QList<Component *> InstallerCalculator::autoDependOnCandidates()
+{
+    if (!m_autoDependOnChecked) {
+        m_autoDependOnChecked = true;
+        m_autoDependOnTriggers.clear();
+        return m_autoDependOnComponents;
+    }
+
+    QSet<Component *> candidates;
+    foreach (const QString &name, m_autoDependOnTriggers) {
+        foreach (Component *component, m_autoDependees.value(name))
+            candidates.insert(component);
+    }
+    m_autoDependOnTriggers.clear();
+
+    QList<Component *> ordered = candidates.toList();
+    std::sort(ordered.begin(), ordered.end(), [this](Component *lhs, Component *rhs) {
+        return m_autoDependOnPositions.value(lhs) < m_autoDependOnPositions.value(rhs);
+    });
+    return ordered;
+}
+
+// Returns the names of the installed components, read once per calculator.
+const QSet<QString> &InstallerCalculator::installedComponentNames()
+{
+    if (!m_installedComponentNamesRead && !m_allComponents.isEmpty()) {
+        PackageManagerCore *core = m_allComponents.first()->packageManagerCore();
+        // not needed for essential updates, see Component::isAutoDependOn()
+        if (!core->foundEssentialUpdate())
+            m_installedComponentNames = core->localInstalledPackages().keys().toSet();
+        m_installedComponentNamesRead = true;
+    }
+    return m_installedComponentNames;
+}
+
 QString InstallerCalculator::recursionError(Component *component)
 {
     return QCoreApplication::translate("InstallerCalculator", "Recursion detected, component \"%1\" "
@@ -137,14 +222,16 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
 
     QList<Component *> foundAutoDependOnList;
     // All regular dependencies are resolved. Now we are looking for auto depend on components.
-    foreach (Component *component, m_allComponents) {
+    // Only components that depend on a component added since the last check can have changed.
+    foreach (Component *component, autoDependOnCandidates()) {
         // If a components is already installed or is scheduled for installation, no need to check
         // for auto depend installation.
         if ((!component->isInstalled() || component->updateRequested())
             && !m_toInstallComponentIds.contains(component->name())) {
                 // If we figure out a component requests auto installation, keep it to resolve
                 // their dependencies as well.
-                if (component->isAutoDependOn(m_toInstallComponentIds)) {
+                if (component->isAutoDependOn(m_toInstallComponentIds,
+                        installedComponentNames())) {
                     foundAutoDependOnList.append(component);
                     insertInstallReason(component, InstallerCalculator::Automatic);
                 }
@@ -158,16 +245,15 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
 
 bool InstallerCalculator::appendComponentToInstall(Component *component, const QString &version)
 {
-    QSet<QString> allDependencies = component->dependencies().toSet();
     QString requiredDependencyVersion = version;
-    foreach (const QString &dependencyComponentName, allDependencies) {
-        // PackageManagerCore::componentByName returns 0 if dependencyComponentName contains a
+    foreach (const Dependency &dependency, component->parsedDependencies()) {
+        // PackageManagerCore::componentByName returns 0 if the dependency contains a
         // version which is not available
         Component *dependencyComponent =
-            PackageManagerCore::componentByName(dependencyComponentName, m_allComponents);
+            PackageManagerCore::componentByName(dependency, m_componentsByName);
         if (!dependencyComponent) {
             const QString errorMessage = QCoreApplication::translate("InstallerCalculator",
-                "Cannot find missing dependency \"%1\" for \"%2\".").arg(dependencyComponentName,
+                "Cannot find missing dependency \"%1\" for \"%2\".").arg(dependency.requirement(),
                 component->name());
             qCWarning(QInstaller::lcInstallerInstallLog).noquote() << errorMessage;
             m_componentsToInstallError.append(errorMessage);
@@ -180,20 +266,11 @@ bool InstallerCalculator::appendComponentToInstall(Component *component, const Q
         }
         //Check if component requires higher version than what might be already installed
         bool isUpdateRequired = false;
-        QString requiredName;
-        QString requiredVersion;
-        PackageManagerCore::parseNameAndVersion(dependencyComponentName, &requiredName, &requiredVersion);
-        if (!requiredVersion.isEmpty() &&
+        if (!dependency.version().isEmpty() &&
                 !dependencyComponent->value(scInstalledVersion).isEmpty()) {
-            QRegExp compEx(QLatin1String("([<=>]+)(.*)"));
-            const QString installedVersion = compEx.exactMatch(dependencyComponent->value(scInstalledVersion)) ?
-                compEx.cap(2) : dependencyComponent->value(scInstalledVersion);
-
-            requiredVersion = compEx.exactMatch(requiredVersion) ? compEx.cap(2) : requiredVersion;
-
-            if (KDUpdater::compareVersion(requiredVersion, installedVersion) >= 1 ) {
+            if (dependency.requiredVersion() > dependencyComponent->installedVersion()) {
                 isUpdateRequired = true;
-                requiredDependencyVersion = requiredVersion;
+                requiredDependencyVersion = dependency.requiredVersion().toString();
             }
         }
         //Check dependencies only if
@@ -29,11 +29,13 @@
 #define INSTALLERCALCULATOR_H
 
 #include "installer_global.h"
+#include "graph.h"
 
 #include <QHash>
 #include <QList>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 
 namespace QInstaller {
 
@@ -57,9 +59,13 @@ public:
     QString installReason(Component *component) const;
     QList<Component*> orderedComponentsToInstall() const;
     QString componentsToInstallError() const;
+    Graph<Component*> installationGraph(const QList<Component*> &components) const;
 
     bool appendComponentsToInstall(const QList<Component*> &components);
 
+    static QHash<QString, QList<Component *> > autoDependeesByName(
+        const QList<Component *> &components);
+
 private:
     void insertInstallReason(Component *component,
                              InstallReasonType installReasonType,
@@ -67,8 +73,21 @@ private:
     void realAppendToInstallComponents(Component *component, const QString &version = QString());
     bool appendComponentToInstall(Component *components, const QString &version = QString());
     QString recursionError(Component *component);
+    QList<Component *> autoDependOnCandidates();
+    const QSet<QString> &installedComponentNames();
 
     QList<Component*> m_allComponents;
+    QHash<QString, QList<Component *> > m_componentsByName; //for faster lookups
+    // < name, components that automatically depend on it >
+    QHash<QString, QList<Component *> > m_autoDependees;
+    // components with automatic dependencies, with their position in m_allComponents
+    QList<Component *> m_autoDependOnComponents;
+    QHash<Component *, int> m_autoDependOnPositions;
+    // names added to install since the automatic dependencies were last checked
+    QStringList m_autoDependOnTriggers;
+    bool m_autoDependOnChecked;
+    QSet<QString> m_installedComponentNames;
+    bool m_installedComponentNamesRead;
     QHash<Component*, QSet<Component*> > m_visitedComponents;
     QSet<QString> m_toInstallComponentIds; //for faster lookups
     QString m_componentsToInstallError;
@@ -44,26 +44,42 @@
 #include <Common/MyCom.h>
 #include <7zip/Archive/IArchive.h>
 
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
 #include <QString>
+#include <QVector>
+
+#include <memory>
 
 class CArc;
 
 QT_BEGIN_NAMESPACE
 class QFileDevice;
+class QIODevice;
 QT_END_NAMESPACE
 
 namespace Lib7z
 {
+    class WriteBehindFile;
+    class WriteBehindGroup;
+    class WriteBehindPool;
+
     class INSTALLER_EXPORT ExtractCallback : public IArchiveExtractCallback, public CMyUnknownImp
     {
         Q_DISABLE_COPY(ExtractCallback)
 
     public:
-        ExtractCallback() = default;
-        virtual ~ExtractCallback() = default;
+        ExtractCallback();
+        virtual ~ExtractCallback();
 
         void setArchive(CArc *carc) { arc = carc; }
         void setTarget(const QString &dir) { targetDir = dir; }
+        void setEmptyDirectories(const QSet<QString> &dirs);
+        void setWriteBehind(int writerCount, qint64 maxPendingBytes = 32 * 1024 * 1024);
+        void setWriteBehind(const QSharedPointer<WriteBehindPool> &pool);
+        HRESULT finishWriting();
 
         MY_UNKNOWN_IMP
         INTERFACE_IArchiveExtractCallback(;)
@@ -73,17 +89,56 @@ namespace Lib7z
         virtual void setCurrentFile(const QString &filename) { Q_UNUSED(filename) }
         virtual HRESULT setCompleted(quint64 /*completed*/, quint64 /*total*/) { return S_OK; }
 
-    private:
+    protected:
         CArc *arc = 0;
 
+    private:
+        HRESULT writeBehindError() const;
+
+    private:
         QString targetDir;
         quint64 total = 0;
         quint64 completed = 0;
         quint32 currentIndex = 0;
+        QString currentPath;
+        QSet<QString> existingDirectories;
+        QSet<QString> emptyDirectories;
+
+        std::unique_ptr<WriteBehindGroup> writeBehind;
+        QSharedPointer<WriteBehindFile> currentWriteBehindFile;
+        QSet<QString> writtenPaths;
+    };
+
+    class INSTALLER_EXPORT BackupExtractCallback : public ExtractCallback
+    {
+        Q_DISABLE_COPY(BackupExtractCallback)
+
+    public:
+        typedef QVector<QPair<QString, QString> > BackupFiles;
+
+        BackupExtractCallback() = default;
+
+        BackupFiles backupFiles() const { return m_backupFiles; }
+
+    protected:
+        bool prepareForFile(const QString &filename) Q_DECL_OVERRIDE;
+        void setBackupFiles(const BackupFiles &backupFiles) { m_backupFiles = backupFiles; }
+
+    private:
+        BackupFiles m_backupFiles;
     };
 
+    QSharedPointer<WriteBehindPool> INSTALLER_EXPORT createWriteBehindPool(int writerCount,
+        qint64 maxPendingBytes = 32 * 1024 * 1024);
+
     void INSTALLER_EXPORT extractArchive(QFileDevice *archive, const QString &targetDirectory,
         ExtractCallback *callback = 0);
+    void INSTALLER_EXPORT extractArchive(QIODevice *archive, const QString &archiveName,
+        const QString &targetDirectory, ExtractCallback *callback = 0);
+    void INSTALLER_EXPORT extractArchive(QIODevice *archive, const QString &archiveName,
+        const QString &targetDirectory, const QVector<quint32> &items, ExtractCallback *callback);
+    QHash<QString, QByteArray> INSTALLER_EXPORT extractArchiveToMemory(QIODevice *archive,
+        const QString &archiveName);
 
 } // namespace Lib7z
 
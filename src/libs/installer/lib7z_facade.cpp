@@ -53,6 +53,7 @@
 #include <Windows/PropVariant.h>
 #include <Windows/PropVariantConv.h>
 
+#include <QBuffer>
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
@@ -60,7 +61,11 @@
 #include <QPointer>
 #include <QReadWriteLock>
 #include <QTemporaryFile>
+#include <QThreadPool>
+#include <QWaitCondition>
 
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <memory>
 
@@ -456,6 +461,329 @@ private:
     std::unique_ptr<QIODevice> m_device;
 };
 
+// -- write-behind
+
+// The attributes of an extracted file, applied once its content is written.
+struct FileAttributes
+{
+    FILETIME mTime = { 0, 0 };
+    FILETIME cTime = { 0, 0 };
+    FILETIME aTime = { 0, 0 };
+    bool hasMTime = false;
+    bool hasCATime = false;
+    bool hasPermissions = false;
+    QFile::Permissions permissions = nullptr;
+};
+
+static FileAttributes readFileAttributes(IInArchive *archive, int index)
+{
+    FileAttributes attributes;
+    try {
+        // This might fail for archives without all properties, we can only be sure
+        // about modification time, as it's always stored by default in 7z archives.
+        attributes.hasMTime = getFileTimeFromProperty(archive, index, kpidMTime,
+            &attributes.mTime);
+#ifdef Q_OS_WIN
+        attributes.hasCATime = getFileTimeFromProperty(archive, index, kpidCTime,
+            &attributes.cTime) && getFileTimeFromProperty(archive, index, kpidATime,
+            &attributes.aTime);
+#endif
+    } catch (...) {}
+    attributes.permissions = getPermissions(archive, index, &attributes.hasPermissions);
+    return attributes;
+}
+
+static void applyFileAttributes(const QString &filePath, const FileAttributes &attributes)
+{
+    try {   // Note: This part might also fail while running a elevated installation.
+        // Also note that we restore modification time on Unix only, as access time
+        // and change time are supposed to be set to the time of installation.
+        const UString fileName = QString2UString(filePath);
+        if (attributes.hasMTime) {
+            NWindows::NFile::NIO::COutFile file;
+            if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
+                file.SetTime(&attributes.mTime, &attributes.mTime, &attributes.mTime);
+        }
+#ifdef Q_OS_WIN
+        if (attributes.hasCATime) {
+            NWindows::NFile::NIO::COutFile file;
+            if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
+                file.SetTime(&attributes.cTime, &attributes.aTime, &attributes.mTime);
+        }
+#endif
+    } catch (...) {}
+
+    if (attributes.hasPermissions)
+        QFile::setPermissions(filePath, attributes.permissions);
+}
+
+static bool isSymLink(IInArchive *archive, int index)
+{
+    const quint32 attributes = getUInt32Property(archive, index, kpidAttrib, 0);
+    struct stat stat_info;
+    stat_info.st_mode = attributes >> 16;
+    return S_ISLNK(stat_info.st_mode);
+}
+
+/*
+    Writes the extracted files on a few threads of its own, so that decoding does not wait for
+    creating, writing, and closing files. Several extract callbacks can share a pool, posting
+    blocks while more than the maximum number of bytes waits to be written by any of them.
+*/
+class WriteBehindPool
+{
+    Q_DISABLE_COPY(WriteBehindPool)
+
+public:
+    WriteBehindPool(int writerCount, qint64 maxPendingBytes)
+        : m_maxPendingBytes(maxPendingBytes)
+    {
+        m_pool.setMaxThreadCount(writerCount);
+    }
+
+    ~WriteBehindPool()
+    {
+        m_pool.waitForDone();
+    }
+
+    void acquire(qint64 bytes)
+    {
+        QMutexLocker _(&m_mutex);
+        while (m_pendingBytes > 0 && m_pendingBytes + bytes > m_maxPendingBytes)
+            m_bytesReleased.wait(&m_mutex);
+        m_pendingBytes += bytes;
+    }
+
+    void release(qint64 bytes)
+    {
+        QMutexLocker _(&m_mutex);
+        m_pendingBytes -= bytes;
+        m_bytesReleased.wakeAll();
+    }
+
+    void start(QRunnable *runnable)
+    {
+        m_pool.start(runnable);
+    }
+
+private:
+    QThreadPool m_pool;
+    const qint64 m_maxPendingBytes;
+    qint64 m_pendingBytes = 0;
+    QMutex m_mutex;
+    QWaitCondition m_bytesReleased;
+};
+
+/*
+    The files one extract callback writes through a WriteBehindPool. Tasks posted for the same
+    file run in order, different files are written in parallel. Keeps the first error of its own
+    files for the callback to report, and lets the callback wait for its own files only.
+*/
+class WriteBehindGroup
+{
+    Q_DISABLE_COPY(WriteBehindGroup)
+
+public:
+    explicit WriteBehindGroup(const QSharedPointer<WriteBehindPool> &pool)
+        : m_pool(pool)
+    {}
+
+    ~WriteBehindGroup()
+    {
+        waitForDone();
+    }
+
+    void acquire(qint64 bytes)
+    {
+        m_pool->acquire(bytes);
+        QMutexLocker _(&m_mutex);
+        ++m_pendingTasks;
+    }
+
+    void release(qint64 bytes)
+    {
+        m_pool->release(bytes);
+        QMutexLocker _(&m_mutex);
+        if (--m_pendingTasks == 0)
+            m_done.wakeAll();
+    }
+
+    void start(QRunnable *runnable)
+    {
+        m_pool->start(runnable);
+    }
+
+    void waitForDone()
+    {
+        QMutexLocker _(&m_mutex);
+        while (m_pendingTasks > 0)
+            m_done.wait(&m_mutex);
+    }
+
+    void setError(const QString &error)
+    {
+        QMutexLocker _(&m_mutex);
+        if (m_error.isEmpty())
+            m_error = error;
+    }
+
+    QString error() const
+    {
+        QMutexLocker _(&m_mutex);
+        return m_error;
+    }
+
+private:
+    const QSharedPointer<WriteBehindPool> m_pool;
+    int m_pendingTasks = 0;
+    QString m_error;
+    mutable QMutex m_mutex;
+    QWaitCondition m_done;
+};
+
+/*
+    A file written by a WriteBehindGroup. The decoder posts the tasks to open, write, and close
+    the file, a writer thread runs them. A failed task skips the remaining tasks of the file.
+*/
+class WriteBehindFile : public QEnableSharedFromThis<WriteBehindFile>
+{
+    Q_DISABLE_COPY(WriteBehindFile)
+
+public:
+    typedef std::function<QString (QFile *file)> Task;
+
+    WriteBehindFile(WriteBehindGroup *group, const QString &filePath)
+        : m_group(group)
+        , m_file(filePath)
+    {}
+
+    void post(const Task &task, qint64 bytes = 0)
+    {
+        // account for the task itself as well, to bound the queue for many small files
+        bytes += sizeof(Task);
+        m_group->acquire(bytes);
+
+        QMutexLocker _(&m_mutex);
+        m_tasks.push_back(qMakePair(task, bytes));
+        if (m_scheduled)
+            return;
+        m_scheduled = true;
+        m_group->start(new Writer(sharedFromThis()));
+    }
+
+private:
+    class Writer : public QRunnable
+    {
+    public:
+        explicit Writer(const QSharedPointer<WriteBehindFile> &file)
+            : m_file(file)
+        {}
+
+        void run() Q_DECL_OVERRIDE
+        {
+            m_file->runTasks();
+        }
+
+    private:
+        const QSharedPointer<WriteBehindFile> m_file;
+    };
+
+    void runTasks()
+    {
+        forever {
+            QPair<Task, qint64> task;
+            {
+                QMutexLocker _(&m_mutex);
+                if (m_tasks.empty()) {
+                    m_scheduled = false;
+                    return;
+                }
+                task = m_tasks.front();
+                m_tasks.pop_front();
+            }
+
+            if (!m_failed) {
+                const QString error = task.first(&m_file);
+                if (!error.isEmpty()) {
+                    m_failed = true;
+                    m_file.close();
+                    m_group->setError(error);
+                }
+            }
+            m_group->release(task.second);
+        }
+    }
+
+private:
+    WriteBehindGroup *const m_group;
+    QFile m_file;
+    bool m_failed = false;
+
+    QMutex m_mutex;
+    std::deque<QPair<Task, qint64> > m_tasks;
+    bool m_scheduled = false;
+};
+
+/*
+    Collects the decoded data of a file and hands it to the WriteBehindFile in chunks. Releasing
+    the stream hands over the rest and closes the file.
+*/
+class WriteBehindOutStream : public ISequentialOutStream, public CMyUnknownImp
+{
+    Q_DISABLE_COPY(WriteBehindOutStream)
+
+public:
+    MY_UNKNOWN_IMP
+
+    explicit WriteBehindOutStream(const QSharedPointer<WriteBehindFile> &file)
+        : ISequentialOutStream()
+        , m_file(file)
+    {}
+
+    ~WriteBehindOutStream()
+    {
+        postBuffer();
+        m_file->post([](QFile *file) {
+            file->close();
+            return file->error() == QFileDevice::NoError ? QString()
+                : QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(file->fileName()),
+                file->errorString());
+        });
+    }
+
+    STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
+    {
+        m_buffer.append(reinterpret_cast<const char*>(data), size);
+        if (m_buffer.size() >= ChunkSize)
+            postBuffer();
+        if (processedSize)
+            *processedSize = size;
+        return S_OK;
+    }
+
+private:
+    enum { ChunkSize = 1024 * 1024 };
+
+    void postBuffer()
+    {
+        if (m_buffer.isEmpty())
+            return;
+        const QByteArray data = m_buffer;
+        m_buffer.clear();
+        m_file->post([data](QFile *file) {
+            return file->write(data) == data.size() ? QString()
+                : QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(file->fileName()),
+                file->errorString());
+        }, data.size());
+    }
+
+private:
+    QSharedPointer<WriteBehindFile> m_file;
+    QByteArray m_buffer;
+};
+
 class QIODeviceInStream : public IInStream, public CMyUnknownImp
 {
     Q_DISABLE_COPY(QIODeviceInStream)
@@ -582,6 +910,9 @@ QVector<File> listArchive(QFileDevice *archive)
                 getDateTimeProperty(arch, item, kpidMTime, &(f.utcTime));
                 f.uncompressedSize = getUInt64Property(arch, item, kpidSize, 0);
                 f.compressedSize = getUInt64Property(arch, item, kpidPackSize, 0);
+                const NCOM::CPropVariant block = readProperty(arch, item, kpidBlock);
+                if (block.vt == VT_UI4)
+                    f.block = static_cast<int>(block.ulVal);
                 flat.append(f);
             }
         }
@@ -603,6 +934,14 @@ QVector<File> listArchive(QFileDevice *archive)
 
 // -- ExtractCallback
 
+ExtractCallback::ExtractCallback()
+{
+}
+
+ExtractCallback::~ExtractCallback()
+{
+}
+
 STDMETHODIMP ExtractCallback::SetTotal(UInt64 t)
 {
     total = t;
@@ -612,18 +951,89 @@ STDMETHODIMP ExtractCallback::SetTotal(UInt64 t)
 STDMETHODIMP ExtractCallback::SetCompleted(const UInt64 *c)
 {
     completed = *c;
+    if (writeBehindError() != S_OK)
+        return E_FAIL;
     if (total > 0)
         return setCompleted(completed, total);
     return S_OK;
 }
 
+/*!
+    Lets \a writerCount threads create, write, and close the extracted files, while the archive
+    is decoded. Data waiting to be written is limited to \a maxPendingBytes, decoding waits if
+    the writers fall behind. Write errors are reported by failing the next callback. A
+    \a writerCount of \c 0 writes the files while decoding, which is the default.
+
+    \note The extractArchive() functions wait for the files to be written before returning.
+*/
+void ExtractCallback::setWriteBehind(int writerCount, qint64 maxPendingBytes)
+{
+    setWriteBehind(writerCount > 0 ? createWriteBehindPool(writerCount, maxPendingBytes)
+        : QSharedPointer<WriteBehindPool>());
+}
+
+/*!
+    \overload
+
+    Lets the threads of \a pool write the extracted files. Callbacks extracting at the same time
+    can share a pool, so that its threads and its limit for the data waiting to be written hold
+    for all of them. Write errors only fail the callback whose file could not be written. A null
+    \a pool writes the files while decoding.
+*/
+void ExtractCallback::setWriteBehind(const QSharedPointer<WriteBehindPool> &pool)
+{
+    finishWriting();
+    writeBehind.reset(pool ? new WriteBehindGroup(pool) : nullptr);
+}
+
+/*!
+    Waits until the files extracted so far are written. Returns \c S_OK on success, otherwise
+    sets the last error and returns \c E_FAIL.
+*/
+HRESULT ExtractCallback::finishWriting()
+{
+    if (!writeBehind)
+        return S_OK;
+    currentWriteBehindFile.clear();
+    writeBehind->waitForDone();
+    return writeBehindError();
+}
+
+HRESULT ExtractCallback::writeBehindError() const
+{
+    if (!writeBehind)
+        return S_OK;
+    const QString error = writeBehind->error();
+    if (error.isEmpty())
+        return S_OK;
+    setLastError(error);
+    return E_FAIL;
+}
+
+/*!
+    Tells the callback that the directories \a dirs exist and are empty, given as absolute paths
+    with \c / as separator. Files extracted into them cannot replace anything but files extracted
+    before by this callback, so extracting skips the checks for existing files and symlinks for
+    all other files. Use it if the target directory is known to be empty, for example because it
+    was just created. Directories created while extracting are known to be empty anyway.
+*/
+void ExtractCallback::setEmptyDirectories(const QSet<QString> &dirs)
+{
+    emptyDirectories = dirs;
+    existingDirectories += dirs;
+}
+
 // this method will be called by CFolderOutStream::OpenFile to stream via
 // CDecoder::CodeSpec extracted content to an output stream.
 STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **outStream, Int32 /*askExtractMode*/)
 {
     *outStream = nullptr;
+    currentPath.clear();
+    currentWriteBehindFile.clear();
     if (targetDir.isEmpty())
         return E_FAIL;
+    if (writeBehindError() != S_OK)
+        return E_FAIL;
 
     Q_ASSERT(arc);
     currentIndex = index;
@@ -635,44 +1045,82 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
         return E_FAIL;
     }
 
-    const QFileInfo fi(QString::fromLatin1("%1/%2").arg(targetDir, UString2QString(s)));
-
-    DirectoryGuard guard(fi.absolutePath());
-    const QStringList directories = guard.tryCreate();
+    // resolve the path once, SetOperationResult() reuses it
+    const QFileInfo fi(QString::fromLatin1("%1/%2").arg(targetDir,
+        UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'))));
+    const QString parent = fi.absolutePath();
+
+    // Most items go to a directory seen before, do not check for its existence over and over.
+    DirectoryGuard guard(parent);
+    QStringList directories;
+    if (!existingDirectories.contains(parent)) {
+        directories = guard.tryCreate();
+        existingDirectories.insert(parent);
+        foreach (const QString &created, directories) {
+            existingDirectories.insert(created);
+            emptyDirectories.insert(created);
+        }
+    }
 
     bool isDir = false;
     Archive_IsItem_Folder(arc->Archive, index, isDir);
-    if (isDir)
-        QDir(fi.absolutePath()).mkdir(fi.fileName());
+    currentPath = fi.absoluteFilePath();
+    // Nothing to replace in a directory that was empty before extracting, except for what
+    // was extracted to the same path before, for example an archive listing it twice.
+    const bool replaces = !emptyDirectories.contains(parent) || writtenPaths.contains(currentPath);
+    if (isDir && !existingDirectories.contains(currentPath)) {
+        if (QDir(parent).mkdir(fi.fileName()))
+            emptyDirectories.insert(currentPath);
+        existingDirectories.insert(currentPath);
+    }
 
     // this makes sure that all directories created get removed as well
     foreach (const QString &directory, directories)
         setCurrentFile(directory);
 
-    if (!isDir && !prepareForFile(fi.absoluteFilePath()))
+    // an item replacing one written before needs to wait for it
+    if (!isDir && writeBehind && writtenPaths.contains(currentPath))
+        writeBehind->waitForDone();
+
+    if (!isDir && replaces && !prepareForFile(currentPath))
         return E_FAIL;
 
-    setCurrentFile(fi.absoluteFilePath());
+    setCurrentFile(currentPath);
 
     if (!isDir) {
+        writtenPaths.insert(currentPath);
 #ifndef Q_OS_WIN
         // do not follow symlinks, so we need to remove an existing one
-        if (fi.isSymLink() && (!QFile::remove(fi.absoluteFilePath()))) {
+        if (replaces && fi.isSymLink() && (!QFile::remove(currentPath))) {
             setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                "Cannot remove already existing symlink %1.").arg(fi.absoluteFilePath()));
+                "Cannot remove already existing symlink %1.").arg(currentPath));
             return E_FAIL;
         }
 #endif
-        std::unique_ptr<QFile> file(new QFile(fi.absoluteFilePath()));
-        if (!file->open(QIODevice::WriteOnly)) {
-            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                                                     "Cannot open file \"%1\" for writing: %2").arg(
-                             QDir::toNativeSeparators(fi.absoluteFilePath()), file->errorString()));
-            return E_FAIL;
+        // symlinks are created from the written file in SetOperationResult()
+        if (writeBehind && !isSymLink(arc->Archive, index)) {
+            currentWriteBehindFile.reset(new WriteBehindFile(writeBehind.get(), currentPath));
+            currentWriteBehindFile->post([](QFile *file) {
+                return file->open(QIODevice::WriteOnly) ? QString()
+                    : QCoreApplication::translate("ExtractCallbackImpl",
+                    "Cannot open file \"%1\" for writing: %2").arg(
+                    QDir::toNativeSeparators(file->fileName()), file->errorString());
+            });
+            CMyComPtr<ISequentialOutStream> stream =
+                new WriteBehindOutStream(currentWriteBehindFile);
+            *outStream = stream.Detach(); // CMyComPtr is needed, otherwise it crashes in Write().
+        } else {
+            std::unique_ptr<QFile> file(new QFile(currentPath));
+            if (!file->open(QIODevice::WriteOnly)) {
+                setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                    "Cannot open file \"%1\" for writing: %2").arg(
+                    QDir::toNativeSeparators(currentPath), file->errorString()));
+                return E_FAIL;
+            }
+            CMyComPtr<ISequentialOutStream> stream =
+                new QIODeviceSequentialOutStream(std::move(file));
+            *outStream = stream.Detach(); // CMyComPtr is needed, otherwise it crashes in Write().
         }
-        CMyComPtr<ISequentialOutStream> stream =
-            new QIODeviceSequentialOutStream(std::move(file));
-        *outStream = stream.Detach(); // CMyComPtr is needed, otherwise it crashes in Write().
     }
 
     guard.release();
@@ -686,24 +1134,15 @@ STDMETHODIMP ExtractCallback::PrepareOperation(Int32 /*askExtractMode*/)
 
 STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*/)
 {
-    if (targetDir.isEmpty())
+    if (targetDir.isEmpty() || currentPath.isEmpty())
         return S_OK;
-
-    UString s;
-    if (arc->GetItemPath(currentIndex, s) != S_OK) {
-        setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-            "Cannot retrieve path of archive item %1.").arg(currentIndex));
+    if (writeBehindError() != S_OK)
         return E_FAIL;
-    }
 
-    const QString absFilePath = QFileInfo(QString::fromLatin1("%1/%2").arg(targetDir,
-        UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/')))).absoluteFilePath();
+    const QString absFilePath = currentPath;
 
     // do we have a symlink?
-    const quint32 attributes = getUInt32Property(arc->Archive, currentIndex, kpidAttrib, 0);
-    struct stat stat_info;
-    stat_info.st_mode = attributes >> 16;
-    if (S_ISLNK(stat_info.st_mode)) {
+    if (isSymLink(arc->Archive, currentIndex)) {
 #ifdef Q_OS_WIN
         qFatal(QString::fromLatin1("Creating a link from archive is not implemented for "
             "windows. Link filename: %1").arg(absFilePath).toLatin1());
@@ -741,35 +1180,141 @@ STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*
 #endif
     }
 
-    try {   // Note: This part might also fail while running a elevated installation.
-        if (!absFilePath.isEmpty()) {
-            // This might fail for archives without all properties, we can only be sure
-            // about modification time, as it's always stored by default in 7z archives.
-            // Also note that we restore modification time on Unix only, as access time
-            // and change time are supposed to be set to the time of installation.
-            FILETIME mTime;
-            const UString fileName = QString2UString(absFilePath);
-            if (getFileTimeFromProperty(arc->Archive, currentIndex, kpidMTime, &mTime)) {
-                NWindows::NFile::NIO::COutFile file;
-                if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
-                    file.SetTime(&mTime, &mTime, &mTime);
-            }
-#ifdef Q_OS_WIN
-            FILETIME cTime, aTime;
-            if (getFileTimeFromProperty(arc->Archive, currentIndex, kpidCTime, &cTime)
-                && getFileTimeFromProperty(arc->Archive, currentIndex, kpidATime, &aTime)) {
-                    NWindows::NFile::NIO::COutFile file;
-                    if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
-                        file.SetTime(&cTime, &aTime, &mTime);
-            }
-#endif
-        }
-    } catch (...) {}
+    const FileAttributes attributes = readFileAttributes(arc->Archive, currentIndex);
+    if (currentWriteBehindFile) {
+        // the file is closed by now, as 7-Zip releases the stream before calling us
+        currentWriteBehindFile->post([attributes](QFile *file) {
+            applyFileAttributes(file->fileName(), attributes);
+            return QString();
+        });
+        currentWriteBehindFile.clear();
+        return S_OK;
+    }
+    applyFileAttributes(absFilePath, attributes);
+    return S_OK;
+}
+
+
+// -- BackupExtractCallback
+
+/*!
+    \class Lib7z::BackupExtractCallback
+    \inmodule QtInstallerFramework
+    \brief The BackupExtractCallback class moves files replaced by an extracted archive aside.
+
+    Existing files are renamed before the archive overwrites them. backupFiles() lists the
+    original and backup names, so the files can be restored when the extraction gets undone.
+*/
+
+/*!
+    \fn Lib7z::BackupExtractCallback::backupFiles() const
+
+    Returns the pairs of original and backup file names of the files replaced so far.
+*/
+
+/*!
+    \fn Lib7z::BackupExtractCallback::setBackupFiles(const BackupFiles &backupFiles)
+
+    Sets the list of replaced files to \a backupFiles, for files replaced by someone else
+    extracting on behalf of this callback.
+*/
+
+static QString generateBackupName(const QString &fn)
+{
+    const QString bfn = fn + QLatin1String(".tmpUpdate");
+    QString res = bfn;
+    int i = 0;
+    while (QFile::exists(res))
+        res = bfn + QString::fromLatin1(".%1").arg(i++);
+    return res;
+}
+
+/*!
+    Renames \a filename to a free backup name if it exists. Returns \c false if the file cannot
+    be renamed, which aborts the extraction.
+*/
+bool BackupExtractCallback::prepareForFile(const QString &filename)
+{
+    if (!QFile::exists(filename))
+        return true;
+    const QString backup = generateBackupName(filename);
+    QFile f(filename);
+    const bool renamed = f.rename(backup);
+    if (f.exists() && !renamed) {
+        qCritical("Cannot rename %s to %s: %s", qPrintable(filename), qPrintable(backup),
+            qPrintable(f.errorString()));
+        return false;
+    }
+    m_backupFiles.append(qMakePair(filename, backup));
+    return true;
+}
+
+
+// -- MemoryExtractCallback
+
+/*
+    Collects the files of an archive in memory instead of writing them to disk. Directories
+    are skipped, the file names are relative to the archive root.
+*/
+class MemoryExtractCallback : public ExtractCallback
+{
+    Q_DISABLE_COPY(MemoryExtractCallback)
+
+public:
+    MemoryExtractCallback() = default;
+
+    QHash<QString, QByteArray> files() const { return m_files; }
+
+    STDMETHOD(GetStream)(UInt32 index, ISequentialOutStream **outStream, Int32 askExtractMode);
+    STDMETHOD(SetOperationResult)(Int32 resultEOperationResult);
+
+private:
+    QString m_currentPath;
+    QByteArray m_currentData;
+    QHash<QString, QByteArray> m_files;
+};
+
+STDMETHODIMP MemoryExtractCallback::GetStream(UInt32 index, ISequentialOutStream **outStream,
+    Int32 /*askExtractMode*/)
+{
+    *outStream = nullptr;
+    m_currentPath.clear();
+
+    Q_ASSERT(arc);
+    UString s;
+    if (arc->GetItemPath(index, s) != S_OK) {
+        setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+            "Cannot retrieve path of archive item %1.").arg(index));
+        return E_FAIL;
+    }
+
+    bool isDir = false;
+    Archive_IsItem_Folder(arc->Archive, index, isDir);
+    if (isDir)
+        return S_OK;
+
+    m_currentPath = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
+    m_currentData.clear();
+
+    std::unique_ptr<QBuffer> buffer(new QBuffer(&m_currentData));
+    buffer->open(QIODevice::WriteOnly);
+    CMyComPtr<ISequentialOutStream> stream = new QIODeviceSequentialOutStream(std::move(buffer));
+    *outStream = stream.Detach(); // CMyComPtr is needed, otherwise it crashes in Write().
+    return S_OK;
+}
 
-    bool hasPerm = false;
-    const QFile::Permissions permissions = getPermissions(arc->Archive, currentIndex, &hasPerm);
-    if (hasPerm)
-        QFile::setPermissions(absFilePath, permissions);
+STDMETHODIMP MemoryExtractCallback::SetOperationResult(Int32 resultEOperationResult)
+{
+    if (m_currentPath.isEmpty())
+        return S_OK;
+
+    if (resultEOperationResult != NArchive::NExtract::NOperationResult::kOK) {
+        setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+            "Cannot extract archive item \"%1\".").arg(m_currentPath));
+        return E_FAIL;
+    }
+    m_files.insert(m_currentPath, m_currentData);
+    m_currentPath.clear();
     return S_OK;
 }
 
@@ -1078,6 +1623,70 @@ void createArchive(const QString &archive, const QStringList &sources, TmpFile m
     }
 }
 
+static void extractWithCallback(QIODevice *archive, const QString &archiveName,
+    ExtractCallback *callback, const QVector<quint32> *items = nullptr)
+{
+    CCodecs codecs;
+    if (codecs.Load() != S_OK)
+        throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
+
+    COpenOptions op;
+    op.codecs = &codecs;
+
+    CObjectVector<COpenType> types;
+    op.types = &types;  // Empty, because we use a stream.
+
+    CIntVector excluded;
+    op.excludedFormats = &excluded;
+
+    const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
+    op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
+
+    CObjectVector<CProperty> properties;
+    op.props = &properties;
+
+    CArchiveLink archiveLink;
+    if (archiveLink.Open2(op, nullptr) != S_OK) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Cannot open archive \"%1\".").arg(archiveName));
+    }
+
+    // the item indexes of listArchive() are only meaningful for a single archive
+    if (items && archiveLink.Arcs.Size() != 1) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Cannot extract single items of nested archive \"%1\".").arg(archiveName));
+    }
+
+    for (unsigned a = 0; a < archiveLink.Arcs.Size(); ++a) {
+        callback->setArchive(&archiveLink.Arcs[a]);
+        IInArchive *const arch = archiveLink.Arcs[a].Archive;
+
+        const LONG result = items
+            ? arch->Extract(items->constData(), static_cast<UInt32>(items->count()), false,
+                callback)
+            : arch->Extract(0, static_cast<UInt32>(-1), false, callback);
+        // files written behind need to be done before reporting anything
+        const HRESULT written = callback->finishWriting();
+        if (result != S_OK)
+            throw SevenZipException(errorMessageFrom7zResult(result));
+        if (written != S_OK)
+            throw SevenZipException(errorMessageFrom7zResult(written));
+    }
+}
+
+/*!
+    Creates a pool of \a writerCount threads that write the files of the extract callbacks
+    sharing it. Data waiting to be written is limited to \a maxPendingBytes for all of them
+    together.
+
+    \sa ExtractCallback::setWriteBehind()
+*/
+QSharedPointer<WriteBehindPool> createWriteBehindPool(int writerCount, qint64 maxPendingBytes)
+{
+    return QSharedPointer<WriteBehindPool>(new WriteBehindPool(qMax(1, writerCount),
+        maxPendingBytes));
+}
+
 /*!
     Extracts the given \a archive content into target directory \a directory using the provided
     extract callback \a callback. The output filenames are deduced from the \a archive content.
@@ -1086,6 +1695,21 @@ void createArchive(const QString &archive, const QStringList &sources, TmpFile m
     \note The ownership of \a callback is not transferred to the function.
 */
 void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallback *callback)
+{
+    extractArchive(archive, archive->fileName(), directory, callback);
+}
+
+/*!
+    Extracts the given \a archive content into target directory \a directory using the provided
+    extract callback \a callback. Unlike the overload taking a QFileDevice, \a archive can be any
+    random access device, for example a resource inside the installer binary. \a archiveName is
+    used in error messages.
+
+    \note Throws SevenZipException on error.
+    \note The ownership of \a callback is not transferred to the function.
+*/
+void extractArchive(QIODevice *archive, const QString &archiveName, const QString &directory,
+    ExtractCallback *callback)
 {
     LIB7Z_ASSERTS(archive, Readable)
 
@@ -1101,41 +1725,44 @@ void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallb
     DirectoryGuard outDir(QFileInfo(directory).absolutePath());
     try {
         outDir.tryCreate();
+        callback->setTarget(directory);
+        extractWithCallback(archive, archiveName, callback);
+    } catch (const SevenZipException &e) {
+        externCallback.Detach();
+        throw e; // re-throw unmodified
+    } catch (...) {
+        externCallback.Detach();
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Unknown exception caught (%1).").arg(QString::fromLatin1(Q_FUNC_INFO)));
+    }
+    outDir.release();
+    externCallback.Detach();
+}
 
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        COpenOptions op;
-        op.codecs = &codecs;
-
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
-
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
-
-        const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
+/*!
+    Extracts only \a items of the given \a archive into target directory \a directory using the
+    provided extract callback \a callback. \a items are the item indexes as reported by
+    listArchive() and need to be sorted in ascending order. Only the solid blocks holding \a items
+    get decoded, so several parts of one archive can be extracted at the same time, each with its
+    own device and callback. \a archiveName is used in error messages.
 
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
+    \note Throws SevenZipException on error, also for archives nested in another archive.
+    \note The ownership of \a callback is not transferred to the function.
+*/
+void extractArchive(QIODevice *archive, const QString &archiveName, const QString &directory,
+    const QVector<quint32> &items, ExtractCallback *callback)
+{
+    LIB7Z_ASSERTS(archive, Readable)
+    Q_ASSERT(callback);
 
-        CArchiveLink archiveLink;
-        if (archiveLink.Open2(op, nullptr) != S_OK) {
-            throw SevenZipException(QCoreApplication::translate("Lib7z",
-                "Cannot open archive \"%1\".").arg(archive->fileName()));
-        }
+    // Guard a given object against unwanted delete.
+    CMyComPtr<ExtractCallback> externCallback = callback;
 
+    DirectoryGuard outDir(QFileInfo(directory).absolutePath());
+    try {
+        outDir.tryCreate();
         callback->setTarget(directory);
-        for (unsigned a = 0; a < archiveLink.Arcs.Size(); ++a) {
-            callback->setArchive(&archiveLink.Arcs[a]);
-            IInArchive *const arch = archiveLink.Arcs[a].Archive;
-
-            const LONG result = arch->Extract(0, static_cast<UInt32>(-1), false, callback);
-            if (result != S_OK)
-                throw SevenZipException(errorMessageFrom7zResult(result));
-        }
+        extractWithCallback(archive, archiveName, callback, &items);
     } catch (const SevenZipException &e) {
         externCallback.Detach();
         throw e; // re-throw unmodified
@@ -1148,6 +1775,30 @@ void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallb
     externCallback.Detach();
 }
 
+/*!
+    Extracts the files of \a archive into memory and returns them hashed by their path relative
+    to the archive root. Directories are not part of the result. \a archiveName is used in error
+    messages. Meant for small archives, for example the meta data of a component.
+
+    \note Throws SevenZipException on error.
+*/
+QHash<QString, QByteArray> extractArchiveToMemory(QIODevice *archive, const QString &archiveName)
+{
+    LIB7Z_ASSERTS(archive, Readable)
+
+    MemoryExtractCallback *const callback = new MemoryExtractCallback;
+    const CMyComPtr<ExtractCallback> guard = callback;
+    try {
+        extractWithCallback(archive, archiveName, callback);
+    } catch (const SevenZipException &e) {
+        throw e; // re-throw unmodified
+    } catch (...) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Unknown exception caught (%1).").arg(QString::fromLatin1(Q_FUNC_INFO)));
+    }
+    return callback->files();
+}
+
 /*!
     Returns \c true if the given \a archive is supported; otherwise returns \c false.
 
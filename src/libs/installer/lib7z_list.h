@@ -57,6 +57,8 @@ namespace Lib7z
         quint64 compressedSize = 0;
         quint64 uncompressedSize = 0;
         QFile::Permissions permissions = 0;
+        // the solid block holding the data, -1 for items without data, like directories
+        int block = -1;
     };
 
     INSTALLER_EXPORT bool operator==(const File &lhs, const File &rhs);
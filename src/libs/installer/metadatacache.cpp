@@ -0,0 +1,291 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "metadatacache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+
+namespace QInstaller {
+
+static const QLatin1String scArchives("archives");
+static const QLatin1String scUpdates("updates");
+
+static bool copyAtomically(const QString &source, const QString &target)
+{
+    QFile in(source);
+    if (!in.open(QIODevice::ReadOnly))
+        return false;
+
+    QSaveFile out(target);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    qint64 read = 0;
+    while ((read = in.read(buffer.data(), buffer.size())) > 0) {
+        if (out.write(buffer.constData(), read) != read)
+            return false;
+    }
+    return read == 0 && out.commit();
+}
+
+static void touch(const QString &fileName)
+{
+    // Entries that were used within the last day are recent enough, saves a write per lookup.
+    const QDateTime now = QDateTime::currentDateTime();
+    if (QFileInfo(fileName).lastModified().daysTo(now) < 1)
+        return;
+
+    QFile file(fileName);
+    if (file.open(QIODevice::Append))
+        file.setFileTime(now, QFileDevice::FileModificationTime);
+}
+
+static QString validatorsPath(const QString &updatesXml)
+{
+    const QFileInfo info(updatesXml);
+    return info.path() + QLatin1Char('/') + info.completeBaseName() + QLatin1String(".ini");
+}
+
+static void removeExpiredFiles(const QString &directory, const QString &filter,
+    const QDateTime &expiry)
+{
+    QDir dir(directory);
+    const QFileInfoList entries = dir.entryInfoList(QStringList(filter), QDir::Files);
+    foreach (const QFileInfo &entry, entries) {
+        if (entry.lastModified() >= expiry)
+            continue;
+        QFile::remove(entry.absoluteFilePath());
+        if (entry.suffix() == QLatin1String("xml"))
+            QFile::remove(validatorsPath(entry.absoluteFilePath()));
+    }
+}
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::MetadataCache
+    \brief The MetadataCache class keeps repository metadata across installer runs.
+
+    Meta archives are stored under the SHA-1 checksum published for them in Updates.xml, so an
+    archive downloaded once never needs to be fetched again while its checksum stays the same.
+    The last Updates.xml fetched from a repository is stored together with the \c ETag and
+    \c Last-Modified headers the server sent with it, which allows revalidating it with a
+    conditional request.
+
+    Entries that have not been used for a while are removed by removeExpired().
+*/
+
+/*!
+    Creates a cache in defaultPath().
+*/
+MetadataCache::MetadataCache()
+    : m_path(defaultPath())
+{
+}
+
+/*!
+    Creates a cache in the directory \a path. An empty \a path creates a disabled cache.
+*/
+MetadataCache::MetadataCache(const QString &path)
+    : m_path(path)
+{
+}
+
+/*!
+    Returns the directory of the cache shared by all installers of the current user. The
+    location can be changed with the \c IFW_METADATA_CACHE environment variable. Setting it
+    to \c none disables the cache and an empty string is returned.
+*/
+QString MetadataCache::defaultPath()
+{
+    const QString path = QString::fromLocal8Bit(qgetenv("IFW_METADATA_CACHE"));
+    if (path == QLatin1String("none"))
+        return QString();
+    if (!path.isEmpty())
+        return path;
+
+    const QString cache = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cache.isEmpty())
+        return QString();
+    return cache + QLatin1String("/qt-installer-framework/metadata");
+}
+
+/*!
+    Returns \c true if the cache has a directory to store entries in.
+*/
+bool MetadataCache::isValid() const
+{
+    return !m_path.isEmpty();
+}
+
+/*!
+    Returns the directory of the cache.
+*/
+QString MetadataCache::path() const
+{
+    return m_path;
+}
+
+/*!
+    Returns the cached Updates.xml of the repository \a repositoryUrl, or an empty string if
+    there is none. The validators stored with the file are returned in \a eTag and
+    \a lastModified.
+*/
+QString MetadataCache::updatesXml(const QString &repositoryUrl, QByteArray *eTag,
+    QByteArray *lastModified)
+{
+    const QString fileName = updatesXmlPath(repositoryUrl);
+    if (fileName.isEmpty() || !QFileInfo::exists(fileName))
+        return QString();
+
+    const QSettings validators(validatorsPath(fileName), QSettings::IniFormat);
+    if (validators.value(QLatin1String("Url")).toString() != repositoryUrl)
+        return QString();
+
+    if (eTag)
+        *eTag = validators.value(QLatin1String("ETag")).toByteArray();
+    if (lastModified)
+        *lastModified = validators.value(QLatin1String("LastModified")).toByteArray();
+    touch(fileName);
+    return fileName;
+}
+
+/*!
+    Stores a copy of \a fileName as the Updates.xml of the repository \a repositoryUrl
+    together with the \a eTag and \a lastModified validators the server sent for it.
+    Returns \c true on success.
+*/
+bool MetadataCache::insertUpdatesXml(const QString &repositoryUrl, const QString &fileName,
+    const QByteArray &eTag, const QByteArray &lastModified)
+{
+    const QString target = updatesXmlPath(repositoryUrl);
+    if (target.isEmpty() || !QDir().mkpath(QFileInfo(target).path()))
+        return false;
+
+    if (!copyAtomically(fileName, target))
+        return false;
+
+    // Written after the file, a crash in between leaves validators that no longer match
+    // and the server simply sends the complete file again.
+    QSettings validators(validatorsPath(target), QSettings::IniFormat);
+    validators.setValue(QLatin1String("Url"), repositoryUrl);
+    validators.setValue(QLatin1String("ETag"), eTag);
+    validators.setValue(QLatin1String("LastModified"), lastModified);
+    validators.sync();
+    return validators.status() == QSettings::NoError;
+}
+
+/*!
+    Returns the cached meta archive with the hex encoded SHA-1 checksum \a sha1, or an empty
+    string if there is none.
+*/
+QString MetadataCache::archive(const QByteArray &sha1)
+{
+    const QString fileName = archivePath(sha1);
+    if (fileName.isEmpty() || !QFileInfo::exists(fileName))
+        return QString();
+
+    touch(fileName);
+    return fileName;
+}
+
+/*!
+    Stores a copy of the meta archive \a fileName under its hex encoded SHA-1 checksum
+    \a sha1. The checksum must have been verified by the caller. Returns \c true on success.
+*/
+bool MetadataCache::insertArchive(const QString &fileName, const QByteArray &sha1)
+{
+    const QString target = archivePath(sha1);
+    if (target.isEmpty())
+        return false;
+    if (QFileInfo::exists(target))
+        return true;
+
+    if (!QDir().mkpath(QFileInfo(target).path()))
+        return false;
+    return copyAtomically(fileName, target);
+}
+
+/*!
+    Removes the cached meta archive \a fileName, for example after it failed to extract.
+    Files outside of the cache are left untouched. Returns \c true if the file was removed.
+*/
+bool MetadataCache::removeArchive(const QString &fileName)
+{
+    if (!isValid())
+        return false;
+
+    const QFileInfo info(fileName);
+    if (info.absolutePath() != QFileInfo(m_path + QLatin1Char('/') + scArchives).absoluteFilePath())
+        return false;
+    return QFile::remove(info.absoluteFilePath());
+}
+
+/*!
+    Removes entries that have not been used for \a days days.
+*/
+void MetadataCache::removeExpired(int days)
+{
+    if (!isValid())
+        return;
+
+    const QDateTime expiry = QDateTime::currentDateTime().addDays(-days);
+    removeExpiredFiles(m_path + QLatin1Char('/') + scArchives, QLatin1String("*.7z"), expiry);
+    removeExpiredFiles(m_path + QLatin1Char('/') + scUpdates, QLatin1String("*.xml"), expiry);
+}
+
+QString MetadataCache::archivePath(const QByteArray &sha1) const
+{
+    // Only accept proper checksums, the value is read from a remote file and ends up in a path.
+    const QByteArray checksum = QByteArray::fromHex(sha1);
+    if (!isValid() || checksum.size() != 20 || checksum.toHex() != sha1.toLower())
+        return QString();
+
+    return m_path + QLatin1Char('/') + scArchives + QLatin1Char('/')
+        + QString::fromLatin1(checksum.toHex()) + QLatin1String(".7z");
+}
+
+QString MetadataCache::updatesXmlPath(const QString &repositoryUrl) const
+{
+    if (!isValid() || repositoryUrl.isEmpty())
+        return QString();
+
+    const QByteArray hash = QCryptographicHash::hash(repositoryUrl.toUtf8(),
+        QCryptographicHash::Sha1).toHex();
+    return m_path + QLatin1Char('/') + scUpdates + QLatin1Char('/') + QString::fromLatin1(hash)
+        + QLatin1String(".xml");
+}
+
+} // namespace QInstaller
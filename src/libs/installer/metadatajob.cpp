@@ -36,14 +36,25 @@
 #include "settings.h"
 #include "testrepository.h"
 #include "globals.h"
+#include "updatesinfo_p.h"
 
 #include <QTemporaryDir>
-#include <QtMath>
+#include <QThread>
+
+using namespace KDUpdater;
 
 const QStringList metaElements = {QLatin1String("Script"), QLatin1String("Licenses"), QLatin1String("UserInterfaces"), QLatin1String("Translations")};
 
 namespace QInstaller {
 
+static bool isCacheable(const Repository &repository)
+{
+    // local repositories are as fast to read as the cache itself
+    const QString scheme = repository.url().scheme();
+    return scheme == QLatin1String("http") || scheme == QLatin1String("https")
+        || scheme == QLatin1String("ftp");
+}
+
 static QUrl resolveUrl(const FileTaskResult &result, const QString &url)
 {
     QUrl u(url);
@@ -56,20 +67,19 @@ MetadataJob::MetadataJob(QObject *parent)
     : Job(parent)
     , m_core(nullptr)
     , m_downloadType(DownloadType::All)
-    , m_downloadableChunkSize(1000)
-    , m_taskNumber(0)
+    , m_downloadingMetadata(false)
+    , m_maxConcurrentUnzips(qMax(1, QThread::idealThreadCount() - 1))
+    , m_unzipCount(0)
+    , m_unzipFinishedCount(0)
+    , m_downloadProgress(0)
 {
-    QByteArray downloadableChunkSize = qgetenv("IFW_METADATA_SIZE");
-    if (!downloadableChunkSize.isEmpty()) {
-        int chunkSize = QString::fromLocal8Bit(downloadableChunkSize).toInt();
-        if (chunkSize > 0)
-            m_downloadableChunkSize = chunkSize;
-    }
+    m_metadataCache.removeExpired();
 
     setCapabilities(Cancelable);
     connect(&m_xmlTask, &QFutureWatcherBase::finished, this, &MetadataJob::xmlTaskFinished);
     connect(&m_metadataTask, &QFutureWatcherBase::finished, this, &MetadataJob::metadataTaskFinished);
-    connect(&m_metadataTask, &QFutureWatcherBase::progressValueChanged, this, &MetadataJob::progressChanged);
+    connect(&m_metadataTask, &QFutureWatcherBase::resultsReadyAt, this, &MetadataJob::metadataResultsReady);
+    connect(&m_metadataTask, &QFutureWatcherBase::progressValueChanged, this, &MetadataJob::metadataProgressChanged);
 }
 
 MetadataJob::~MetadataJob()
@@ -131,14 +141,21 @@ void MetadataJob::doStart()
                     authenticator.setPassword(repo.password());
 
                     if (!repo.isCompressed()) {
-                        QString url = repo.url().toString() + QLatin1String("/Updates.xml?");
+                        QString url = repo.url().toString() + QLatin1String("/Updates.xml");
                         if (!m_core->value(scUrlQueryString).isEmpty())
-                            url += m_core->value(scUrlQueryString) + QLatin1Char('&');
+                            url += QLatin1Char('?') + m_core->value(scUrlQueryString);
 
-                        // also append a random string to avoid proxy caches
-                        FileTaskItem item(url.append(QString::number(qrand() * qrand())));
+                        FileTaskItem item(url);
                         item.insert(TaskRole::UserRole, QVariant::fromValue(repo));
                         item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
+                        if (isCacheable(repo)) {
+                            // Revalidate the cached copy, this also keeps proxies from
+                            // answering with a stale one.
+                            QByteArray eTag, lastModified;
+                            m_metadataCache.updatesXml(repo.url().toString(), &eTag, &lastModified);
+                            item.insert(TaskRole::ETag, eTag);
+                            item.insert(TaskRole::LastModified, lastModified);
+                        }
                         items.append(item);
                     }
                     else {
@@ -375,8 +392,14 @@ void MetadataJob::xmlTaskFinished()
 
     if (status == XmlDownloadSuccess) {
         if (m_downloadType != DownloadType::UpdatesXML) {
-            if (!fetchMetaDataPackages())
-                emitFinished();
+            // archives found in the metadata cache are extracted while the others download
+            m_unzipCount = m_unzipQueue.count() + m_packages.count();
+            m_unzipFinishedCount = 0;
+            setProgressTotalAmount(100);
+            setProcessedAmount(0);
+            m_downloadingMetadata = fetchMetaDataPackages();
+            m_downloadProgress = m_downloadingMetadata ? 0 : 100;
+            startUnzipTasks();
         } else {
             emitFinished();
         }
@@ -394,10 +417,17 @@ void MetadataJob::unzipTaskFinished()
     try {
         watcher->waitForFinished();    // trigger possible exceptions
     } catch (const UnzipArchiveException &e) {
+        // do not keep a broken archive around, the next run downloads it again
+        UnzipArchiveTask *task = qobject_cast<UnzipArchiveTask *>(m_unzipTasks.value(watcher));
+        if (task)
+            m_metadataCache.removeArchive(task->archive());
+        reset();
         emitFinishedWithError(QInstaller::ExtractionError, e.message());
     } catch (const QUnhandledException &e) {
+        reset();
         emitFinishedWithError(QInstaller::DownloadError, QLatin1String(e.what()));
     } catch (...) {
+        reset();
         emitFinishedWithError(QInstaller::DownloadError, tr("Unknown exception during extracting."));
     }
 
@@ -408,10 +438,9 @@ void MetadataJob::unzipTaskFinished()
     m_unzipTasks.remove(watcher);
     delete watcher;
 
-    if (m_unzipTasks.isEmpty()) {
-        setProcessedAmount(100);
-        emitFinished();
-    }
+    ++m_unzipFinishedCount;
+    updateMetadataProgress();
+    startUnzipTasks();
 }
 
 void MetadataJob::progressChanged(int progress)
@@ -419,43 +448,67 @@ void MetadataJob::progressChanged(int progress)
     setProcessedAmount(progress);
 }
 
+void MetadataJob::metadataProgressChanged(int progress)
+{
+    m_downloadProgress = progress;
+    updateMetadataProgress();
+}
+
 void MetadataJob::setProgressTotalAmount(int maximum)
 {
     setTotalAmount(maximum);
 }
 
-void MetadataJob::metadataTaskFinished()
+/*
+    Queues each downloaded archive for extraction as soon as it arrives, instead of waiting
+    for the remaining downloads.
+*/
+void MetadataJob::metadataResultsReady(int beginIndex, int endIndex)
 {
-    try {
-        m_metadataTask.waitForFinished();
-        m_metadataResult.append(m_metadataTask.future().results());
-        if (!fetchMetaDataPackages()) {
-            if (m_metadataResult.count() > 0) {
-                emit infoMessage(this, tr("Extracting meta information..."));
-                foreach (const FileTaskResult &result, m_metadataResult) {
-                    const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
-                    if (result.value(TaskRole::ChecksumMismatch).toBool()) {
-                        QString mismatchMessage = tr("Checksum mismatch detected for \"%1\".")
-                                .arg(item.value(TaskRole::SourceFile).toString());
-                        if (m_core->settings().allowUnstableComponents()) {
-                            m_shaMissmatchPackages.append(item.value(TaskRole::Name).toString());
-                            qCWarning(QInstaller::lcInstallerInstallLog) << mismatchMessage;
-                        } else {
-                            throw QInstaller::TaskException(mismatchMessage);
-                        }
-                    }
-                    UnzipArchiveTask *task = new UnzipArchiveTask(result.target(),
-                        item.value(TaskRole::UserRole).toString());
+    if (error() != Job::NoError)
+        return;
 
-                    QFutureWatcher<void> *watcher = new QFutureWatcher<void>();
-                    m_unzipTasks.insert(watcher, qobject_cast<QObject*> (task));
-                    connect(watcher, &QFutureWatcherBase::finished, this, &MetadataJob::unzipTaskFinished);
-                    watcher->setFuture(QtConcurrent::run(&UnzipArchiveTask::doTask, task));
+    try {
+        for (int i = beginIndex; i < endIndex; ++i) {
+            const FileTaskResult result = m_metadataTask.resultAt(i);
+            const FileTaskItem item = result.taskItem();
+            if (result.checksumMismatch()) {
+                QString mismatchMessage = tr("Checksum mismatch detected for \"%1\".")
+                        .arg(item.value(TaskRole::SourceFile).toString());
+                if (m_core->settings().allowUnstableComponents()) {
+                    m_shaMissmatchPackages.append(item.value(TaskRole::Name).toString());
+                    qCWarning(QInstaller::lcInstallerInstallLog) << mismatchMessage;
+                } else {
+                    throw QInstaller::TaskException(mismatchMessage);
                 }
             } else {
-                emitFinished();
+                const QByteArray sha1 = item.value(TaskRole::Checksum).toByteArray();
+                const QString directory = item.value(TaskRole::UserRole).toString();
+                if (!sha1.isEmpty() && isCacheable(repositoryForDirectory(directory)))
+                    m_metadataCache.insertArchive(result.target(), sha1);
             }
+            m_unzipQueue.append(result);
         }
+        startUnzipTasks();
+    } catch (const TaskException &e) {
+        reset();
+        emitFinishedWithError(QInstaller::DownloadError, e.message());
+    }
+}
+
+void MetadataJob::metadataTaskFinished()
+{
+    try {
+        m_metadataTask.waitForFinished();
+        if (error() != Job::NoError)
+            return;
+
+        m_downloadingMetadata = false;
+        m_downloadProgress = 100;
+        updateMetadataProgress();
+        if (!m_unzipTasks.isEmpty())
+            emit infoMessage(this, tr("Extracting meta information..."));
+        startUnzipTasks();
     } catch (const TaskException &e) {
         reset();
         emitFinishedWithError(QInstaller::DownloadError, e.message());
@@ -473,26 +526,51 @@ void MetadataJob::metadataTaskFinished()
 
 bool MetadataJob::fetchMetaDataPackages()
 {
-    //Download files in chunks. QtConcurrent will choke if too many task is given to it
-    int chunkSize = qMin(m_packages.length(), m_downloadableChunkSize);
-    QList<FileTaskItem> tempPackages = m_packages.mid(0, chunkSize);
-    m_packages = m_packages.mid(chunkSize, m_packages.length());
-    if (tempPackages.length() > 0) {
-        m_taskNumber++;
-        setProcessedAmount(0);
-        DownloadFileTask *const metadataTask = new DownloadFileTask(tempPackages);
-        metadataTask->setProxyFactory(m_core->proxyFactory());
-        m_metadataTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, metadataTask));
-        setProgressTotalAmount(100);
-        QString metaInformation;
-        if (m_totalTaskCount > 1)
-            metaInformation = tr("Retrieving meta information from remote repository... %1/%2 ").arg(m_taskNumber).arg(m_totalTaskCount);
-        else
-            metaInformation = tr("Retrieving meta information from remote repository... ");
-        emit infoMessage(this, metaInformation);
-        return true;
+    // The download task keeps only a bounded number of requests in flight, so all
+    // packages can be handed over at once.
+    if (m_packages.isEmpty())
+        return false;
+
+    DownloadFileTask *const metadataTask = new DownloadFileTask(m_packages);
+    m_packages.clear();
+    metadataTask->setProxyFactory(m_core->proxyFactory());
+    m_metadataTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, metadataTask));
+    emit infoMessage(this, tr("Retrieving meta information from remote repository... "));
+    return true;
+}
+
+/*
+    Starts extracting queued archives, keeping at most m_maxConcurrentUnzips of them running,
+    and finishes the job once nothing is left to download or extract.
+*/
+void MetadataJob::startUnzipTasks()
+{
+    if (error() != Job::NoError)
+        return;
+
+    while (m_unzipTasks.count() < m_maxConcurrentUnzips && !m_unzipQueue.isEmpty()) {
+        const FileTaskResult result = m_unzipQueue.takeFirst();
+        UnzipArchiveTask *task = new UnzipArchiveTask(result.target(),
+            result.taskItem().value(TaskRole::UserRole).toString());
+        task->setStoreInMemory(true);
+
+        QFutureWatcher<void> *watcher = new QFutureWatcher<void>();
+        m_unzipTasks.insert(watcher, qobject_cast<QObject*> (task));
+        connect(watcher, &QFutureWatcherBase::finished, this, &MetadataJob::unzipTaskFinished);
+        watcher->setFuture(QtConcurrent::run(&UnzipArchiveTask::doTask, task));
+    }
+
+    if (!m_downloadingMetadata && m_unzipTasks.isEmpty() && m_unzipQueue.isEmpty()) {
+        setProcessedAmount(100);
+        emitFinished();
     }
-    return false;
+}
+
+void MetadataJob::updateMetadataProgress()
+{
+    // downloading and extracting count for one half each
+    const int extracted = m_unzipCount > 0 ? (m_unzipFinishedCount * 100 / m_unzipCount) : 100;
+    setProcessedAmount((m_downloadProgress + extracted) / 2);
 }
 
 void MetadataJob::reset()
@@ -510,9 +588,29 @@ void MetadataJob::reset()
         m_xmlTask.cancel();
         m_metadataTask.cancel();
     } catch (...) {}
+
+    // Extractions cannot be interrupted, let the running ones clean up after themselves instead
+    // of reporting to a job that has finished already or started over.
+    for (auto it = m_unzipTasks.constBegin(); it != m_unzipTasks.constEnd(); ++it) {
+        QFutureWatcher<void> *const watcher = it.key();
+        disconnect(watcher, nullptr, this, nullptr);
+        if (watcher->isFinished()) {
+            delete it.value();
+            watcher->deleteLater();
+        } else {
+            // keep it from recreating the directories removed below
+            static_cast<UnzipArchiveTask *>(it.value())->cancel();
+            connect(watcher, &QFutureWatcherBase::finished, it.value(), &QObject::deleteLater);
+            connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+        }
+    }
+    m_unzipTasks.clear();
+
+    foreach (const QString &path, m_tempDirDeleter.paths())
+        MetadataStore::instance()->removeDirectory(path);
     m_tempDirDeleter.releaseAndDeleteAll();
-    m_metadataResult.clear();
-    m_taskNumber = 0;
+    m_unzipQueue.clear();
+    m_downloadingMetadata = false;
 }
 
 void MetadataJob::resetCompressedFetch()
@@ -546,12 +644,25 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         if (error() != Job::NoError)
             return XmlDownloadFailure;
 
+        const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
+        Metadata metadata;
+        metadata.repository = item.value(TaskRole::UserRole).value<Repository>();
+
+        // The server confirmed that the cached copy is still current.
+        const bool notModified = result.value(TaskRole::NotModified).toBool();
+        const QString cachedUpdatesXml = notModified
+            ? m_metadataCache.updatesXml(metadata.repository.url().toString()) : QString();
+        if (notModified && cachedUpdatesXml.isEmpty()) {
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot find cached Updates.xml of"
+                << metadata.repository.displayname();
+            continue;
+        }
+
         //If repository is not found, target might be empty. Do not continue parsing the
         //repository and do not prevent further repositories usage.
-        if (result.target().isEmpty()) {
+        if (!notModified && result.target().isEmpty()) {
             continue;
         }
-        Metadata metadata;
         QTemporaryDir tmp(QDir::tempPath() + QLatin1String("/remoterepo-XXXXXX"));
         if (!tmp.isValid()) {
             qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot create unique temporary directory.";
@@ -562,77 +673,81 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         metadata.directory = tmp.path();
         m_tempDirDeleter.add(metadata.directory);
 
-        QFile file(result.target());
-        if (!file.rename(metadata.directory + QLatin1String("/Updates.xml"))) {
+        QFile file(notModified ? cachedUpdatesXml : result.target());
+        if (notModified) {
+            if (!file.copy(metadata.directory + QLatin1String("/Updates.xml"))) {
+                qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot copy cached Updates.xml:"
+                    << file.errorString();
+                return XmlDownloadFailure;
+            }
+            file.setFileName(metadata.directory + QLatin1String("/Updates.xml"));
+        } else if (!file.rename(metadata.directory + QLatin1String("/Updates.xml"))) {
             qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot rename target to Updates.xml:"
                 << file.errorString();
             return XmlDownloadFailure;
         }
 
-        if (!file.open(QIODevice::ReadOnly)) {
+        // parse the file once, the update finder picks up the result when it reads it next
+        UpdatesInfo updatesInfo;
+        updatesInfo.setFileName(file.fileName());
+        if (updatesInfo.error() == UpdatesInfo::CouldNotReadUpdateInfoFileError) {
             qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot open Updates.xml for reading:"
-                << file.errorString();
+                << updatesInfo.errorString();
             return XmlDownloadFailure;
         }
 
-        QString error;
-        QDomDocument doc;
-        if (!doc.setContent(&file, &error)) {
+        if (updatesInfo.error() == UpdatesInfo::InvalidXmlError) {
             qCWarning(QInstaller::lcInstallerInstallLog).nospace() << "Cannot fetch a valid version of Updates.xml from repository "
-                               << metadata.repository.displayname() << ": " << error;
+                               << metadata.repository.displayname() << ": " << updatesInfo.errorString();
             //If there are other repositories, try to use those
             continue;
         }
-        file.close();
+        UpdatesInfo::keepForNextRead(updatesInfo);
+
+        const QByteArray eTag = result.value(TaskRole::ETag).toByteArray();
+        const QByteArray lastModified = result.value(TaskRole::LastModified).toByteArray();
+        if (!notModified && isCacheable(metadata.repository)
+                && (!eTag.isEmpty() || !lastModified.isEmpty())) {
+            m_metadataCache.insertUpdatesXml(metadata.repository.url().toString(),
+                file.fileName(), eTag, lastModified);
+        }
 
-        const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
-        metadata.repository = item.value(TaskRole::UserRole).value<Repository>();
         const bool online = !(metadata.repository.url().scheme()).isEmpty();
 
         bool testCheckSum = true;
-        const QDomElement root = doc.documentElement();
-        const QDomNode checksum = root.firstChildElement(QLatin1String("Checksum"));
-        if (!checksum.isNull())
-            testCheckSum = (checksum.toElement().text().toLower() == scTrue);
+        if (!updatesInfo.checksum().isNull())
+            testCheckSum = (updatesInfo.checksum().toLower() == scTrue);
 
         // If we have top level sha1 element, we have compressed all metadata inside
         // one repository to a single 7z file. Fetch that instead of component specific
         // meta 7z files.
-        const QDomNode sha1 = root.firstChildElement(scSHA1);
-        QDomNodeList children = root.childNodes();
-        if (sha1.isNull()) {
-            bool metaFound = false;
-            for (int i = 0; i < children.count(); ++i) {
-                const QDomElement el = children.at(i).toElement();
-                if (!el.isNull() && el.tagName() == QLatin1String("PackageUpdate")) {
-                    const QDomNodeList c2 = el.childNodes();
-                    QString packageName, packageVersion, packageHash;
-                    metaFound = parsePackageUpdate(c2, packageName, packageVersion, packageHash,
-                                                   online, testCheckSum);
-
-                    //If meta element (script, licenses, etc.) is not found, no need to fetch metadata
-                    if (metaFound) {
-                        const QString repoUrl = metadata.repository.url().toString();
-                        addFileTaskItem(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName, packageVersion),
-                            metadata.directory + QString::fromLatin1("/%1-%2-meta.7z").arg(packageName, packageVersion),
-                            metadata, packageHash, packageName);
-                    } else {
-                        QString fileName = metadata.directory + QLatin1Char('/') + packageName;
-                        QDir directory(fileName);
-                        if (!directory.exists()) {
-                            directory.mkdir(fileName);
-                        }
+        if (updatesInfo.sha1().isNull()) {
+            foreach (const UpdateInfo &info, updatesInfo.updatesInfo()) {
+                QString packageName, packageVersion, packageHash;
+                const bool metaFound = parsePackageUpdate(info, packageName, packageVersion,
+                    packageHash, online, testCheckSum);
+
+                //If meta element (script, licenses, etc.) is not found, no need to fetch metadata
+                if (metaFound) {
+                    const QString repoUrl = metadata.repository.url().toString();
+                    addFileTaskItem(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName, packageVersion),
+                        metadata.directory + QString::fromLatin1("/%1-%2-meta.7z").arg(packageName, packageVersion),
+                        metadata, packageHash, packageName);
+                } else {
+                    QString fileName = metadata.directory + QLatin1Char('/') + packageName;
+                    QDir directory(fileName);
+                    if (!directory.exists()) {
+                        directory.mkdir(fileName);
                     }
                 }
             }
         } else {
             const QString repoUrl = metadata.repository.url().toString();
-            QDomElement metadataNameElement = root.firstChildElement(QLatin1String("MetadataName"));
-            if (!metadataNameElement.isNull()) {
-                const QString metadataName = metadataNameElement.toElement().text();
+            if (!updatesInfo.metadataName().isNull()) {
+                const QString metadataName = updatesInfo.metadataName();
                 addFileTaskItem(QString::fromLatin1("%1/%2").arg(repoUrl, metadataName),
                     metadata.directory + QString::fromLatin1("/%1").arg(metadataName),
-                    metadata, sha1.toElement().text(), QString());
+                    metadata, updatesInfo.sha1(), QString());
             } else {
                 qCWarning(QInstaller::lcInstallerInstallLog) <<
                     "Unable to find MetadataName element from Updates.xml";
@@ -665,8 +780,8 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
 
 
         // search for additional repositories that we might need to check
-        const QDomNode repositoryUpdate = root.firstChildElement(QLatin1String("RepositoryUpdate"));
-        if (!repositoryUpdate.isNull()) {
+        const QList<UpdateInfo> repositoryUpdate = updatesInfo.repositoryUpdates();
+        if (!repositoryUpdate.isEmpty()) {
             QHash<QString, QPair<Repository, Repository> > repositoryUpdates =
                     searchAdditionalRepositories(repositoryUpdate, result, metadata);
             if (!repositoryUpdates.isEmpty()) {
@@ -676,10 +791,6 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
             }
         }
     }
-    double taskCount = m_packages.length()/static_cast<double>(m_downloadableChunkSize);
-    m_totalTaskCount = qCeil(taskCount);
-    m_taskNumber = 0;
-
     return XmlDownloadSuccess;
 }
 
@@ -726,78 +837,79 @@ void MetadataJob::addFileTaskItem(const QString &source, const QString &target,
     item.insert(TaskRole::Checksum, sha1.toLatin1());
     item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
     item.insert(TaskRole::Name, packageName);
+
+    if (isCacheable(metadata.repository)) {
+        const QString archive = m_metadataCache.archive(sha1.toLatin1());
+        if (!archive.isEmpty()) {
+            // fetched by an earlier run, extract the cached copy instead
+            m_unzipQueue.append(FileTaskResult(archive, QByteArray::fromHex(sha1.toLatin1()),
+                item, false));
+            return;
+        }
+    }
     m_packages.append(item);
 }
 
-bool MetadataJob::parsePackageUpdate(const QDomNodeList &c2, QString &packageName,
+bool MetadataJob::parsePackageUpdate(const UpdateInfo &info, QString &packageName,
                                     QString &packageVersion, QString &packageHash,
                                     bool online, bool testCheckSum)
 {
-    bool metaFound = false;
-    for (int j = 0; j < c2.count(); ++j) {
-        const QDomElement element = c2.at(j).toElement();
-        if (element.tagName() == scName)
-            packageName = element.text();
-        else if (element.tagName() == scVersion)
-            packageVersion = (online ? element.text() : QString());
-        else if ((element.tagName() == QLatin1String("SHA1")) && testCheckSum)
-            packageHash = element.text();
-        else {
-            foreach (QString meta, metaElements) {
-                if (element.tagName() == meta) {
-                    metaFound = true;
-                    break;
-                }
-            }
-        }
+    packageName = info.data.value(scName).toString();
+    if (online)
+        packageVersion = info.data.value(scVersion).toString();
+    if (testCheckSum)
+        packageHash = info.data.value(QLatin1String("SHA1")).toString();
+
+    foreach (const QString &meta, metaElements) {
+        if (info.data.contains(meta))
+            return true;
     }
-    return metaFound;
+    return false;
 }
 
 QHash<QString, QPair<Repository, Repository> > MetadataJob::searchAdditionalRepositories
-    (const QDomNode &repositoryUpdate, const FileTaskResult &result, const Metadata &metadata)
+    (const QList<UpdateInfo> &repositoryUpdate, const FileTaskResult &result, const Metadata &metadata)
 {
     QHash<QString, QPair<Repository, Repository> > repositoryUpdates;
-    const QDomNodeList children = repositoryUpdate.toElement().childNodes();
-    for (int i = 0; i < children.count(); ++i) {
-        const QDomElement el = children.at(i).toElement();
-        if (!el.isNull() && el.tagName() == QLatin1String("Repository")) {
-            const QString action = el.attribute(QLatin1String("action"));
-            if (action == QLatin1String("add")) {
-                // add a new repository to the defaults list
-                Repository repository(resolveUrl(result, el.attribute(QLatin1String("url"))), true);
-                repository.setUsername(el.attribute(QLatin1String("username")));
-                repository.setPassword(el.attribute(QLatin1String("password")));
-                repository.setDisplayName(el.attribute(QLatin1String("displayname")));
-                if (ProductKeyCheck::instance()->isValidRepository(repository)) {
-                    repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
-                    qDebug() << "Repository to add:" << repository.displayname();
-                }
-            } else if (action == QLatin1String("remove")) {
-                // remove possible default repositories using the given server url
-                Repository repository(resolveUrl(result, el.attribute(QLatin1String("url"))), true);
-                repository.setDisplayName(el.attribute(QLatin1String("displayname")));
+    foreach (const UpdateInfo &el, repositoryUpdate) {
+        const auto attribute = [&el](const char *name) {
+            return el.data.value(QLatin1String(name)).toString();
+        };
+        const QString action = attribute("action");
+        if (action == QLatin1String("add")) {
+            // add a new repository to the defaults list
+            Repository repository(resolveUrl(result, attribute("url")), true);
+            repository.setUsername(attribute("username"));
+            repository.setPassword(attribute("password"));
+            repository.setDisplayName(attribute("displayname"));
+            if (ProductKeyCheck::instance()->isValidRepository(repository)) {
                 repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
-
-                qDebug() << "Repository to remove:" << repository.displayname();
-            } else if (action == QLatin1String("replace")) {
-                // replace possible default repositories using the given server url
-                Repository oldRepository(resolveUrl(result, el.attribute(QLatin1String("oldUrl"))), true);
-                Repository newRepository(resolveUrl(result, el.attribute(QLatin1String("newUrl"))), true);
-                newRepository.setUsername(el.attribute(QLatin1String("username")));
-                newRepository.setPassword(el.attribute(QLatin1String("password")));
-                newRepository.setDisplayName(el.attribute(QLatin1String("displayname")));
-
-                if (ProductKeyCheck::instance()->isValidRepository(newRepository)) {
-                    // store the new repository and the one old it replaces
-                    repositoryUpdates.insertMulti(action, qMakePair(newRepository, oldRepository));
-                    qDebug() << "Replace repository" << oldRepository.displayname() << "with"
-                        << newRepository.displayname();
-                }
-            } else {
-                qDebug() << "Invalid additional repositories action set in Updates.xml fetched "
-                    "from" << metadata.repository.displayname() << "line:" << el.lineNumber();
+                qDebug() << "Repository to add:" << repository.displayname();
             }
+        } else if (action == QLatin1String("remove")) {
+            // remove possible default repositories using the given server url
+            Repository repository(resolveUrl(result, attribute("url")), true);
+            repository.setDisplayName(attribute("displayname"));
+            repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
+
+            qDebug() << "Repository to remove:" << repository.displayname();
+        } else if (action == QLatin1String("replace")) {
+            // replace possible default repositories using the given server url
+            Repository oldRepository(resolveUrl(result, attribute("oldUrl")), true);
+            Repository newRepository(resolveUrl(result, attribute("newUrl")), true);
+            newRepository.setUsername(attribute("username"));
+            newRepository.setPassword(attribute("password"));
+            newRepository.setDisplayName(attribute("displayname"));
+
+            if (ProductKeyCheck::instance()->isValidRepository(newRepository)) {
+                // store the new repository and the one old it replaces
+                repositoryUpdates.insertMulti(action, qMakePair(newRepository, oldRepository));
+                qDebug() << "Replace repository" << oldRepository.displayname() << "with"
+                    << newRepository.displayname();
+            }
+        } else {
+            qDebug() << "Invalid additional repositories action set in Updates.xml fetched "
+                "from" << metadata.repository.displayname() << "line:" << attribute("LineNumber");
         }
     }
     return repositoryUpdates;
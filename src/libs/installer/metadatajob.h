@@ -32,12 +32,14 @@
 #include "downloadfiletask.h"
 #include "fileutils.h"
 #include "job.h"
+#include "metadatacache.h"
 #include "repository.h"
 
 #include <QFutureWatcher>
 
-class QDomNodeList;
-class QDomNode;
+namespace KDUpdater {
+struct UpdateInfo;
+}
 
 namespace QInstaller {
 
@@ -89,14 +91,18 @@ private slots:
 
     void xmlTaskFinished();
     void unzipTaskFinished();
+    void metadataResultsReady(int beginIndex, int endIndex);
     void metadataTaskFinished();
     void progressChanged(int progress);
+    void metadataProgressChanged(int progress);
     void setProgressTotalAmount(int maximum);
     void unzipRepositoryTaskFinished();
     void startXMLTask(const QList<FileTaskItem> items);
 
 private:
     bool fetchMetaDataPackages();
+    void startUnzipTasks();
+    void updateMetadataProgress();
     void startUnzipRepositoryTask(const Repository &repo);
     void reset();
     void resetCompressedFetch();
@@ -104,9 +110,10 @@ private:
     QSet<Repository> getRepositories();
     void addFileTaskItem(const QString &source, const QString &target, const Metadata &metadata,
                          const QString &sha1, const QString &packageName);
-    bool parsePackageUpdate(const QDomNodeList &c2, QString &packageName, QString &packageVersion,
-                            QString &packageHash, bool online, bool testCheckSum);
-    QHash<QString, QPair<Repository, Repository> > searchAdditionalRepositories(const QDomNode &repositoryUpdate,
+    bool parsePackageUpdate(const KDUpdater::UpdateInfo &info, QString &packageName,
+                            QString &packageVersion, QString &packageHash, bool online, bool testCheckSum);
+    QHash<QString, QPair<Repository, Repository> > searchAdditionalRepositories(
+                            const QList<KDUpdater::UpdateInfo> &repositoryUpdate,
                             const FileTaskResult &result, const Metadata &metadata);
     MetadataJob::Status setAdditionalRepositories(QHash<QString, QPair<Repository, Repository> > repositoryUpdates,
                             const FileTaskResult &result, const Metadata& metadata);
@@ -122,14 +129,17 @@ private:
     QHash<QFutureWatcher<void> *, QObject*> m_unzipRepositoryTasks;
     DownloadType m_downloadType;
     QList<FileTaskItem> m_unzipRepositoryitems;
-    QList<FileTaskResult> m_metadataResult;
-    int m_downloadableChunkSize;
-    int m_taskNumber;
-    int m_totalTaskCount;
+    QList<FileTaskResult> m_unzipQueue;
+    bool m_downloadingMetadata;
+    int m_maxConcurrentUnzips;
+    int m_unzipCount;
+    int m_unzipFinishedCount;
+    int m_downloadProgress;
     QStringList m_shaMissmatchPackages;
     QHash<QString, ArchiveMetadata> m_fetchedArchive;
     QHash<QString, Metadata> m_metaFromDefaultRepositories;
     QHash<QString, Metadata> m_metaFromArchive; //for faster lookups.
+    MetadataCache m_metadataCache;
 };
 
 }   // namespace QInstaller
@@ -32,9 +32,12 @@
 #include "lib7z_extract.h"
 #include "lib7z_facade.h"
 #include "metadatajob.h"
+#include "metadatastore.h"
 
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QMutex>
 
 namespace QInstaller{
 
@@ -62,10 +65,23 @@ class UnzipArchiveTask : public AbstractTask<void>
 
 public:
     UnzipArchiveTask(const QString &arcive, const QString &target)
-        : m_archive(arcive), m_targetDir(target)
+        : m_archive(arcive), m_targetDir(target), m_storeInMemory(false), m_canceled(false)
     {}
     QString target() { return m_targetDir; }
     QString archive() { return m_archive; }
+
+    // Extracts the files components read through the MetadataStore into the store, everything
+    // else is still written to the target.
+    void setStoreInMemory(bool storeInMemory) { m_storeInMemory = storeInMemory; }
+
+    // Tells a running extraction into the store that the target is about to be removed, nothing
+    // is placed in the target or the store afterwards. Waits for files being placed right now.
+    void cancel()
+    {
+        QMutexLocker _(&m_mutex);
+        m_canceled = true;
+    }
+
     void doTask(QFutureInterface<void> &fi)
     {
         fi.reportStarted();
@@ -79,7 +95,10 @@ public:
         QFile archive(m_archive);
         if (archive.open(QIODevice::ReadOnly)) {
             try {
-                Lib7z::extractArchive(&archive, m_targetDir);
+                if (m_storeInMemory)
+                    extractToStore(&archive);
+                else
+                    Lib7z::extractArchive(&archive, m_targetDir);
             } catch (const Lib7z::SevenZipException& e) {
                 fi.reportException(UnzipArchiveException(MetadataJob::tr("Error while extracting "
                     "archive \"%1\": %2").arg(QDir::toNativeSeparators(m_archive), e.message())));
@@ -95,9 +114,54 @@ public:
         fi.reportFinished();
     }
 
+private:
+    // Scripts, user interfaces and translations are loaded through the MetadataStore. Any other
+    // file, like licenses or helper files a script reads itself, might be opened by path.
+    static bool isServedFromStore(const QString &fileName)
+    {
+        return fileName.endsWith(QLatin1String(".qs")) || fileName.endsWith(QLatin1String(".js"))
+            || fileName.endsWith(QLatin1String(".ui")) || fileName.endsWith(QLatin1String(".qm"));
+    }
+
+    void extractToStore(QIODevice *archive)
+    {
+        QHash<QString, QByteArray> files = Lib7z::extractArchiveToMemory(archive, m_archive);
+
+        QMutexLocker _(&m_mutex);
+        if (m_canceled)
+            return;
+
+        // Downloaded component archives are still placed next to the meta data later on.
+        QDir targetDir(m_targetDir);
+        for (auto it = files.begin(); it != files.end();) {
+            const QString filePath = targetDir.filePath(it.key());
+            const QString path = QFileInfo(filePath).path();
+            if (!targetDir.mkpath(path)) {
+                throw Lib7z::SevenZipException(MetadataJob::tr("Cannot create directory \"%1\".")
+                    .arg(QDir::toNativeSeparators(path)));
+            }
+            if (isServedFromStore(it.key())) {
+                ++it;
+                continue;
+            }
+
+            QFile file(filePath);
+            if (!file.open(QIODevice::WriteOnly) || file.write(it.value()) != it.value().size()) {
+                throw Lib7z::SevenZipException(MetadataJob::tr("Cannot write file \"%1\": %2")
+                    .arg(QDir::toNativeSeparators(filePath), file.errorString()));
+            }
+            it = files.erase(it);
+        }
+        MetadataStore::instance()->insert(m_targetDir, files);
+    }
+
 private:
     QString m_archive;
     QString m_targetDir;
+    bool m_storeInMemory;
+
+    QMutex m_mutex;
+    bool m_canceled;
 };
 
 }   // namespace QInstaller
@@ -0,0 +1,211 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "metadatastore.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+namespace QInstaller {
+
+Q_GLOBAL_STATIC(MetadataStore, globalMetadataStore)
+
+static QString normalizedPath(const QString &path)
+{
+    const QString cleanPath = QDir::cleanPath(QDir::fromNativeSeparators(path));
+#ifdef Q_OS_WIN
+    return cleanPath.toLower();
+#else
+    return cleanPath;
+#endif
+}
+
+static QString parentPath(const QString &normalizedFileName)
+{
+    const int index = normalizedFileName.lastIndexOf(QLatin1Char('/'));
+    return index < 0 ? QString() : normalizedFileName.left(index);
+}
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::MetadataStore
+    \brief The MetadataStore class serves the meta data of components from memory.
+
+    Scripts, user interfaces, and translations in meta archives of online repositories are
+    extracted into the store instead of into the repository's temporary directory. Other files,
+    like licenses or files a script reads itself, are still written to disk. The files in the
+    store keep the paths they would have had on disk, so that a component can look them up with
+    the same paths as before. Functions that take a path fall back to the file system for anything
+    that is not in the store, for example the meta data of offline installers.
+*/
+
+/*!
+    Creates an empty store. Most users want the process wide instance().
+*/
+MetadataStore::MetadataStore()
+{
+}
+
+/*!
+    Returns the store shared by the meta data job and the components.
+*/
+MetadataStore *MetadataStore::instance()
+{
+    return globalMetadataStore();
+}
+
+/*!
+    Adds \a files to the store. The keys of \a files are paths relative to \a directory. Files
+    that are already in the store are replaced.
+*/
+void MetadataStore::insert(const QString &directory, const QHash<QString, QByteArray> &files)
+{
+    const QString root = normalizedPath(directory);
+
+    QWriteLocker _(&m_lock);
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const QString fileName = normalizedPath(root + QLatin1Char('/') + it.key());
+        if (!m_files.contains(fileName)) {
+            const QString parent = parentPath(fileName);
+            m_directories[parent].append(fileName.mid(parent.length() + 1));
+        }
+        m_files.insert(fileName, it.value());
+    }
+}
+
+/*!
+    Removes all files inside \a directory, including files in subdirectories.
+*/
+void MetadataStore::removeDirectory(const QString &directory)
+{
+    const QString root = normalizedPath(directory);
+    const QString prefix = root + QLatin1Char('/');
+
+    QWriteLocker _(&m_lock);
+    for (auto it = m_files.begin(); it != m_files.end();) {
+        if (it.key().startsWith(prefix))
+            it = m_files.erase(it);
+        else
+            ++it;
+    }
+    for (auto it = m_directories.begin(); it != m_directories.end();) {
+        if (it.key() == root || it.key().startsWith(prefix))
+            it = m_directories.erase(it);
+        else
+            ++it;
+    }
+}
+
+/*!
+    Removes all files from the store.
+*/
+void MetadataStore::clear()
+{
+    QWriteLocker _(&m_lock);
+    m_files.clear();
+    m_directories.clear();
+}
+
+/*!
+    Returns \c true if the store holds no files.
+*/
+bool MetadataStore::isEmpty() const
+{
+    QReadLocker _(&m_lock);
+    return m_files.isEmpty();
+}
+
+/*!
+    Returns \c true if the store holds \a fileName.
+*/
+bool MetadataStore::contains(const QString &fileName) const
+{
+    QReadLocker _(&m_lock);
+    return m_files.contains(normalizedPath(fileName));
+}
+
+/*!
+    Returns the content of \a fileName, or an empty byte array if the store does not hold it.
+*/
+QByteArray MetadataStore::file(const QString &fileName) const
+{
+    QReadLocker _(&m_lock);
+    return m_files.value(normalizedPath(fileName));
+}
+
+/*!
+    Returns \c true if \a fileName is in the store or exists on disk.
+*/
+bool MetadataStore::exists(const QString &fileName) const
+{
+    return contains(fileName) || QFileInfo::exists(fileName);
+}
+
+/*!
+    Returns a device to read \a fileName from. The device reads from memory if the store holds
+    \a fileName, otherwise it is a QFile. The device still needs to be opened.
+*/
+std::unique_ptr<QIODevice> MetadataStore::open(const QString &fileName) const
+{
+    {
+        QReadLocker _(&m_lock);
+        const auto it = m_files.constFind(normalizedPath(fileName));
+        if (it != m_files.constEnd()) {
+            std::unique_ptr<QBuffer> buffer(new QBuffer);
+            buffer->setData(it.value());
+            return std::move(buffer);
+        }
+    }
+    return std::unique_ptr<QIODevice>(new QFile(fileName));
+}
+
+/*!
+    Returns the names of the files directly inside \a directory that match \a nameFilters. Lists
+    \a directory on disk if the store holds no files for it.
+*/
+QStringList MetadataStore::entryList(const QString &directory, const QStringList &nameFilters) const
+{
+    QStringList names;
+    {
+        QReadLocker _(&m_lock);
+        names = m_directories.value(normalizedPath(directory));
+    }
+    if (names.isEmpty())
+        return QDir(directory).entryList(nameFilters, QDir::Files);
+
+    QStringList result;
+    foreach (const QString &name, names) {
+        if (QDir::match(nameFilters, name))
+            result.append(name);
+    }
+    return result;
+}
+
+} // namespace QInstaller
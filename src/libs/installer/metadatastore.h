@@ -0,0 +1,74 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef METADATASTORE_H
+#define METADATASTORE_H
+
+#include "installer_global.h"
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QStringList>
+
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT MetadataStore
+{
+    Q_DISABLE_COPY(MetadataStore)
+
+public:
+    MetadataStore();
+    static MetadataStore *instance();
+
+    void insert(const QString &directory, const QHash<QString, QByteArray> &files);
+    void removeDirectory(const QString &directory);
+    void clear();
+
+    bool isEmpty() const;
+    bool contains(const QString &fileName) const;
+    QByteArray file(const QString &fileName) const;
+
+    bool exists(const QString &fileName) const;
+    std::unique_ptr<QIODevice> open(const QString &fileName) const;
+    QStringList entryList(const QString &directory, const QStringList &nameFilters) const;
+
+private:
+    mutable QReadWriteLock m_lock;
+    QHash<QString, QByteArray> m_files;
+    QHash<QString, QStringList> m_directories;
+};
+
+} // namespace QInstaller
+
+#endif // METADATASTORE_H
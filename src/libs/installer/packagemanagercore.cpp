@@ -36,6 +36,7 @@
 #include "errors.h"
 #include "globals.h"
 #include "messageboxhandler.h"
+#include "metadatastore.h"
 #include "packagemanagerproxyfactory.h"
 #include "progresscoordinator.h"
 #include "qprocesswrapper.h"
@@ -45,6 +46,7 @@
 #include "settings.h"
 #include "utils.h"
 #include "installercalculator.h"
+#include "incrementalinstallercalculator.h"
 #include "uninstallercalculator.h"
 
 #include <productkeycheck.h>
@@ -416,17 +418,16 @@ static bool sNoDefaultInstallation = false;
 static bool sVirtualComponentsVisible = false;
 static bool sCreateLocalRepositoryFromBinary = false;
 
-static bool componentMatches(const Component *component, const QString &name,
-    const QString &version = QString())
+static bool componentMatches(const Component *component, const Dependency &dependency)
 {
-    if (name.isEmpty() || component->name() != name)
+    if (dependency.name().isEmpty() || component->name() != dependency.name())
         return false;
 
-    if (version.isEmpty())
+    if (dependency.version().isEmpty())
         return true;
 
     // can be remote or local version
-    return PackageManagerCore::versionMatches(component->value(scVersion), version);
+    return dependency.matches(component->version());
 }
 
 /*!
@@ -538,10 +539,19 @@ void PackageManagerCore::componentsToInstallNeedsRecalculation()
     d->clearUninstallerCalculator();
     QList<Component*> selectedComponentsToInstall = componentsMarkedForInstallation();
 
-    d->m_componentsToInstallCalculated =
-            d->installerCalculator()->appendComponentsToInstall(selectedComponentsToInstall);
-
-    QList<Component *> componentsToInstall = d->installerCalculator()->orderedComponentsToInstall();
+    QList<Component *> componentsToInstall;
+    IncrementalInstallerCalculator *const calculator = d->incrementalInstallerCalculator();
+    if (calculator->setSelectedComponents(selectedComponentsToInstall)) {
+        // Only apply the change of the selection here, the ordered calculation with install
+        // reasons runs once it is needed, see calculateComponentsToInstall().
+        componentsToInstall = calculator->componentsToInstall().toList();
+        d->m_componentsToInstallCalculated = false;
+        d->m_installerCalculatorOutdated = true;
+    } else {
+        d->m_componentsToInstallCalculated =
+                d->installerCalculator()->appendComponentsToInstall(selectedComponentsToInstall);
+        componentsToInstall = d->installerCalculator()->orderedComponentsToInstall();
+    }
 
     QList<Component *> selectedComponentsToUninstall;
     foreach (Component *component, components(ComponentType::All)) {
@@ -726,49 +736,18 @@ int PackageManagerCore::downloadNeededArchives(double partProgressSize)
 {
     Q_ASSERT(partProgressSize >= 0 && partProgressSize <= 1);
 
-    QList<QPair<QString, QString> > archivesToDownload;
-    QList<Component*> neededComponents = orderedComponentsToInstall();
-    foreach (Component *component, neededComponents) {
-        // collect all archives to be downloaded
-        const QStringList toDownload = component->downloadableArchives();
-        foreach (const QString &versionFreeString, toDownload) {
-            archivesToDownload.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
-                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
-                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
-        }
-    }
-
+    const QList<QPair<QString, QString> > archivesToDownload
+        = d->archivesToDownload(orderedComponentsToInstall());
     if (archivesToDownload.isEmpty())
         return 0;
 
-    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
-
-    DownloadArchivesJob archivesJob(this);
-    archivesJob.setAutoDelete(false);
-    archivesJob.setArchivesToDownload(archivesToDownload);
-    connect(this, &PackageManagerCore::installationInterrupted, &archivesJob, &Job::cancel);
-    connect(&archivesJob, &DownloadArchivesJob::outputTextChanged,
-            ProgressCoordinator::instance(), &ProgressCoordinator::emitLabelAndDetailTextChanged);
-    connect(&archivesJob, &DownloadArchivesJob::downloadStatusChanged,
-            ProgressCoordinator::instance(), &ProgressCoordinator::downloadStatusChanged);
+    QScopedPointer<DownloadArchivesJob> archivesJob(d->createArchivesDownloadJob(archivesToDownload,
+        partProgressSize));
+    archivesJob->start();
+    archivesJob->waitForFinished();
+    d->finishArchivesDownload(archivesJob.data());
 
-    ProgressCoordinator::instance()->registerPartProgress(&archivesJob,
-        SIGNAL(progressChanged(double)), partProgressSize);
-
-    archivesJob.start();
-    archivesJob.waitForFinished();
-
-    if (archivesJob.error() == Job::Canceled)
-        interrupt();
-    else if (archivesJob.error() != Job::NoError)
-        throw Error(archivesJob.errorString());
-
-    if (d->statusCanceledOrFailed())
-        throw Error(tr("Installation canceled by user."));
-
-    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
-
-    return archivesJob.numberOfDownloads();
+    return archivesJob->numberOfDownloads();
 }
 
 /*!
@@ -905,7 +884,8 @@ bool PackageManagerCore::isFileExtensionRegistered(const QString &extension) con
  */
 bool PackageManagerCore::fileExists(const QString &filePath) const
 {
-    return QFileInfo(filePath).exists();
+    // component meta data of online repositories might only be held in memory
+    return MetadataStore::instance()->exists(filePath);
 }
 
 /*!
@@ -921,15 +901,15 @@ bool PackageManagerCore::fileExists(const QString &filePath) const
  */
 QString PackageManagerCore::readFile(const QString &filePath, const QString &codecName) const
 {
-    QFile f(filePath);
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
+    const std::unique_ptr<QIODevice> f = MetadataStore::instance()->open(filePath);
+    if (!f->open(QIODevice::ReadOnly | QIODevice::Text))
         return QString();
 
     QTextCodec *codec = QTextCodec::codecForName(qPrintable(codecName));
     if (!codec)
         return QString();
 
-    QTextStream stream(&f);
+    QTextStream stream(f.get());
     stream.setCodec(codec);
     return stream.readAll();
 }
@@ -1540,8 +1520,7 @@ bool PackageManagerCore::fetchPackagesTree(const PackagesList &packages, const L
                     }
 
                     const LocalPackage localPackage = installedPackages.value(name);
-                    const QString updateVersion = update->data(scVersion).toString();
-                    if (KDUpdater::compareVersion(updateVersion, localPackage.version) <= 0)
+                    if (update->version() <= KDUpdater::Version(localPackage.version))
                         continue;  // remote version equals or is less than the installed maintenance tool
 
                     const QDate updateDate = update->data(scReleaseDate).toDate();
@@ -1786,6 +1765,7 @@ ScriptEngine *PackageManagerCore::controlScriptEngine() const
 void PackageManagerCore::appendRootComponent(Component *component)
 {
     d->m_rootComponents.append(component);
+    d->invalidateComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1856,6 +1836,7 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 {
     component->setUpdateAvailable(true);
     d->m_updaterComponents.append(component);
+    d->invalidateComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1867,7 +1848,7 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 */
 Component *PackageManagerCore::componentByName(const QString &name) const
 {
-    return componentByName(name, components(ComponentType::AllNoReplacements));
+    return componentByName(name, d->componentIndex());
 }
 
 /*!
@@ -1882,19 +1863,97 @@ Component *PackageManagerCore::componentByName(const QString &name, const QList<
     if (name.isEmpty())
         return nullptr;
 
-    QString fixedVersion;
-    QString fixedName;
+    const Dependency dependency(name);
+    foreach (Component *component, components) {
+        if (componentMatches(component, dependency))
+            return component;
+    }
+
+    return nullptr;
+}
+
+/*!
+    Looks up a component matching \a name in the \a componentsByName index created by
+    componentsByName(). \a name can also contain a version requirement, which is checked only
+    against the components having the requested name. If no component matches the requirement,
+    \c 0 is returned.
+*/
+Component *PackageManagerCore::componentByName(const QString &name,
+    const QHash<QString, QList<Component *> > &componentsByName)
+{
+    if (name.isEmpty())
+        return nullptr;
+
+    return componentByName(Dependency(name), componentsByName);
+}
 
-    parseNameAndVersion(name, &fixedName, &fixedVersion);
+/*!
+    Looks up a component matching the already parsed \a dependency in the \a componentsByName
+    index created by componentsByName(). Returns \c 0 if no component matches.
+*/
+Component *PackageManagerCore::componentByName(const Dependency &dependency,
+    const QHash<QString, QList<Component *> > &componentsByName)
+{
+    const QHash<QString, QList<Component *> >::const_iterator it
+        = componentsByName.constFind(dependency.name());
+    if (it == componentsByName.constEnd())
+        return nullptr;
 
-    foreach (Component *component, components) {
-        if (componentMatches(component, fixedName, fixedVersion))
+    foreach (Component *component, it.value()) {
+        if (componentMatches(component, dependency))
             return component;
     }
 
     return nullptr;
 }
 
+/*!
+    Returns an index of \a components by their name. Components sharing a name are kept in the
+    order of \a components, so that looking them up gives the same result as searching the list.
+*/
+QHash<QString, QList<Component *> > PackageManagerCore::componentsByName(const QList<Component *> &components)
+{
+    QHash<QString, QList<Component *> > index;
+    index.reserve(components.count());
+    foreach (Component *component, components)
+        index[component->name()].append(component);
+    return index;
+}
+
+/*!
+    \internal
+
+    Marks the name index used by componentByName() as outdated, it gets rebuilt on the next lookup.
+*/
+void PackageManagerCore::invalidateComponentIndex()
+{
+    d->invalidateComponentIndex();
+}
+
+/*!
+    \internal
+
+    Updates the index used by dependees() after the dependencies of \a component changed from
+    \a previous, and drops the incremental calculation of components to install.
+*/
+void PackageManagerCore::dependenciesChanged(Component *component,
+    const QList<Dependency> &previous)
+{
+    d->updateDependeeIndex(component, previous);
+    d->clearIncrementalInstallerCalculator();
+}
+
+/*!
+    \internal
+
+    Drops the incremental calculation of components to install after a value of a component
+    changed that it only reads when it is created.
+*/
+void PackageManagerCore::calculationInputChanged()
+{
+    d->clearIncrementalInstallerCalculator();
+}
+
 /*!
     Returns \c true if directory specified by \a path is writable by
     the current user.
@@ -2090,18 +2149,13 @@ QList<Component*> PackageManagerCore::dependees(const Component *_component) con
     if (!_component)
         return QList<Component *>();
 
-    const QList<QInstaller::Component *> availableComponents = components(ComponentType::All);
-    if (availableComponents.isEmpty())
-        return QList<Component *>();
+    // only the components listing a dependency with the name of _component can match
+    const QList<Component *> candidates = d->dependeeIndex().value(_component->name());
 
     QList<Component *> dependees;
-    QString name;
-    QString version;
-    foreach (Component *component, availableComponents) {
-        const QStringList &dependencies = component->dependencies();
-        foreach (const QString &dependency, dependencies) {
-            parseNameAndVersion(dependency, &name, &version);
-            if (componentMatches(_component, name, version))
+    foreach (Component *component, candidates) {
+        foreach (const Dependency &dependency, component->parsedDependencies()) {
+            if (componentMatches(_component, dependency))
                 dependees.append(component);
         }
     }
@@ -2861,24 +2915,7 @@ bool PackageManagerCore::performOperation(const QString &name, const QStringList
 */
 bool PackageManagerCore::versionMatches(const QString &version, const QString &requirement)
 {
-    QRegExp compEx(QLatin1String("([<=>]+)(.*)"));
-    const QString comparator = compEx.exactMatch(requirement) ? compEx.cap(1) : QLatin1String("=");
-    const QString ver = compEx.exactMatch(requirement) ? compEx.cap(2) : requirement;
-
-    const bool allowEqual = comparator.contains(QLatin1Char('='));
-    const bool allowLess = comparator.contains(QLatin1Char('<'));
-    const bool allowMore = comparator.contains(QLatin1Char('>'));
-
-    if (allowEqual && version == ver)
-        return true;
-
-    if (allowLess && KDUpdater::compareVersion(ver, version) > 0)
-        return true;
-
-    if (allowMore && KDUpdater::compareVersion(ver, version) < 0)
-        return true;
-
-    return false;
+    return Dependency(QString(), requirement).matches(KDUpdater::Version(version));
 }
 
 /*!
@@ -3498,6 +3535,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
         if (updateComponentData(data, component.data())) {
             // Keep a reference so we can resolve dependencies during update.
             d->m_updaterComponentsDeps.append(component.take());
+            d->invalidateComponentIndex();
 
 //            const QString isNew = update->data(scNewComponent).toString();
 //            if (isNew.toLower() != scTrue)
@@ -3525,8 +3563,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
                 continue;   // Update for not installed package found, skip it.
 
             const LocalPackage &localPackage = locals.value(name);
-            const QString updateVersion = update->data(scVersion).toString();
-            if (KDUpdater::compareVersion(updateVersion, localPackage.version) <= 0)
+            if (update->version() <= KDUpdater::Version(localPackage.version))
                 continue;
 
             // It is quite possible that we may have already installed the update. Lets check the last
@@ -3541,6 +3578,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
 
             // this is not a dependency, it is a real update
             components.insert(name, d->m_updaterComponentsDeps.takeLast());
+            d->invalidateComponentIndex();
         }
     }
 
@@ -3549,6 +3587,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
         QInstaller::Component *component = new QInstaller::Component(this);
         component->loadDataFromPackage(installedPackages.value(key));
         d->m_updaterComponentsDeps.append(component);
+        d->invalidateComponentIndex();
         // Keep a list of local components that should be replaced
         if (replaceMes.contains(component->name()))
             localReplaceMes.insert(component->name(), component);
@@ -3608,6 +3647,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
 
             std::sort(d->m_updaterComponents.begin(), d->m_updaterComponents.end(),
                 Component::SortingPriorityGreaterThan());
+            d->invalidateComponentIndex();
         } else {
             // we have no updates, no need to store possible dependencies
             d->clearUpdaterComponentLists();
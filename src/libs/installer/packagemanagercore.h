@@ -42,6 +42,7 @@ namespace QInstaller {
 
 class Component;
 class ComponentModel;
+class Dependency;
 class ScriptEngine;
 class PackageManagerCorePrivate;
 class PackageManagerProxyFactory;
@@ -117,6 +118,11 @@ public:
     static void setCreateLocalRepositoryFromBinary(bool create);
 
     static Component *componentByName(const QString &name, const QList<Component *> &components);
+    static Component *componentByName(const QString &name,
+        const QHash<QString, QList<Component *> > &componentsByName);
+    static Component *componentByName(const Dependency &dependency,
+        const QHash<QString, QList<Component *> > &componentsByName);
+    static QHash<QString, QList<Component *> > componentsByName(const QList<Component *> &components);
 
     bool directoryWritable(const QString &path) const;
 
@@ -398,6 +404,12 @@ private:
     // remove once we deprecate isSelected, setSelected etc...
     friend class ComponentSelectionPage;
     void restoreCheckState();
+
+private:
+    friend class Component;
+    void invalidateComponentIndex();
+    void dependenciesChanged(Component *component, const QList<Dependency> &previous);
+    void calculationInputChanged();
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(PackageManagerCore::ComponentTypes)
 
@@ -34,7 +34,9 @@
 #include "component.h"
 #include "scriptengine.h"
 #include "componentmodel.h"
+#include "downloadarchivesjob.h"
 #include "errors.h"
+#include "extractarchiveoperation.h"
 #include "fileio.h"
 #include "remotefileengine.h"
 #include "graph.h"
@@ -45,6 +47,7 @@
 #include "protocol.h"
 #include "qsettingswrapper.h"
 #include "installercalculator.h"
+#include "incrementalinstallercalculator.h"
 #include "uninstallercalculator.h"
 #include "componentchecker.h"
 #include "globals.h"
@@ -52,6 +55,7 @@
 #include "selfrestarter.h"
 #include "filedownloaderfactory.h"
 #include "updateoperationfactory.h"
+#include "updatesinfo_p.h"
 
 #include <productkeycheck.h>
 
@@ -60,10 +64,13 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QDirIterator>
+#include <QtCore/QEventLoop>
 #include <QtCore/QUuid>
 #include <QtCore/QFuture>
 #include <QtCore/QFutureWatcher>
 #include <QtCore/QTemporaryFile>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -126,6 +133,49 @@ static bool runOperation(Operation *operation, PackageManagerCorePrivate::Operat
     return false;
 }
 
+static QString archiveResourceName(const Component *component, const QString &archive)
+{
+    return QString::fromLatin1("installer://%1/%2").arg(component->name(), archive);
+}
+
+static bool pipelinedInstallation()
+{
+    // Installing components while the archives of the following ones are still downloading
+    // is opt-in: a download that fails or gets canceled later on rolls back the components
+    // that are already installed, instead of stopping before anything has been installed.
+    return !qEnvironmentVariableIsEmpty("IFW_PIPELINED_INSTALLATION");
+}
+
+static int parallelInstallationThreads()
+{
+    // Installing the components of independent dependency subtrees concurrently is opt-in, the
+    // variable holds the number of operations that may run at the same time.
+    if (qEnvironmentVariableIsEmpty("IFW_PARALLEL_INSTALLATION"))
+        return 1;
+    bool ok = false;
+    const int count = qEnvironmentVariableIntValue("IFW_PARALLEL_INSTALLATION", &ok);
+    return ok ? qMax(1, count) : QThread::idealThreadCount();
+}
+
+static bool runsConcurrently(const Operation *operation)
+{
+    // Only operations known to touch nothing but the files of their own component may run next
+    // to other operations. Everything else, including operations registered by plugins or by
+    // component scripts, might change state shared by all components or run external code, and
+    // therefore never runs at the same time as any other operation.
+    static const QSet<QString> names = QSet<QString>()
+        << QLatin1String("Copy") << QLatin1String("Extract") << QLatin1String("License")
+        << QLatin1String("MinimumProgress") << QLatin1String("Mkdir");
+    return names.contains(operation->name());
+}
+
+static bool backupAndPerformOperation(Operation *operation)
+{
+    // allow the operation to backup stuff before performing the operation
+    runOperation(operation, PackageManagerCorePrivate::Backup);
+    return runOperation(operation, PackageManagerCorePrivate::Perform);
+}
+
 static QStringList checkRunningProcessesFromList(const QStringList &processList)
 {
     const QList<ProcessInfo> allProcesses = runningProcesses();
@@ -210,6 +260,12 @@ PackageManagerCorePrivate::PackageManagerCorePrivate(PackageManagerCore *core)
     , m_controlScriptEngine(nullptr)
     , m_installerCalculator(nullptr)
     , m_uninstallerCalculator(nullptr)
+    , m_incrementalInstallerCalculator(nullptr)
+    , m_installerCalculatorOutdated(false)
+    , m_componentIndexValid(false)
+    , m_componentIndexUpdater(false)
+    , m_dependeeIndexValid(false)
+    , m_dependeeIndexUpdater(false)
     , m_proxyFactory(nullptr)
     , m_defaultModel(nullptr)
     , m_updaterModel(nullptr)
@@ -246,6 +302,12 @@ PackageManagerCorePrivate::PackageManagerCorePrivate(PackageManagerCore *core, q
     , m_controlScriptEngine(nullptr)
     , m_installerCalculator(nullptr)
     , m_uninstallerCalculator(nullptr)
+    , m_incrementalInstallerCalculator(nullptr)
+    , m_installerCalculatorOutdated(false)
+    , m_componentIndexValid(false)
+    , m_componentIndexUpdater(false)
+    , m_dependeeIndexValid(false)
+    , m_dependeeIndexUpdater(false)
     , m_proxyFactory(nullptr)
     , m_defaultModel(nullptr)
     , m_updaterModel(nullptr)
@@ -291,6 +353,7 @@ PackageManagerCorePrivate::~PackageManagerCorePrivate()
     clearUpdaterComponentLists();
     clearInstallerCalculator();
     clearUninstallerCalculator();
+    clearIncrementalInstallerCalculator();
 
     qDeleteAll(m_ownedOperations);
     qDeleteAll(m_performedOperationsOld);
@@ -421,6 +484,7 @@ bool PackageManagerCorePrivate::buildComponentTree(QHash<QString, Component*> &c
         }
 
         std::sort(m_rootComponents.begin(), m_rootComponents.end(), Component::SortingPriorityGreaterThan());
+        invalidateComponentIndex();
 
         storeCheckState();
 
@@ -498,6 +562,7 @@ void PackageManagerCorePrivate::clearAllComponentLists()
     m_componentsToReplaceAllMode.clear();
     m_componentsToInstallCalculated = false;
 
+    invalidateComponentIndex();
     qDeleteAll(toDelete);
     cleanUpComponentEnvironment();
 }
@@ -523,6 +588,7 @@ void PackageManagerCorePrivate::clearUpdaterComponentLists()
     m_componentsToReplaceUpdaterMode.clear();
     m_componentsToInstallCalculated = false;
 
+    invalidateComponentIndex();
     qDeleteAll(usedComponents);
     cleanUpComponentEnvironment();
 }
@@ -537,10 +603,98 @@ QHash<QString, QPair<Component*, Component*> > &PackageManagerCorePrivate::compo
     return (!isUpdater()) ? m_componentsToReplaceAllMode : m_componentsToReplaceUpdaterMode;
 }
 
+/*!
+    Returns the name index of the components relevant to the current run mode, rebuilding it if
+    the component lists have changed since it was last used.
+*/
+const QHash<QString, QList<Component *> > &PackageManagerCorePrivate::componentIndex() const
+{
+    // The run mode decides which component lists are searched, see PackageManagerCore::components().
+    if (!m_componentIndexValid || m_componentIndexUpdater != isUpdater()) {
+        m_componentIndex = PackageManagerCore::componentsByName(
+            m_core->components(PackageManagerCore::ComponentType::AllNoReplacements));
+        m_componentIndexUpdater = isUpdater();
+        m_componentIndexValid = true;
+    }
+    return m_componentIndex;
+}
+
+void PackageManagerCorePrivate::invalidateComponentIndex()
+{
+    m_componentIndexValid = false;
+    m_componentIndex.clear();
+
+    m_dependeeIndexValid = false;
+    m_dependeeIndex.clear();
+    m_dependeeIndexPositions.clear();
+
+    clearIncrementalInstallerCalculator();
+}
+
+/*!
+    Returns the components of components(All) by the names of the components they depend on,
+    rebuilding the index if the component lists have changed since it was last used.
+*/
+const QHash<QString, QList<Component *> > &PackageManagerCorePrivate::dependeeIndex() const
+{
+    if (!m_dependeeIndexValid || m_dependeeIndexUpdater != isUpdater()) {
+        m_dependeeIndex.clear();
+        m_dependeeIndexPositions.clear();
+        foreach (Component *component, m_core->components(PackageManagerCore::ComponentType::All)) {
+            m_dependeeIndexPositions.insert(component, m_dependeeIndexPositions.count());
+            foreach (const Dependency &dependency, component->parsedDependencies()) {
+                QList<Component *> &dependees = m_dependeeIndex[dependency.name()];
+                if (dependees.isEmpty() || dependees.last() != component)
+                    dependees.append(component);
+            }
+        }
+        m_dependeeIndexUpdater = isUpdater();
+        m_dependeeIndexValid = true;
+    }
+    return m_dependeeIndex;
+}
+
+/*!
+    Moves \a component to the index entries of its current dependencies after they changed
+    from \a previous, at its position in components(All). Components the index does not know
+    about are ignored.
+*/
+void PackageManagerCorePrivate::updateDependeeIndex(Component *component,
+    const QList<Dependency> &previous)
+{
+    if (!m_dependeeIndexValid || !m_dependeeIndexPositions.contains(component))
+        return;
+
+    // the uninstaller calculator walks the dependees in this order, keep it independent of
+    // the order dependencies were changed in
+    const int position = m_dependeeIndexPositions.value(component);
+    const auto isBefore = [this](Component *dependee, int other) {
+        return m_dependeeIndexPositions.value(dependee) < other;
+    };
+
+    foreach (const Dependency &dependency, previous) {
+        const QHash<QString, QList<Component *> >::iterator it
+            = m_dependeeIndex.find(dependency.name());
+        if (it == m_dependeeIndex.end())
+            continue;
+        it.value().removeAll(component);
+        if (it.value().isEmpty())
+            m_dependeeIndex.erase(it);
+    }
+    foreach (const Dependency &dependency, component->parsedDependencies()) {
+        QList<Component *> &dependees = m_dependeeIndex[dependency.name()];
+        const QList<Component *>::iterator it = std::lower_bound(dependees.begin(),
+            dependees.end(), position, isBefore);
+        if (it == dependees.end() || *it != component)
+            dependees.insert(it, component);
+    }
+}
+
 void PackageManagerCorePrivate::clearInstallerCalculator()
 {
     delete m_installerCalculator;
     m_installerCalculator = nullptr;
+    m_installerCalculatorOutdated = false;
 }
 
 InstallerCalculator *PackageManagerCorePrivate::installerCalculator() const
@@ -549,6 +703,11 @@ InstallerCalculator *PackageManagerCorePrivate::installerCalculator() const
         PackageManagerCorePrivate *const pmcp = const_cast<PackageManagerCorePrivate *> (this);
         pmcp->m_installerCalculator = new InstallerCalculator(
             m_core->components(PackageManagerCore::ComponentType::AllNoReplacements));
+        if (m_installerCalculatorOutdated) {
+            pmcp->m_installerCalculatorOutdated = false;
+            pmcp->m_componentsToInstallCalculated = m_installerCalculator
+                ->appendComponentsToInstall(m_core->componentsMarkedForInstallation());
+        }
     }
     return m_installerCalculator;
 }
@@ -577,6 +736,22 @@ UninstallerCalculator *PackageManagerCorePrivate::uninstallerCalculator() const
     return m_uninstallerCalculator;
 }
 
+void PackageManagerCorePrivate::clearIncrementalInstallerCalculator()
+{
+    delete m_incrementalInstallerCalculator;
+    m_incrementalInstallerCalculator = nullptr;
+}
+
+IncrementalInstallerCalculator *PackageManagerCorePrivate::incrementalInstallerCalculator() const
+{
+    if (!m_incrementalInstallerCalculator) {
+        PackageManagerCorePrivate *const pmcp = const_cast<PackageManagerCorePrivate *> (this);
+        pmcp->m_incrementalInstallerCalculator = new IncrementalInstallerCalculator(
+            m_core->components(PackageManagerCore::ComponentType::AllNoReplacements));
+    }
+    return m_incrementalInstallerCalculator;
+}
+
 void PackageManagerCorePrivate::initialize(const QHash<QString, QString> &params)
 {
     m_coreCheckedHash.clear();
@@ -1548,7 +1723,21 @@ bool PackageManagerCorePrivate::runInstaller()
 
         const double downloadPartProgressSize = double(1) / double(3);
         double componentsInstallPartProgressSize = double(2) / double(3);
-        const int downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+
+        // In pipelined mode the downloads keep running in the background while the components
+        // get installed, each component waits only for its own archives.
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        int downloadedArchivesCount = 0;
+        if (pipelinedInstallation()) {
+            const QList<QPair<QString, QString> > archives = archivesToDownload(componentsToInstall);
+            if (!archives.isEmpty()) {
+                archivesJob.reset(createArchivesDownloadJob(archives, downloadPartProgressSize));
+                archivesJob->start();
+                downloadedArchivesCount = archives.count();
+            }
+        } else {
+            downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+        }
 
         // if there was no download we have the whole progress for installing components
         if (!downloadedArchivesCount)
@@ -1562,14 +1751,28 @@ bool PackageManagerCorePrivate::runInstaller()
         m_localPackageHub->setApplicationName(m_data.value(QLatin1String("ProductName"),
             m_data.settings().applicationName()).toString());
         m_localPackageHub->setApplicationVersion(QLatin1String(QUOTE(IFW_REPOSITORY_FORMAT_VERSION)));
+        // only journal the installed components, the file gets written once all are done
+        m_localPackageHub->beginTransaction();
 
         const int progressOperationCount = countProgressOperations(componentsToInstall)
             // add one more operation as we support progress
             + (PackageManagerCore::createLocalRepositoryFromBinary() ? 1 : 0);
         double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        const int installThreads = parallelInstallationThreads();
+        if (installThreads > 1) {
+            installComponentsConcurrently(componentsToInstall, progressOperationSize,
+                adminRightsGained, archivesJob.data(), installThreads);
+        } else {
+            foreach (Component *component, componentsToInstall) {
+                if (archivesJob)
+                    waitForComponentArchives(archivesJob.data(), component);
+                installComponent(component, progressOperationSize, adminRightsGained);
+            }
+        }
+        if (archivesJob)
+            finishArchivesDownload(archivesJob.data());
+        m_localPackageHub->commitTransaction();
 
         if (m_core->isOfflineOnly() && PackageManagerCore::createLocalRepositoryFromBinary()) {
             emit m_core->titleMessageChanged(tr("Creating local repository"));
@@ -1644,6 +1847,7 @@ bool PackageManagerCorePrivate::runInstaller()
                 << m_performedOperationsCurrentSession.count();
         }
 
+        m_localPackageHub->commitTransaction();
         m_core->rollBackInstallation();
 
         ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nInstallation aborted!"));
@@ -1780,8 +1984,21 @@ bool PackageManagerCorePrivate::runPackageUpdater()
 
         ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("Preparing the installation..."));
 
-        // following, we download the needed archives
-        m_core->downloadNeededArchives(downloadPartProgressSize);
+        // following, we download the needed archives, in pipelined mode while removing the
+        // deselected components and installing the new ones
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        if (pipelinedInstallation()) {
+            const QList<QPair<QString, QString> > archives = archivesToDownload(componentsToInstall);
+            if (!archives.isEmpty()) {
+                archivesJob.reset(createArchivesDownloadJob(archives, downloadPartProgressSize));
+                archivesJob->start();
+            }
+        } else {
+            m_core->downloadNeededArchives(downloadPartProgressSize);
+        }
+
+        // only journal the removed and installed components, the file gets written once all are done
+        m_localPackageHub->beginTransaction();
 
         if (undoOperations.count() > 0) {
             ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("Removing deselected components..."));
@@ -1792,8 +2009,20 @@ bool PackageManagerCorePrivate::runPackageUpdater()
         const double progressOperationCount = countProgressOperations(componentsToInstall);
         const double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        const int installThreads = parallelInstallationThreads();
+        if (installThreads > 1) {
+            installComponentsConcurrently(componentsToInstall, progressOperationSize,
+                adminRightsGained, archivesJob.data(), installThreads);
+        } else {
+            foreach (Component *component, componentsToInstall) {
+                if (archivesJob)
+                    waitForComponentArchives(archivesJob.data(), component);
+                installComponent(component, progressOperationSize, adminRightsGained);
+            }
+        }
+        if (archivesJob)
+            finishArchivesDownload(archivesJob.data());
+        m_localPackageHub->commitTransaction();
 
         emit m_core->titleMessageChanged(tr("Creating Maintenance Tool"));
 
@@ -1820,6 +2049,7 @@ bool PackageManagerCorePrivate::runPackageUpdater()
                 << m_performedOperationsCurrentSession.count();
         }
 
+        m_localPackageHub->commitTransaction();
         m_core->rollBackInstallation();
 
         ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nUpdate aborted!"));
@@ -1899,21 +2129,307 @@ bool PackageManagerCorePrivate::runUninstaller()
     return success;
 }
 
+class ComponentInstallScheduler
+{
+    Q_DISABLE_COPY(ComponentInstallScheduler)
+
+public:
+    ComponentInstallScheduler(PackageManagerCorePrivate *d, const QList<Component *> &components,
+            double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob,
+            int threadCount)
+        : m_d(d)
+        , m_progressOperationSize(progressOperationSize)
+        , m_adminRightsGained(adminRightsGained)
+        , m_archivesJob(archivesJob)
+    {
+        m_pool.setMaxThreadCount(threadCount);
+
+        QHash<Component *, int> indexes;
+        foreach (Component *component, components) {
+            Entry entry;
+            entry.component = component;
+            entry.operations = component->operations();
+            indexes.insert(component, m_entries.count());
+            m_entries.append(entry);
+        }
+
+        const Graph<Component *> graph = d->installerCalculator()->installationGraph(components);
+        for (int i = 0; i < m_entries.count(); ++i) {
+            foreach (Component *dependency, graph.edges(m_entries.at(i).component)) {
+                // only wait for what the sequential installation would have installed before,
+                // that keeps the order of the list the one to follow and rules out cycles
+                const int index = indexes.value(dependency, -1);
+                if (index < 0 || index >= i)
+                    continue;
+                ++m_entries[i].pendingDependencies;
+                m_entries[index].dependents.append(i);
+            }
+        }
+    }
+
+    void run()
+    {
+        QEventLoop loop;
+        m_loop = &loop;
+        if (m_archivesJob) {
+            QObject::connect(m_archivesJob, &DownloadArchivesJob::archiveDownloaded, &loop,
+                [this]() { schedule(); });
+            QObject::connect(m_archivesJob, &Job::finished, &loop, [this]() { schedule(); });
+        }
+
+        schedule();
+        if (!isDone())
+            loop.exec();
+        m_loop = nullptr;
+
+        // operations of components that did not finish need to be undone as well
+        for (int i = m_committed; i < m_entries.count(); ++i) {
+            foreach (Operation *operation, m_entries.at(i).performed)
+                m_d->addPerformed(operation);
+        }
+
+        if (m_stopping)
+            throw Error(m_error);
+    }
+
+private:
+    struct Entry
+    {
+        Component *component = nullptr;
+        OperationList operations;
+        OperationList performed;
+        QList<int> dependents;
+        int pendingDependencies = 0;
+        int nextOperation = 0;
+        bool started = false;
+        bool running = false;
+        bool finished = false;
+        bool becameAdmin = false;
+        bool showDetailsLog = false;
+        QSharedPointer<ConcurrentArchiveExtractor> extractor;
+    };
+
+    bool isDone() const
+    {
+        return m_inFlight == 0 && (m_stopping || m_committed == m_entries.count());
+    }
+
+    void stop(const QString &error)
+    {
+        if (m_stopping)
+            return;
+        m_stopping = true;
+        m_error = error;
+    }
+
+    bool checkStatus()
+    {
+        try {
+            if (m_archivesJob && m_archivesJob->isFinished())
+                m_d->checkArchivesDownloadError(m_archivesJob);
+            else if (m_d->statusCanceledOrFailed())
+                throw Error(PackageManagerCorePrivate::tr("Installation canceled by user"));
+        } catch (const Error &error) {
+            stop(error.message());
+        }
+        return !m_stopping;
+    }
+
+    bool archivesDownloaded(Component *component) const
+    {
+        if (!m_archivesJob)
+            return true;
+        foreach (const QString &archive, component->downloadableArchives()) {
+            if (!m_archivesJob->isArchiveDownloaded(archiveResourceName(component, archive)))
+                return false;
+        }
+        return true;
+    }
+
+    void schedule()
+    {
+        // a message box or the admin rights request might spin an event loop, pick up the
+        // requests made meanwhile once we are back
+        if (m_scheduling || m_paused) {
+            m_rescheduleRequested = true;
+            return;
+        }
+
+        m_scheduling = true;
+        do {
+            m_rescheduleRequested = false;
+            startReadyOperations();
+        } while (m_rescheduleRequested && !m_paused);
+        m_scheduling = false;
+
+        if (m_loop && isDone())
+            m_loop->quit();
+    }
+
+    void startReadyOperations()
+    {
+        for (int i = 0; i < m_entries.count() && checkStatus(); ++i) {
+            if (m_exclusiveRunning || m_inFlight >= m_pool.maxThreadCount())
+                return;
+
+            Entry &entry = m_entries[i];
+            if (entry.finished || entry.running || entry.pendingDependencies > 0)
+                continue;
+
+            if (!entry.started) {
+                if (!archivesDownloaded(entry.component))
+                    continue;
+                entry.started = true;
+                entry.showDetailsLog = m_d->beginComponentInstallation(entry.component);
+                if (!checkStatus())
+                    return;
+            }
+
+            if (entry.nextOperation == entry.operations.count()) {
+                try {
+                    finishComponent(i);
+                } catch (const Error &error) {
+                    stop(error.message());
+                }
+                continue;
+            }
+
+            Operation *operation = entry.operations.at(entry.nextOperation);
+            const bool exclusive = !runsConcurrently(operation) || (!m_adminRightsGained
+                && operation->value(QLatin1String("admin")).toBool());
+            if (exclusive && m_inFlight > 0)
+                return; // start nothing else until the running operations are done
+
+            startOperation(i, exclusive, false);
+        }
+    }
+
+    void startOperation(int index, bool exclusive, bool retry)
+    {
+        Entry &entry = m_entries[index];
+        Operation *operation = entry.operations.at(entry.nextOperation);
+        if (!retry) {
+            // maybe this operations wants us to be admin...
+            if (!m_adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
+                entry.becameAdmin = m_d->m_core->gainAdminRights();
+                qCDebug(QInstaller::lcGeneral) << operation->name() << "as admin:"
+                    << entry.becameAdmin;
+            }
+            m_d->connectOperationToInstaller(operation, m_progressOperationSize);
+            m_d->connectOperationCallMethodRequest(operation);
+
+            if (!entry.extractor)
+                entry.extractor.reset(new ConcurrentArchiveExtractor(entry.operations));
+            entry.extractor->start(operation);
+        }
+
+        entry.running = true;
+        m_exclusiveRunning = exclusive;
+        ++m_inFlight;
+
+        QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>;
+        QObject::connect(watcher, &QFutureWatcher<bool>::finished, watcher,
+            [this, index, exclusive, watcher]() {
+                watcher->deleteLater();
+                operationFinished(index, exclusive, watcher->result());
+            }, Qt::QueuedConnection);
+        watcher->setFuture(retry
+            ? QtConcurrent::run(&m_pool, runOperation, operation, PackageManagerCorePrivate::Perform)
+            : QtConcurrent::run(&m_pool, backupAndPerformOperation, operation));
+    }
+
+    void operationFinished(int index, bool exclusive, bool ok)
+    {
+        Entry &entry = m_entries[index];
+        Operation *operation = entry.operations.at(entry.nextOperation);
+        entry.running = false;
+        m_exclusiveRunning = false;
+        --m_inFlight;
+
+        PackageManagerCore *core = m_d->m_core;
+        bool ignoreError = false;
+        if (!ok && !m_stopping && core->status() != PackageManagerCore::Canceled) {
+            m_paused = true;
+            const QMessageBox::StandardButton button =
+                m_d->askForOperationRetry(entry.component, operation);
+            m_paused = false;
+
+            if (button == QMessageBox::Retry) {
+                startOperation(index, exclusive, true);
+                schedule();
+                return;
+            }
+            if (button == QMessageBox::Ignore)
+                ignoreError = true;
+            else if (button == QMessageBox::Cancel)
+                core->interrupt();
+        }
+
+        if (ok || operation->error() > Operation::InvalidArguments) {
+            // Remember that the operation was performed, that allows us to undo it if a following operation
+            // fails or if this operation failed but still needs an undo call to cleanup.
+            entry.performed.append(operation);
+        }
+
+        if (entry.becameAdmin) {
+            core->dropAdminRights();
+            entry.becameAdmin = false;
+        }
+
+        if (!ok && !ignoreError) {
+            stop(operation->errorString());
+        } else {
+            if (entry.component->value(scEssential, scFalse) == scTrue)
+                m_d->m_needsHardRestart = true;
+            ++entry.nextOperation;
+        }
+        schedule();
+    }
+
+    void finishComponent(int index)
+    {
+        m_entries[index].finished = true;
+        m_entries[index].extractor.clear();
+        foreach (int dependent, m_entries.at(index).dependents)
+            --m_entries[dependent].pendingDependencies;
+
+        // register the components and their performed operations in list order, so the undo order
+        // does not depend on which thread happened to be faster
+        while (m_committed < m_entries.count() && m_entries.at(m_committed).finished) {
+            Entry &entry = m_entries[m_committed++];
+            foreach (Operation *operation, entry.performed)
+                m_d->addPerformed(operation);
+            entry.performed.clear();
+            m_d->finishComponentInstallation(entry.component, entry.showDetailsLog);
+        }
+    }
+
+    PackageManagerCorePrivate *const m_d;
+    const double m_progressOperationSize;
+    const bool m_adminRightsGained;
+    DownloadArchivesJob *const m_archivesJob;
+
+    QThreadPool m_pool;
+    QEventLoop *m_loop = nullptr;
+    QList<Entry> m_entries;
+    int m_committed = 0;
+    int m_inFlight = 0;
+    bool m_exclusiveRunning = false;
+    bool m_scheduling = false;
+    bool m_rescheduleRequested = false;
+    bool m_paused = false;
+    bool m_stopping = false;
+    QString m_error;
+};
+
 void PackageManagerCorePrivate::installComponent(Component *component, double progressOperationSize,
     bool adminRightsGained)
 {
     const OperationList operations = component->operations();
-    if (!component->operationsCreatedSuccessfully())
-        m_core->setCanceled();
+    const bool showDetailsLog = beginComponentInstallation(component);
 
-    const int opCount = operations.count();
-    // show only components which do something, MinimumProgress is only for progress calculation safeness
-    bool showDetailsLog = false;
-    if (opCount > 1 || (opCount == 1 && operations.at(0)->name() != QLatin1String("MinimumProgress"))) {
-        ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nInstalling component %1")
-            .arg(component->displayName()));
-        showDetailsLog = true;
-    }
+    // extracts the archives of the component in parallel, while performing the operations
+    ConcurrentArchiveExtractor extractor(operations);
 
     foreach (Operation *operation, operations) {
         if (statusCanceledOrFailed())
@@ -1928,6 +2444,7 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
 
         connectOperationToInstaller(operation, progressOperationSize);
         connectOperationCallMethodRequest(operation);
+        extractor.start(operation);
 
         // allow the operation to backup stuff before performing the operation
         performOperationThreaded(operation, PackageManagerCorePrivate::Backup);
@@ -1935,16 +2452,7 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
         bool ignoreError = false;
         bool ok = performOperationThreaded(operation);
         while (!ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
-            qCDebug(QInstaller::lcInstallerInstallLog) << QString::fromLatin1("Operation \"%1\" with arguments "
-                "\"%2\" failed: %3").arg(operation->name(), operation->arguments()
-                .join(QLatin1String("; ")), operation->errorString());
-            const QMessageBox::StandardButton button =
-                MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
-                QLatin1String("installationErrorWithCancel"), tr("Installer Error"),
-                tr("Error during installation process (%1):\n%2").arg(component->name(),
-                operation->errorString()),
-                QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Cancel);
-
+            const QMessageBox::StandardButton button = askForOperationRetry(component, operation);
             if (button == QMessageBox::Retry)
                 ok = performOperationThreaded(operation);
             else if (button == QMessageBox::Ignore)
@@ -1969,6 +2477,67 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
             m_needsHardRestart = true;
     }
 
+    finishComponentInstallation(component, showDetailsLog);
+}
+
+/*!
+    Installs \a components, given in installation order, like installComponent() does for each
+    of them. Components that do not depend on each other run their operations concurrently, up
+    to \a threadCount at a time, while each component keeps the order of its own operations.
+    Operations not known to be safe next to others, for example the ones registered by scripts,
+    run alone. Components waiting for their archives from \a archivesJob are started once they arrived.
+*/
+void PackageManagerCorePrivate::installComponentsConcurrently(const QList<Component *> &components,
+    double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob,
+    int threadCount)
+{
+    ComponentInstallScheduler scheduler(this, components, progressOperationSize, adminRightsGained,
+        archivesJob, threadCount);
+    scheduler.run();
+}
+
+/*!
+    Announces the installation of \a component. Returns whether the component does anything
+    worth to be shown in the details log.
+*/
+bool PackageManagerCorePrivate::beginComponentInstallation(Component *component)
+{
+    const OperationList operations = component->operations();
+    if (!component->operationsCreatedSuccessfully())
+        m_core->setCanceled();
+
+    const int opCount = operations.count();
+    // show only components which do something, MinimumProgress is only for progress calculation safeness
+    if (opCount > 1 || (opCount == 1 && operations.at(0)->name() != QLatin1String("MinimumProgress"))) {
+        ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nInstalling component %1")
+            .arg(component->displayName()));
+        return true;
+    }
+    return false;
+}
+
+/*!
+    Logs the failure of \a operation of \a component and asks the user how to continue. Returns
+    QMessageBox::Retry, QMessageBox::Ignore or QMessageBox::Cancel.
+*/
+QMessageBox::StandardButton PackageManagerCorePrivate::askForOperationRetry(Component *component,
+    Operation *operation)
+{
+    qCDebug(QInstaller::lcInstallerInstallLog) << QString::fromLatin1("Operation \"%1\" with arguments "
+        "\"%2\" failed: %3").arg(operation->name(), operation->arguments()
+        .join(QLatin1String("; ")), operation->errorString());
+    return MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
+        QLatin1String("installationErrorWithCancel"), tr("Installer Error"),
+        tr("Error during installation process (%1):\n%2").arg(component->name(),
+        operation->errorString()),
+        QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Cancel);
+}
+
+/*!
+    Registers \a component as installed once all of its operations have been performed.
+*/
+void PackageManagerCorePrivate::finishComponentInstallation(Component *component, bool showDetailsLog)
+{
     registerPathsForUninstallation(component->pathsForUninstallation(), component->name());
 
     if (!component->stopProcessForUpdateRequests().isEmpty()) {
@@ -2002,6 +2571,104 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
         ProgressCoordinator::instance()->emitDetailTextChanged(tr("Done"));
 }
 
+/*!
+    Returns the archives of \a components that need to be downloaded. The first value of each pair
+    contains the file name to register the archive with in the installer's internal file system,
+    the second one the source url.
+*/
+QList<QPair<QString, QString> > PackageManagerCorePrivate::archivesToDownload(
+    const QList<Component *> &components) const
+{
+    QList<QPair<QString, QString> > archives;
+    foreach (Component *component, components) {
+        // collect all archives to be downloaded
+        const QStringList toDownload = component->downloadableArchives();
+        foreach (const QString &versionFreeString, toDownload) {
+            archives.push_back(qMakePair(archiveResourceName(component, versionFreeString),
+                QString::fromLatin1("%1/%2/%3").arg(component->repositoryUrl().toString(),
+                component->name(), versionFreeString)));
+        }
+    }
+    return archives;
+}
+
+/*!
+    Creates a job that downloads \a archives and reports its progress as part of the
+    installation progress, \a partProgressSize is reserved for it. The caller takes ownership
+    of the job and starts it.
+*/
+DownloadArchivesJob *PackageManagerCorePrivate::createArchivesDownloadJob(
+    const QList<QPair<QString, QString> > &archives, double partProgressSize)
+{
+    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
+
+    DownloadArchivesJob *archivesJob = new DownloadArchivesJob(m_core);
+    archivesJob->setAutoDelete(false);
+    archivesJob->setArchivesToDownload(archives);
+    connect(m_core, &PackageManagerCore::installationInterrupted, archivesJob, &Job::cancel);
+    connect(archivesJob, &DownloadArchivesJob::outputTextChanged,
+            ProgressCoordinator::instance(), &ProgressCoordinator::emitLabelAndDetailTextChanged);
+    connect(archivesJob, &DownloadArchivesJob::downloadStatusChanged,
+            ProgressCoordinator::instance(), &ProgressCoordinator::downloadStatusChanged);
+
+    ProgressCoordinator::instance()->registerPartProgress(archivesJob,
+        SIGNAL(progressChanged(double)), partProgressSize);
+    return archivesJob;
+}
+
+/*!
+    Blocks until all archives of \a component are downloaded by \a archivesJob, while the
+    remaining downloads keep running. Throws if the job has finished with an error.
+*/
+void PackageManagerCorePrivate::waitForComponentArchives(DownloadArchivesJob *archivesJob,
+    Component *component)
+{
+    QSet<QString> pending;
+    foreach (const QString &archive, component->downloadableArchives()) {
+        const QString name = archiveResourceName(component, archive);
+        if (!archivesJob->isArchiveDownloaded(name))
+            pending.insert(name);
+    }
+
+    if (!pending.isEmpty() && !archivesJob->isFinished()) {
+        QEventLoop loop;
+        connect(archivesJob, &DownloadArchivesJob::archiveDownloaded, &loop,
+            [&pending, &loop](const QString &name) {
+                pending.remove(name);
+                if (pending.isEmpty())
+                    loop.quit();
+        });
+        connect(archivesJob, &Job::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    if (archivesJob->isFinished())
+        checkArchivesDownloadError(archivesJob);
+}
+
+/*!
+    Waits for \a archivesJob to finish and throws if it has failed or was canceled.
+*/
+void PackageManagerCorePrivate::finishArchivesDownload(DownloadArchivesJob *archivesJob)
+{
+    if (!archivesJob->isFinished())
+        archivesJob->waitForFinished();
+
+    checkArchivesDownloadError(archivesJob);
+    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
+}
+
+void PackageManagerCorePrivate::checkArchivesDownloadError(DownloadArchivesJob *archivesJob)
+{
+    if (archivesJob->error() == Job::Canceled)
+        m_core->interrupt();
+    else if (archivesJob->error() != Job::NoError)
+        throw Error(archivesJob->errorString());
+
+    if (statusCanceledOrFailed())
+        throw Error(tr("Installation canceled by user."));
+}
+
 bool PackageManagerCorePrivate::runningProcessesFound()
 {
     //Check if there are processes running in the install
@@ -2375,31 +3042,20 @@ bool PackageManagerCorePrivate::addUpdateResourcesFromRepositories(bool parseChe
 
         if (parseChecksum) {
             const QString updatesXmlPath = data.directory + QLatin1String("/Updates.xml");
-            QFile updatesFile(updatesXmlPath);
-            try {
-                QInstaller::openForRead(&updatesFile);
-            } catch(const Error &e) {
-                qCWarning(QInstaller::lcInstallerInstallLog) << "Error opening Updates.xml:"
-                    << e.message();
-                setStatus(PackageManagerCore::Failure, tr("Cannot add temporary update source information."));
-                return false;
-            }
-
-            int line = 0;
-            int column = 0;
-            QString error;
-            QDomDocument doc;
-            if (!doc.setContent(&updatesFile, &error, &line, &column)) {
-                qCWarning(QInstaller::lcInstallerInstallLog).nospace() << "Parse error in file "
-                    << updatesFile.fileName() << ": " << error << " at line " << line
-                    << " col " << column;
+            KDUpdater::UpdatesInfo updatesInfo;
+            updatesInfo.setFileName(updatesXmlPath);
+            if (updatesInfo.error() == KDUpdater::UpdatesInfo::CouldNotReadUpdateInfoFileError
+                    || updatesInfo.error() == KDUpdater::UpdatesInfo::InvalidXmlError) {
+                qCWarning(QInstaller::lcInstallerInstallLog) << "Error reading Updates.xml:"
+                    << updatesInfo.errorString();
                 setStatus(PackageManagerCore::Failure, tr("Cannot add temporary update source information."));
                 return false;
             }
 
-            const QDomNode checksum = doc.documentElement().firstChildElement(QLatin1String("Checksum"));
-            if (!checksum.isNull())
-                m_core->setTestChecksum(checksum.toElement().text().toLower() == scTrue);
+            if (!updatesInfo.checksum().isNull())
+                m_core->setTestChecksum(updatesInfo.checksum().toLower() == scTrue);
+            // hand the parsed file over to the update finder
+            KDUpdater::UpdatesInfo::keepForNextRead(updatesInfo);
         }
         if (compressedRepository)
             m_compressedPackageSources.insert(PackageSource(QUrl::fromLocalFile(data.directory), 1));
@@ -2474,13 +3130,15 @@ OperationList PackageManagerCorePrivate::sortOperationsBasedOnComponentDependenc
     Graph<QString> componentGraph;  // create the complete component graph
     foreach (const Component* node, m_core->components(PackageManagerCore::ComponentType::All)) {
         componentGraph.addNode(node->name());
-        componentGraph.addEdges(node->name(), m_core->parseNames(node->dependencies()));
+        foreach (const Dependency &dependency, node->parsedDependencies())
+            componentGraph.addEdge(node->name(), dependency.name());
     }
 
     const QStringList resolvedComponents = componentGraph.sort();
     if (componentGraph.hasCycle()) {
-        throw Error(tr("Dependency cycle between components \"%1\" and \"%2\" detected.")
-            .arg(componentGraph.cycle().first, componentGraph.cycle().second));
+        const QStringList cycle = componentGraph.cyclePath() << componentGraph.cyclePath().first();
+        throw Error(tr("Dependency cycle between components detected: %1.")
+            .arg(cycle.join(QLatin1String(" -> "))));
     }
     foreach (const QString &componentName, resolvedComponents)
         sortedOperations.append(componentOperationHash.value(componentName));
@@ -39,7 +39,9 @@
 #include "sysinfo.h"
 #include "updatefinder.h"
 
+#include <QMessageBox>
 #include <QObject>
+#include <QSet>
 
 class Job;
 
@@ -53,17 +55,21 @@ namespace QInstaller {
 
 struct BinaryLayout;
 class Component;
+class DownloadArchivesJob;
 class ScriptEngine;
 class ComponentModel;
 class TempDirDeleter;
 class InstallerCalculator;
+class IncrementalInstallerCalculator;
 class UninstallerCalculator;
 class RemoteFileEngineHandler;
+class ComponentInstallScheduler;
 
 class PackageManagerCorePrivate : public QObject
 {
     Q_OBJECT
     friend class PackageManagerCore;
+    friend class ComponentInstallScheduler;
     Q_DISABLE_COPY(PackageManagerCorePrivate)
 
 public:
@@ -116,12 +122,21 @@ public:
     QList<Component*> &replacementDependencyComponents();
     QHash<QString, QPair<Component*, Component*> > &componentsToReplace();
 
+    const QHash<QString, QList<Component *> > &componentIndex() const;
+    void invalidateComponentIndex();
+
+    const QHash<QString, QList<Component *> > &dependeeIndex() const;
+    void updateDependeeIndex(Component *component, const QList<Dependency> &previous);
+
     void clearInstallerCalculator();
     InstallerCalculator *installerCalculator() const;
 
     void clearUninstallerCalculator();
     UninstallerCalculator *uninstallerCalculator() const;
 
+    void clearIncrementalInstallerCalculator();
+    IncrementalInstallerCalculator *incrementalInstallerCalculator() const;
+
     bool runInstaller();
     bool isInstaller() const;
 
@@ -162,6 +177,19 @@ public:
 
     void installComponent(Component *component, double progressOperationSize,
         bool adminRightsGained = false);
+    void installComponentsConcurrently(const QList<Component *> &components,
+        double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob,
+        int threadCount);
+    bool beginComponentInstallation(Component *component);
+    QMessageBox::StandardButton askForOperationRetry(Component *component, Operation *operation);
+    void finishComponentInstallation(Component *component, bool showDetailsLog);
+
+    QList<QPair<QString, QString> > archivesToDownload(const QList<Component *> &components) const;
+    DownloadArchivesJob *createArchivesDownloadJob(const QList<QPair<QString, QString> > &archives,
+        double partProgressSize);
+    void waitForComponentArchives(DownloadArchivesJob *archivesJob, Component *component);
+    void finishArchivesDownload(DownloadArchivesJob *archivesJob);
+    void checkArchivesDownloadError(DownloadArchivesJob *archivesJob);
 
     bool runningProcessesFound();
 
@@ -268,6 +296,23 @@ private:
 
     InstallerCalculator *m_installerCalculator;
     UninstallerCalculator *m_uninstallerCalculator;
+    IncrementalInstallerCalculator *m_incrementalInstallerCalculator;
+    // the selection was only applied to the incremental calculator, installerCalculator()
+    // needs to calculate it once it is asked for
+    bool m_installerCalculatorOutdated;
+
+    // < name, components with that name > in the order of components(AllNoReplacements)
+    mutable QHash<QString, QList<Component *> > m_componentIndex;
+    mutable bool m_componentIndexValid;
+    mutable bool m_componentIndexUpdater;
+
+    // < dependency name, components listing a dependency with that name > in the order of
+    // components(All), kept up to date when dependencies change
+    mutable QHash<QString, QList<Component *> > m_dependeeIndex;
+    // < component, position in components(All) > of the components in the index
+    mutable QHash<Component *, int> m_dependeeIndexPositions;
+    mutable bool m_dependeeIndexValid;
+    mutable bool m_dependeeIndexUpdater;
 
     PackageManagerProxyFactory *m_proxyFactory;
 
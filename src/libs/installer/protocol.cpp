@@ -27,10 +27,189 @@
 **************************************************************************/
 
 #include "protocol.h"
+
+#include <QHash>
 #include <QIODevice>
 
 namespace QInstaller {
 
+namespace Protocol {
+
+struct CommandInfo
+{
+    CommandGroup group;
+    const char *name;
+};
+
+// Indexed by Command, keep in the same order.
+static const CommandInfo scCommands[] = {
+    { CommandGroup::General, "" },
+
+    { CommandGroup::General, Protocol::Create },
+    { CommandGroup::General, Protocol::Destroy },
+    { CommandGroup::General, Protocol::Shutdown },
+    { CommandGroup::General, Protocol::Authorize },
+    { CommandGroup::General, Protocol::AuthorizeVersioned },
+    { CommandGroup::General, Protocol::Reply },
+    { CommandGroup::General, Protocol::GetQProcessSignals },
+
+    { CommandGroup::QProcess, Protocol::QProcessCloseWriteChannel },
+    { CommandGroup::QProcess, Protocol::QProcessExitCode },
+    { CommandGroup::QProcess, Protocol::QProcessExitStatus },
+    { CommandGroup::QProcess, Protocol::QProcessKill },
+    { CommandGroup::QProcess, Protocol::QProcessReadAll },
+    { CommandGroup::QProcess, Protocol::QProcessReadAllStandardOutput },
+    { CommandGroup::QProcess, Protocol::QProcessReadAllStandardError },
+    { CommandGroup::QProcess, Protocol::QProcessStartDetached },
+    { CommandGroup::QProcess, Protocol::QProcessSetWorkingDirectory },
+    { CommandGroup::QProcess, Protocol::QProcessSetEnvironment },
+    { CommandGroup::QProcess, Protocol::QProcessEnvironment },
+    { CommandGroup::QProcess, Protocol::QProcessStart3Arg },
+    { CommandGroup::QProcess, Protocol::QProcessStart2Arg },
+    { CommandGroup::QProcess, Protocol::QProcessState },
+    { CommandGroup::QProcess, Protocol::QProcessTerminate },
+    { CommandGroup::QProcess, Protocol::QProcessWaitForFinished },
+    { CommandGroup::QProcess, Protocol::QProcessWaitForStarted },
+    { CommandGroup::QProcess, Protocol::QProcessWorkingDirectory },
+    { CommandGroup::QProcess, Protocol::QProcessErrorString },
+    { CommandGroup::QProcess, Protocol::QProcessReadChannel },
+    { CommandGroup::QProcess, Protocol::QProcessSetReadChannel },
+    { CommandGroup::QProcess, Protocol::QProcessWrite },
+    { CommandGroup::QProcess, Protocol::QProcessProcessChannelMode },
+    { CommandGroup::QProcess, Protocol::QProcessSetProcessChannelMode },
+    { CommandGroup::QProcess, Protocol::QProcessSetNativeArguments },
+
+    { CommandGroup::QSettings, Protocol::QSettingsAllKeys },
+    { CommandGroup::QSettings, Protocol::QSettingsBeginGroup },
+    { CommandGroup::QSettings, Protocol::QSettingsBeginWriteArray },
+    { CommandGroup::QSettings, Protocol::QSettingsBeginReadArray },
+    { CommandGroup::QSettings, Protocol::QSettingsChildGroups },
+    { CommandGroup::QSettings, Protocol::QSettingsChildKeys },
+    { CommandGroup::QSettings, Protocol::QSettingsClear },
+    { CommandGroup::QSettings, Protocol::QSettingsContains },
+    { CommandGroup::QSettings, Protocol::QSettingsEndArray },
+    { CommandGroup::QSettings, Protocol::QSettingsEndGroup },
+    { CommandGroup::QSettings, Protocol::QSettingsFallbacksEnabled },
+    { CommandGroup::QSettings, Protocol::QSettingsFileName },
+    { CommandGroup::QSettings, Protocol::QSettingsGroup },
+    { CommandGroup::QSettings, Protocol::QSettingsIsWritable },
+    { CommandGroup::QSettings, Protocol::QSettingsRemove },
+    { CommandGroup::QSettings, Protocol::QSettingsSetArrayIndex },
+    { CommandGroup::QSettings, Protocol::QSettingsSetFallbacksEnabled },
+    { CommandGroup::QSettings, Protocol::QSettingsStatus },
+    { CommandGroup::QSettings, Protocol::QSettingsSync },
+    { CommandGroup::QSettings, Protocol::QSettingsSetValue },
+    { CommandGroup::QSettings, Protocol::QSettingsValue },
+    { CommandGroup::QSettings, Protocol::QSettingsOrganizationName },
+    { CommandGroup::QSettings, Protocol::QSettingsApplicationName },
+
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineAtEnd },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineCaseSensitive },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineClose },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineCopy },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineEntryList },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineError },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineErrorString },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineFileFlags },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineFileName },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineFlush },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineHandle },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineIsRelativePath },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineIsSequential },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineLink },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineMkdir },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineOpen },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineOwner },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineOwnerId },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEnginePos },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineRead },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineReadLine },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineRemove },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineRename },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineRmdir },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSeek },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSetFileName },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSetPermissions },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSetSize },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSize },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSupportsExtension },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineExtension },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineWrite },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineSyncToDisk },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineRenameOverwrite },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineFileTime },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineReadRaw },
+    { CommandGroup::QAbstractFileEngine, Protocol::QAbstractFileEngineWriteRaw },
+
+    { CommandGroup::FileOperations, Protocol::FileOperationsExtractArchive },
+    { CommandGroup::FileOperations, Protocol::FileOperationsCopyFile },
+    { CommandGroup::FileOperations, Protocol::FileOperationsSetPermissions },
+    { CommandGroup::FileOperations, Protocol::FileOperationsProgress },
+    { CommandGroup::FileOperations, Protocol::FileOperationsCancel },
+};
+
+Q_STATIC_ASSERT_X(sizeof(scCommands) / sizeof(scCommands[0]) == size_t(Command::Count),
+    "Every Protocol::Command needs an entry in the command table.");
+
+/*!
+    Returns the command called \a name, or Command::Invalid if there is none.
+*/
+Command commandFromName(const QByteArray &name)
+{
+    static const QHash<QByteArray, Command> commands = [] {
+        QHash<QByteArray, Command> result;
+        for (int i = 1; i < int(Command::Count); ++i)
+            result.insert(QByteArray(scCommands[i].name), Command(i));
+        return result;
+    }();
+    return commands.value(name, Command::Invalid);
+}
+
+/*!
+    Returns the name of \a command, as sent on legacy connections.
+*/
+const char *commandName(Command command)
+{
+    if (command >= Command::Count)
+        return scCommands[0].name;
+    return scCommands[int(command)].name;
+}
+
+/*!
+    Returns the group of \a command, which decides the handler in the server.
+*/
+CommandGroup commandGroup(Command command)
+{
+    if (command >= Command::Count)
+        return CommandGroup::General;
+    return scCommands[int(command)].group;
+}
+
+/*!
+    Returns \a command encoded for protocol version 2 connections. The single byte is never
+    \c 0 and cannot be mistaken for a command name, which are longer.
+*/
+QByteArray encodeCommand(Command command)
+{
+    Q_ASSERT(command != Command::Invalid && command < Command::Count);
+    return QByteArray(1, char(command));
+}
+
+/*!
+    Returns the command of a packet, \a command can be encoded with encodeCommand() or be the name
+    of the command. Returns Command::Invalid for unknown commands.
+*/
+Command decodeCommand(const QByteArray &command)
+{
+    if (command.size() == 1) {
+        const quint8 code = quint8(command.at(0));
+        return code < quint8(Command::Count) ? Command(code) : Command::Invalid;
+    }
+    return commandFromName(command);
+}
+
+} // namespace Protocol
+
 typedef qint32 PackageSize;
 
 /*!
@@ -39,26 +218,46 @@ typedef qint32 PackageSize;
     \note Both client and server need to have the same endianness.
  */
 void sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data)
+{
+    sendPacket(device, command, data, nullptr, 0);
+}
+
+static void writeFully(QIODevice *device, const char *data, qint64 size)
+{
+    while (size > 0) {
+        const qint64 bytesWritten = device->write(data, size);
+        Q_ASSERT(bytesWritten >= 0);
+        if (bytesWritten < 0)
+            return;
+        data += bytesWritten;
+        size -= bytesWritten;
+    }
+}
+
+/*!
+    Write a packet containing \a command, \a data and the \a bulkSize bytes at \a bulkData to
+    \a device. The bulk data is appended to \a data on the receiving side, but written to the
+    device as is, without being copied into the packet first.
+
+    \note Both client and server need to have the same endianness.
+ */
+void sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data,
+    const char *bulkData, qint64 bulkSize)
 {
     // use aliasing for writing payload size into bytes
     char payloadBytes[sizeof(PackageSize)];
     PackageSize *payloadSize = reinterpret_cast<PackageSize*>(&payloadBytes);
-    *payloadSize = command.size() + sizeof(char) + data.size();
+    *payloadSize = command.size() + sizeof(char) + data.size() + bulkSize;
 
     QByteArray packet;
-    packet.reserve(sizeof(PackageSize) + *payloadSize);
+    packet.reserve(sizeof(PackageSize) + command.size() + sizeof(char) + data.size());
     packet.append(payloadBytes, sizeof(PackageSize));
     packet.append(command);
     packet.append('\0');
     packet.append(data);
 
-    forever {
-        const int bytesWritten = device->write(packet);
-        Q_ASSERT(bytesWritten >= 0);
-        if (bytesWritten == packet.size())
-            break;
-        packet.remove(0, bytesWritten);
-    }
+    writeFully(device, packet.constData(), packet.size());
+    writeFully(device, bulkData, bulkSize);
 }
 
 /*!
@@ -85,11 +284,12 @@ bool receivePacket(QIODevice *device, QByteArray *command, QByteArray *data)
         return false;
     }
 
-    const QByteArray payload = device->read(*payloadSize);
-    int separator = payload.indexOf('\0');
+    // read into data and strip the command in place, bulk payloads are not copied again
+    *data = device->read(*payloadSize);
+    const int separator = data->indexOf('\0');
 
-    *command = payload.left(separator);
-    *data = payload.right(payload.size() - separator - 1);
+    *command = data->left(separator);
+    data->remove(0, separator + 1);
     return true;
 }
 
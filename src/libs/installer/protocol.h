@@ -31,6 +31,7 @@
 
 #include "installer_global.h"
 
+QT_FORWARD_DECLARE_CLASS(QByteArray)
 QT_FORWARD_DECLARE_CLASS(QIODevice)
 
 namespace QInstaller {
@@ -51,10 +52,18 @@ enum struct StartAs {
 const char DefaultSocket[] = "ifw_srv";
 const char DefaultAuthorizationKey[] = "DefaultAuthorizationKey";
 
+// Connections authorized with Authorize speak the legacy protocol: one request at a time, every
+// reply is read before the next request is sent. AuthorizeVersioned negotiates a newer version,
+// where each request starts with a request ID the reply echoes, so several requests can be in
+// flight and requests without a reply are not waited for.
+const quint32 LegacyVersion = 1;
+const quint32 Version = 2;
+
 const char Create[] = "Create";
 const char Destroy[] = "Destroy";
 const char Shutdown[] = "Shutdown";
 const char Authorize[] = "Authorize";
+const char AuthorizeVersioned[] = "AuthorizeVersioned";
 const char Reply[] = "Reply";
 
 // QProcessWrapper
@@ -162,10 +171,156 @@ const char QAbstractFileEngineWrite[] = "QAbstractFileEngine::write";
 const char QAbstractFileEngineSyncToDisk[] = "QAbstractFileEngine::syncToDisk";
 const char QAbstractFileEngineRenameOverwrite[] = "QAbstractFileEngine::renameOverwrite";
 const char QAbstractFileEngineFileTime[] = "QAbstractFileEngine::fileTime";
+// Protocol version 2 only, the file content is sent as raw bytes after the request ID
+const char QAbstractFileEngineReadRaw[] = "QAbstractFileEngine::readRaw";
+const char QAbstractFileEngineWriteRaw[] = "QAbstractFileEngine::writeRaw";
+
+// RemoteFileOperations, protocol version 2 only
+const char FileOperations[] = "FileOperations";
+const char FileOperationsExtractArchive[] = "FileOperations::extractArchive";
+const char FileOperationsCopyFile[] = "FileOperations::copyFile";
+const char FileOperationsSetPermissions[] = "FileOperations::setPermissions";
+// Sent by the server while an archive is extracted, before the reply
+const char FileOperationsProgress[] = "FileOperations::progress";
+// Sent by the client while waiting for the reply to extractArchive
+const char FileOperationsCancel[] = "FileOperations::cancel";
+
+// Numeric command codes. Protocol version 2 connections send them as a single byte instead of
+// the command name, the names are only sent on legacy connections and used for debug output.
+// Client and server always come from the same build, new commands can be inserted anywhere.
+enum struct Command : quint8 {
+    Invalid = 0,
+
+    // General
+    Create,
+    Destroy,
+    Shutdown,
+    Authorize,
+    AuthorizeVersioned,
+    Reply,
+    GetQProcessSignals,
+
+    // QProcess
+    QProcessCloseWriteChannel,
+    QProcessExitCode,
+    QProcessExitStatus,
+    QProcessKill,
+    QProcessReadAll,
+    QProcessReadAllStandardOutput,
+    QProcessReadAllStandardError,
+    QProcessStartDetached,
+    QProcessSetWorkingDirectory,
+    QProcessSetEnvironment,
+    QProcessEnvironment,
+    QProcessStart3Arg,
+    QProcessStart2Arg,
+    QProcessState,
+    QProcessTerminate,
+    QProcessWaitForFinished,
+    QProcessWaitForStarted,
+    QProcessWorkingDirectory,
+    QProcessErrorString,
+    QProcessReadChannel,
+    QProcessSetReadChannel,
+    QProcessWrite,
+    QProcessProcessChannelMode,
+    QProcessSetProcessChannelMode,
+    QProcessSetNativeArguments,
+
+    // QSettings
+    QSettingsAllKeys,
+    QSettingsBeginGroup,
+    QSettingsBeginWriteArray,
+    QSettingsBeginReadArray,
+    QSettingsChildGroups,
+    QSettingsChildKeys,
+    QSettingsClear,
+    QSettingsContains,
+    QSettingsEndArray,
+    QSettingsEndGroup,
+    QSettingsFallbacksEnabled,
+    QSettingsFileName,
+    QSettingsGroup,
+    QSettingsIsWritable,
+    QSettingsRemove,
+    QSettingsSetArrayIndex,
+    QSettingsSetFallbacksEnabled,
+    QSettingsStatus,
+    QSettingsSync,
+    QSettingsSetValue,
+    QSettingsValue,
+    QSettingsOrganizationName,
+    QSettingsApplicationName,
+
+    // QAbstractFileEngine
+    QAbstractFileEngineAtEnd,
+    QAbstractFileEngineCaseSensitive,
+    QAbstractFileEngineClose,
+    QAbstractFileEngineCopy,
+    QAbstractFileEngineEntryList,
+    QAbstractFileEngineError,
+    QAbstractFileEngineErrorString,
+    QAbstractFileEngineFileFlags,
+    QAbstractFileEngineFileName,
+    QAbstractFileEngineFlush,
+    QAbstractFileEngineHandle,
+    QAbstractFileEngineIsRelativePath,
+    QAbstractFileEngineIsSequential,
+    QAbstractFileEngineLink,
+    QAbstractFileEngineMkdir,
+    QAbstractFileEngineOpen,
+    QAbstractFileEngineOwner,
+    QAbstractFileEngineOwnerId,
+    QAbstractFileEnginePos,
+    QAbstractFileEngineRead,
+    QAbstractFileEngineReadLine,
+    QAbstractFileEngineRemove,
+    QAbstractFileEngineRename,
+    QAbstractFileEngineRmdir,
+    QAbstractFileEngineSeek,
+    QAbstractFileEngineSetFileName,
+    QAbstractFileEngineSetPermissions,
+    QAbstractFileEngineSetSize,
+    QAbstractFileEngineSize,
+    QAbstractFileEngineSupportsExtension,
+    QAbstractFileEngineExtension,
+    QAbstractFileEngineWrite,
+    QAbstractFileEngineSyncToDisk,
+    QAbstractFileEngineRenameOverwrite,
+    QAbstractFileEngineFileTime,
+    QAbstractFileEngineReadRaw,
+    QAbstractFileEngineWriteRaw,
+
+    // FileOperations
+    FileOperationsExtractArchive,
+    FileOperationsCopyFile,
+    FileOperationsSetPermissions,
+    FileOperationsProgress,
+    FileOperationsCancel,
+
+    Count
+};
+
+enum struct CommandGroup : quint8 {
+    General,
+    QProcess,
+    QSettings,
+    QAbstractFileEngine,
+    FileOperations
+};
+
+Command INSTALLER_EXPORT commandFromName(const QByteArray &name);
+const char INSTALLER_EXPORT *commandName(Command command);
+CommandGroup INSTALLER_EXPORT commandGroup(Command command);
+
+QByteArray INSTALLER_EXPORT encodeCommand(Command command);
+Command INSTALLER_EXPORT decodeCommand(const QByteArray &command);
 
 } // namespace Protocol
 
 void INSTALLER_EXPORT sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data);
+void INSTALLER_EXPORT sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data,
+    const char *bulkData, qint64 bulkSize);
 bool INSTALLER_EXPORT receivePacket(QIODevice *device, QByteArray *command, QByteArray *data);
 
 } // namespace QInstaller
@@ -70,7 +70,7 @@ void QProcessWrapper::processSignals()
         return;
 
     QList<QVariant> receivedSignals =
-        callRemoteMethod<QList<QVariant> >(QString::fromLatin1(Protocol::GetQProcessSignals));
+        callRemoteMethod<QList<QVariant> >(Protocol::Command::GetQProcessSignals);
 
     while (!receivedSignals.isEmpty()) {
         const QString name = receivedSignals.takeFirst().toString();
@@ -107,7 +107,7 @@ bool QProcessWrapper::startDetached(const QString &program, const QStringList &a
     QProcessWrapper w;
     if (w.connectToServer()) {
         const QPair<bool, qint64> result =
-            w.callRemoteMethod<QPair<bool, qint64> >(QLatin1String(Protocol::QProcessStartDetached),
+            w.callRemoteMethod<QPair<bool, qint64> >(Protocol::Command::QProcessStartDetached,
                 program, arguments, workingDirectory);
         if (pid != nullptr)
             *pid = result.second;
@@ -131,7 +131,7 @@ void QProcessWrapper::setProcessChannelMode(QProcessWrapper::ProcessChannelMode
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessSetProcessChannelMode),
+        callRemoteMethod(Protocol::Command::QProcessSetProcessChannelMode,
             static_cast<QProcess::ProcessChannelMode>(mode), dummy);
         m_lock.unlock();
     } else {
@@ -156,7 +156,7 @@ void QProcessWrapper::setReadChannel(QProcessWrapper::ProcessChannel chan)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessSetReadChannel),
+        callRemoteMethod(Protocol::Command::QProcessSetReadChannel,
             static_cast<QProcess::ProcessChannel>(chan), dummy);
         m_lock.unlock();
     } else {
@@ -168,7 +168,7 @@ bool QProcessWrapper::waitForFinished(int msecs)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        const bool value = callRemoteMethod<bool>(QLatin1String(Protocol::QProcessWaitForFinished),
+        const bool value = callRemoteMethod<bool>(Protocol::Command::QProcessWaitForFinished,
             qint32(msecs));
         m_lock.unlock();
         return value;
@@ -180,7 +180,7 @@ bool QProcessWrapper::waitForStarted(int msecs)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        const bool value = callRemoteMethod<bool>(QLatin1String(Protocol::QProcessWaitForStarted),
+        const bool value = callRemoteMethod<bool>(Protocol::Command::QProcessWaitForStarted,
             qint32(msecs));
         m_lock.unlock();
         return value;
@@ -192,7 +192,7 @@ qint64 QProcessWrapper::write(const QByteArray &data)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        const qint64 value = callRemoteMethod<qint64>(QLatin1String(Protocol::QProcessWrite), data);
+        const qint64 value = callRemoteMethod<qint64>(Protocol::Command::QProcessWrite, data);
         m_lock.unlock();
         return value;
     }
@@ -203,7 +203,7 @@ void QProcessWrapper::closeWriteChannel()
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessCloseWriteChannel));
+        callRemoteMethod(Protocol::Command::QProcessCloseWriteChannel);
         m_lock.unlock();
     } else {
         process.closeWriteChannel();
@@ -214,7 +214,7 @@ int QProcessWrapper::exitCode() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const int value = callRemoteMethod<qint32>(QLatin1String(Protocol::QProcessExitCode));
+        const int value = callRemoteMethod<qint32>(Protocol::Command::QProcessExitCode);
         m_lock.unlock();
         return value;
     }
@@ -225,7 +225,7 @@ QProcessWrapper::ExitStatus QProcessWrapper::exitStatus() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const int status = callRemoteMethod<qint32>(QLatin1String(Protocol::QProcessExitStatus));
+        const int status = callRemoteMethod<qint32>(Protocol::Command::QProcessExitStatus);
         m_lock.unlock();
         return static_cast<QProcessWrapper::ExitStatus>(status);
     }
@@ -236,7 +236,7 @@ void QProcessWrapper::kill()
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessKill));
+        callRemoteMethod(Protocol::Command::QProcessKill);
         m_lock.unlock();
     } else {
         process.kill();
@@ -247,7 +247,7 @@ QByteArray QProcessWrapper::readAll()
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        const QByteArray ba = callRemoteMethod<QByteArray>(QLatin1String(Protocol::QProcessReadAll));
+        const QByteArray ba = callRemoteMethod<QByteArray>(Protocol::Command::QProcessReadAll);
         m_lock.unlock();
         return ba;
     }
@@ -259,7 +259,7 @@ QByteArray QProcessWrapper::readAllStandardOutput()
     if (connectToServer()) {
         m_lock.lockForWrite();
         const QByteArray ba =
-            callRemoteMethod<QByteArray>(QLatin1String(Protocol::QProcessReadAllStandardOutput));
+            callRemoteMethod<QByteArray>(Protocol::Command::QProcessReadAllStandardOutput);
         m_lock.unlock();
         return ba;
     }
@@ -271,7 +271,7 @@ QByteArray QProcessWrapper::readAllStandardError()
     if (connectToServer()) {
         m_lock.lockForWrite();
         const QByteArray ba =
-            callRemoteMethod<QByteArray>(QLatin1String(Protocol::QProcessReadAllStandardError));
+            callRemoteMethod<QByteArray>(Protocol::Command::QProcessReadAllStandardError);
         m_lock.unlock();
         return ba;
     }
@@ -283,7 +283,7 @@ void QProcessWrapper::start(const QString &param1, const QStringList &param2,
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessStart3Arg), param1, param2, param3);
+        callRemoteMethod(Protocol::Command::QProcessStart3Arg, param1, param2, param3);
         m_lock.unlock();
     } else {
         process.start(param1, param2, param3);
@@ -294,7 +294,7 @@ void QProcessWrapper::start(const QString &param1, QIODevice::OpenMode param2)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessStart2Arg), param1, param2);
+        callRemoteMethod(Protocol::Command::QProcessStart2Arg, param1, param2);
         m_lock.unlock();
     } else {
         process.start(param1, param2);
@@ -305,7 +305,7 @@ QProcessWrapper::ProcessState QProcessWrapper::state() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const int state = callRemoteMethod<qint32>(QLatin1String(Protocol::QProcessState));
+        const int state = callRemoteMethod<qint32>(Protocol::Command::QProcessState);
         m_lock.unlock();
         return static_cast<QProcessWrapper::ProcessState>(state);
     }
@@ -316,7 +316,7 @@ void QProcessWrapper::terminate()
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessTerminate));
+        callRemoteMethod(Protocol::Command::QProcessTerminate);
         m_lock.unlock();
     } else {
         process.terminate();
@@ -327,7 +327,7 @@ QProcessWrapper::ProcessChannel QProcessWrapper::readChannel() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const int channel = callRemoteMethod<qint32>(QLatin1String(Protocol::QProcessReadChannel));
+        const int channel = callRemoteMethod<qint32>(Protocol::Command::QProcessReadChannel);
         m_lock.unlock();
         return static_cast<QProcessWrapper::ProcessChannel>(channel);
     }
@@ -338,7 +338,7 @@ QProcessWrapper::ProcessChannelMode QProcessWrapper::processChannelMode() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const int mode = callRemoteMethod<qint32>(QLatin1String(Protocol::QProcessProcessChannelMode));
+        const int mode = callRemoteMethod<qint32>(Protocol::Command::QProcessProcessChannelMode);
         m_lock.unlock();
         return static_cast<QProcessWrapper::ProcessChannelMode>(mode);
     }
@@ -349,7 +349,7 @@ QString QProcessWrapper::workingDirectory() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const QString dir = callRemoteMethod<QString>(QLatin1String(Protocol::QProcessWorkingDirectory));
+        const QString dir = callRemoteMethod<QString>(Protocol::Command::QProcessWorkingDirectory);
         m_lock.unlock();
         return dir;
     }
@@ -360,7 +360,7 @@ QString QProcessWrapper::errorString() const
 {
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
-        const QString error = callRemoteMethod<QString>(QLatin1String(Protocol::QProcessErrorString));
+        const QString error = callRemoteMethod<QString>(Protocol::Command::QProcessErrorString);
         m_lock.unlock();
         return error;
     }
@@ -372,7 +372,7 @@ QStringList QProcessWrapper::environment() const
     if ((const_cast<QProcessWrapper *>(this))->connectToServer()) {
         m_lock.lockForWrite();
         const QStringList env =
-            callRemoteMethod<QStringList>(QLatin1String(Protocol::QProcessEnvironment));
+            callRemoteMethod<QStringList>(Protocol::Command::QProcessEnvironment);
         m_lock.unlock();
         return env;
     }
@@ -383,7 +383,7 @@ void QProcessWrapper::setEnvironment(const QStringList &param1)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessSetEnvironment), param1, dummy);
+        callRemoteMethod(Protocol::Command::QProcessSetEnvironment, param1, dummy);
         m_lock.unlock();
     } else {
         process.setEnvironment(param1);
@@ -395,7 +395,7 @@ void QProcessWrapper::setNativeArguments(const QString &param1)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessSetNativeArguments), param1, dummy);
+        callRemoteMethod(Protocol::Command::QProcessSetNativeArguments, param1, dummy);
         m_lock.unlock();
     } else {
         process.setNativeArguments(param1);
@@ -407,7 +407,7 @@ void QProcessWrapper::setWorkingDirectory(const QString &param1)
 {
     if (connectToServer()) {
         m_lock.lockForWrite();
-        callRemoteMethod(QLatin1String(Protocol::QProcessSetWorkingDirectory), param1, dummy);
+        callRemoteMethod(Protocol::Command::QProcessSetWorkingDirectory, param1, dummy);
         m_lock.unlock();
     } else {
         process.setWorkingDirectory(param1);
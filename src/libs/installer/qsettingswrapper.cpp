@@ -125,21 +125,21 @@ QSettingsWrapper::~QSettingsWrapper()
 QStringList QSettingsWrapper::allKeys() const
 {
     if (createSocket())
-        return callRemoteMethod<QStringList>(QLatin1String(Protocol::QSettingsAllKeys));
+        return callRemoteMethod<QStringList>(Protocol::Command::QSettingsAllKeys);
     return d->settings.allKeys();
 }
 
 QString QSettingsWrapper::applicationName() const
 {
     if (createSocket())
-        return callRemoteMethod<QString>(QLatin1String(Protocol::QSettingsApplicationName));
+        return callRemoteMethod<QString>(Protocol::Command::QSettingsApplicationName);
     return d->settings.applicationName();
 }
 
 void QSettingsWrapper::beginGroup(const QString &param1)
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsBeginGroup), param1, dummy);
+        callRemoteMethod(Protocol::Command::QSettingsBeginGroup, param1, dummy);
     else
         d->settings.beginGroup(param1);
 }
@@ -147,14 +147,14 @@ void QSettingsWrapper::beginGroup(const QString &param1)
 int QSettingsWrapper::beginReadArray(const QString &param1)
 {
     if (createSocket())
-        return callRemoteMethod<qint32>(QLatin1String(Protocol::QSettingsBeginReadArray), param1);
+        return callRemoteMethod<qint32>(Protocol::Command::QSettingsBeginReadArray, param1);
     return d->settings.beginReadArray(param1);
 }
 
 void QSettingsWrapper::beginWriteArray(const QString &param1, int param2)
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsBeginWriteArray), param1, qint32(param2));
+        callRemoteMethod(Protocol::Command::QSettingsBeginWriteArray, param1, qint32(param2));
     else
         d->settings.beginWriteArray(param1, param2);
 }
@@ -162,35 +162,35 @@ void QSettingsWrapper::beginWriteArray(const QString &param1, int param2)
 QStringList QSettingsWrapper::childGroups() const
 {
     if (createSocket())
-        return callRemoteMethod<QStringList>(QLatin1String(Protocol::QSettingsChildGroups));
+        return callRemoteMethod<QStringList>(Protocol::Command::QSettingsChildGroups);
     return d->settings.childGroups();
 }
 
 QStringList QSettingsWrapper::childKeys() const
 {
     if (createSocket())
-        return callRemoteMethod<QStringList>(QLatin1String(Protocol::QSettingsChildKeys));
+        return callRemoteMethod<QStringList>(Protocol::Command::QSettingsChildKeys);
     return d->settings.childKeys();
 }
 
 void QSettingsWrapper::clear()
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsClear));
+        callRemoteMethod(Protocol::Command::QSettingsClear);
     else d->settings.clear();
 }
 
 bool QSettingsWrapper::contains(const QString &param1) const
 {
     if (createSocket())
-        return callRemoteMethod<bool>(QLatin1String(Protocol::QSettingsContains), param1);
+        return callRemoteMethod<bool>(Protocol::Command::QSettingsContains, param1);
     return d->settings.contains(param1);
 }
 
 void QSettingsWrapper::endArray()
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsEndArray));
+        callRemoteMethod(Protocol::Command::QSettingsEndArray);
     else
         d->settings.endArray();
 }
@@ -198,7 +198,7 @@ void QSettingsWrapper::endArray()
 void QSettingsWrapper::endGroup()
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsEndGroup));
+        callRemoteMethod(Protocol::Command::QSettingsEndGroup);
     else
         d->settings.endGroup();
 }
@@ -206,14 +206,14 @@ void QSettingsWrapper::endGroup()
 bool QSettingsWrapper::fallbacksEnabled() const
 {
     if (createSocket())
-        return callRemoteMethod<bool>(QLatin1String(Protocol::QSettingsFallbacksEnabled));
+        return callRemoteMethod<bool>(Protocol::Command::QSettingsFallbacksEnabled);
     return d->settings.fallbacksEnabled();
 }
 
 QString QSettingsWrapper::fileName() const
 {
     if (createSocket())
-        return callRemoteMethod<QString>(QLatin1String(Protocol::QSettingsFileName));
+        return callRemoteMethod<QString>(Protocol::Command::QSettingsFileName);
     return d->settings.fileName();
 }
 
@@ -226,28 +226,28 @@ QSettingsWrapper::Format QSettingsWrapper::format() const
 QString QSettingsWrapper::group() const
 {
     if (createSocket())
-        return callRemoteMethod<QString>(QLatin1String(Protocol::QSettingsGroup));
+        return callRemoteMethod<QString>(Protocol::Command::QSettingsGroup);
     return d->settings.group();
 }
 
 bool QSettingsWrapper::isWritable() const
 {
     if (createSocket())
-        return callRemoteMethod<bool>(QLatin1String(Protocol::QSettingsIsWritable));
+        return callRemoteMethod<bool>(Protocol::Command::QSettingsIsWritable);
     return d->settings.isWritable();
 }
 
 QString QSettingsWrapper::organizationName() const
 {
     if (createSocket())
-        return callRemoteMethod<QString>(QLatin1String(Protocol::QSettingsOrganizationName));
+        return callRemoteMethod<QString>(Protocol::Command::QSettingsOrganizationName);
     return d->settings.organizationName();
 }
 
 void QSettingsWrapper::remove(const QString &param1)
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsRemove), param1, dummy);
+        callRemoteMethod(Protocol::Command::QSettingsRemove, param1, dummy);
     else
         d->settings.remove(param1);
 }
@@ -261,7 +261,7 @@ QSettingsWrapper::Scope QSettingsWrapper::scope() const
 void QSettingsWrapper::setArrayIndex(int param1)
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsSetArrayIndex), qint32(param1), dummy);
+        callRemoteMethod(Protocol::Command::QSettingsSetArrayIndex, qint32(param1), dummy);
     else
         d->settings.setArrayIndex(param1);
 }
@@ -269,7 +269,7 @@ void QSettingsWrapper::setArrayIndex(int param1)
 void QSettingsWrapper::setFallbacksEnabled(bool param1)
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsSetFallbacksEnabled), param1, dummy);
+        callRemoteMethod(Protocol::Command::QSettingsSetFallbacksEnabled, param1, dummy);
     else
         d->settings.setFallbacksEnabled(param1);
 }
@@ -277,7 +277,7 @@ void QSettingsWrapper::setFallbacksEnabled(bool param1)
 void QSettingsWrapper::setValue(const QString &param1, const QVariant &param2)
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsSetValue), param1, param2);
+        callRemoteMethod(Protocol::Command::QSettingsSetValue, param1, param2);
     else
         d->settings.setValue(param1, param2);
 }
@@ -286,7 +286,7 @@ QSettingsWrapper::Status QSettingsWrapper::status() const
 {
     if (createSocket()) {
         return static_cast<QSettingsWrapper::Status>
-            (callRemoteMethod<qint32>(QLatin1String(Protocol::QSettingsStatus)));
+            (callRemoteMethod<qint32>(Protocol::Command::QSettingsStatus));
     }
     return static_cast<QSettingsWrapper::Status>(d->settings.status());
 }
@@ -294,7 +294,7 @@ QSettingsWrapper::Status QSettingsWrapper::status() const
 void QSettingsWrapper::sync()
 {
     if (createSocket())
-        callRemoteMethod(QLatin1String(Protocol::QSettingsSync));
+        callRemoteMethod(Protocol::Command::QSettingsSync);
     else
         d->settings.sync();
 }
@@ -302,7 +302,7 @@ void QSettingsWrapper::sync()
 QVariant QSettingsWrapper::value(const QString &param1, const QVariant &param2) const
 {
     if (createSocket())
-        return callRemoteMethod<QVariant>(QLatin1String(Protocol::QSettingsValue), param1, param2);
+        return callRemoteMethod<QVariant>(Protocol::Command::QSettingsValue, param1, param2);
     return d->settings.value(param1, param2);
 }
 
@@ -187,7 +187,7 @@ public:
 
         if (!authorize())
             return;
-        m_serverStarted = !callRemoteMethod<bool>(QString::fromLatin1(Protocol::Shutdown));
+        m_serverStarted = !callRemoteMethod<bool>(Protocol::Command::Shutdown);
     }
 
 private:
@@ -35,6 +35,9 @@
 
 namespace QInstaller {
 
+// Writes smaller than this are collected and sent as one request on pipelined connections.
+static const int scWriteBatchSize = 64 * 1024;
+
 
 // -- RemoteFileEngineHandler
 
@@ -119,6 +122,23 @@ RemoteFileEngine::RemoteFileEngine()
 
 RemoteFileEngine::~RemoteFileEngine()
 {
+    // the base class destructor cannot call our reimplementation anymore
+    if (isConnectedToServer())
+        sendPendingRequests();
+}
+
+/*!
+    Sends the writes collected by write(), they are sent before any other request so the server
+    sees all requests in order.
+*/
+void RemoteFileEngine::sendPendingRequests() const
+{
+    if (m_writeBuffer.isEmpty())
+        return;
+
+    sendBulkRequest(Protocol::Command::QAbstractFileEngineWriteRaw,
+        m_writeBuffer.constData(), m_writeBuffer.size());
+    m_writeBuffer.resize(0);
 }
 
 /*!
@@ -127,7 +147,7 @@ RemoteFileEngine::~RemoteFileEngine()
 bool RemoteFileEngine::atEnd() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineAtEnd));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineAtEnd);
     return m_fileEngine.atEnd();
 }
 
@@ -159,7 +179,7 @@ QAbstractFileEngine::Iterator* RemoteFileEngine::endEntryList()
 bool RemoteFileEngine::caseSensitive() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineCaseSensitive));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineCaseSensitive);
     return m_fileEngine.caseSensitive();
 }
 
@@ -169,7 +189,7 @@ bool RemoteFileEngine::caseSensitive() const
 bool RemoteFileEngine::close()
 {
     if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineClose));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineClose);
     return m_fileEngine.close();
 }
 
@@ -179,7 +199,7 @@ bool RemoteFileEngine::close()
 bool RemoteFileEngine::copy(const QString &newName)
 {
     if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineCopy), newName);
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineCopy, newName);
     return m_fileEngine.copy(newName);
 }
 
@@ -190,7 +210,7 @@ QStringList RemoteFileEngine::entryList(QDir::Filters filters, const QStringList
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
         return callRemoteMethod<QStringList>
-            (QString::fromLatin1(Protocol::QAbstractFileEngineEntryList),
+            (Protocol::Command::QAbstractFileEngineEntryList,
             static_cast<qint32>(filters), filterNames);
     }
     return m_fileEngine.entryList(filters, filterNames);
@@ -203,7 +223,7 @@ QFile::FileError RemoteFileEngine::error() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
         return static_cast<QFile::FileError>
-            (callRemoteMethod<qint32>(QString::fromLatin1(Protocol::QAbstractFileEngineError)));
+            (callRemoteMethod<qint32>(Protocol::Command::QAbstractFileEngineError));
     }
     return m_fileEngine.error();
 }
@@ -214,7 +234,7 @@ QFile::FileError RemoteFileEngine::error() const
 QString RemoteFileEngine::errorString() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<QString>(QString::fromLatin1(Protocol::QAbstractFileEngineErrorString));
+        return callRemoteMethod<QString>(Protocol::Command::QAbstractFileEngineErrorString);
     return m_fileEngine.errorString();
 }
 
@@ -235,7 +255,7 @@ QAbstractFileEngine::FileFlags RemoteFileEngine::fileFlags(FileFlags type) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
         return static_cast<QAbstractFileEngine::FileFlags>
-            (callRemoteMethod<qint32>(QString::fromLatin1(Protocol::QAbstractFileEngineFileFlags),
+            (callRemoteMethod<qint32>(Protocol::Command::QAbstractFileEngineFileFlags,
             static_cast<qint32>(type)));
     }
     return m_fileEngine.fileFlags(type);
@@ -247,7 +267,7 @@ QAbstractFileEngine::FileFlags RemoteFileEngine::fileFlags(FileFlags type) const
 QString RemoteFileEngine::fileName(FileName file) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
-        return callRemoteMethod<QString>(QString::fromLatin1(Protocol::QAbstractFileEngineFileName),
+        return callRemoteMethod<QString>(Protocol::Command::QAbstractFileEngineFileName,
             static_cast<qint32>(file));
     }
     return m_fileEngine.fileName(file);
@@ -259,7 +279,7 @@ QString RemoteFileEngine::fileName(FileName file) const
 bool RemoteFileEngine::flush()
 {
     if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineFlush));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineFlush);
     return m_fileEngine.flush();
 }
 
@@ -269,7 +289,7 @@ bool RemoteFileEngine::flush()
 int RemoteFileEngine::handle() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<qint32>(QString::fromLatin1(Protocol::QAbstractFileEngineHandle));
+        return callRemoteMethod<qint32>(Protocol::Command::QAbstractFileEngineHandle);
     return m_fileEngine.handle();
 }
 
@@ -279,7 +299,7 @@ int RemoteFileEngine::handle() const
 bool RemoteFileEngine::isRelativePath() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineIsRelativePath));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineIsRelativePath);
     return m_fileEngine.isRelativePath();
 }
 
@@ -289,7 +309,7 @@ bool RemoteFileEngine::isRelativePath() const
 bool RemoteFileEngine::isSequential() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineIsSequential));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineIsSequential);
     return m_fileEngine.isSequential();
 }
 
@@ -299,7 +319,7 @@ bool RemoteFileEngine::isSequential() const
 bool RemoteFileEngine::link(const QString &newName)
 {
     if (connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineLink),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineLink,
             newName);
     }
     return m_fileEngine.link(newName);
@@ -311,7 +331,7 @@ bool RemoteFileEngine::link(const QString &newName)
 bool RemoteFileEngine::mkdir(const QString &dirName, bool createParentDirectories) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineMkdir),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineMkdir,
             dirName, createParentDirectories);
     }
     return m_fileEngine.mkdir(dirName, createParentDirectories);
@@ -323,7 +343,7 @@ bool RemoteFileEngine::mkdir(const QString &dirName, bool createParentDirectorie
 bool RemoteFileEngine::open(QIODevice::OpenMode mode)
 {
     if (connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineOpen),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineOpen,
             static_cast<qint32>(mode | QIODevice::Unbuffered));
     }
     return m_fileEngine.open(mode | QIODevice::Unbuffered);
@@ -335,7 +355,7 @@ bool RemoteFileEngine::open(QIODevice::OpenMode mode)
 QString RemoteFileEngine::owner(FileOwner owner) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
-        return callRemoteMethod<QString>(QString::fromLatin1(Protocol::QAbstractFileEngineOwner),
+        return callRemoteMethod<QString>(Protocol::Command::QAbstractFileEngineOwner,
             static_cast<qint32>(owner));
     }
     return m_fileEngine.owner(owner);
@@ -347,7 +367,7 @@ QString RemoteFileEngine::owner(FileOwner owner) const
 uint RemoteFileEngine::ownerId(FileOwner owner) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
-        return callRemoteMethod<quint32>(QString::fromLatin1(Protocol::QAbstractFileEngineOwnerId),
+        return callRemoteMethod<quint32>(Protocol::Command::QAbstractFileEngineOwnerId,
             static_cast<qint32>(owner));
     }
     return m_fileEngine.ownerId(owner);
@@ -359,7 +379,7 @@ uint RemoteFileEngine::ownerId(FileOwner owner) const
 qint64 RemoteFileEngine::pos() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEnginePos));
+        return callRemoteMethod<qint64>(Protocol::Command::QAbstractFileEnginePos);
     return m_fileEngine.pos();
 }
 
@@ -369,7 +389,7 @@ qint64 RemoteFileEngine::pos() const
 bool RemoteFileEngine::remove()
 {
     if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineRemove));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineRemove);
     return m_fileEngine.remove();
 }
 
@@ -379,7 +399,7 @@ bool RemoteFileEngine::remove()
 bool RemoteFileEngine::rename(const QString &newName)
 {
     if (connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineRename),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineRename,
             newName);
     }
     return m_fileEngine.rename(newName);
@@ -391,7 +411,7 @@ bool RemoteFileEngine::rename(const QString &newName)
 bool RemoteFileEngine::rmdir(const QString &dirName, bool recurseParentDirectories) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineRmdir),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineRmdir,
             dirName, recurseParentDirectories);
     }
     return m_fileEngine.rmdir(dirName, recurseParentDirectories);
@@ -403,7 +423,7 @@ bool RemoteFileEngine::rmdir(const QString &dirName, bool recurseParentDirectori
 bool RemoteFileEngine::seek(qint64 offset)
 {
     if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSeek), offset);
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineSeek, offset);
     return m_fileEngine.seek(offset);
 }
 
@@ -413,7 +433,7 @@ bool RemoteFileEngine::seek(qint64 offset)
 void RemoteFileEngine::setFileName(const QString &fileName)
 {
     if (connectToServer()) {
-        callRemoteMethod(QString::fromLatin1(Protocol::QAbstractFileEngineSetFileName), fileName,
+        callRemoteMethod(Protocol::Command::QAbstractFileEngineSetFileName, fileName,
             dummy);
     }
     m_fileEngine.setFileName(fileName);
@@ -425,7 +445,7 @@ void RemoteFileEngine::setFileName(const QString &fileName)
 bool RemoteFileEngine::setPermissions(uint perms)
 {
     if (connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSetPermissions),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineSetPermissions,
             perms);
     }
     return m_fileEngine.setPermissions(perms);
@@ -437,7 +457,7 @@ bool RemoteFileEngine::setPermissions(uint perms)
 bool RemoteFileEngine::setSize(qint64 size)
 {
     if (connectToServer()) {
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSetSize),
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineSetSize,
             size);
     }
     return m_fileEngine.setSize(size);
@@ -449,7 +469,7 @@ bool RemoteFileEngine::setSize(qint64 size)
 qint64 RemoteFileEngine::size() const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEngineSize));
+        return callRemoteMethod<qint64>(Protocol::Command::QAbstractFileEngineSize);
     return m_fileEngine.size();
 }
 
@@ -469,8 +489,25 @@ bool RemoteFileEngine::supportsExtension(Extension extension) const
 qint64 RemoteFileEngine::read(char *data, qint64 maxlen)
 {
     if (connectToServer()) {
+        if (isPipelined()) {
+            // The reply carries the result followed by only the bytes actually read.
+            const Protocol::Command command = Protocol::Command::QAbstractFileEngineReadRaw;
+            const QByteArray reply = receiveReply(command, sendRequest(command, maxlen));
+
+            qint64 result = -1;
+            QDataStream stream(reply);
+            stream >> result;
+            if (result <= 0)
+                return result;
+
+            const int offset = int(sizeof(qint64));
+            result = qMin(result, qint64(reply.size() - offset));
+            memcpy(data, reply.constData() + offset, size_t(result));
+            return result;
+        }
+
         QPair<qint64, QByteArray> result = callRemoteMethod<QPair<qint64, QByteArray> >
-            (QString::fromLatin1(Protocol::QAbstractFileEngineRead), maxlen);
+            (Protocol::Command::QAbstractFileEngineRead, maxlen);
 
         if (result.first <= 0)
             return result.first;
@@ -489,7 +526,7 @@ qint64 RemoteFileEngine::readLine(char *data, qint64 maxlen)
 {
     if (connectToServer()) {
         QPair<qint64, QByteArray> result = callRemoteMethod<QPair<qint64, QByteArray> >
-            (QString::fromLatin1(Protocol::QAbstractFileEngineReadLine), maxlen);
+            (Protocol::Command::QAbstractFileEngineReadLine, maxlen);
 
         if (result.first <= 0)
             return result.first;
@@ -507,8 +544,24 @@ qint64 RemoteFileEngine::readLine(char *data, qint64 maxlen)
 qint64 RemoteFileEngine::write(const char *data, qint64 len)
 {
     if (connectToServer()) {
-        QByteArray ba(data, len);
-        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEngineWrite), ba);
+        if (!isPipelined()) {
+            QByteArray ba(data, len);
+            return callRemoteMethod<qint64>(Protocol::Command::QAbstractFileEngineWrite,
+                ba);
+        }
+
+        // Do not wait for the server, a failed write is reported by the next flush(), close() or
+        // syncToDisk() instead. Small writes are collected, large ones are sent as they are.
+        if (m_writeBuffer.size() + len > scWriteBatchSize)
+            sendPendingRequests();
+        if (len >= scWriteBatchSize) {
+            sendBulkRequest(Protocol::Command::QAbstractFileEngineWriteRaw, data, len);
+        } else {
+            if (m_writeBuffer.capacity() < scWriteBatchSize)
+                m_writeBuffer.reserve(scWriteBatchSize);
+            m_writeBuffer.append(data, int(len));
+        }
+        return len;
     }
     return m_fileEngine.write(data, len);
 }
@@ -516,7 +569,7 @@ qint64 RemoteFileEngine::write(const char *data, qint64 len)
 bool RemoteFileEngine::syncToDisk()
 {
     if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSyncToDisk));
+        return callRemoteMethod<bool>(Protocol::Command::QAbstractFileEngineSyncToDisk);
     return m_fileEngine.syncToDisk();
 }
 
@@ -524,7 +577,7 @@ bool RemoteFileEngine::renameOverwrite(const QString &newName)
 {
     if (connectToServer()) {
         return callRemoteMethod<bool>
-            (QString::fromLatin1(Protocol::QAbstractFileEngineRenameOverwrite), newName);
+            (Protocol::Command::QAbstractFileEngineRenameOverwrite, newName);
     }
     return m_fileEngine.renameOverwrite(newName);
 }
@@ -533,7 +586,7 @@ QDateTime RemoteFileEngine::fileTime(FileTime time) const
 {
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer()) {
         return callRemoteMethod<QDateTime>
-            (QString::fromLatin1(Protocol::QAbstractFileEngineFileTime),
+            (Protocol::Command::QAbstractFileEngineFileTime,
             static_cast<qint32> (time));
     }
     return m_fileEngine.fileTime(time);
@@ -98,8 +98,12 @@ public:
         ExtensionReturn *output = 0) Q_DECL_OVERRIDE;
     bool supportsExtension(Extension extension) const Q_DECL_OVERRIDE;
 
+protected:
+    void sendPendingRequests() const Q_DECL_OVERRIDE;
+
 private:
     QFSFileEngine m_fileEngine;
+    mutable QByteArray m_writeBuffer;
 };
 
 } // namespace QInstaller
@@ -0,0 +1,173 @@
+/**************************************************************************
+**
+** Copyright (C) 2019 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "remotefileoperations.h"
+
+#include "binaryformatenginehandler.h"
+#include "protocol.h"
+
+namespace QInstaller {
+
+/*!
+    \class QInstaller::RemoteFileOperations
+    \inmodule QtInstallerFramework
+    \brief The RemoteFileOperations class runs file operations inside the privileged server.
+
+    While the installer runs with elevated rights, every file access is forwarded to the server
+    process one read or write at a time. The operations of this class send a single request
+    instead and let the server do the file I/O locally, only progress and the result travel back.
+
+    The operations need protocol version 2, use isAvailable() before calling them.
+*/
+
+/*!
+    \fn void QInstaller::RemoteFileOperations::progressChanged(double progress)
+
+    This signal is emitted while extractArchive() waits for the server. \a progress is a value
+    between \c 0 and \c 1. The signal is emitted from the thread calling extractArchive().
+*/
+
+/*!
+    Creates a remote file operations object with the parent \a parent.
+*/
+RemoteFileOperations::RemoteFileOperations(QObject *parent)
+    : RemoteObject(QLatin1String(Protocol::FileOperations), parent)
+    , m_cancelSent(false)
+{
+}
+
+/*!
+    Destroys the remote file operations object.
+*/
+RemoteFileOperations::~RemoteFileOperations()
+{
+}
+
+/*!
+    Returns \c true if the privileged server is running and understands the operations of this
+    class; otherwise returns \c false.
+*/
+bool RemoteFileOperations::isAvailable()
+{
+    return connectToServer() && isPipelined();
+}
+
+/*!
+    Extracts the archive \a archivePath into \a targetDirectory inside the server. \a archivePath
+    may be a file name or a resource registered with the BinaryFormatEngineHandler. Existing
+    files are renamed to backup files before they get overwritten, the returned result lists them
+    together with the extracted files.
+
+    \sa cancel()
+*/
+RemoteFileOperations::ExtractResult RemoteFileOperations::extractArchive(const QString &archivePath,
+    const QString &targetDirectory)
+{
+    // The server does not know the resources of this process, send where the data is stored.
+    QString path = archivePath;
+    qint64 start = 0;
+    qint64 length = -1;
+    if (const QSharedPointer<Resource> resource = BinaryFormatEngineHandler::instance()
+            ->resource(archivePath)) {
+        path = resource->path();
+        start = resource->segment().start();
+        length = resource->segment().length();
+    }
+
+    m_canceled.store(0);
+    m_cancelSent = false;
+
+    return callRemoteMethod<ExtractResult>(Protocol::Command::FileOperationsExtractArchive,
+        qMakePair(archivePath, path), qMakePair(start, length), targetDirectory);
+}
+
+/*!
+    Copies the file \a source to \a target inside the server. Returns \c true on success;
+    otherwise returns \c false and sets \a errorString if given.
+*/
+bool RemoteFileOperations::copyFile(const QString &source, const QString &target,
+    QString *errorString)
+{
+    const QPair<bool, QString> result = callRemoteMethod<QPair<bool, QString> >(
+        Protocol::Command::FileOperationsCopyFile, source, target);
+    if (errorString)
+        *errorString = result.second;
+    return result.first;
+}
+
+/*!
+    Sets \a permissions on all files in \a fileNames inside the server. Returns \c true if the
+    permissions could be set on all files; otherwise returns \c false.
+*/
+bool RemoteFileOperations::setPermissions(const QStringList &fileNames,
+    QFileDevice::Permissions permissions)
+{
+    return callRemoteMethod<bool>(Protocol::Command::FileOperationsSetPermissions,
+        fileNames, qint32(permissions));
+}
+
+/*!
+    Asks the server to abort a running extractArchive(). Can be called from any thread, the
+    request is sent with the next progress update.
+*/
+void RemoteFileOperations::cancel()
+{
+    m_canceled.store(1);
+}
+
+void RemoteFileOperations::notificationReceived(Protocol::Command command,
+    const QByteArray &data) const
+{
+    if (command != Protocol::Command::FileOperationsProgress)
+        return;
+
+    double progress = 0.0;
+    QDataStream in(data);
+    in >> progress;
+    emit const_cast<RemoteFileOperations *>(this)->progressChanged(progress);
+
+    if (m_canceled.load() && !m_cancelSent) {
+        m_cancelSent = true;
+        sendRequest(Protocol::Command::FileOperationsCancel);
+    }
+}
+
+QDataStream &operator<<(QDataStream &stream, const RemoteFileOperations::ExtractResult &result)
+{
+    return stream << result.success << result.errorString << result.extractedFiles
+        << result.backupFiles;
+}
+
+QDataStream &operator>>(QDataStream &stream, RemoteFileOperations::ExtractResult &result)
+{
+    return stream >> result.success >> result.errorString >> result.extractedFiles
+        >> result.backupFiles;
+}
+
+} // namespace QInstaller
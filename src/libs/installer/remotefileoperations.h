@@ -0,0 +1,90 @@
+/**************************************************************************
+**
+** Copyright (C) 2019 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef REMOTEFILEOPERATIONS_H
+#define REMOTEFILEOPERATIONS_H
+
+#include "remoteobject.h"
+
+#include <QAtomicInt>
+#include <QFileDevice>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT RemoteFileOperations : public RemoteObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(RemoteFileOperations)
+
+public:
+    typedef QVector<QPair<QString, QString> > BackupFiles;
+
+    struct ExtractResult
+    {
+        bool success = false;
+        QString errorString;
+        QStringList extractedFiles;
+        BackupFiles backupFiles;
+    };
+
+    explicit RemoteFileOperations(QObject *parent = 0);
+    ~RemoteFileOperations();
+
+    bool isAvailable();
+
+    ExtractResult extractArchive(const QString &archivePath, const QString &targetDirectory);
+    bool copyFile(const QString &source, const QString &target, QString *errorString = 0);
+    bool setPermissions(const QStringList &fileNames, QFileDevice::Permissions permissions);
+
+public slots:
+    void cancel();
+
+signals:
+    void progressChanged(double progress);
+
+private:
+    void notificationReceived(Protocol::Command command, const QByteArray &data) const
+        Q_DECL_OVERRIDE;
+
+private:
+    QAtomicInt m_canceled;
+    mutable bool m_cancelSent;
+};
+
+INSTALLER_EXPORT QDataStream &operator<<(QDataStream &stream,
+    const RemoteFileOperations::ExtractResult &result);
+INSTALLER_EXPORT QDataStream &operator>>(QDataStream &stream,
+    RemoteFileOperations::ExtractResult &result);
+
+} // namespace QInstaller
+
+#endif // REMOTEFILEOPERATIONS_H
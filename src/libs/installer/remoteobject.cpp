@@ -42,6 +42,8 @@ RemoteObject::RemoteObject(const QString &wrappedType, QObject *parent)
     , dummy(nullptr)
     , m_type(wrappedType)
     , m_socket(nullptr)
+    , m_protocolVersion(Protocol::LegacyVersion)
+    , m_lastRequestId(0)
 {
     Q_ASSERT_X(!m_type.isEmpty(), Q_FUNC_INFO, "The wrapped Qt type needs to be passed as "
         "argument and cannot be empty.");
@@ -52,7 +54,7 @@ RemoteObject::~RemoteObject()
     if (m_socket) {
         if (QThread::currentThread() == m_socket->thread()) {
             if (m_type != QLatin1String("RemoteClientPrivate"))
-                writeData(QLatin1String(Protocol::Destroy), m_type, dummy, dummy);
+                writeData(Protocol::Command::Destroy, m_type, dummy, dummy);
         } else {
             Q_ASSERT_X(false, Q_FUNC_INFO, "Socket running in a different Thread than this object.");
         }
@@ -72,16 +74,66 @@ bool RemoteObject::authorize()
     m_socket->connectToServer(RemoteClient::instance().socketName());
 
     if (m_socket->waitForConnected()) {
-        bool authorized = callRemoteMethod<bool>(QString::fromLatin1(Protocol::Authorize),
-                                                 RemoteClient::instance().authorizationKey());
-        if (authorized)
+        bool answered = false;
+        if (authorizeVersioned(&answered))
             return true;
+
+        // A server that does not know the versioned handshake closes the connection without
+        // answering, retry with the legacy one.
+        if (!answered) {
+            delete m_socket;
+            m_socket = new QLocalSocket;
+            m_socket->connectToServer(RemoteClient::instance().socketName());
+            if (m_socket->waitForConnected()) {
+                m_protocolVersion = Protocol::LegacyVersion;
+                bool authorized = callRemoteMethod<bool>(Protocol::Command::Authorize,
+                                                         RemoteClient::instance().authorizationKey());
+                if (authorized)
+                    return true;
+            }
+        }
     }
     delete m_socket;
     m_socket = nullptr;
     return false;
 }
 
+// Authorizes with the versioned handshake and negotiates the protocol version. Returns false if the
+// key was rejected or the server closed the connection. answered is set to true if the server
+// replied at all.
+bool RemoteObject::authorizeVersioned(bool *answered)
+{
+    *answered = false;
+    m_protocolVersion = Protocol::LegacyVersion;
+    m_lastRequestId = 0;
+    m_pendingReplies.clear();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << RemoteClient::instance().authorizationKey() << Protocol::Version;
+    sendPacket(m_socket, Protocol::AuthorizeVersioned, data);
+    m_socket->flush();
+
+    QByteArray command;
+    QByteArray reply;
+    while (!receivePacket(m_socket, &command, &reply)) {
+        if (!m_socket->waitForReadyRead(-1))
+            return false;
+    }
+    Q_ASSERT(command == Protocol::Reply);
+    *answered = true;
+
+    bool authorized = false;
+    quint32 serverVersion = Protocol::LegacyVersion;
+    QDataStream in(&reply, QIODevice::ReadOnly);
+    in >> authorized >> serverVersion;
+    if (in.status() != QDataStream::Ok || !authorized)
+        return false;
+
+    m_protocolVersion = qMin(serverVersion, Protocol::Version);
+    return true;
+}
+
 bool RemoteObject::connectToServer(const QVariantList &arguments)
 {
     if (!RemoteClient::instance().isActive())
@@ -95,11 +147,12 @@ bool RemoteObject::connectToServer(const QVariantList &arguments)
 
     QByteArray data;
     QDataStream out(&data, QIODevice::WriteOnly);
+    writeRequestId(out);
     out << m_type;
     foreach (const QVariant &arg, arguments)
         out << arg;
 
-    sendPacket(m_socket, Protocol::Create, data);
+    sendPacket(m_socket, packetCommand(Protocol::Command::Create), data);
     m_socket->flush();
 
     return true;
@@ -114,9 +167,93 @@ bool RemoteObject::isConnectedToServer() const
     return false;
 }
 
-void RemoteObject::callRemoteMethod(const QString &name)
+void RemoteObject::callRemoteMethod(Protocol::Command command)
+{
+    writeData(command, dummy, dummy, dummy);
+}
+
+// Returns true if the connection negotiated a protocol version that tags requests with IDs, so
+// requests can be sent without waiting for the previous reply.
+bool RemoteObject::isPipelined() const
+{
+    return m_protocolVersion > Protocol::LegacyVersion;
+}
+
+// Sends the request command followed by the raw size bytes at data. Unlike writeData(), the bytes
+// are not serialized into a QByteArray first.
+void RemoteObject::sendBulkRequest(Protocol::Command command, const char *data, qint64 size) const
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    writeRequestId(out);
+
+    sendPacket(m_socket, packetCommand(command), header, data, size);
+    m_socket->flush();
+}
+
+// Waits for the reply to the request requestId sent for command and returns its data. Replies to
+// other requests arriving meanwhile are kept until they are asked for.
+QByteArray RemoteObject::receiveReply(Protocol::Command command, quint32 requestId) const
+{
+    if (m_pendingReplies.contains(requestId))
+        return m_pendingReplies.take(requestId);
+
+    while (m_socket->bytesToWrite())
+        m_socket->waitForBytesWritten();
+
+    forever {
+        QByteArray received;
+        QByteArray data;
+        while (!receivePacket(m_socket, &received, &data)) {
+            if (!m_socket->waitForReadyRead(-1)) {
+                throw Error(tr("Cannot read all data after sending command: %1. "
+                    "Bytes expected: %2, Bytes received: %3. Error: %4")
+                    .arg(QLatin1String(Protocol::commandName(command))).arg(0)
+                    .arg(m_socket->bytesAvailable()).arg(m_socket->errorString()));
+            }
+        }
+
+        const Protocol::Command code = Protocol::decodeCommand(received);
+        if (code != Protocol::Command::Reply) {
+            notificationReceived(code, data);
+            continue;
+        }
+        if (!isPipelined())
+            return data;
+
+        quint32 replyId = 0;
+        {
+            QDataStream in(&data, QIODevice::ReadOnly);
+            in >> replyId;
+        }
+        data.remove(0, sizeof(quint32));
+        if (replyId == requestId)
+            return data;
+        m_pendingReplies.insert(replyId, data);
+    }
+}
+
+// Writes the next request ID to out if the connection is pipelined and returns it. Returns 0 for
+// legacy connections, which do not send request IDs.
+quint32 RemoteObject::writeRequestId(QDataStream &out) const
+{
+    if (!isPipelined())
+        return 0;
+
+    // 0 is never used, wrapping around after 2^32 requests is fine though
+    if (++m_lastRequestId == 0)
+        ++m_lastRequestId;
+    out << m_lastRequestId;
+    return m_lastRequestId;
+}
+
+// Returns the packet command sent for command: the numeric code on pipelined connections, the name
+// on legacy ones.
+QByteArray RemoteObject::packetCommand(Protocol::Command command) const
 {
-    writeData(name, dummy, dummy, dummy);
+    if (isPipelined())
+        return Protocol::encodeCommand(command);
+    return QByteArray(Protocol::commandName(command));
 }
 
 } // namespace QInstaller
@@ -35,6 +35,7 @@
 
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QHash>
 #include <QObject>
 #include <QLocalSocket>
 
@@ -50,57 +51,75 @@ public:
     virtual ~RemoteObject() = 0;
 
     bool isConnectedToServer() const;
-    void callRemoteMethod(const QString &name);
+    void callRemoteMethod(Protocol::Command command);
 
     template<typename T1, typename T2>
-    void callRemoteMethod(const QString &name, const T1 &arg, const T2 &arg2)
+    void callRemoteMethod(Protocol::Command command, const T1 &arg, const T2 &arg2)
     {
-        writeData(name, arg, arg2, dummy);
+        writeData(command, arg, arg2, dummy);
     }
 
     template<typename T1, typename T2, typename T3>
-    void callRemoteMethod(const QString &name, const T1 &arg, const T2 &arg2, const T3 & arg3)
+    void callRemoteMethod(Protocol::Command command, const T1 &arg, const T2 &arg2, const T3 & arg3)
     {
-        writeData(name, arg, arg2, arg3);
+        writeData(command, arg, arg2, arg3);
     }
 
     template<typename T>
-    T callRemoteMethod(const QString &name) const
+    T callRemoteMethod(Protocol::Command command) const
     {
-        return callRemoteMethod<T>(name, dummy, dummy, dummy);
+        return callRemoteMethod<T>(command, dummy, dummy, dummy);
     }
 
     template<typename T, typename T1>
-    T callRemoteMethod(const QString &name, const T1 &arg) const
+    T callRemoteMethod(Protocol::Command command, const T1 &arg) const
     {
-        return callRemoteMethod<T>(name, arg, dummy, dummy);
+        return callRemoteMethod<T>(command, arg, dummy, dummy);
     }
 
     template<typename T, typename T1, typename T2>
-    T callRemoteMethod(const QString &name, const T1 & arg, const T2 &arg2) const
+    T callRemoteMethod(Protocol::Command command, const T1 & arg, const T2 &arg2) const
     {
-        return callRemoteMethod<T>(name, arg, arg2, dummy);
+        return callRemoteMethod<T>(command, arg, arg2, dummy);
     }
 
     template<typename T, typename T1, typename T2, typename T3>
-    T callRemoteMethod(const QString &name, const T1 &arg, const T2 &arg2, const T3 &arg3) const
+    T callRemoteMethod(Protocol::Command command, const T1 &arg,
+        const T2 &arg2, const T3 &arg3) const
     {
-        writeData(name, arg, arg2, arg3);
-        while (m_socket->bytesToWrite())
-            m_socket->waitForBytesWritten();
+        return waitForReply<T>(command, sendRequest(command, arg, arg2, arg3));
+    }
 
-        QByteArray command;
-        QByteArray data;
-        while (!receivePacket(m_socket, &command, &data)) {
-            if (!m_socket->waitForReadyRead(-1)) {
-                throw Error(tr("Cannot read all data after sending command: %1. "
-                    "Bytes expected: %2, Bytes received: %3. Error: %4").arg(name).arg(0)
-                    .arg(m_socket->bytesAvailable()).arg(m_socket->errorString()));
-            }
-        }
+    // Sends a request whose reply is collected later with waitForReply(). With a pipelined
+    // connection several requests can be in flight before the first reply is read.
+    quint32 sendRequest(Protocol::Command command) const
+    {
+        return writeData(command, dummy, dummy, dummy);
+    }
+
+    template<typename T1>
+    quint32 sendRequest(Protocol::Command command, const T1 &arg) const
+    {
+        return writeData(command, arg, dummy, dummy);
+    }
+
+    template<typename T1, typename T2>
+    quint32 sendRequest(Protocol::Command command, const T1 &arg, const T2 &arg2) const
+    {
+        return writeData(command, arg, arg2, dummy);
+    }
 
-        Q_ASSERT(command == Protocol::Reply);
+    template<typename T1, typename T2, typename T3>
+    quint32 sendRequest(Protocol::Command command, const T1 &arg,
+        const T2 &arg2, const T3 &arg3) const
+    {
+        return writeData(command, arg, arg2, arg3);
+    }
 
+    template<typename T>
+    T waitForReply(Protocol::Command command, quint32 requestId) const
+    {
+        QByteArray data = receiveReply(command, requestId);
         QDataStream stream(&data, QIODevice::ReadOnly);
 
         T result;
@@ -114,6 +133,19 @@ protected:
     bool authorize();
     bool connectToServer(const QVariantList &arguments = QVariantList());
 
+    bool isPipelined() const;
+    void sendBulkRequest(Protocol::Command command, const char *data, qint64 size) const;
+    QByteArray receiveReply(Protocol::Command command, quint32 requestId) const;
+
+    // Called before a request is sent, derived classes send requests they held back here.
+    virtual void sendPendingRequests() const {}
+    // Called for packets other than replies the server sends while a reply is waited for.
+    virtual void notificationReceived(Protocol::Command command, const QByteArray &data) const
+    {
+        Q_UNUSED(command)
+        Q_UNUSED(data)
+    }
+
     // Use this structure to allow derived classes to manipulate the template
     // function signature of the callRemoteMethod templates, since most of the
     // generated functions will differ in return type rather given arguments.
@@ -133,12 +165,20 @@ private:
         return false;
     }
 
+    quint32 writeRequestId(QDataStream &out) const;
+    QByteArray packetCommand(Protocol::Command command) const;
+    bool authorizeVersioned(bool *answered);
+
     template<typename T1, typename T2, typename T3>
-    void writeData(const QString &name, const T1 &arg, const T2 &arg2, const T3 &arg3) const
+    quint32 writeData(Protocol::Command command, const T1 &arg,
+        const T2 &arg2, const T3 &arg3) const
     {
+        sendPendingRequests();
+
         QByteArray data;
         QDataStream out(&data, QIODevice::WriteOnly);
 
+        const quint32 requestId = writeRequestId(out);
         if (isValueType(arg))
             out << arg;
         if (isValueType(arg2))
@@ -146,13 +186,17 @@ private:
         if (isValueType(arg3))
             out << arg3;
 
-        sendPacket(m_socket, name.toLatin1(), data);
+        sendPacket(m_socket, packetCommand(command), data);
         m_socket->flush();
+        return requestId;
     }
 
 private:
     QString m_type;
     QLocalSocket *m_socket;
+    quint32 m_protocolVersion;
+    mutable quint32 m_lastRequestId;
+    mutable QHash<quint32, QByteArray> m_pendingReplies;
 };
 
 } // namespace QInstaller
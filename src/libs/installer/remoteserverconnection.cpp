@@ -28,7 +28,9 @@
 
 #include "remoteserverconnection.h"
 
+#include "binaryformat.h"
 #include "errors.h"
+#include "lib7z_facade.h"
 #include "protocol.h"
 #include "remoteserverconnection_p.h"
 #include "utils.h"
@@ -49,6 +51,9 @@ RemoteServerConnection::RemoteServerConnection(qintptr socketDescriptor, const Q
     , m_engine(nullptr)
     , m_authorizationKey(key)
     , m_signalReceiver(nullptr)
+    , m_protocolVersion(Protocol::LegacyVersion)
+    , m_requestId(0)
+    , m_deferredWriteFailed(false)
 {
     setObjectName(QString::fromLatin1("RemoteServerConnection(%1)").arg(socketDescriptor));
 }
@@ -76,11 +81,13 @@ void RemoteServerConnection::run()
         QByteArray data;
 
         if (!receivePacket(&socket, &cmd, &data)) {
+            // everything received so far is handled, send the collected replies in one go
+            socket.flush();
             socket.waitForReadyRead(250);
             continue;
         }
 
-        const QString command = QString::fromLatin1(cmd);
+        const Protocol::Command command = Protocol::decodeCommand(cmd);
         QBuffer buf;
         buf.setBuffer(&data);
         buf.open(QIODevice::ReadOnly);
@@ -88,27 +95,53 @@ void RemoteServerConnection::run()
         stream.setDevice(&buf);
         StreamChecker streamChecker(&stream);
 
-        if (authorized && command == QLatin1String(Protocol::Shutdown)) {
+        const bool handshake = command == Protocol::Command::Authorize
+            || command == Protocol::Command::AuthorizeVersioned;
+        if (authorized && !handshake && m_protocolVersion > Protocol::LegacyVersion)
+            stream >> m_requestId;
+
+        if (authorized && command == Protocol::Command::Shutdown) {
             authorized = false;
             sendData(&socket, true);
             socket.flush();
             socket.close();
             emit shutdownRequested();
             return;
-        } else if (command == QLatin1String(Protocol::Authorize)) {
+        } else if (command == Protocol::Command::Authorize) {
             QString key;
             stream >> key;
+            m_protocolVersion = Protocol::LegacyVersion;
             sendData(&socket, (authorized = (key == m_authorizationKey)));
             socket.flush();
             if (!authorized) {
                 socket.close();
                 return;
             }
+        } else if (command == Protocol::Command::AuthorizeVersioned) {
+            QString key;
+            quint32 clientVersion;
+            stream >> key;
+            stream >> clientVersion;
+            authorized = (key == m_authorizationKey);
+            m_protocolVersion = qMin(clientVersion, Protocol::Version);
+
+            QByteArray reply;
+            QDataStream replyStream(&reply, QIODevice::WriteOnly);
+            replyStream << authorized << Protocol::Version;
+            sendPacket(&socket, Protocol::Reply, reply);
+            socket.flush();
+            if (!authorized) {
+                socket.close();
+                return;
+            }
         } else if (authorized) {
-            if (command.isEmpty())
+            if (command == Protocol::Command::Invalid) {
+                if (!cmd.isEmpty())
+                    qCDebug(QInstaller::lcServer) << "Unknown command:" << cmd;
                 continue;
+            }
 
-            if (command == QLatin1String(Protocol::Create)) {
+            if (command == Protocol::Command::Create) {
                 QString type;
                 stream >> type;
                 if (type == QLatin1String(Protocol::QSettings)) {
@@ -135,11 +168,12 @@ void RemoteServerConnection::run()
                     if (m_engine)
                         delete m_engine;
                     m_engine = new QFSFileEngine;
+                    m_deferredWriteFailed = false;
                 }
                 continue;
             }
 
-            if (command == QLatin1String(Protocol::Destroy)) {
+            if (command == Protocol::Command::Destroy) {
                 QString type;
                 stream >> type;
                 if (type == QLatin1String(Protocol::QSettings)) {
@@ -152,358 +186,574 @@ void RemoteServerConnection::run()
                     delete m_engine;
                     m_engine = nullptr;
                 }
+                socket.flush();
                 return;
             }
 
-            if (command == QLatin1String(Protocol::GetQProcessSignals)) {
+            if (command == Protocol::Command::GetQProcessSignals) {
                 if (m_signalReceiver) {
                     QMutexLocker _(&m_signalReceiver->m_lock);
                     sendData(&socket, m_signalReceiver->m_receivedSignals);
-                    socket.flush();
                     m_signalReceiver->m_receivedSignals.clear();
                 }
                 continue;
             }
 
-            if (command.startsWith(QLatin1String(Protocol::QProcess))) {
-                handleQProcess(&socket, command, stream);
-            } else if (command.startsWith(QLatin1String(Protocol::QSettings))) {
-                handleQSettings(&socket, command, stream, settings.data());
-            } else if (command.startsWith(QLatin1String(Protocol::QAbstractFileEngine))) {
-                handleQFSFileEngine(&socket, command, stream);
-            } else {
-                qCDebug(QInstaller::lcServer) << "Unknown command:" << command;
+            switch (Protocol::commandGroup(command)) {
+                case Protocol::CommandGroup::QProcess:
+                    handleQProcess(&socket, command, stream);
+                    break;
+                case Protocol::CommandGroup::QSettings:
+                    handleQSettings(&socket, command, stream, settings.data());
+                    break;
+                case Protocol::CommandGroup::QAbstractFileEngine:
+                    handleQFSFileEngine(&socket, command, stream, data, buf.pos());
+                    break;
+                case Protocol::CommandGroup::FileOperations:
+                    handleFileOperations(&socket, command, stream);
+                    break;
+                default:
+                    qCDebug(QInstaller::lcServer) << "Unknown command:"
+                        << Protocol::commandName(command);
+                    break;
             }
-            socket.flush();
         } else {
             // authorization failed, connection not wanted
             socket.close();
-            qCDebug(QInstaller::lcServer) << "Unknown command:" << command;
+            qCDebug(QInstaller::lcServer) << "Unknown command:" << cmd;
             return;
         }
     }
 }
 
+// Returns whether a write sent without waiting for an answer failed since the last call.
+bool RemoteServerConnection::takeDeferredWriteFailure()
+{
+    const bool failed = m_deferredWriteFailed;
+    m_deferredWriteFailed = false;
+    return failed;
+}
+
+// Returns the command of reply packets, encoded if the connection speaks protocol version 2.
+QByteArray RemoteServerConnection::replyCommand() const
+{
+    if (m_protocolVersion > Protocol::LegacyVersion)
+        return Protocol::encodeCommand(Protocol::Command::Reply);
+    return QByteArray(Protocol::Reply);
+}
+
 template <typename T>
 void RemoteServerConnection::sendData(QIODevice *device, const T &data)
 {
     QByteArray result;
     QDataStream returnStream(&result, QIODevice::WriteOnly);
+    if (m_protocolVersion > Protocol::LegacyVersion)
+        returnStream << m_requestId;
     returnStream << data;
 
-    sendPacket(device, Protocol::Reply, result);
+    sendPacket(device, replyCommand(), result);
 }
 
-void RemoteServerConnection::handleQProcess(QIODevice *socket, const QString &command, QDataStream &data)
+void RemoteServerConnection::sendBulkData(QIODevice *device, qint64 result, const char *data,
+                                          qint64 size)
 {
-    if (command == QLatin1String(Protocol::QProcessCloseWriteChannel)) {
-        m_process->closeWriteChannel();
-    } else if (command == QLatin1String(Protocol::QProcessExitCode)) {
-        sendData(socket, m_process->exitCode());
-    } else if (command == QLatin1String(Protocol::QProcessExitStatus)) {
-        sendData(socket, static_cast<qint32> (m_process->exitStatus()));
-    } else if (command == QLatin1String(Protocol::QProcessKill)) {
-        m_process->kill();
-    } else if (command == QLatin1String(Protocol::QProcessReadAll)) {
-        sendData(socket, m_process->readAll());
-    } else if (command == QLatin1String(Protocol::QProcessReadAllStandardOutput)) {
-        sendData(socket, m_process->readAllStandardOutput());
-    } else if (command == QLatin1String(Protocol::QProcessReadAllStandardError)) {
-        sendData(socket, m_process->readAllStandardError());
-    } else if (command == QLatin1String(Protocol::QProcessStartDetached)) {
-        QString program;
-        QStringList arguments;
-        QString workingDirectory;
-        data >> program;
-        data >> arguments;
-        data >> workingDirectory;
-
-        qint64 pid = -1;
-        bool success = QInstaller::startDetached(program, arguments, workingDirectory, &pid);
-        sendData(socket, qMakePair< bool, qint64>(success, pid));
-    } else if (command == QLatin1String(Protocol::QProcessSetWorkingDirectory)) {
-        QString dir;
-        data >> dir;
-        m_process->setWorkingDirectory(dir);
-    } else if (command == QLatin1String(Protocol::QProcessSetEnvironment)) {
-        QStringList env;
-        data >> env;
-        m_process->setEnvironment(env);
-    } else if (command == QLatin1String(Protocol::QProcessEnvironment)) {
-        sendData(socket, m_process->environment());
-    } else if (command == QLatin1String(Protocol::QProcessStart3Arg)) {
-        QString program;
-        QStringList arguments;
-        qint32 mode;
-        data >> program;
-        data >> arguments;
-        data >> mode;
-        m_process->start(program, arguments, static_cast<QIODevice::OpenMode> (mode));
-    } else if (command == QLatin1String(Protocol::QProcessStart2Arg)) {
-        QString program;
-        qint32 mode;
-        data >> program;
-        data >> mode;
-        m_process->start(program, static_cast<QIODevice::OpenMode> (mode));
-    } else if (command == QLatin1String(Protocol::QProcessState)) {
-        sendData(socket, static_cast<qint32> (m_process->state()));
-    } else if (command == QLatin1String(Protocol::QProcessTerminate)) {
-        m_process->terminate();
-    } else if (command == QLatin1String(Protocol::QProcessWaitForFinished)) {
-        qint32 msecs;
-        data >> msecs;
-        sendData(socket, m_process->waitForFinished(msecs));
-    } else if (command == QLatin1String(Protocol::QProcessWaitForStarted)) {
-        qint32 msecs;
-        data >> msecs;
-        sendData(socket, m_process->waitForStarted(msecs));
-    } else if (command == QLatin1String(Protocol::QProcessWorkingDirectory)) {
-        sendData(socket, m_process->workingDirectory());
-    } else if (command == QLatin1String(Protocol::QProcessErrorString)) {
-        sendData(socket, m_process->errorString());
-    } else if (command == QLatin1String(Protocol::QProcessReadChannel)) {
-        sendData(socket, static_cast<qint32> (m_process->readChannel()));
-    } else if (command == QLatin1String(Protocol::QProcessSetReadChannel)) {
-        qint32 processChannel;
-        data >> processChannel;
-        m_process->setReadChannel(static_cast<QProcess::ProcessChannel>(processChannel));
-    } else if (command == QLatin1String(Protocol::QProcessWrite)) {
-        QByteArray byteArray;
-        data >> byteArray;
-        sendData(socket, m_process->write(byteArray));
-    } else if (command == QLatin1String(Protocol::QProcessProcessChannelMode)) {
-        sendData(socket, static_cast<qint32> (m_process->processChannelMode()));
-    } else if (command == QLatin1String(Protocol::QProcessSetProcessChannelMode)) {
-        qint32 processChannel;
-        data >> processChannel;
-        m_process->setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannel));
-    }
+    QByteArray header;
+    QDataStream headerStream(&header, QIODevice::WriteOnly);
+    headerStream << m_requestId;
+    headerStream << result;
+
+    sendPacket(device, replyCommand(), header, data, size);
+}
+
+void RemoteServerConnection::handleQProcess(QIODevice *socket, Protocol::Command command,
+                                            QDataStream &data)
+{
+    switch (command) {
+        case Protocol::Command::QProcessCloseWriteChannel:
+            m_process->closeWriteChannel();
+            break;
+        case Protocol::Command::QProcessExitCode:
+            sendData(socket, m_process->exitCode());
+            break;
+        case Protocol::Command::QProcessExitStatus:
+            sendData(socket, static_cast<qint32> (m_process->exitStatus()));
+            break;
+        case Protocol::Command::QProcessKill:
+            m_process->kill();
+            break;
+        case Protocol::Command::QProcessReadAll:
+            sendData(socket, m_process->readAll());
+            break;
+        case Protocol::Command::QProcessReadAllStandardOutput:
+            sendData(socket, m_process->readAllStandardOutput());
+            break;
+        case Protocol::Command::QProcessReadAllStandardError:
+            sendData(socket, m_process->readAllStandardError());
+            break;
+        case Protocol::Command::QProcessStartDetached: {
+            QString program;
+            QStringList arguments;
+            QString workingDirectory;
+            data >> program;
+            data >> arguments;
+            data >> workingDirectory;
+
+            qint64 pid = -1;
+            bool success = QInstaller::startDetached(program, arguments, workingDirectory, &pid);
+            sendData(socket, qMakePair< bool, qint64>(success, pid));
+        }   break;
+        case Protocol::Command::QProcessSetWorkingDirectory: {
+            QString dir;
+            data >> dir;
+            m_process->setWorkingDirectory(dir);
+        }   break;
+        case Protocol::Command::QProcessSetEnvironment: {
+            QStringList env;
+            data >> env;
+            m_process->setEnvironment(env);
+        }   break;
+        case Protocol::Command::QProcessEnvironment:
+            sendData(socket, m_process->environment());
+            break;
+        case Protocol::Command::QProcessStart3Arg: {
+            QString program;
+            QStringList arguments;
+            qint32 mode;
+            data >> program;
+            data >> arguments;
+            data >> mode;
+            m_process->start(program, arguments, static_cast<QIODevice::OpenMode> (mode));
+        }   break;
+        case Protocol::Command::QProcessStart2Arg: {
+            QString program;
+            qint32 mode;
+            data >> program;
+            data >> mode;
+            m_process->start(program, static_cast<QIODevice::OpenMode> (mode));
+        }   break;
+        case Protocol::Command::QProcessState:
+            sendData(socket, static_cast<qint32> (m_process->state()));
+            break;
+        case Protocol::Command::QProcessTerminate:
+            m_process->terminate();
+            break;
+        case Protocol::Command::QProcessWaitForFinished: {
+            qint32 msecs;
+            data >> msecs;
+            sendData(socket, m_process->waitForFinished(msecs));
+        }   break;
+        case Protocol::Command::QProcessWaitForStarted: {
+            qint32 msecs;
+            data >> msecs;
+            sendData(socket, m_process->waitForStarted(msecs));
+        }   break;
+        case Protocol::Command::QProcessWorkingDirectory:
+            sendData(socket, m_process->workingDirectory());
+            break;
+        case Protocol::Command::QProcessErrorString:
+            sendData(socket, m_process->errorString());
+            break;
+        case Protocol::Command::QProcessReadChannel:
+            sendData(socket, static_cast<qint32> (m_process->readChannel()));
+            break;
+        case Protocol::Command::QProcessSetReadChannel: {
+            qint32 processChannel;
+            data >> processChannel;
+            m_process->setReadChannel(static_cast<QProcess::ProcessChannel>(processChannel));
+        }   break;
+        case Protocol::Command::QProcessWrite: {
+            QByteArray byteArray;
+            data >> byteArray;
+            sendData(socket, m_process->write(byteArray));
+        }   break;
+        case Protocol::Command::QProcessProcessChannelMode:
+            sendData(socket, static_cast<qint32> (m_process->processChannelMode()));
+            break;
+        case Protocol::Command::QProcessSetProcessChannelMode: {
+            qint32 processChannel;
+            data >> processChannel;
+            m_process->setProcessChannelMode(
+                static_cast<QProcess::ProcessChannelMode>(processChannel));
+        }   break;
 #ifdef Q_OS_WIN
-    else if (command == QLatin1String(Protocol::QProcessSetNativeArguments)) {
-        QString arguments;
-        data >> arguments;
-        m_process->setNativeArguments(arguments);
-    }
+        case Protocol::Command::QProcessSetNativeArguments: {
+            QString arguments;
+            data >> arguments;
+            m_process->setNativeArguments(arguments);
+        }   break;
 #endif
-    else if (!command.isEmpty()) {
-        qCDebug(QInstaller::lcServer) << "Unknown QProcess command:" << command;
+        default:
+            qCDebug(QInstaller::lcServer) << "Unknown QProcess command:"
+                << Protocol::commandName(command);
+            break;
     }
 }
 
-void RemoteServerConnection::handleQSettings(QIODevice *socket, const QString &command,
+void RemoteServerConnection::handleQSettings(QIODevice *socket, Protocol::Command command,
                                              QDataStream &data, PermissionSettings *settings)
 {
     if (!settings)
         return;
 
-    if (command == QLatin1String(Protocol::QSettingsAllKeys)) {
-        sendData(socket, settings->allKeys());
-    } else if (command == QLatin1String(Protocol::QSettingsBeginGroup)) {
-        QString prefix;
-        data >> prefix;
-        settings->beginGroup(prefix);
-    } else if (command == QLatin1String(Protocol::QSettingsBeginWriteArray)) {
-        QString prefix;
-        data >> prefix;
-        qint32 size;
-        data >> size;
-        settings->beginWriteArray(prefix, size);
-    } else if (command == QLatin1String(Protocol::QSettingsBeginReadArray)) {
-        QString prefix;
-        data >> prefix;
-        sendData(socket, settings->beginReadArray(prefix));
-    } else if (command == QLatin1String(Protocol::QSettingsChildGroups)) {
-        sendData(socket, settings->childGroups());
-    } else if (command == QLatin1String(Protocol::QSettingsChildKeys)) {
-        sendData(socket, settings->childKeys());
-    } else if (command == QLatin1String(Protocol::QSettingsClear)) {
-        settings->clear();
-    } else if (command == QLatin1String(Protocol::QSettingsContains)) {
-        QString key;
-        data >> key;
-        sendData(socket, settings->contains(key));
-    } else if (command == QLatin1String(Protocol::QSettingsEndArray)) {
-        settings->endArray();
-    } else if (command == QLatin1String(Protocol::QSettingsEndGroup)) {
-        settings->endGroup();
-    } else if (command == QLatin1String(Protocol::QSettingsFallbacksEnabled)) {
-        sendData(socket, settings->fallbacksEnabled());
-    } else if (command == QLatin1String(Protocol::QSettingsFileName)) {
-        sendData(socket, settings->fileName());
-    } else if (command == QLatin1String(Protocol::QSettingsGroup)) {
-        sendData(socket, settings->group());
-    } else if (command == QLatin1String(Protocol::QSettingsIsWritable)) {
-        sendData(socket, settings->isWritable());
-    } else if (command == QLatin1String(Protocol::QSettingsRemove)) {
-        QString key;
-        data >> key;
-        settings->remove(key);
-    } else if (command == QLatin1String(Protocol::QSettingsSetArrayIndex)) {
-        qint32 i;
-        data >> i;
-        settings->setArrayIndex(i);
-    } else if (command == QLatin1String(Protocol::QSettingsSetFallbacksEnabled)) {
-        bool b;
-        data >> b;
-        settings->setFallbacksEnabled(b);
-    } else if (command == QLatin1String(Protocol::QSettingsStatus)) {
-        sendData(socket, settings->status());
-    } else if (command == QLatin1String(Protocol::QSettingsSync)) {
-        settings->sync();
-    } else if (command == QLatin1String(Protocol::QSettingsSetValue)) {
-        QString key;
-        QVariant value;
-        data >> key;
-        data >> value;
-        settings->setValue(key, value);
-    } else if (command == QLatin1String(Protocol::QSettingsValue)) {
-        QString key;
-        QVariant defaultValue;
-        data >> key;
-        data >> defaultValue;
-        sendData(socket, settings->value(key, defaultValue));
-    } else if (command == QLatin1String(Protocol::QSettingsOrganizationName)) {
-        sendData(socket, settings->organizationName());
-    } else if (command == QLatin1String(Protocol::QSettingsApplicationName)) {
-        sendData(socket, settings->applicationName());
-    } else if (!command.isEmpty()) {
-        qCDebug(QInstaller::lcServer) << "Unknown QSettings command:" << command;
+    switch (command) {
+        case Protocol::Command::QSettingsAllKeys:
+            sendData(socket, settings->allKeys());
+            break;
+        case Protocol::Command::QSettingsBeginGroup: {
+            QString prefix;
+            data >> prefix;
+            settings->beginGroup(prefix);
+        }   break;
+        case Protocol::Command::QSettingsBeginWriteArray: {
+            QString prefix;
+            data >> prefix;
+            qint32 size;
+            data >> size;
+            settings->beginWriteArray(prefix, size);
+        }   break;
+        case Protocol::Command::QSettingsBeginReadArray: {
+            QString prefix;
+            data >> prefix;
+            sendData(socket, settings->beginReadArray(prefix));
+        }   break;
+        case Protocol::Command::QSettingsChildGroups:
+            sendData(socket, settings->childGroups());
+            break;
+        case Protocol::Command::QSettingsChildKeys:
+            sendData(socket, settings->childKeys());
+            break;
+        case Protocol::Command::QSettingsClear:
+            settings->clear();
+            break;
+        case Protocol::Command::QSettingsContains: {
+            QString key;
+            data >> key;
+            sendData(socket, settings->contains(key));
+        }   break;
+        case Protocol::Command::QSettingsEndArray:
+            settings->endArray();
+            break;
+        case Protocol::Command::QSettingsEndGroup:
+            settings->endGroup();
+            break;
+        case Protocol::Command::QSettingsFallbacksEnabled:
+            sendData(socket, settings->fallbacksEnabled());
+            break;
+        case Protocol::Command::QSettingsFileName:
+            sendData(socket, settings->fileName());
+            break;
+        case Protocol::Command::QSettingsGroup:
+            sendData(socket, settings->group());
+            break;
+        case Protocol::Command::QSettingsIsWritable:
+            sendData(socket, settings->isWritable());
+            break;
+        case Protocol::Command::QSettingsRemove: {
+            QString key;
+            data >> key;
+            settings->remove(key);
+        }   break;
+        case Protocol::Command::QSettingsSetArrayIndex: {
+            qint32 i;
+            data >> i;
+            settings->setArrayIndex(i);
+        }   break;
+        case Protocol::Command::QSettingsSetFallbacksEnabled: {
+            bool b;
+            data >> b;
+            settings->setFallbacksEnabled(b);
+        }   break;
+        case Protocol::Command::QSettingsStatus:
+            sendData(socket, settings->status());
+            break;
+        case Protocol::Command::QSettingsSync:
+            settings->sync();
+            break;
+        case Protocol::Command::QSettingsSetValue: {
+            QString key;
+            QVariant value;
+            data >> key;
+            data >> value;
+            settings->setValue(key, value);
+        }   break;
+        case Protocol::Command::QSettingsValue: {
+            QString key;
+            QVariant defaultValue;
+            data >> key;
+            data >> defaultValue;
+            sendData(socket, settings->value(key, defaultValue));
+        }   break;
+        case Protocol::Command::QSettingsOrganizationName:
+            sendData(socket, settings->organizationName());
+            break;
+        case Protocol::Command::QSettingsApplicationName:
+            sendData(socket, settings->applicationName());
+            break;
+        default:
+            qCDebug(QInstaller::lcServer) << "Unknown QSettings command:"
+                << Protocol::commandName(command);
+            break;
     }
 }
 
-void RemoteServerConnection::handleQFSFileEngine(QIODevice *socket, const QString &command,
-                                                 QDataStream &data)
+void RemoteServerConnection::handleQFSFileEngine(QIODevice *socket, Protocol::Command command,
+                                                 QDataStream &data, const QByteArray &packet,
+                                                 qint64 offset)
 {
-    if (command == QLatin1String(Protocol::QAbstractFileEngineAtEnd)) {
-        sendData(socket, m_engine->atEnd());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineCaseSensitive)) {
-        sendData(socket, m_engine->caseSensitive());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineClose)) {
-        sendData(socket, m_engine->close());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineCopy)) {
-        QString newName;
-        data >>newName;
+    switch (command) {
+        case Protocol::Command::QAbstractFileEngineAtEnd:
+            sendData(socket, m_engine->atEnd());
+            break;
+        case Protocol::Command::QAbstractFileEngineCaseSensitive:
+            sendData(socket, m_engine->caseSensitive());
+            break;
+        case Protocol::Command::QAbstractFileEngineClose: {
+            const bool closed = m_engine->close();
+            sendData(socket, closed && !takeDeferredWriteFailure());
+        }   break;
+        case Protocol::Command::QAbstractFileEngineCopy: {
+            QString newName;
+            data >>newName;
 #ifdef Q_OS_LINUX
-        // QFileSystemEngine::copyFile() is currently unimplemented on Linux,
-        // copy using QFile instead of directly with QFSFileEngine.
-        QFile file(m_engine->fileName(QAbstractFileEngine::AbsoluteName));
-        sendData(socket, file.copy(newName));
+            // QFileSystemEngine::copyFile() is currently unimplemented on Linux,
+            // copy using QFile instead of directly with QFSFileEngine.
+            QFile file(m_engine->fileName(QAbstractFileEngine::AbsoluteName));
+            sendData(socket, file.copy(newName));
 #else
-        sendData(socket, m_engine->copy(newName));
+            sendData(socket, m_engine->copy(newName));
 #endif
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineEntryList)) {
-        qint32 filters;
-        QStringList filterNames;
-        data >>filters;
-        data >>filterNames;
-        sendData(socket, m_engine->entryList(static_cast<QDir::Filters> (filters), filterNames));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineError)) {
-        sendData(socket, static_cast<qint32> (m_engine->error()));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineErrorString)) {
-        sendData(socket, m_engine->errorString());
-    }
-    else if (command == QLatin1String(Protocol::QAbstractFileEngineFileFlags)) {
-        qint32 flags;
-        data >>flags;
-        flags = m_engine->fileFlags(static_cast<QAbstractFileEngine::FileFlags>(flags));
-        sendData(socket, static_cast<qint32>(flags));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFileName)) {
-        qint32 file;
-        data >>file;
-        sendData(socket, m_engine->fileName(static_cast<QAbstractFileEngine::FileName> (file)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFlush)) {
-        sendData(socket, m_engine->flush());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineHandle)) {
-        sendData(socket, m_engine->handle());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineIsRelativePath)) {
-        sendData(socket, m_engine->isRelativePath());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineIsSequential)) {
-        sendData(socket, m_engine->isSequential());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineLink)) {
-        QString newName;
-        data >>newName;
-        sendData(socket, m_engine->link(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineMkdir)) {
-        QString dirName;
-        bool createParentDirectories;
-        data >>dirName;
-        data >>createParentDirectories;
-        sendData(socket, m_engine->mkdir(dirName, createParentDirectories));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOpen)) {
-        qint32 openMode;
-        data >>openMode;
-        sendData(socket, m_engine->open(static_cast<QIODevice::OpenMode> (openMode)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOwner)) {
-        qint32 owner;
-        data >>owner;
-        sendData(socket, m_engine->owner(static_cast<QAbstractFileEngine::FileOwner> (owner)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOwnerId)) {
-        qint32 owner;
-        data >>owner;
-        sendData(socket, m_engine->ownerId(static_cast<QAbstractFileEngine::FileOwner> (owner)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEnginePos)) {
-        sendData(socket, m_engine->pos());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRead)) {
-        qint64 maxlen;
-        data >> maxlen;
-        QByteArray byteArray(maxlen, '\0');
-        const qint64 r = m_engine->read(byteArray.data(), maxlen);
-        sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineReadLine)) {
-        qint64 maxlen;
-        data >> maxlen;
-        QByteArray byteArray(maxlen, '\0');
-        const qint64 r = m_engine->readLine(byteArray.data(), maxlen);
-        sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRemove)) {
-        sendData(socket, m_engine->remove());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRename)) {
-        QString newName;
-        data >>newName;
-        sendData(socket, m_engine->rename(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRmdir)) {
-        QString dirName;
-        bool recurseParentDirectories;
-        data >>dirName;
-        data >>recurseParentDirectories;
-        sendData(socket, m_engine->rmdir(dirName, recurseParentDirectories));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSeek)) {
-        quint64 offset;
-        data >>offset;
-        sendData(socket, m_engine->seek(offset));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetFileName)) {
-        QString fileName;
-        data >>fileName;
-        m_engine->setFileName(fileName);
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetPermissions)) {
-        uint perms;
-        data >>perms;
-        sendData(socket, m_engine->setPermissions(perms));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetSize)) {
-        qint64 size;
-        data >>size;
-        sendData(socket, m_engine->setSize(size));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSize)) {
-        sendData(socket, m_engine->size());
-    } else if ((command == QLatin1String(Protocol::QAbstractFileEngineSupportsExtension))
-        || (command == QLatin1String(Protocol::QAbstractFileEngineExtension))) {
+        }   break;
+        case Protocol::Command::QAbstractFileEngineEntryList: {
+            qint32 filters;
+            QStringList filterNames;
+            data >>filters;
+            data >>filterNames;
+            sendData(socket, m_engine->entryList(static_cast<QDir::Filters> (filters), filterNames));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineError:
+            sendData(socket, static_cast<qint32> (m_engine->error()));
+            break;
+        case Protocol::Command::QAbstractFileEngineErrorString:
+            sendData(socket, m_engine->errorString());
+            break;
+        case Protocol::Command::QAbstractFileEngineFileFlags: {
+            qint32 flags;
+            data >>flags;
+            flags = m_engine->fileFlags(static_cast<QAbstractFileEngine::FileFlags>(flags));
+            sendData(socket, static_cast<qint32>(flags));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineFileName: {
+            qint32 file;
+            data >>file;
+            sendData(socket, m_engine->fileName(static_cast<QAbstractFileEngine::FileName> (file)));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineFlush: {
+            const bool flushed = m_engine->flush();
+            sendData(socket, flushed && !takeDeferredWriteFailure());
+        }   break;
+        case Protocol::Command::QAbstractFileEngineHandle:
+            sendData(socket, m_engine->handle());
+            break;
+        case Protocol::Command::QAbstractFileEngineIsRelativePath:
+            sendData(socket, m_engine->isRelativePath());
+            break;
+        case Protocol::Command::QAbstractFileEngineIsSequential:
+            sendData(socket, m_engine->isSequential());
+            break;
+        case Protocol::Command::QAbstractFileEngineLink: {
+            QString newName;
+            data >>newName;
+            sendData(socket, m_engine->link(newName));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineMkdir: {
+            QString dirName;
+            bool createParentDirectories;
+            data >>dirName;
+            data >>createParentDirectories;
+            sendData(socket, m_engine->mkdir(dirName, createParentDirectories));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineOpen: {
+            qint32 openMode;
+            data >>openMode;
+            sendData(socket, m_engine->open(static_cast<QIODevice::OpenMode> (openMode)));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineOwner: {
+            qint32 owner;
+            data >>owner;
+            sendData(socket, m_engine->owner(static_cast<QAbstractFileEngine::FileOwner> (owner)));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineOwnerId: {
+            qint32 owner;
+            data >>owner;
+            sendData(socket, m_engine->ownerId(static_cast<QAbstractFileEngine::FileOwner> (owner)));
+        }   break;
+        case Protocol::Command::QAbstractFileEnginePos:
+            sendData(socket, m_engine->pos());
+            break;
+        case Protocol::Command::QAbstractFileEngineRead: {
+            qint64 maxlen;
+            data >> maxlen;
+            QByteArray byteArray(maxlen, '\0');
+            const qint64 r = m_engine->read(byteArray.data(), maxlen);
+            sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineReadLine: {
+            qint64 maxlen;
+            data >> maxlen;
+            QByteArray byteArray(maxlen, '\0');
+            const qint64 r = m_engine->readLine(byteArray.data(), maxlen);
+            sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineRemove:
+            sendData(socket, m_engine->remove());
+            break;
+        case Protocol::Command::QAbstractFileEngineRename: {
+            QString newName;
+            data >>newName;
+            sendData(socket, m_engine->rename(newName));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineRmdir: {
+            QString dirName;
+            bool recurseParentDirectories;
+            data >>dirName;
+            data >>recurseParentDirectories;
+            sendData(socket, m_engine->rmdir(dirName, recurseParentDirectories));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineSeek: {
+            quint64 offset;
+            data >>offset;
+            sendData(socket, m_engine->seek(offset));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineSetFileName: {
+            QString fileName;
+            data >>fileName;
+            m_engine->setFileName(fileName);
+        }   break;
+        case Protocol::Command::QAbstractFileEngineSetPermissions: {
+            uint perms;
+            data >>perms;
+            sendData(socket, m_engine->setPermissions(perms));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineSetSize: {
+            qint64 size;
+            data >>size;
+            sendData(socket, m_engine->setSize(size));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineSize:
+            sendData(socket, m_engine->size());
+            break;
+        case Protocol::Command::QAbstractFileEngineSupportsExtension:
+        case Protocol::Command::QAbstractFileEngineExtension:
             // Implemented client side.
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineWrite)) {
-        QByteArray content;
-        data >> content;
-        sendData(socket, m_engine->write(content.data(), content.size()));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSyncToDisk)) {
-        sendData(socket, m_engine->syncToDisk());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRenameOverwrite)) {
-        QString newFilename;
-        data >> newFilename;
-        sendData(socket, m_engine->renameOverwrite(newFilename));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFileTime)) {
-        qint32 filetime;
-        data >> filetime;
-        sendData(socket, m_engine->fileTime(static_cast<QAbstractFileEngine::FileTime> (filetime)));
-    } else if (!command.isEmpty()) {
-        qCDebug(QInstaller::lcServer) << "Unknown QAbstractFileEngine command:" << command;
+            break;
+        case Protocol::Command::QAbstractFileEngineWrite: {
+            QByteArray content;
+            data >> content;
+            sendData(socket, m_engine->write(content.data(), content.size()));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineSyncToDisk: {
+            const bool synced = m_engine->syncToDisk();
+            sendData(socket, synced && !takeDeferredWriteFailure());
+        }   break;
+        case Protocol::Command::QAbstractFileEngineRenameOverwrite: {
+            QString newFilename;
+            data >> newFilename;
+            sendData(socket, m_engine->renameOverwrite(newFilename));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineFileTime: {
+            qint32 filetime;
+            data >> filetime;
+            sendData(socket, m_engine->fileTime(static_cast<QAbstractFileEngine::FileTime> (filetime)));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineReadRaw: {
+            qint64 maxlen;
+            data >> maxlen;
+            QByteArray byteArray(int(maxlen), Qt::Uninitialized);
+            const qint64 r = m_engine->read(byteArray.data(), maxlen);
+            sendBulkData(socket, r, byteArray.constData(), qMax<qint64>(r, 0));
+        }   break;
+        case Protocol::Command::QAbstractFileEngineWriteRaw: {
+            // The content follows the request ID as is, from offset to the end of the packet.
+            // Nobody waits for an answer, a failure is reported with the next flush, close or
+            // syncToDisk.
+            const qint64 size = packet.size() - offset;
+            if (m_engine->write(packet.constData() + offset, size) != size)
+                m_deferredWriteFailed = true;
+            data.skipRawData(int(size));
+        }   break;
+        default:
+            qCDebug(QInstaller::lcServer) << "Unknown QAbstractFileEngine command:"
+                << Protocol::commandName(command);
+            break;
+    }
+}
+
+void RemoteServerConnection::handleFileOperations(QLocalSocket *socket, Protocol::Command command,
+                                                  QDataStream &data)
+{
+    switch (command) {
+        case Protocol::Command::FileOperationsExtractArchive: {
+            QPair<QString, QString> archive;    // name used for messages, file containing the data
+            QPair<qint64, qint64> segment;      // start and length, a negative length means all
+            QString targetDirectory;
+            data >> archive;
+            data >> segment;
+            data >> targetDirectory;
+
+            QScopedPointer<Resource> resource(segment.second < 0 ? new Resource(archive.second)
+                : new Resource(archive.second, Range<qint64>::fromStartAndLength(segment.first,
+                segment.second)));
+
+            RemoteFileOperations::ExtractResult result;
+            FileOperationsExtractCallback callback(socket);
+            if (!resource->open()) {
+                result.errorString = tr("Cannot open archive \"%1\" for reading: %2")
+                    .arg(archive.first, resource->errorString());
+            } else {
+                try {
+                    Lib7z::initSevenZ();
+                    Lib7z::extractArchive(resource.data(), archive.first, targetDirectory,
+                        &callback);
+                    result.success = true;
+                } catch (const Lib7z::SevenZipException &e) {
+                    result.errorString = tr("Error while extracting archive \"%1\": %2")
+                        .arg(archive.first, e.message());
+                } catch (...) {
+                    result.errorString = tr("Unknown exception caught while extracting \"%1\".")
+                        .arg(archive.first);
+                }
+            }
+            result.extractedFiles = callback.extractedFiles();
+            result.backupFiles = callback.backupFiles();
+            sendData(socket, result);
+        }   break;
+        case Protocol::Command::FileOperationsCopyFile: {
+            QString source;
+            QString target;
+            data >> source;
+            data >> target;
+            QFile file(source);
+            const bool copied = file.copy(target);
+            sendData(socket, qMakePair(copied, copied ? QString() : file.errorString()));
+        }   break;
+        case Protocol::Command::FileOperationsSetPermissions: {
+            QStringList fileNames;
+            qint32 permissions;
+            data >> fileNames;
+            data >> permissions;
+            const QFileDevice::Permissions perms(permissions);
+            bool success = true;
+            foreach (const QString &fileName, fileNames)
+                success = QFile::setPermissions(fileName, perms) && success;
+            sendData(socket, success);
+        }   break;
+        case Protocol::Command::FileOperationsCancel:
+            // The extraction finished before the request arrived, nothing to cancel.
+            break;
+        default:
+            qCDebug(QInstaller::lcServer) << "Unknown FileOperations command:"
+                << Protocol::commandName(command);
+            break;
     }
 }
 
@@ -29,6 +29,8 @@
 #ifndef REMOTESERVERCONNECTION_H
 #define REMOTESERVERCONNECTION_H
 
+#include "protocol.h"
+
 #include <QPointer>
 #include <QThread>
 
@@ -37,6 +39,7 @@
 QT_BEGIN_NAMESPACE
 class QProcess;
 class QIODevice;
+class QLocalSocket;
 QT_END_NAMESPACE
 
 namespace QInstaller {
@@ -62,10 +65,15 @@ signals:
 private:
     template <typename T>
     void sendData(QIODevice *device, const T &arg);
-    void handleQProcess(QIODevice *device, const QString &command, QDataStream &data);
-    void handleQSettings(QIODevice *device, const QString &command, QDataStream &data,
+    void sendBulkData(QIODevice *device, qint64 result, const char *data, qint64 size);
+    QByteArray replyCommand() const;
+    bool takeDeferredWriteFailure();
+    void handleQProcess(QIODevice *device, Protocol::Command command, QDataStream &data);
+    void handleQSettings(QIODevice *device, Protocol::Command command, QDataStream &data,
                          PermissionSettings *settings);
-    void handleQFSFileEngine(QIODevice *device, const QString &command, QDataStream &data);
+    void handleQFSFileEngine(QIODevice *device, Protocol::Command command, QDataStream &data,
+                             const QByteArray &packet, qint64 offset);
+    void handleFileOperations(QLocalSocket *socket, Protocol::Command command, QDataStream &data);
 
 private:
     qintptr m_socketDescriptor;
@@ -74,6 +82,10 @@ private:
     QFSFileEngine *m_engine;
     QString m_authorizationKey;
     QProcessSignalReceiver *m_signalReceiver;
+
+    quint32 m_protocolVersion;
+    quint32 m_requestId;
+    bool m_deferredWriteFailed;
 };
 
 } // namespace QInstaller
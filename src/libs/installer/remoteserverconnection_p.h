@@ -29,8 +29,13 @@
 #ifndef REMOTESERVERCONNECTION_P_H
 #define REMOTESERVERCONNECTION_P_H
 
+#include "lib7z_extract.h"
 #include "protocol.h"
+#include "remotefileoperations.h"
 
+#include <QDir>
+#include <QFile>
+#include <QLocalSocket>
 #include <QMutex>
 #include <QProcess>
 #include <QVariant>
@@ -124,6 +129,59 @@ private:
     QVariantList m_receivedSignals;
 };
 
+class FileOperationsExtractCallback : public Lib7z::BackupExtractCallback
+{
+    Q_DISABLE_COPY(FileOperationsExtractCallback)
+
+public:
+    explicit FileOperationsExtractCallback(QLocalSocket *socket)
+        : m_socket(socket)
+    {}
+
+    QStringList extractedFiles() const {
+        return m_extractedFiles;
+    }
+
+private:
+    void setCurrentFile(const QString &filename) Q_DECL_OVERRIDE
+    {
+        m_extractedFiles.prepend(QDir::toNativeSeparators(filename));
+    }
+
+    HRESULT setCompleted(quint64 completed, quint64 total) Q_DECL_OVERRIDE
+    {
+        // Report whole percents only, archives with many small files would flood the client.
+        const int percent = total ? int(completed * 100 / total) : 0;
+        if (percent == m_percent)
+            return m_state;
+        m_percent = percent;
+
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << (total ? double(completed) / total : 0.0);
+        sendPacket(m_socket, Protocol::encodeCommand(Protocol::Command::FileOperationsProgress),
+            data);
+        m_socket->flush();
+
+        // The client is blocked waiting for the reply, the only thing it sends is a cancel.
+        if (m_socket->bytesAvailable() || m_socket->waitForReadyRead(0)) {
+            QByteArray command;
+            QByteArray ignored;
+            if (receivePacket(m_socket, &command, &ignored) && Protocol::decodeCommand(command)
+                    == Protocol::Command::FileOperationsCancel) {
+                m_state = E_ABORT;
+            }
+        }
+        return m_state;
+    }
+
+private:
+    QLocalSocket *m_socket;
+    HRESULT m_state = S_OK;
+    int m_percent = -1;
+    QStringList m_extractedFiles;
+};
+
 } // namespace QInstaller
 
 #endif // REMOTESERVERCONNECTION_P_H
@@ -29,6 +29,7 @@
 
 #include "messageboxhandler.h"
 #include "errors.h"
+#include "metadatastore.h"
 #include "scriptengine_p.h"
 #include "systeminfo.h"
 
@@ -476,17 +477,17 @@ void ScriptEngine::removeFromGlobalObject(QObject *object)
 QJSValue ScriptEngine::loadInContext(const QString &context, const QString &fileName,
     const QString &scriptInjection)
 {
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
+    const std::unique_ptr<QIODevice> file = MetadataStore::instance()->open(fileName);
+    if (!file->open(QIODevice::ReadOnly)) {
         throw Error(tr("Cannot open script file at %1: %2")
-            .arg(fileName, file.errorString()));
+            .arg(fileName, file->errorString()));
     }
 
     // Create a closure. Put the content in the first line to keep line number order in case of an
     // exception. Script content will be added as the last argument to the command to prevent wrong
     // replacements of %1, %2 or %3 inside the javascript code.
     const QString scriptContent = QLatin1String("(function() {")
-        + scriptInjection + QString::fromUtf8(file.readAll())
+        + scriptInjection + QString::fromUtf8(file->readAll())
         + QString::fromLatin1(";"
         "    if (typeof %1 != \"undefined\")"
         "        return new %1;"
@@ -38,6 +38,7 @@ namespace QInstaller {
 
 UninstallerCalculator::UninstallerCalculator(const QList<Component *> &installedComponents)
     : m_installedComponents(installedComponents)
+    , m_installedComponentsByName(PackageManagerCore::componentsByName(installedComponents))
 {
 }
 
@@ -75,10 +76,14 @@ void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*>
     foreach (Component *component, m_installedComponents) {
         // If a components is installed and not yet scheduled for un-installation, check for auto depend.
         if (component->isInstalled() && !m_componentsToUninstall.contains(component)) {
-            QStringList autoDependencies = PackageManagerCore::parseNames(component->autoDependencies());
-            if (autoDependencies.isEmpty())
+            const QList<Dependency> parsedAutoDependencies = component->parsedAutoDependencies();
+            if (parsedAutoDependencies.isEmpty())
                 continue;
 
+            QStringList autoDependencies;
+            foreach (const Dependency &dependency, parsedAutoDependencies)
+                autoDependencies.append(dependency.name());
+
             // This code needs to be enabled once the scripts use isInstalled, installationRequested and
             // uninstallationRequested...
             if (autoDependencies.first().compare(scScript, Qt::CaseInsensitive) == 0) {
@@ -101,7 +106,8 @@ void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*>
                                                                  QString::SkipEmptyParts) << c->name();
                 foreach (const QString &possibleName, possibleNames) {
 
-                    Component *cc = PackageManagerCore::componentByName(possibleName, m_installedComponents);
+                    Component *cc = PackageManagerCore::componentByName(possibleName,
+                        m_installedComponentsByName);
                     if (cc && (cc->installAction() != ComponentModelHelper::AutodependUninstallation)) {
                         autoDependencies.removeAll(possibleName);
 
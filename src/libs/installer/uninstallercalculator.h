@@ -53,6 +53,7 @@ private:
     void appendComponentToUninstall(Component *component);
 
     QList<Component *> m_installedComponents;
+    QHash<QString, QList<Component *> > m_installedComponentsByName; //for faster lookups
     QSet<Component *> m_componentsToUninstall;
 };
 
@@ -32,9 +32,11 @@
 
 #include "fileutils.h"
 
+#include <QAtomicInteger>
 #include <QDialog>
 #include <QDir>
 #include <QFile>
+#include <QFutureWatcher>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkProxyFactory>
 #include <QPointer>
@@ -49,6 +51,9 @@
 #include <QLoggingCategory>
 #include <globals.h>
 #include <QHostInfo>
+#include <QtConcurrentRun>
+
+#include <functional>
 
 using namespace KDUpdater;
 using namespace QInstaller;
@@ -730,6 +735,118 @@ void KDUpdater::FileDownloader::setIgnoreSslErrors(bool ignore)
     d->m_ignoreSslErrors = ignore;
 }
 
+// -- FileCopy
+
+namespace {
+
+typedef std::function<void(const char *data, int length)> CheckSumFunction;
+
+/*
+    Reads the open file \a source in large blocks and writes them to \a destination, if given.
+    Runs on a worker thread. Each block is handed to \a addCheckSumData on another thread while
+    the next block is read and the current one is written. Returns an error message, or an empty
+    string if the copy succeeded or got canceled.
+*/
+QString copyFileData(QFile *source, QFile *destination, QAtomicInteger<qint64> *bytesCopied,
+    QAtomicInt *canceled, const CheckSumFunction &addCheckSumData)
+{
+    const int blockSize = 1024 * 1024;
+    QByteArray blocks[2] = {
+        QByteArray(blockSize, Qt::Uninitialized),
+        QByteArray(blockSize, Qt::Uninitialized)
+    };
+
+    QString error;
+    QFuture<void> hashing;
+    for (int current = 0; !canceled->load(); current = 1 - current) {
+        char *block = blocks[current].data();
+        const qint64 numRead = source->read(block, blockSize);
+        if (numRead < 0) {
+            error = LocalFileDownloader::tr("Reading from file \"%1\" failed: %2").arg(
+                QDir::toNativeSeparators(source->fileName()), source->errorString());
+            break;
+        }
+        if (numRead == 0)
+            break;
+
+        // the other block is read into next, so the hashing of this one has to be done by then
+        hashing.waitForFinished();
+        hashing = QtConcurrent::run([block, numRead, &addCheckSumData]() {
+            addCheckSumData(block, int(numRead));
+        });
+
+        qint64 toWrite = destination ? numRead : 0;
+        while (toWrite > 0) {
+            const qint64 numWritten = destination->write(block + numRead - toWrite, toWrite);
+            if (numWritten < 0) {
+                error = LocalFileDownloader::tr("Writing to file \"%1\" failed: %2").arg(
+                    QDir::toNativeSeparators(destination->fileName()), destination->errorString());
+                break;
+            }
+            toWrite -= numWritten;
+        }
+        if (!error.isEmpty())
+            break;
+
+        bytesCopied->fetchAndAddOrdered(numRead);
+    }
+    hashing.waitForFinished();
+
+    if (error.isEmpty() && destination && !destination->flush()) {
+        error = LocalFileDownloader::tr("Writing to file \"%1\" failed: %2").arg(
+            QDir::toNativeSeparators(destination->fileName()), destination->errorString());
+    }
+    return error;
+}
+
+/*
+    Runs copyFileData() on the global thread pool. The downloaders only poll the number of copied
+    bytes from their download speed timer, instead of doing the work in small blocks on the event
+    loop.
+*/
+struct FileCopy
+{
+    FileCopy()
+        : bytesCopied(0)
+        , bytesReported(0)
+        , bytesToCopy(0)
+        , canceled(0)
+    {}
+
+    void start(QFile *source, QFile *destination, const CheckSumFunction &addCheckSumData)
+    {
+        bytesCopied.store(0);
+        bytesReported = 0;
+        bytesToCopy = source->size();
+        canceled.store(0);
+        watcher.setFuture(QtConcurrent::run(&copyFileData, source, destination, &bytesCopied,
+            &canceled, addCheckSumData));
+    }
+
+    void cancel()
+    {
+        canceled.store(1);
+        watcher.waitForFinished();
+    }
+
+    qint64 takeSample()
+    {
+        const qint64 copied = bytesCopied.load();
+        const qint64 sample = copied - bytesReported;
+        bytesReported = copied;
+        return sample;
+    }
+
+    QFutureWatcher<QString> watcher;
+    QAtomicInteger<qint64> bytesCopied;
+    qint64 bytesReported;
+    qint64 bytesToCopy;
+    QAtomicInt canceled;
+};
+
+} // namespace
+
+
 // -- KDUpdater::LocalFileDownloader
 
 /*!
@@ -751,14 +868,15 @@ struct KDUpdater::LocalFileDownloader::Private
         : source(0)
         , destination(0)
         , downloaded(false)
-        , timerId(-1)
+        , copying(false)
     {}
 
     QFile *source;
     QFile *destination;
     QString destFileName;
     bool downloaded;
-    int timerId;
+    bool copying;
+    FileCopy copy;
 };
 
 /*!
@@ -768,6 +886,8 @@ KDUpdater::LocalFileDownloader::LocalFileDownloader(QObject *parent)
     : KDUpdater::FileDownloader(QLatin1String("file"), parent)
     , d (new Private)
 {
+    connect(&d->copy.watcher, &QFutureWatcherBase::finished, this,
+        &LocalFileDownloader::copyFinished);
 }
 
 /*!
@@ -775,6 +895,9 @@ KDUpdater::LocalFileDownloader::LocalFileDownloader(QObject *parent)
 */
 KDUpdater::LocalFileDownloader::~LocalFileDownloader()
 {
+    if (d->copying)
+        d->copy.cancel();
+
     if (this->isAutoRemoveDownloadedFile() && !d->destFileName.isEmpty())
         QFile::remove(d->destFileName);
 
@@ -805,7 +928,7 @@ void KDUpdater::LocalFileDownloader::doDownload()
         return;
 
     // Already started downloading
-    if (d->timerId >= 0)
+    if (d->copying)
         return;
 
     // Open source and destination files
@@ -835,8 +958,11 @@ void KDUpdater::LocalFileDownloader::doDownload()
     }
 
     runDownloadSpeedTimer();
-    // Start a timer and kickoff the copy process
-    d->timerId = startTimer(0); // as fast as possible
+    // Kickoff the copy process on a worker thread
+    d->copying = true;
+    d->copy.start(d->source, d->destination, [this](const char *data, int length) {
+        addCheckSumData(data, length);
+    });
 
     emit downloadStarted();
     emit downloadProgress(0);
@@ -872,11 +998,11 @@ KDUpdater::LocalFileDownloader *KDUpdater::LocalFileDownloader::clone(QObject *p
 */
 void KDUpdater::LocalFileDownloader::cancelDownload()
 {
-    if (d->timerId < 0)
+    if (!d->copying)
         return;
 
-    killTimer(d->timerId);
-    d->timerId = -1;
+    d->copying = false;
+    d->copy.cancel();
 
     onError();
     setDownloadCanceled();
@@ -887,43 +1013,8 @@ void KDUpdater::LocalFileDownloader::cancelDownload()
 */
 void KDUpdater::LocalFileDownloader::timerEvent(QTimerEvent *event)
 {
-    if (event->timerId() == d->timerId) {
-        if (!d->source || !d->destination)
-            return;
-
-        const qint64 blockSize = 32768;
-        QByteArray buffer;
-        buffer.resize(blockSize);
-        const qint64 numRead = d->source->read(buffer.data(), buffer.size());
-        qint64 toWrite = numRead;
-        while (toWrite > 0) {
-            const qint64 numWritten = d->destination->write(buffer.constData() + numRead - toWrite, toWrite);
-            if (numWritten < 0) {
-                killTimer(d->timerId);
-                d->timerId = -1;
-                onError();
-                setDownloadAborted(tr("Writing to file \"%1\" failed: %2").arg(
-                                       QDir::toNativeSeparators(d->destination->fileName()),
-                                       d->destination->errorString()));
-                return;
-            }
-            toWrite -= numWritten;
-        }
-        addSample(numRead);
-        addCheckSumData(buffer.data(), numRead);
-        if (numRead > 0) {
-            setProgress(d->source->pos(), d->source->size());
-            emit downloadProgress(calcProgress(d->source->pos(), d->source->size()));
-            return;
-        }
-
-        d->destination->flush();
-
-        killTimer(d->timerId);
-        d->timerId = -1;
-
-        setDownloadCompleted();
-    } else if (event->timerId() == downloadSpeedTimerId()) {
+    if (event->timerId() == downloadSpeedTimerId()) {
+        updateCopyProgress();
         emitDownloadSpeed();
         emitDownloadStatus();
         emitDownloadProgress();
@@ -931,6 +1022,37 @@ void KDUpdater::LocalFileDownloader::timerEvent(QTimerEvent *event)
     }
 }
 
+/*!
+    Reports the bytes copied by the worker thread since the last call.
+*/
+void KDUpdater::LocalFileDownloader::updateCopyProgress()
+{
+    addSample(d->copy.takeSample());
+    setProgress(d->copy.bytesReported, d->copy.bytesToCopy);
+    emit downloadProgress(calcProgress(d->copy.bytesReported, d->copy.bytesToCopy));
+}
+
+/*!
+    Called when the worker thread is done copying the file.
+*/
+void KDUpdater::LocalFileDownloader::copyFinished()
+{
+    // canceled meanwhile
+    if (!d->copying)
+        return;
+
+    d->copying = false;
+    updateCopyProgress();
+
+    const QString error = d->copy.watcher.result();
+    if (!error.isEmpty()) {
+        onError();
+        setDownloadAborted(error);
+        return;
+    }
+    setDownloadCompleted();
+}
+
 /*!
     Closes the destination file after it has been successfully copied and stops
     the download speed timer.
@@ -975,13 +1097,14 @@ void LocalFileDownloader::onError()
 struct KDUpdater::ResourceFileDownloader::Private
 {
     Private()
-        : timerId(-1)
+        : copying(false)
         , downloaded(false)
     {}
 
-    int timerId;
+    bool copying;
     QFile destFile;
     bool downloaded;
+    FileCopy copy;
 };
 
 /*!
@@ -991,6 +1114,8 @@ KDUpdater::ResourceFileDownloader::ResourceFileDownloader(QObject *parent)
     : KDUpdater::FileDownloader(QLatin1String("resource"), parent)
     , d(new Private)
 {
+    connect(&d->copy.watcher, &QFutureWatcherBase::finished, this,
+        &ResourceFileDownloader::copyFinished);
 }
 
 /*!
@@ -998,6 +1123,8 @@ KDUpdater::ResourceFileDownloader::ResourceFileDownloader(QObject *parent)
 */
 KDUpdater::ResourceFileDownloader::~ResourceFileDownloader()
 {
+    if (d->copying)
+        d->copy.cancel();
     delete d;
 }
 
@@ -1028,7 +1155,7 @@ void KDUpdater::ResourceFileDownloader::doDownload()
         return;
 
     // Already started downloading
-    if (d->timerId >= 0)
+    if (d->copying)
         return;
 
     // Open source and destination files
@@ -1039,8 +1166,21 @@ void KDUpdater::ResourceFileDownloader::doDownload()
     emit downloadStarted();
     emit downloadProgress(0);
 
-    d->destFile.open(QIODevice::ReadOnly);
-    d->timerId = startTimer(0); // start as fast as possible
+    if (!d->destFile.open(QIODevice::ReadOnly)) {
+        const QString error = tr("Cannot read resource file \"%1\": %2").arg(downloadedFileName(),
+            d->destFile.errorString());
+        onError();
+        emit downloadProgress(1);
+        setDownloadAborted(error);
+        return;
+    }
+
+    runDownloadSpeedTimer();
+    // Nothing to write, the worker thread only reads and hashes the resource
+    d->copying = true;
+    d->copy.start(&d->destFile, nullptr, [this](const char *data, int length) {
+        addCheckSumData(data, length);
+    });
 }
 
 /*!
@@ -1073,11 +1213,12 @@ KDUpdater::ResourceFileDownloader *KDUpdater::ResourceFileDownloader::clone(QObj
 */
 void KDUpdater::ResourceFileDownloader::cancelDownload()
 {
-    if (d->timerId < 0)
+    if (!d->copying)
         return;
 
-    killTimer(d->timerId);
-    d->timerId = -1;
+    d->copying = false;
+    d->copy.cancel();
+    stopDownloadSpeedTimer();
 
     setDownloadCanceled();
 }
@@ -1087,33 +1228,8 @@ void KDUpdater::ResourceFileDownloader::cancelDownload()
 */
 void KDUpdater::ResourceFileDownloader::timerEvent(QTimerEvent *event)
 {
-    if (event->timerId() == d->timerId) {
-        if (!d->destFile.isOpen()) {
-            onError();
-            killTimer(d->timerId);
-            emit downloadProgress(1);
-            setDownloadAborted(tr("Cannot read resource file \"%1\": %2").arg(downloadedFileName(),
-                d->destFile.errorString()));
-            return;
-        }
-
-        QByteArray buffer;
-        buffer.resize(32768);
-        const qint64 numRead = d->destFile.read(buffer.data(), buffer.size());
-
-        addSample(numRead);
-        addCheckSumData(buffer.data(), numRead);
-
-        if (numRead > 0) {
-            setProgress(d->destFile.pos(), d->destFile.size());
-            emit downloadProgress(calcProgress(d->destFile.pos(), d->destFile.size()));
-            return;
-        }
-
-        killTimer(d->timerId);
-        d->timerId = -1;
-        setDownloadCompleted();
-    } else if (event->timerId() == downloadSpeedTimerId()) {
+    if (event->timerId() == downloadSpeedTimerId()) {
+        updateCopyProgress();
         emitDownloadSpeed();
         emitDownloadStatus();
         emitDownloadProgress();
@@ -1121,6 +1237,37 @@ void KDUpdater::ResourceFileDownloader::timerEvent(QTimerEvent *event)
     }
 }
 
+/*!
+    Reports the bytes read by the worker thread since the last call.
+*/
+void KDUpdater::ResourceFileDownloader::updateCopyProgress()
+{
+    addSample(d->copy.takeSample());
+    setProgress(d->copy.bytesReported, d->copy.bytesToCopy);
+    emit downloadProgress(calcProgress(d->copy.bytesReported, d->copy.bytesToCopy));
+}
+
+/*!
+    Called when the worker thread is done reading the resource file.
+*/
+void KDUpdater::ResourceFileDownloader::copyFinished()
+{
+    // canceled meanwhile
+    if (!d->copying)
+        return;
+
+    d->copying = false;
+    updateCopyProgress();
+
+    const QString error = d->copy.watcher.result();
+    if (!error.isEmpty()) {
+        onError();
+        setDownloadAborted(error);
+        return;
+    }
+    setDownloadCompleted();
+}
+
 /*!
     Closes the destination file after it has been successfully copied and stops
     the download speed timer.
@@ -62,6 +62,10 @@ protected:
 
 private Q_SLOTS:
     void doDownload();
+    void copyFinished();
+
+private:
+    void updateCopyProgress();
 
 private:
     struct Private;
@@ -92,6 +96,10 @@ protected:
 
 private Q_SLOTS:
     void doDownload();
+    void copyFinished();
+
+private:
+    void updateCopyProgress();
 
 private:
     struct Private;
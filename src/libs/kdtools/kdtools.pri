@@ -32,7 +32,8 @@ HEADERS += $$PWD/updater.h \
     $$PWD/updatefinder.h \
     $$PWD/updatesinfo_p.h \
     $$PWD/environment.h \
-    $$PWD/updatesinfodata_p.h
+    $$PWD/updatesinfodata_p.h \
+    $$PWD/version.h
 
 SOURCES += $$PWD/filedownloader.cpp \
     $$PWD/filedownloaderfactory.cpp \
@@ -44,7 +45,8 @@ SOURCES += $$PWD/filedownloader.cpp \
     $$PWD/task.cpp \
     $$PWD/updatefinder.cpp \
     $$PWD/updatesinfo.cpp \
-    $$PWD/environment.cpp
+    $$PWD/environment.cpp \
+    $$PWD/version.cpp
 
 win32 {
     SOURCES += $$PWD/lockfile_win.cpp \
@@ -32,6 +32,7 @@
 #include "globals.h"
 #include "constants.h"
 
+#include <QDataStream>
 #include <QDomDocument>
 #include <QDomElement>
 #include <QFileInfo>
@@ -53,6 +54,12 @@ using namespace QInstaller;
         \li Get information about the number of packages installed and their meta-data via the
             packageInfoCount() and packageInfo() methods.
     \endlist
+
+    Rewriting the whole file on every writeToDisk() call gets expensive for installations with
+    many components. Between beginTransaction() and commitTransaction() the changes are therefore
+    appended as small records to a journal file next to the installation information file. The
+    journal is folded back into the XML file when the transaction is committed; a journal left
+    behind by an interrupted installation is replayed by refresh().
 */
 
 /*!
@@ -70,11 +77,21 @@ using namespace QInstaller;
                                             descriptions.
 */
 
+static const quint32 scJournalMagic = 0x4C50484A; // "LPHJ"
+static const quint32 scJournalVersion = 1;
+
+enum JournalRecord {
+    AddPackageRecord = 1,
+    RemovePackageRecord,
+    ClearPackagesRecord
+};
+
 struct LocalPackageHub::PackagesInfoData
 {
     PackagesInfoData() :
         error(LocalPackageHub::NotYetReadError),
-        modified(false)
+        modified(false),
+        inTransaction(false)
     {}
     QString errorMessage;
     LocalPackageHub::Error error;
@@ -83,12 +100,155 @@ struct LocalPackageHub::PackagesInfoData
     QString applicationVersion;
     bool modified;
 
+    bool inTransaction;
+    QByteArray pendingJournal;
+
     QMap<QString, LocalPackage> m_packageInfoMap;
 
     void addPackageFrom(const QDomElement &packageE);
     void setInvalidContentError(const QString &detail);
+
+    QString journalFileName() const;
+    void queueJournalRecord(const QByteArray &payload);
+    void queueAddPackage(const LocalPackage &info);
+    bool appendPendingJournal();
+    bool replayJournal();
+    void removeJournal();
 };
 
+static void writePackage(QDataStream &stream, const LocalPackage &info)
+{
+    stream << info.name << info.title << info.description << info.version
+        << info.inheritVersionFrom << info.dependencies << info.autoDependencies
+        << info.lastUpdateDate << info.installDate << info.forcedInstallation << info.virtualComp
+        << info.uncompressedSize << info.checkable << info.expandedByDefault;
+}
+
+static void readPackage(QDataStream &stream, LocalPackage *info)
+{
+    stream >> info->name >> info->title >> info->description >> info->version
+        >> info->inheritVersionFrom >> info->dependencies >> info->autoDependencies
+        >> info->lastUpdateDate >> info->installDate >> info->forcedInstallation >> info->virtualComp
+        >> info->uncompressedSize >> info->checkable >> info->expandedByDefault;
+}
+
+QString LocalPackageHub::PackagesInfoData::journalFileName() const
+{
+    return fileName + QLatin1String(".journal");
+}
+
+void LocalPackageHub::PackagesInfoData::queueJournalRecord(const QByteArray &payload)
+{
+    // Every record carries its own checksum, so a record torn by a crash while appending it
+    // is detected on replay and everything in front of it is still used.
+    QDataStream stream(&pendingJournal, QIODevice::WriteOnly | QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << payload << qChecksum(payload.constData(), uint(payload.size()));
+}
+
+void LocalPackageHub::PackagesInfoData::queueAddPackage(const LocalPackage &info)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint8(AddPackageRecord);
+    writePackage(stream, info);
+    queueJournalRecord(payload);
+}
+
+bool LocalPackageHub::PackagesInfoData::appendPendingJournal()
+{
+    if (pendingJournal.isEmpty())
+        return true;
+
+    QFile file(journalFileName());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+
+    if (file.size() == 0) {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << scJournalMagic << scJournalVersion << applicationName << applicationVersion;
+        QInstaller::setDefaultFilePermissions(&file, DefaultFilePermissions::NonExecutable);
+    }
+
+    if (file.write(pendingJournal) != pendingJournal.size())
+        return false;
+    file.close();
+
+    pendingJournal.clear();
+    return true;
+}
+
+bool LocalPackageHub::PackagesInfoData::replayJournal()
+{
+    QFile file(journalFileName());
+    if (!file.exists() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString name;
+    QString appVersion;
+    stream >> magic >> version >> name >> appVersion;
+    if (stream.status() != QDataStream::Ok || magic != scJournalMagic
+        || version != scJournalVersion) {
+        return false;
+    }
+
+    if (!name.isEmpty())
+        applicationName = name;
+    if (!appVersion.isEmpty())
+        applicationVersion = appVersion;
+
+    while (!stream.atEnd()) {
+        QByteArray payload;
+        quint16 checksum = 0;
+        stream >> payload >> checksum;
+        if (stream.status() != QDataStream::Ok
+            || checksum != qChecksum(payload.constData(), uint(payload.size()))) {
+            break;
+        }
+
+        QDataStream record(payload);
+        record.setVersion(QDataStream::Qt_5_0);
+        quint8 type = 0;
+        record >> type;
+        switch (type) {
+        case AddPackageRecord: {
+            LocalPackage info;
+            readPackage(record, &info);
+            m_packageInfoMap.insert(info.name, info);
+        }   break;
+        case RemovePackageRecord: {
+            QString packageName;
+            record >> packageName;
+            m_packageInfoMap.remove(packageName);
+        }   break;
+        case ClearPackagesRecord:
+            m_packageInfoMap.clear();
+            break;
+        default:
+            break;
+        }
+    }
+
+    // the XML file does not reflect the journal yet, fold it in with the next write
+    modified = true;
+    return true;
+}
+
+void LocalPackageHub::PackagesInfoData::removeJournal()
+{
+    pendingJournal.clear();
+    const QString journal = journalFileName();
+    if (QFile::exists(journal))
+        QFile::remove(journal);
+}
+
 void LocalPackageHub::PackagesInfoData::setInvalidContentError(const QString &detail)
 {
     error = LocalPackageHub::InvalidContentError;
@@ -110,6 +270,7 @@ LocalPackageHub::LocalPackageHub()
 */
 LocalPackageHub::~LocalPackageHub()
 {
+    d->inTransaction = false;
     writeToDisk();
     delete d;
 }
@@ -232,6 +393,9 @@ QList<LocalPackage> LocalPackageHub::packageInfos() const
     Re-reads the installation information XML file and updates itself. Changes to applicationName()
     and applicationVersion() are lost after this function returns. The function emits a reset()
     signal after completion.
+
+    A journal left behind by an interrupted transaction is replayed on top of the XML file. Ends a
+    running transaction, changes that were not written to disk yet are lost.
 */
 void LocalPackageHub::refresh()
 {
@@ -240,11 +404,19 @@ void LocalPackageHub::refresh()
     d->applicationVersion.clear();
     d->m_packageInfoMap.clear();
     d->modified = false;
+    d->inTransaction = false;
+    d->pendingJournal.clear();
 
     QFile file(d->fileName);
 
     // if the file does not exist then we just skip the reading
     if (!file.exists()) {
+        // unless an interrupted installation never got to write it
+        if (d->replayJournal()) {
+            d->error = NoError;
+            d->errorMessage.clear();
+            return;
+        }
         d->error = NotYetReadError;
         d->errorMessage = tr("The file %1 does not exist.").arg(d->fileName);
         return;
@@ -295,6 +467,7 @@ void LocalPackageHub::refresh()
         else if (childNodeE.tagName() == QLatin1String("Package"))
             d->addPackageFrom(childNodeE);
     }
+    d->replayJournal();
 
     d->error = NoError;
     d->errorMessage.clear();
@@ -350,6 +523,9 @@ void LocalPackageHub::addPackage(const QString &name,
         d->m_packageInfoMap.insert(name, info);
     }
     d->modified = true;
+
+    if (d->inTransaction)
+        d->queueAddPackage(d->m_packageInfoMap.value(name));
 }
 
 /*!
@@ -361,6 +537,14 @@ bool LocalPackageHub::removePackage(const QString &name)
         return false;
 
     d->modified = true;
+
+    if (d->inTransaction) {
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << quint8(RemovePackageRecord) << name;
+        d->queueJournalRecord(payload);
+    }
     return true;
 }
 
@@ -380,10 +564,17 @@ static void addTextChildHelper(QDomNode *node,
 }
 
 /*!
-    Writes the installation information file to disk.
+    Writes the installation information file to disk. Inside a transaction only the changes since
+    the last call are appended to the journal.
+
+    \sa beginTransaction()
 */
 void LocalPackageHub::writeToDisk()
 {
+    // fall back to rewriting the whole file if the journal cannot be written
+    if (d->inTransaction && d->appendPendingJournal())
+        return;
+
     if (d->modified && (!d->m_packageInfoMap.isEmpty() || QFile::exists(d->fileName))) {
         QDomDocument doc;
         QDomElement root = doc.createElement(QLatin1String("Packages")) ;
@@ -439,9 +630,62 @@ void LocalPackageHub::writeToDisk()
             &file, DefaultFilePermissions::NonExecutable);
 
         d->modified = false;
+        // the file holds everything now, the journal is obsolete
+        d->removeJournal();
     }
 }
 
+/*!
+    Starts a transaction. Until commitTransaction() is called, writeToDisk() appends the changes
+    made by addPackage(), removePackage() and clearPackageInfos() to a journal file instead of
+    rewriting the installation information file.
+
+    \sa commitTransaction(), isInTransaction()
+*/
+void LocalPackageHub::beginTransaction()
+{
+    if (d->inTransaction)
+        return;
+
+    // start from an up to date file, so the journal only holds the changes of this transaction
+    writeToDisk();
+    d->inTransaction = true;
+
+    if (d->modified) {
+        // the file could not be written, record the complete state instead
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << quint8(ClearPackagesRecord);
+        d->queueJournalRecord(payload);
+        foreach (const LocalPackage &info, d->m_packageInfoMap)
+            d->queueAddPackage(info);
+    }
+}
+
+/*!
+    Ends the transaction and writes the complete installation information file, removing the
+    journal.
+
+    \sa beginTransaction()
+*/
+void LocalPackageHub::commitTransaction()
+{
+    if (!d->inTransaction)
+        return;
+
+    d->inTransaction = false;
+    d->pendingJournal.clear();
+    writeToDisk();
+}
+
+/*!
+    Returns \c true if a transaction was started with beginTransaction() and not yet committed.
+*/
+bool LocalPackageHub::isInTransaction() const
+{
+    return d->inTransaction;
+}
+
 void LocalPackageHub::PackagesInfoData::addPackageFrom(const QDomElement &packageE)
 {
     if (packageE.isNull())
@@ -503,6 +747,13 @@ void LocalPackageHub::clearPackageInfos()
 {
     d->m_packageInfoMap.clear();
     d->modified = true;
+
+    if (d->inTransaction) {
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << quint8(ClearPackagesRecord);
+        d->queueJournalRecord(payload);
+    }
 }
 
 /*!
@@ -112,6 +112,10 @@ public:
     void refresh();
     void writeToDisk();
 
+    void beginTransaction();
+    void commitTransaction();
+    bool isInTransaction() const;
+
 private:
     struct PackagesInfoData;
     PackagesInfoData *d;
@@ -49,6 +49,7 @@ using namespace KDUpdater;
 Update::Update(const QInstaller::PackageSource &packageSource, const UpdateInfo &updateInfo)
     : m_packageSource(packageSource)
     , m_updateInfo(updateInfo)
+    , m_version(updateInfo.data.value(QLatin1String("Version")).toString())
 {
 }
 
@@ -60,3 +61,9 @@ QVariant Update::data(const QString &name, const QVariant &defaultValue) const
 {
     return m_updateInfo.data.value(name, defaultValue);
 }
+
+/*!
+   \fn KDUpdater::Update::version() const
+
+   Returns the version of the update, parsed once when the update is created.
+*/
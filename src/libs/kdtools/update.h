@@ -31,6 +31,8 @@
 
 #include "packagesource.h"
 #include "updatesinfo_p.h"
+#include "version.h"
+
 #include <QVariant>
 
 namespace KDUpdater {
@@ -41,6 +43,7 @@ public:
     QVariant data(const QString &name, const QVariant &defaultValue = QVariant()) const;
 
     QInstaller::PackageSource packageSource() const {return m_packageSource; }
+    Version version() const { return m_version; }
 
 private:
     friend class UpdateFinder;
@@ -49,6 +52,7 @@ private:
 private:
     QInstaller::PackageSource m_packageSource;
     UpdateInfo m_updateInfo;
+    Version m_version;
 };
 
 } // namespace KDUpdater
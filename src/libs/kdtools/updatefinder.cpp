@@ -33,13 +33,13 @@
 #include "filedownloaderfactory.h"
 #include "updatesinfo_p.h"
 #include "localpackagehub.h"
+#include "version.h"
 
 #include "fileutils.h"
 #include "globals.h"
 
 #include <QCoreApplication>
 #include <QFileInfo>
-#include <QRegExp>
 
 using namespace KDUpdater;
 using namespace QInstaller;
@@ -413,8 +413,8 @@ UpdateFinder::Private::Resolution UpdateFinder::Private::checkPriorityAndVersion
     if (Update *existingPackage = updates.value(name)) {
         // Bingo, package was previously found elsewhere.
 
-        const int match = compareVersion(newPackage.value(QLatin1String("Version")).toString(),
-            existingPackage->data(QLatin1String("Version")).toString());
+        const int match = Version::compare(Version(newPackage.value(QLatin1String("Version"))
+            .toString()), existingPackage->version());
 
         if (match > 0) {
             // new package has higher version, use
@@ -581,90 +581,13 @@ void UpdateFinder::Private::slotDownloadDone()
    KDUpdater::compareVersion("2.x", "2.1.12.x");      // Returns 0
 
    \endcode
+
+   Callers comparing the same version many times should keep a KDUpdater::Version instead.
 */
 int KDUpdater::compareVersion(const QString &v1, const QString &v2)
 {
     // For tests refer VersionCompareFnTest testcase.
-
-    // Check for equality
-    if (v1 == v2)
-        return 0;
-
-    // Split version components across ".", "-" or "_"
-    QStringList v1_comps = v1.split(QRegExp(QLatin1String( "\\.|-|_")));
-    QStringList v2_comps = v2.split(QRegExp(QLatin1String( "\\.|-|_")));
-
-    // Check each component of the version
-    int index = 0;
-    while (true) {
-        bool v1_ok = false;
-        bool v2_ok = false;
-
-        if (index == v1_comps.count() && index < v2_comps.count()) {
-            v2_comps.at(index).toLongLong(&v2_ok);
-            return v2_ok ? -1 : +1;
-        }
-        if (index < v1_comps.count() && index == v2_comps.count()) {
-            v1_comps.at(index).toLongLong(&v1_ok);
-            return v1_ok ? +1 : -1;
-        }
-        if (index >= v1_comps.count() || index >= v2_comps.count())
-            break;
-
-        qlonglong v1_comp = v1_comps.at(index).toLongLong(&v1_ok);
-        qlonglong v2_comp = v2_comps.at(index).toLongLong(&v2_ok);
-
-        if (!v1_ok) {
-            if (v1_comps.at(index) == QLatin1String("x"))
-                return 0;
-        }
-        if (!v2_ok) {
-            if (v2_comps.at(index) == QLatin1String("x"))
-                return 0;
-        }
-        if (!v1_ok && !v2_ok) {
-            // try remove equal start
-            int i = 0;
-            while (i < v1_comps.at(index).size()
-                && i < v2_comps.at(index).size()
-                && v1_comps.at(index).at(i) == v2_comps.at(index).at(i)) {
-                ++i;
-            }
-            if (i > 0) {
-                v1_comps[index] = v1_comps.at(index).mid(i);
-                v2_comps[index] = v2_comps.at(index).mid(i);
-                // compare again
-                continue;
-            }
-        }
-        if (!v1_ok || !v2_ok) {
-            int res = v1_comps.at(index).compare(v2_comps.at(index));
-            if (res == 0) {
-                // v1_comps.at(index) == v2_comps(index)
-                ++index;
-                continue;
-            }
-            return res > 0 ? +1 : -1;
-        }
-
-        if (v1_comp < v2_comp)
-            return -1;
-
-        if (v1_comp > v2_comp)
-            return +1;
-
-        // v1_comp == v2_comp
-        ++index;
-    }
-
-    if (index < v2_comps.count())
-        return +1;
-
-    if (index < v1_comps.count())
-        return -1;
-
-    // Controversial return. I hope this never happens.
-    return 0;
+    return Version::compare(Version(v1), Version(v2));
 }
 
 #include "moc_updatefinder.cpp"
@@ -29,15 +29,39 @@
 #include "updatesinfo_p.h"
 #include "utils.h"
 
-#include <QDomDocument>
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QLocale>
+#include <QMutex>
 #include <QPair>
 #include <QVector>
 #include <QUrl>
+#include <QXmlStreamReader>
 
 using namespace KDUpdater;
 
+namespace {
+
+// Files parsed ahead of time, for example while fetching the repository metadata, waiting to be
+// picked up by the next UpdatesInfo reading the same, unchanged file.
+struct ParsedFile
+{
+    UpdatesInfo info;
+    qint64 size = -1;
+    QDateTime lastModified;
+};
+
+struct ParsedFiles
+{
+    QMutex mutex;
+    QHash<QString, ParsedFile> files;
+};
+
+Q_GLOBAL_STATIC(ParsedFiles, parsedFiles)
+
+} // namespace
+
 UpdatesInfoData::UpdatesInfoData()
      : error(UpdatesInfo::NotYetReadError)
 {
@@ -62,38 +86,62 @@ void UpdatesInfoData::parseFile(const QString &updateXmlFile)
         return;
     }
 
-    QDomDocument doc;
-    QString parseErrorMessage;
-    int parseErrorLine, parseErrorColumn;
-    if (!doc.setContent(&file, &parseErrorMessage, &parseErrorLine, &parseErrorColumn)) {
+    // Read the file in a single pass, packages that lack mandatory elements are still read
+    // so that callers only interested in parts of the file can use it. The first such problem
+    // is reported once the whole file turned out to be well-formed.
+    QString contentError;
+    QXmlStreamReader reader(&file);
+    if (reader.readNextStartElement()) {
+        if (reader.name() != QLatin1String("Updates")) {
+            setInvalidContentError(tr("Root element %1 unexpected, should be \"Updates\".")
+                .arg(reader.name().toString()));
+            return;
+        }
+
+        bool repositoryUpdateFound = false;
+        while (reader.readNextStartElement()) {
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("ApplicationName")) {
+                applicationName = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            } else if (name == QLatin1String("ApplicationVersion")) {
+                applicationVersion = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            } else if (name == QLatin1String("Checksum")) {
+                checksum = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+                if (checksum.isNull())
+                    checksum = QLatin1String("");  // tell an empty element from a missing one
+            } else if (name == QLatin1String("SHA1")) {
+                sha1 = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            } else if (name == QLatin1String("MetadataName")) {
+                metadataName = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            } else if (name == QLatin1String("RepositoryUpdate") && !repositoryUpdateFound) {
+                repositoryUpdateFound = true;
+                parseRepositoryUpdateElement(reader);
+            } else if (name == QLatin1String("PackageUpdate")) {
+                const QString packageError = parsePackageUpdateElement(reader);
+                if (contentError.isEmpty())
+                    contentError = packageError;
+            } else {
+                reader.skipCurrentElement();
+            }
+        }
+        // make sure nothing but whitespace and comments follow the root element
+        while (!reader.atEnd())
+            reader.readNext();
+    }
+
+    if (reader.hasError()) {
         error = UpdatesInfo::InvalidXmlError;
         errorMessage = tr("Parse error in %1 at %2, %3: %4").arg(updateXmlFile,
-            QString::number(parseErrorLine), QString::number(parseErrorColumn), parseErrorMessage);
+            QString::number(reader.lineNumber()), QString::number(reader.columnNumber()),
+            reader.errorString());
         return;
     }
 
-    QDomElement rootE = doc.documentElement();
-    if (rootE.tagName() != QLatin1String("Updates")) {
-        setInvalidContentError(tr("Root element %1 unexpected, should be \"Updates\".").arg(rootE.tagName()));
+    if (!contentError.isEmpty()) {
+        setInvalidContentError(contentError);
         return;
     }
 
-    QDomNodeList childNodes = rootE.childNodes();
-    for(int i = 0; i < childNodes.count(); i++) {
-        const QDomElement childE = childNodes.at(i).toElement();
-        if (childE.isNull())
-            continue;
-
-        if (childE.tagName() == QLatin1String("ApplicationName"))
-            applicationName = childE.text();
-        else if (childE.tagName() == QLatin1String("ApplicationVersion"))
-            applicationVersion = childE.text();
-        else if (childE.tagName() == QLatin1String("PackageUpdate")) {
-            if (!parsePackageUpdateElement(childE))
-                return; //error handled in subroutine
-        }
-    }
-
     if (applicationName.isEmpty()) {
         setInvalidContentError(tr("ApplicationName element is missing."));
         return;
@@ -108,88 +156,108 @@ void UpdatesInfoData::parseFile(const QString &updateXmlFile)
     error = UpdatesInfo::NoError;
 }
 
-bool UpdatesInfoData::parsePackageUpdateElement(const QDomElement &updateE)
+/*
+    Reads the PackageUpdate element the \a reader is positioned at and adds it to the update
+    info list. Returns a description of the missing mandatory elements, if any.
+*/
+QString UpdatesInfoData::parsePackageUpdateElement(QXmlStreamReader &reader)
 {
-    if (updateE.isNull())
-        return false;
-
     UpdateInfo info;
     QMap<QString, QString> localizedDescriptions;
-    for (int i = 0; i < updateE.childNodes().count(); i++) {
-        QDomElement childE = updateE.childNodes().at(i).toElement();
-        if (childE.isNull())
-            continue;
-
-        if (childE.tagName() == QLatin1String("ReleaseNotes")) {
-            info.data[childE.tagName()] = QUrl(childE.text());
-        } else if (childE.tagName() == QLatin1String("Licenses")) {
+    while (reader.readNextStartElement()) {
+        const QString tagName = reader.name().toString();
+        const QXmlStreamAttributes attributes = reader.attributes();
+
+        if (tagName == QLatin1String("ReleaseNotes")) {
+            info.data[tagName] = QUrl(reader.readElementText(QXmlStreamReader::IncludeChildElements));
+        } else if (tagName == QLatin1String("Licenses")) {
             QHash<QString, QVariant> licenseHash;
-            const QDomNodeList licenseNodes = childE.childNodes();
-            for (int i = 0; i < licenseNodes.count(); ++i) {
-                const QDomNode licenseNode = licenseNodes.at(i);
-                if (licenseNode.nodeName() == QLatin1String("License")) {
-                    QDomElement element = licenseNode.toElement();
-                    licenseHash.insert(element.attributeNode(QLatin1String("name")).value(),
-                        element.attributeNode(QLatin1String("file")).value());
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("License")) {
+                    const QXmlStreamAttributes license = reader.attributes();
+                    licenseHash.insert(license.value(QLatin1String("name")).toString(),
+                        license.value(QLatin1String("file")).toString());
                 }
+                reader.skipCurrentElement();
             }
-            if (!licenseHash.isEmpty())
-                info.data.insert(QLatin1String("Licenses"), licenseHash);
-        } else if (childE.tagName() == QLatin1String("Version")) {
+            // an empty hash still tells the element was there
+            info.data.insert(QLatin1String("Licenses"), licenseHash);
+        } else if (tagName == QLatin1String("Version")) {
             info.data.insert(QLatin1String("inheritVersionFrom"),
-                childE.attribute(QLatin1String("inheritVersionFrom")));
-            info.data[childE.tagName()] = childE.text();
-        } else if (childE.tagName() == QLatin1String("DisplayName")) {
-            processLocalizedTag(childE, info.data);
-        } else if (childE.tagName() == QLatin1String("Description")) {
-            if (!childE.hasAttribute(QLatin1String("xml:lang")))
-                info.data[QLatin1String("Description")] = childE.text();
-            QString languageAttribute = childE.attribute(QLatin1String("xml:lang"), QLatin1String("en"));
-            localizedDescriptions.insert(languageAttribute.toLower(), childE.text());
-        } else if (childE.tagName() == QLatin1String("UpdateFile")) {
-            info.data[QLatin1String("CompressedSize")] = childE.attribute(QLatin1String("CompressedSize"));
-            info.data[QLatin1String("UncompressedSize")] = childE.attribute(QLatin1String("UncompressedSize"));
+                attributes.value(QLatin1String("inheritVersionFrom")).toString());
+            info.data[tagName] = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+        } else if (tagName == QLatin1String("DisplayName")) {
+            processLocalizedTag(tagName, attributes.value(QLatin1String("xml:lang")).toString(),
+                reader.readElementText(QXmlStreamReader::IncludeChildElements), info.data);
+        } else if (tagName == QLatin1String("Description")) {
+            const QString text = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            if (!attributes.hasAttribute(QLatin1String("xml:lang")))
+                info.data[QLatin1String("Description")] = text;
+            QString languageAttribute = attributes.hasAttribute(QLatin1String("xml:lang"))
+                ? attributes.value(QLatin1String("xml:lang")).toString() : QLatin1String("en");
+            localizedDescriptions.insert(languageAttribute.toLower(), text);
+        } else if (tagName == QLatin1String("UpdateFile")) {
+            info.data[QLatin1String("CompressedSize")] =
+                attributes.value(QLatin1String("CompressedSize")).toString();
+            info.data[QLatin1String("UncompressedSize")] =
+                attributes.value(QLatin1String("UncompressedSize")).toString();
+            reader.skipCurrentElement();
         } else {
-            info.data[childE.tagName()] = childE.text();
+            info.data[tagName] = reader.readElementText(QXmlStreamReader::IncludeChildElements);
         }
     }
 
-    QStringList candidates;
-    foreach (const QString &lang, QLocale().uiLanguages())
-        candidates << QInstaller::localeCandidates(lang.toLower());
-    foreach (const QString &candidate, candidates) {
-        if (localizedDescriptions.contains(candidate)) {
-            info.data[QLatin1String("Description")] = localizedDescriptions.value(candidate);
-            break;
+    if (!localizedDescriptions.isEmpty()) {
+        QStringList candidates;
+        foreach (const QString &lang, QLocale().uiLanguages())
+            candidates << QInstaller::localeCandidates(lang.toLower());
+        foreach (const QString &candidate, candidates) {
+            if (localizedDescriptions.contains(candidate)) {
+                info.data[QLatin1String("Description")] = localizedDescriptions.value(candidate);
+                break;
+            }
         }
     }
 
-    if (!info.data.contains(QLatin1String("Name"))) {
-        setInvalidContentError(tr("PackageUpdate element without Name"));
-        return false;
-    }
-    if (!info.data.contains(QLatin1String("Version"))) {
-        setInvalidContentError(tr("PackageUpdate element without Version"));
-        return false;
-    }
-    if (!info.data.contains(QLatin1String("ReleaseDate"))) {
-        setInvalidContentError(tr("PackageUpdate element without ReleaseDate"));
-        return false;
-    }
-
     updateInfoList.append(info);
-    return true;
+
+    if (!info.data.contains(QLatin1String("Name")))
+        return tr("PackageUpdate element without Name");
+    if (!info.data.contains(QLatin1String("Version")))
+        return tr("PackageUpdate element without Version");
+    if (!info.data.contains(QLatin1String("ReleaseDate")))
+        return tr("PackageUpdate element without ReleaseDate");
+    return QString();
 }
 
-void UpdatesInfoData::processLocalizedTag(const QDomElement &childE, QHash<QString, QVariant> &info) const
+/*
+    Reads the Repository children of the RepositoryUpdate element the \a reader is positioned
+    at. Their attributes and line number end up in the repository update list.
+*/
+void UpdatesInfoData::parseRepositoryUpdateElement(QXmlStreamReader &reader)
 {
-    QString languageAttribute = childE.attribute(QLatin1String("xml:lang")).toLower();
-    if (!info.contains(childE.tagName()) && (languageAttribute.isEmpty()))
-        info[childE.tagName()] = childE.text();
+    while (reader.readNextStartElement()) {
+        if (reader.name() == QLatin1String("Repository")) {
+            UpdateInfo info;
+            foreach (const QXmlStreamAttribute &attribute, reader.attributes())
+                info.data.insert(attribute.qualifiedName().toString(), attribute.value().toString());
+            info.data.insert(QLatin1String("LineNumber"), reader.lineNumber());
+            repositoryUpdateList.append(info);
+        }
+        reader.skipCurrentElement();
+    }
+}
+
+void UpdatesInfoData::processLocalizedTag(const QString &tagName, const QString &language,
+    const QString &text, QHash<QString, QVariant> &info) const
+{
+    const QString languageAttribute = language.toLower();
+    if (!info.contains(tagName) && (languageAttribute.isEmpty()))
+        info[tagName] = text;
 
     // overwrite default if we have a language specific description
     if (QLocale().name().startsWith(languageAttribute, Qt::CaseInsensitive))
-        info[childE.tagName()] = childE.text();
+        info[tagName] = text;
 }
 
 
@@ -215,19 +283,57 @@ QString UpdatesInfo::errorString() const
     return d->errorMessage;
 }
 
+UpdatesInfo::Error UpdatesInfo::error() const
+{
+    return static_cast<Error>(d->error);
+}
+
 void UpdatesInfo::setFileName(const QString &updateXmlFile)
 {
     if (d->updateXmlFile == updateXmlFile)
         return;
 
+    const QFileInfo fileInfo(updateXmlFile);
+    {
+        QMutexLocker _(&parsedFiles->mutex);
+        const ParsedFile parsed = parsedFiles->files.take(fileInfo.absoluteFilePath());
+        if (parsed.size == fileInfo.size() && parsed.lastModified == fileInfo.lastModified()) {
+            d = parsed.info.d;
+            return;
+        }
+    }
+
     d->applicationName.clear();
     d->applicationVersion.clear();
+    d->checksum.clear();
+    d->sha1.clear();
+    d->metadataName.clear();
     d->updateInfoList.clear();
+    d->repositoryUpdateList.clear();
 
     d->updateXmlFile = updateXmlFile;
     d->parseFile(d->updateXmlFile);
 }
 
+/*!
+    Keeps the already parsed \a info, so that the next UpdatesInfo reading the same file does not
+    need to parse it again. The file must not change in between, otherwise it gets read again.
+*/
+void UpdatesInfo::keepForNextRead(const UpdatesInfo &info)
+{
+    if (info.d->updateXmlFile.isEmpty())
+        return;
+
+    const QFileInfo fileInfo(info.d->updateXmlFile);
+    ParsedFile parsed;
+    parsed.info = info;
+    parsed.size = fileInfo.size();
+    parsed.lastModified = fileInfo.lastModified();
+
+    QMutexLocker _(&parsedFiles->mutex);
+    parsedFiles->files.insert(fileInfo.absoluteFilePath(), parsed);
+}
+
 QString UpdatesInfo::fileName() const
 {
     return d->updateXmlFile;
@@ -243,6 +349,33 @@ QString UpdatesInfo::applicationVersion() const
     return d->applicationVersion;
 }
 
+/*!
+    Returns the text of the Checksum element, or a null string if there is none.
+*/
+QString UpdatesInfo::checksum() const
+{
+    return d->checksum;
+}
+
+QString UpdatesInfo::sha1() const
+{
+    return d->sha1;
+}
+
+QString UpdatesInfo::metadataName() const
+{
+    return d->metadataName;
+}
+
+/*!
+    Returns the Repository elements of the RepositoryUpdate element, holding their attributes
+    and LineNumber.
+*/
+QList<UpdateInfo> UpdatesInfo::repositoryUpdates() const
+{
+    return d->repositoryUpdateList;
+}
+
 int UpdatesInfo::updateInfoCount() const
 {
     return d->updateInfoList.count();
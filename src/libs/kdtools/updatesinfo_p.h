@@ -72,10 +72,17 @@ public:
     QString applicationName() const;
     QString applicationVersion() const;
 
+    QString checksum() const;
+    QString sha1() const;
+    QString metadataName() const;
+    QList<UpdateInfo> repositoryUpdates() const;
+
     int updateInfoCount() const;
     UpdateInfo updateInfo(int index) const;
     QList<UpdateInfo> updatesInfo() const;
 
+    static void keepForNextRead(const UpdatesInfo &info);
+
 private:
     QSharedDataPointer<UpdatesInfoData> d;
 };
@@ -32,7 +32,7 @@
 #include <QCoreApplication>
 #include <QSharedData>
 
-QT_FORWARD_DECLARE_CLASS(QDomElement)
+QT_FORWARD_DECLARE_CLASS(QXmlStreamReader)
 
 namespace KDUpdater {
 
@@ -51,15 +51,21 @@ public:
     QString updateXmlFile;
     QString applicationName;
     QString applicationVersion;
+    QString checksum;
+    QString sha1;
+    QString metadataName;
     QList<UpdateInfo> updateInfoList;
+    QList<UpdateInfo> repositoryUpdateList;
 
     void parseFile(const QString &updateXmlFile);
-    bool parsePackageUpdateElement(const QDomElement &updateE);
+    QString parsePackageUpdateElement(QXmlStreamReader &reader);
+    void parseRepositoryUpdateElement(QXmlStreamReader &reader);
 
     void setInvalidContentError(const QString &detail);
 
 private:
-    void processLocalizedTag(const QDomElement &childE, QHash<QString, QVariant> &info) const;
+    void processLocalizedTag(const QString &tagName, const QString &language, const QString &text,
+        QHash<QString, QVariant> &info) const;
 };
 
 } // namespace KDUpdater
@@ -0,0 +1,150 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "version.h"
+
+using namespace KDUpdater;
+
+static inline bool isSeparator(QChar c)
+{
+    return c == QLatin1Char('.') || c == QLatin1Char('-') || c == QLatin1Char('_');
+}
+
+static inline bool isWildcard(bool isNumber, const QStringRef &segment)
+{
+    return !isNumber && segment == QLatin1String("x");
+}
+
+/*!
+   \inmodule kdupdater
+   \class KDUpdater::Version
+   \brief The Version class holds a version string split into its segments.
+
+   Comparing version strings with KDUpdater::compareVersion() splits both strings on every call.
+   A Version splits the string once, on construction, into the segments separated by \c{.},
+   \c{-} or \c{_} and converts the numeric ones. Comparing two Version objects gives the same
+   result as KDUpdater::compareVersion() for their strings, but does not allocate.
+*/
+
+/*!
+   Creates a version from the string \a version.
+*/
+Version::Version(const QString &version)
+    : m_version(version)
+{
+    const int size = m_version.size();
+    int position = 0;
+    for (int i = 0; i <= size; ++i) {
+        if (i < size && !isSeparator(m_version.at(i)))
+            continue;
+
+        Segment segment;
+        segment.position = position;
+        segment.length = i - position;
+        segment.number = m_version.midRef(position, segment.length).toLongLong(&segment.isNumber);
+        m_segments.append(segment);
+        position = i + 1;
+    }
+}
+
+/*!
+   \fn QString KDUpdater::Version::toString() const
+
+   Returns the version string this version was created from.
+*/
+
+/*!
+   \fn bool KDUpdater::Version::isEmpty() const
+
+   Returns \c true if the version string is empty.
+*/
+
+/*!
+   Compares \a v1 with \a v2 and returns -1, 0 or +1 like KDUpdater::compareVersion().
+*/
+int Version::compare(const Version &v1, const Version &v2)
+{
+    if (v1.m_version == v2.m_version)
+        return 0;
+
+    const int count1 = v1.m_segments.count();
+    const int count2 = v2.m_segments.count();
+    for (int index = 0; index < count1 && index < count2; ++index) {
+        QStringRef c1 = v1.segment(index);
+        QStringRef c2 = v2.segment(index);
+        bool ok1 = v1.m_segments.at(index).isNumber;
+        bool ok2 = v2.m_segments.at(index).isNumber;
+        qlonglong n1 = v1.m_segments.at(index).number;
+        qlonglong n2 = v2.m_segments.at(index).number;
+
+        if (isWildcard(ok1, c1) || isWildcard(ok2, c2))
+            return 0;
+
+        if (!ok1 && !ok2) {
+            // remove the equal start, the rest might be numeric ("rc2" and "rc11")
+            int i = 0;
+            while (i < c1.size() && i < c2.size() && c1.at(i) == c2.at(i))
+                ++i;
+            if (i > 0) {
+                c1 = c1.mid(i);
+                c2 = c2.mid(i);
+                n1 = c1.toLongLong(&ok1);
+                n2 = c2.toLongLong(&ok2);
+                if (isWildcard(ok1, c1) || isWildcard(ok2, c2))
+                    return 0;
+            }
+        }
+
+        if (!ok1 || !ok2) {
+            const int res = c1.compare(c2);
+            if (res == 0)
+                continue;
+            return res > 0 ? +1 : -1;
+        }
+
+        if (n1 < n2)
+            return -1;
+        if (n1 > n2)
+            return +1;
+    }
+
+    // the longer version wins if its next segment is numeric
+    if (count1 < count2)
+        return v2.m_segments.at(count1).isNumber ? -1 : +1;
+    if (count1 > count2)
+        return v1.m_segments.at(count2).isNumber ? +1 : -1;
+
+    return 0;
+}
+
+QStringRef Version::segment(int index) const
+{
+    const Segment &s = m_segments.at(index);
+    return m_version.midRef(s.position, s.length);
+}
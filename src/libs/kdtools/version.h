@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef VERSION_H
+#define VERSION_H
+
+#include "kdtoolsglobal.h"
+
+#include <QString>
+#include <QVarLengthArray>
+
+namespace KDUpdater {
+
+class KDTOOLS_EXPORT Version
+{
+public:
+    explicit Version(const QString &version = QString());
+
+    QString toString() const { return m_version; }
+    bool isEmpty() const { return m_version.isEmpty(); }
+
+    static int compare(const Version &v1, const Version &v2);
+
+private:
+    struct Segment
+    {
+        int position;
+        int length;
+        bool isNumber;
+        qlonglong number;
+    };
+
+    QStringRef segment(int index) const;
+
+private:
+    QString m_version;
+    QVarLengthArray<Segment, 6> m_segments;
+};
+
+inline bool operator==(const Version &v1, const Version &v2) { return Version::compare(v1, v2) == 0; }
+inline bool operator!=(const Version &v1, const Version &v2) { return Version::compare(v1, v2) != 0; }
+inline bool operator<(const Version &v1, const Version &v2) { return Version::compare(v1, v2) < 0; }
+inline bool operator<=(const Version &v1, const Version &v2) { return Version::compare(v1, v2) <= 0; }
+inline bool operator>(const Version &v1, const Version &v2) { return Version::compare(v1, v2) > 0; }
+inline bool operator>=(const Version &v1, const Version &v2) { return Version::compare(v1, v2) >= 0; }
+
+} // namespace KDUpdater
+
+#endif // VERSION_H
@@ -26,18 +26,23 @@
 **
 **************************************************************************/
 
+#include <lib7z_create.h>
+#include <lib7z_facade.h>
 #include <protocol.h>
 #include <qprocesswrapper.h>
 #include <qsettingswrapper.h>
 #include <remoteclient.h>
 #include <remotefileengine.h>
+#include <remotefileoperations.h>
 #include <remoteserver.h>
 
 #include <QBuffer>
+#include <QDir>
 #include <QSettings>
 #include <QLocalSocket>
 #include <QTest>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QUuid>
 #include <QLocalServer>
@@ -231,6 +236,105 @@ private slots:
         }
     }
 
+    void testCommandCodes()
+    {
+        for (int i = 1; i < int(Protocol::Command::Count); ++i) {
+            const Protocol::Command command = Protocol::Command(i);
+            const QByteArray name(Protocol::commandName(command));
+            QVERIFY2(name.size() > 1, name.constData());
+            QCOMPARE(int(Protocol::commandFromName(name)), i);
+            QCOMPARE(int(Protocol::decodeCommand(name)), i);
+            QCOMPARE(int(Protocol::decodeCommand(Protocol::encodeCommand(command))), i);
+            QCOMPARE(Protocol::encodeCommand(command).size(), 1);
+        }
+
+        QCOMPARE(QByteArray(Protocol::commandName(Protocol::Command::Reply)),
+            QByteArray(Protocol::Reply));
+        QCOMPARE(QByteArray(Protocol::commandName(Protocol::Command::QProcessSetNativeArguments)),
+            QByteArray(Protocol::QProcessSetNativeArguments));
+        QCOMPARE(QByteArray(Protocol::commandName(Protocol::Command::QSettingsApplicationName)),
+            QByteArray(Protocol::QSettingsApplicationName));
+        QCOMPARE(QByteArray(Protocol::commandName(Protocol::Command::QAbstractFileEngineWriteRaw)),
+            QByteArray(Protocol::QAbstractFileEngineWriteRaw));
+        QCOMPARE(QByteArray(Protocol::commandName(Protocol::Command::FileOperationsCancel)),
+            QByteArray(Protocol::FileOperationsCancel));
+
+        QVERIFY(Protocol::commandGroup(Protocol::Command::GetQProcessSignals)
+            == Protocol::CommandGroup::General);
+        QVERIFY(Protocol::commandGroup(Protocol::Command::QProcessKill)
+            == Protocol::CommandGroup::QProcess);
+        QVERIFY(Protocol::commandGroup(Protocol::Command::QSettingsValue)
+            == Protocol::CommandGroup::QSettings);
+        QVERIFY(Protocol::commandGroup(Protocol::Command::QAbstractFileEngineOpen)
+            == Protocol::CommandGroup::QAbstractFileEngine);
+        QVERIFY(Protocol::commandGroup(Protocol::Command::FileOperationsCopyFile)
+            == Protocol::CommandGroup::FileOperations);
+
+        QVERIFY(Protocol::decodeCommand(QByteArray("QProcess::unknown"))
+            == Protocol::Command::Invalid);
+        QVERIFY(Protocol::decodeCommand(QByteArray()) == Protocol::Command::Invalid);
+        QVERIFY(Protocol::decodeCommand(QByteArray(1, char(0xff))) == Protocol::Command::Invalid);
+    }
+
+    void testServerConnectVersioned()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QString("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        QLocalSocket socket;
+        socket.connectToServer(socketName);
+        QVERIFY2(socket.waitForConnected(), "Cannot connect to server.");
+
+        {
+            QByteArray data;
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream << QString::fromLatin1("SomeKey") << Protocol::Version;
+            sendPacket(&socket, Protocol::AuthorizeVersioned, data);
+        }
+
+        {
+            QByteArray command;
+            QByteArray data;
+            while (!receivePacket(&socket, &command, &data))
+                socket.waitForReadyRead(-1);
+            QCOMPARE(command, QByteArray(Protocol::Reply));
+
+            bool authorized = false;
+            quint32 version = 0;
+            QDataStream stream(&data, QIODevice::ReadOnly);
+            stream >> authorized >> version;
+            QCOMPARE(authorized, true);
+            QCOMPARE(version, Protocol::Version);
+        }
+
+
+        QLocalSocket socket2;
+        socket2.connectToServer(socketName);
+        QVERIFY2(socket2.waitForConnected(), "Cannot connect to server.");
+
+        {
+            QByteArray data;
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream << QString::fromLatin1("WrongKey") << Protocol::Version;
+            sendPacket(&socket2, Protocol::AuthorizeVersioned, data);
+        }
+
+        {
+            QByteArray command;
+            QByteArray data;
+            while (!receivePacket(&socket2, &command, &data))
+                socket2.waitForReadyRead(-1);
+            QCOMPARE(command, QByteArray(Protocol::Reply));
+
+            bool authorized = true;
+            QDataStream stream(&data, QIODevice::ReadOnly);
+            stream >> authorized;
+            QCOMPARE(authorized, false);
+        }
+    }
+
     void testServerConnectRelease()
     {
         RemoteServer server;
@@ -515,6 +619,142 @@ private slots:
         QCOMPARE(file.atEnd(), true);
     }
 
+    void testRemoteFileEngineBatchedWrites()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+
+        QString filename;
+        {
+            QTemporaryFile file;
+            file.setAutoRemove(false);
+            QCOMPARE(file.open(), true);
+            filename = file.fileName();
+        }
+
+        RemoteFileEngineHandler handler;
+
+        // many small writes are collected, the large one is sent as one bulk request
+        QByteArray expected;
+        {
+            QFile file(filename);
+            QCOMPARE(file.open(QIODevice::WriteOnly | QIODevice::Unbuffered), true);
+            for (int i = 0; i < 10000; ++i) {
+                const QByteArray line = QByteArray::number(i) + '\n';
+                QCOMPARE(file.write(line), qint64(line.size()));
+                expected += line;
+            }
+            const QByteArray block(1024 * 1024, 'x');
+            QCOMPARE(file.write(block), qint64(block.size()));
+            expected += block;
+            QCOMPARE(file.size(), qint64(expected.size()));
+            QCOMPARE(file.flush(), true);
+            file.close();
+        }
+
+        QFile file(filename);
+        QCOMPARE(file.open(QIODevice::ReadOnly), true);
+        QCOMPARE(file.readAll(), expected);
+        file.close();
+        QVERIFY(file.remove());
+    }
+
+    void testRemoteFileOperations()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        const QString source = dir.path() + QLatin1String("/source.txt");
+        {
+            QFile file(source);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("Source File.");
+        }
+
+        const QString archivePath = dir.path() + QLatin1String("/archive.7z");
+        {
+            Lib7z::initSevenZ();
+            QFile archive(archivePath);
+            QVERIFY(archive.open(QIODevice::ReadWrite));
+            Lib7z::createArchive(&archive, QStringList() << source);
+        }
+
+        RemoteFileOperations operations;
+        QVERIFY(operations.isAvailable());
+
+        QSignalSpy progressSpy(&operations, &RemoteFileOperations::progressChanged);
+        const QString target = dir.path() + QLatin1String("/target");
+        RemoteFileOperations::ExtractResult result = operations.extractArchive(archivePath, target);
+        QVERIFY2(result.success, qPrintable(result.errorString));
+        QCOMPARE(result.extractedFiles, QStringList()
+            << QDir::toNativeSeparators(target + QLatin1String("/source.txt")));
+        QCOMPARE(result.backupFiles.count(), 0);
+        QVERIFY(progressSpy.count() > 0);
+
+        // extracting again moves the existing file out of the way
+        result = operations.extractArchive(archivePath, target);
+        QVERIFY2(result.success, qPrintable(result.errorString));
+        QCOMPARE(result.backupFiles.count(), 1);
+        QVERIFY(QFile::exists(result.backupFiles.first().second));
+
+        result = operations.extractArchive(dir.path() + QLatin1String("/missing.7z"), target);
+        QCOMPARE(result.success, false);
+        QVERIFY(!result.errorString.isEmpty());
+
+        const QString copy = dir.path() + QLatin1String("/copy.txt");
+        QString errorString;
+        QVERIFY(operations.copyFile(source, copy, &errorString));
+        QVERIFY(!operations.copyFile(source, copy, &errorString));
+        QVERIFY(!errorString.isEmpty());
+
+        {
+            QFile file(copy);
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.readAll(), QByteArray("Source File."));
+        }
+
+        QVERIFY(operations.setPermissions(QStringList() << copy << source,
+            QFileDevice::ReadOwner | QFileDevice::WriteOwner));
+        QVERIFY(!(QFile::permissions(copy) & QFileDevice::ExeOwner));
+        QVERIFY(!operations.setPermissions(QStringList() << dir.path() + QLatin1String("/missing"),
+            QFileDevice::ReadOwner));
+    }
+
+    void benchmarkRemoteCalls()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+
+        QSettingsWrapper wrapper("digia", "clientserver");
+        wrapper.setValue("benchmark", 42);
+        QCOMPARE(wrapper.isConnectedToServer(), true);
+
+        // One iteration is 1000 round trips over the local socket.
+        QBENCHMARK {
+            for (int i = 0; i < 1000; ++i)
+                wrapper.contains("benchmark");
+        }
+        wrapper.remove("benchmark");
+    }
+
     void cleanupTestCase()
     {
         RemoteClient::instance().setActive(false);
@@ -30,12 +30,133 @@
 
 #include <component.h>
 #include <packagemanagercore.h>
+#include <updateoperations.h>
 
+#include <QCryptographicHash>
+#include <QDirIterator>
 #include <QLoggingCategory>
+#include <QMessageBox>
+#include <QMutex>
+#include <QTemporaryDir>
 #include <QTest>
+#include <QThread>
 
 using namespace QInstaller;
 
+// Records when operations run and in which order they are undone, shared by all probes.
+struct OperationLog
+{
+    QMutex mutex;
+    int concurrentRunning = 0;
+    bool exclusiveRunning = false;
+    bool overlapped = false;
+    QStringList undone;
+};
+
+static OperationLog *operationLog()
+{
+    static OperationLog log;
+    return &log;
+}
+
+// Copies the install packages repository to \a target, so that single archives can be broken.
+static void copyInstallPackagesRepository(const QString &target)
+{
+    const QString source = QLatin1String(":///data/installPackagesRepository");
+    QDirIterator it(source, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString fileName = it.next();
+        const QString targetName = target + fileName.mid(source.length());
+        QVERIFY(QDir().mkpath(QFileInfo(targetName).absolutePath()));
+        QVERIFY(QFile::copy(fileName, targetName));
+    }
+}
+
+// Writes the .sha1 file next to every archive in \a repository, a wrong one for \a broken.
+static void writeArchiveHashes(const QString &repository, const QString &broken)
+{
+    QDirIterator it(repository, QStringList() << QLatin1String("*.7z"), QDir::Files,
+        QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QFile archive(it.next());
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QByteArray hash = QCryptographicHash::hash(archive.readAll(), QCryptographicHash::Sha1);
+        if (archive.fileName().contains(broken))
+            hash = QCryptographicHash::hash(QByteArray("broken"), QCryptographicHash::Sha1);
+
+        QFile hashFile(archive.fileName() + QLatin1String(".sha1"));
+        QVERIFY(hashFile.open(QIODevice::WriteOnly));
+        hashFile.write(hash.toHex());
+    }
+}
+
+// Not known to the installer, so it has to run exclusively like any script or plugin operation.
+class ExclusiveProbeOperation : public KDUpdater::UpdateOperation
+{
+public:
+    explicit ExclusiveProbeOperation(PackageManagerCore *core)
+        : KDUpdater::UpdateOperation(core)
+    {
+        setName(QLatin1String("ExclusiveProbe"));
+    }
+
+    void backup() {}
+    bool performOperation()
+    {
+        OperationLog *log = operationLog();
+        {
+            QMutexLocker _(&log->mutex);
+            if (log->exclusiveRunning || log->concurrentRunning > 0)
+                log->overlapped = true;
+            log->exclusiveRunning = true;
+        }
+        QThread::msleep(20);
+        QMutexLocker _(&log->mutex);
+        log->exclusiveRunning = false;
+        return true;
+    }
+    bool undoOperation()
+    {
+        QMutexLocker _(&operationLog()->mutex);
+        operationLog()->undone.append(name() + QLatin1Char(':') + arguments().value(0));
+        return true;
+    }
+    bool testOperation() { return true; }
+};
+
+// A real Mkdir, which may run next to other operations, that notes when it runs.
+class ConcurrentProbeOperation : public KDUpdater::MkdirOperation
+{
+public:
+    explicit ConcurrentProbeOperation(PackageManagerCore *core)
+        : KDUpdater::MkdirOperation(core)
+    {}
+
+    bool performOperation()
+    {
+        OperationLog *log = operationLog();
+        {
+            QMutexLocker _(&log->mutex);
+            if (log->exclusiveRunning)
+                log->overlapped = true;
+            ++log->concurrentRunning;
+        }
+        QThread::msleep(20);
+        const bool result = KDUpdater::MkdirOperation::performOperation();
+        QMutexLocker _(&log->mutex);
+        --log->concurrentRunning;
+        return result;
+    }
+    bool undoOperation()
+    {
+        {
+            QMutexLocker _(&operationLog()->mutex);
+            operationLog()->undone.append(name() + QLatin1Char(':') + arguments().value(0));
+        }
+        return KDUpdater::MkdirOperation::undoOperation();
+    }
+};
+
 class tst_CLIInterface : public QObject
 {
     Q_OBJECT
@@ -227,6 +348,140 @@ private slots:
                             << "installcontentD.txt"<< "installcontentE.txt" << "installcontentG.txt");
     }
 
+    void testInstallWithDependencyConcurrently()
+    {
+        qputenv("IFW_PARALLEL_INSTALLATION", "4");
+        PackageManagerCore *core = PackageManager::getPackageManagerWithInit
+                (m_installDir, ":///data/installPackagesRepository");
+        const bool success = core->installSelectedComponentsSilently(QStringList()
+                << QLatin1String("componentC") << QLatin1String("componentF"));
+        qunsetenv("IFW_PARALLEL_INSTALLATION");
+        QVERIFY(success);
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentA", "1.0.0content.txt"); //Dependency for componentC
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentB", "1.0.0content.txt"); //Dependency for componentC
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentC", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentD", "1.0.0content.txt"); //Autodepend on componentA and componentB
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentF", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentF.subcomponent1", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentF.subcomponent2", "1.0.0content.txt");
+        VerifyInstaller::verifyFileExistence(m_installDir, QStringList() << "components.xml" << "installcontentC.txt"
+                            << "installcontent.txt" << "installcontentA.txt" << "installcontentB.txt"
+                            << "installcontentD.txt"<< "installcontentE.txt" << "installcontentG.txt");
+    }
+
+    void testRollBackConcurrentInstallation()
+    {
+        qputenv("IFW_PARALLEL_INSTALLATION", "4");
+        PackageManagerCore *core = PackageManager::getPackageManagerWithInit
+                (m_installDir, ":///data/installPackagesRepository");
+
+        // every component gets a Mkdir and an unknown operation in front of its own ones
+        QStringList expectedUndoOrder;
+        connect(core, &PackageManagerCore::installationStarted, this,
+            [this, core, &expectedUndoOrder]() {
+                foreach (Component *component, core->orderedComponentsToInstall()) {
+                    const QString directory = m_installDir + QLatin1Char('/') + component->name()
+                        + QLatin1String("_probe");
+                    Operation *mkdir = new ConcurrentProbeOperation(core);
+                    mkdir->setArguments(QStringList() << directory);
+                    component->addOperation(mkdir);
+                    Operation *exclusive = new ExclusiveProbeOperation(core);
+                    exclusive->setArguments(QStringList() << component->name());
+                    component->addOperation(exclusive);
+                    expectedUndoOrder.prepend(QLatin1String("Mkdir:") + directory);
+                    expectedUndoOrder.prepend(QLatin1String("ExclusiveProbe:")
+                        + component->name());
+                }
+            });
+
+        const bool success = core->installSelectedComponentsSilently(QStringList()
+                << QLatin1String("componentC") << QLatin1String("componentF"));
+        qunsetenv("IFW_PARALLEL_INSTALLATION");
+        QVERIFY(success);
+        QVERIFY(expectedUndoOrder.count() > 2);
+        QVERIFY(!operationLog()->overlapped);
+
+        // the undo order is the reverse of the component order, no matter which thread was faster
+        core->rollBackInstallation();
+        QCOMPARE(operationLog()->undone, expectedUndoOrder);
+        operationLog()->undone.clear();
+        core->deleteLater();
+    }
+
+    void testInstallWhileDownloading()
+    {
+        qputenv("IFW_PIPELINED_INSTALLATION", "1");
+        PackageManagerCore *core = PackageManager::getPackageManagerWithInit
+                (m_installDir, ":///data/installPackagesRepository");
+        const bool success = core->installSelectedComponentsSilently(QStringList()
+                << QLatin1String("componentC"));
+        qunsetenv("IFW_PIPELINED_INSTALLATION");
+        QVERIFY(success);
+        // every component waited for its own archives before it got installed
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentA", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentB", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentC", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentD", "1.0.0content.txt");
+        VerifyInstaller::verifyFileExistence(m_installDir, QStringList() << "components.xml" << "installcontentC.txt"
+                            << "installcontent.txt" << "installcontentA.txt" << "installcontentB.txt"
+                            << "installcontentD.txt"<< "installcontentE.txt" << "installcontentG.txt");
+        core->deleteLater();
+    }
+
+    void testInstallWhileDownloadingFails()
+    {
+        QTemporaryDir repository;
+        QVERIFY(repository.isValid());
+        copyInstallPackagesRepository(repository.path());
+        writeArchiveHashes(repository.path(), QLatin1String("componentD"));
+
+        qputenv("IFW_PIPELINED_INSTALLATION", "1");
+        PackageManagerCore *core = PackageManager::getPackageManagerWithInit
+                (m_installDir, repository.path());
+        core->setTestChecksum(true);
+        core->setMessageBoxAutomaticAnswer(QLatin1String("DownloadError"), QMessageBox::Cancel);
+        const bool success = core->installSelectedComponentsSilently(QStringList()
+                << QLatin1String("componentC"));
+        qunsetenv("IFW_PIPELINED_INSTALLATION");
+        QVERIFY(!success);
+        QCOMPARE(core->status(), PackageManagerCore::Failure);
+
+        // the components installed before the download error are rolled back
+        foreach (const QString &fileName, QStringList() << "installcontentA.txt"
+                << "installcontentB.txt" << "installcontentC.txt" << "installcontentD.txt") {
+            QVERIFY2(!QFileInfo::exists(m_installDir + QLatin1Char('/') + fileName),
+                qPrintable(fileName));
+        }
+        core->deleteLater();
+    }
+
+    void testInstallWhileDownloadingCanceled()
+    {
+        QTemporaryDir repository;
+        QVERIFY(repository.isValid());
+        copyInstallPackagesRepository(repository.path());
+        QVERIFY(QFile::remove(repository.path()
+            + QLatin1String("/componentD/1.0.0content.7z")));
+
+        qputenv("IFW_PIPELINED_INSTALLATION", "1");
+        PackageManagerCore *core = PackageManager::getPackageManagerWithInit
+                (m_installDir, repository.path());
+        core->setMessageBoxAutomaticAnswer(QLatin1String("archiveDownloadError"),
+            QMessageBox::Cancel);
+        const bool success = core->installSelectedComponentsSilently(QStringList()
+                << QLatin1String("componentC"));
+        qunsetenv("IFW_PIPELINED_INSTALLATION");
+        QVERIFY(!success);
+        QCOMPARE(core->status(), PackageManagerCore::Canceled);
+
+        foreach (const QString &fileName, QStringList() << "installcontentA.txt"
+                << "installcontentB.txt" << "installcontentC.txt" << "installcontentD.txt") {
+            QVERIFY2(!QFileInfo::exists(m_installDir + QLatin1Char('/') + fileName),
+                qPrintable(fileName));
+        }
+        core->deleteLater();
+    }
+
     void testUninstallWithDependencySilently()
     {
         PackageManagerCore *core = PackageManager::getPackageManagerWithInit
@@ -27,9 +27,12 @@
 **************************************************************************/
 
 #include "updater.h"
+#include "version.h"
 
 #include <QTest>
 
+using namespace KDUpdater;
+
 class tst_CompareVersion : public QObject
 {
     Q_OBJECT
@@ -39,6 +42,12 @@ private slots:
     void compareVersionX();
     void compareVersionAll();
     void compareVersionExtra();
+
+    void versionObject_data();
+    void versionObject();
+
+    void benchmarkCompare_data();
+    void benchmarkCompare();
 };
 
 void tst_CompareVersion::compareVersion()
@@ -92,6 +101,94 @@ void tst_CompareVersion::compareVersionExtra()
     QCOMPARE(KDUpdater::compareVersion("OpenSSL_1_1_0f", "OpenSSL_1_0_2k"), +1);
 }
 
+void tst_CompareVersion::versionObject_data()
+{
+    QTest::addColumn<QString>("v1");
+    QTest::addColumn<QString>("v2");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("less") << "2.0" << "2.1" << -1;
+    QTest::newRow("equal") << "2.1" << "2.1" << 0;
+    QTest::newRow("build number") << "2.1" << "2.1-201903190747" << -1;
+    QTest::newRow("build number zero") << "2.1-0" << "2.1-201903190747" << -1;
+    QTest::newRow("four segments") << "2.0.12.4" << "2.1.10.4" << -1;
+    QTest::newRow("leading zero") << "2.01" << "2.1" << 0;
+    QTest::newRow("empty") << "" << "1" << -1;
+    QTest::newRow("empty segment") << "2..1" << "2.0.1" << -1;
+    QTest::newRow("trailing text") << "2.0" << "2.0.beta" << +1;
+
+    QTest::newRow("wildcard") << "2.0" << "2.x" << 0;
+    QTest::newRow("wildcard deeper") << "2.0.12.x" << "2.0.x" << 0;
+    QTest::newRow("wildcard greater") << "2.1.12.x" << "2.0.x" << +1;
+    QTest::newRow("wildcard shorter") << "2.x" << "2.1.12.x" << 0;
+    QTest::newRow("wildcard after prefix") << "v2.0-ax" << "v2.0-a1" << 0;
+
+    QTest::newRow("text") << "version-1" << "version-2" << -1;
+    QTest::newRow("prefix wildcard") << "v2.0" << "v2.x" << 0;
+    QTest::newRow("alpha beta") << "v2.0-alpha" << "v2.0-beta" << -1;
+    QTest::newRow("rc beta") << "v2.0-rc1" << "v2.0-beta" << +1;
+    QTest::newRow("rc numeric") << "v2.0-rc2" << "v2.0-rc11" << -1;
+    QTest::newRow("rc release") << "v2.0" << "v2.0-rc3" << +1;
+    QTest::newRow("common prefix only") << "v2.0-alpha" << "v2.0-alphabeta" << -1;
+    QTest::newRow("openssl") << "OpenSSL_1_0_2k" << "OpenSSL_1_0_2l" << -1;
+    QTest::newRow("openssl minor") << "OpenSSL_1_1_0f" << "OpenSSL_1_0_2k" << +1;
+}
+
+void tst_CompareVersion::versionObject()
+{
+    QFETCH(QString, v1);
+    QFETCH(QString, v2);
+    QFETCH(int, expected);
+
+    QCOMPARE(Version::compare(Version(v1), Version(v2)), expected);
+    QCOMPARE(KDUpdater::compareVersion(v1, v2), expected);
+
+    // the same objects compare the same way in both directions, every time
+    const Version version1(v1);
+    const Version version2(v2);
+    QCOMPARE(Version::compare(version2, version1), KDUpdater::compareVersion(v2, v1));
+    QCOMPARE(Version::compare(version1, version2), expected);
+    QCOMPARE(version1 == version2, expected == 0);
+    QCOMPARE(version1 < version2, expected < 0);
+    QCOMPARE(version1 > version2, expected > 0);
+    QCOMPARE(version1.toString(), v1);
+}
+
+void tst_CompareVersion::benchmarkCompare_data()
+{
+    QTest::addColumn<bool>("parsed");
+    QTest::newRow("strings") << false;
+    QTest::newRow("parsed") << true;
+}
+
+void tst_CompareVersion::benchmarkCompare()
+{
+    QFETCH(bool, parsed);
+
+    QStringList strings;
+    for (int i = 0; i < 100; ++i) {
+        strings << QString::fromLatin1("5.%1.%2-201903190747").arg(i % 15).arg(i % 7)
+                << QString::fromLatin1("v5.%1.0-rc%2").arg(i % 15).arg(i % 4);
+    }
+    QList<Version> versions;
+    foreach (const QString &string, strings)
+        versions.append(Version(string));
+
+    int result = 0;
+    if (parsed) {
+        QBENCHMARK {
+            for (int i = 0; i < versions.count(); ++i)
+                result += Version::compare(versions.at(i), versions.at(versions.count() - 1 - i));
+        }
+    } else {
+        QBENCHMARK {
+            for (int i = 0; i < strings.count(); ++i)
+                result += KDUpdater::compareVersion(strings.at(i), strings.at(strings.count() - 1 - i));
+        }
+    }
+    Q_UNUSED(result)
+}
+
 QTEST_MAIN(tst_CompareVersion)
 
 #include "tst_compareversion.moc"
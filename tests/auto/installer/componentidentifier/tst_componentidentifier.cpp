@@ -61,6 +61,9 @@ private slots:
     void testPackageManagerCoreSetterGetter();
 
     void testComponentDependencies();
+    void testParsedDependencies();
+    void testComponentIndexUpdates();
+    void testDependeeIndexUpdates();
 };
 
 void tst_ComponentIdentifier::testPackageManagerCoreSetterGetter_data()
@@ -247,6 +250,130 @@ void tst_ComponentIdentifier::testComponentDependencies()
     delete core;
 }
 
+void tst_ComponentIdentifier::testParsedDependencies()
+{
+    PackageManagerCore *core = new PackageManagerCore();
+    core->setPackageManager();
+
+    Component *componentA = new NamedComponent(core, "A");
+    Component *componentB = new NamedComponent(core, "B", "2.0");
+    Component *componentC = new NamedComponent(core, "component-C");
+    core->appendRootComponent(componentA);
+    core->appendRootComponent(componentB);
+    core->appendRootComponent(componentC);
+
+    componentA->setValue(scDependencies, "B:>=1.5, component-C,B:>=1.5");
+    QCOMPARE(componentA->dependencies(), QStringList() << "B:>=1.5" << "component-C" << "B:>=1.5");
+
+    QList<Dependency> dependencies = componentA->parsedDependencies();
+    QCOMPARE(dependencies.count(), 2);
+    QCOMPARE(dependencies.at(0).requirement(), QString("B:>=1.5"));
+    QCOMPARE(dependencies.at(0).name(), QString("B"));
+    QCOMPARE(dependencies.at(0).version(), QString(">=1.5"));
+    QCOMPARE(dependencies.at(0).comparator(), QString(">="));
+    QCOMPARE(dependencies.at(0).requiredVersion().toString(), QString("1.5"));
+    QVERIFY(dependencies.at(0).matches(KDUpdater::Version("2.0")));
+    QVERIFY(!dependencies.at(0).matches(KDUpdater::Version("1.0")));
+    QCOMPARE(dependencies.at(1).name(), QString("component"));
+    QCOMPARE(dependencies.at(1).version(), QString("C"));
+    QCOMPARE(dependencies.at(1).comparator(), QString("="));
+
+    const QHash<QString, QList<Component *> > index = PackageManagerCore::componentsByName(
+        core->components(PackageManagerCore::ComponentType::All));
+    QCOMPARE(PackageManagerCore::componentByName(dependencies.at(0), index), componentB);
+    QCOMPARE(PackageManagerCore::componentByName(Dependency("B", "<2.0"), index),
+        static_cast<Component *>(nullptr));
+    QCOMPARE(core->dependees(componentB), QList<Component *>() << componentA);
+
+    // the parsed list follows changes of the value
+    componentA->addDependency("component-C:");
+    dependencies = componentA->parsedDependencies();
+    QCOMPARE(dependencies.count(), 3);
+    QCOMPARE(dependencies.at(2).name(), QString("component-C"));
+    QVERIFY(dependencies.at(2).version().isEmpty());
+    QCOMPARE(core->dependees(componentC), QList<Component *>() << componentA);
+
+    componentA->setValue(scAutoDependOn, "B-2.0");
+    QCOMPARE(componentA->parsedAutoDependencies().count(), 1);
+    QCOMPARE(componentA->parsedAutoDependencies().first().name(), QString("B"));
+    componentA->setValue(scAutoDependOn, QString());
+    QVERIFY(componentA->parsedAutoDependencies().isEmpty());
+    QVERIFY(componentA->autoDependencies().isEmpty());
+
+    delete core;
+}
+
+void tst_ComponentIdentifier::testComponentIndexUpdates()
+{
+    PackageManagerCore *core = new PackageManagerCore();
+    core->setPackageManager();
+
+    Component *componentA = new NamedComponent(core, "A");
+    core->appendRootComponent(componentA);
+    QCOMPARE(core->componentByName("A"), componentA);
+    QCOMPARE(core->componentByName("A.B"), static_cast<Component *>(nullptr));
+
+    // children appended to an already looked up tree must be found
+    Component *componentB = new NamedComponent(core, "A.B", "2.0.0");
+    componentA->appendComponent(componentB);
+    QCOMPARE(core->componentByName("A.B"), componentB);
+    QCOMPARE(core->componentByName("A.B:>=2.0.0"), componentB);
+    QCOMPARE(core->componentByName("A.B:<2.0.0"), static_cast<Component *>(nullptr));
+
+    componentB->setValue(scName, "A.C");
+    QCOMPARE(core->componentByName("A.B"), static_cast<Component *>(nullptr));
+    QCOMPARE(core->componentByName("A.C"), componentB);
+
+    componentA->removeComponent(componentB);
+    QCOMPARE(core->componentByName("A.C"), static_cast<Component *>(nullptr));
+    delete componentB;
+
+    delete core;
+}
+
+void tst_ComponentIdentifier::testDependeeIndexUpdates()
+{
+    PackageManagerCore *core = new PackageManagerCore();
+    core->setPackageManager();
+
+    Component *componentA = new NamedComponent(core, "A");
+    Component *componentB = new NamedComponent(core, "B", "2.0");
+    Component *componentC = new NamedComponent(core, "C");
+    componentA->addDependency("B");
+    core->appendRootComponent(componentA);
+    core->appendRootComponent(componentB);
+    core->appendRootComponent(componentC);
+
+    QCOMPARE(core->dependees(componentB), QList<Component *>() << componentA);
+    QVERIFY(core->dependees(componentA).isEmpty());
+
+    // dependencies added after the index was built
+    componentC->addDependency("B:>=2.0");
+    componentC->addDependency("A");
+    QCOMPARE(core->dependees(componentB), QList<Component *>() << componentA << componentC);
+    QCOMPARE(core->dependees(componentA), QList<Component *>() << componentC);
+
+    // the version requirement is still checked
+    componentA->setValue(scDependencies, "B:<2.0");
+    QCOMPARE(core->dependees(componentB), QList<Component *>() << componentC);
+
+    // components keep the order of the component tree, not the order of the changes
+    componentA->setValue(scDependencies, "B");
+    QCOMPARE(core->dependees(componentB), QList<Component *>() << componentA << componentC);
+
+    componentC->setValue(scDependencies, QString());
+    QVERIFY(core->dependees(componentB).isEmpty());
+    QVERIFY(core->dependees(componentA).isEmpty());
+
+    // components appended to the tree are picked up as well
+    Component *componentD = new NamedComponent(core, "D");
+    componentD->addDependency("B-2.0");
+    core->appendRootComponent(componentD);
+    QCOMPARE(core->dependees(componentB), QList<Component *>() << componentD);
+
+    delete core;
+}
+
 QTEST_MAIN(tst_ComponentIdentifier)
 
 #include "tst_componentidentifier.moc"
@@ -0,0 +1,8 @@
+include(../../qttest.pri)
+
+QT += network
+
+SOURCES += tst_downloadarchivesjob.cpp
+
+RESOURCES += \
+    settings.qrc
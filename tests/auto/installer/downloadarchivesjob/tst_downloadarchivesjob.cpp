@@ -0,0 +1,236 @@
+/**************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "../shared/delayinghttpserver.h"
+#include "../shared/packagemanager.h"
+
+#include <downloadarchivesjob.h>
+#include <fileutils.h>
+#include <packagemanagercore.h>
+#include <qinstallerglobal.h>
+
+#include <QMessageBox>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+typedef QList<QPair<QString, QString> > ArchiveList;
+
+class tst_DownloadArchivesJob : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Returns \a count archives of \a component named \a prefix<n>.7z, served by \a server.
+    ArchiveList httpArchives(const QString &component, const QString &prefix,
+        const QString &host, const DelayingHttpServer &server, int count)
+    {
+        ArchiveList archives;
+        for (int i = 0; i < count; ++i) {
+            const QString fileName = QString::fromLatin1("%1%2.7z").arg(prefix).arg(i);
+            archives.append(qMakePair(QString::fromLatin1("installer://%1/%2").arg(component,
+                fileName), QString::fromLatin1("http://%1:%2/%3").arg(host)
+                .arg(server.serverPort()).arg(fileName)));
+        }
+        return archives;
+    }
+
+    // Runs \a job until it has finished.
+    void runJob(DownloadArchivesJob *job)
+    {
+        QSignalSpy finished(job, &Job::finished);
+        job->start();
+        QVERIFY(finished.wait(30000));
+        QVERIFY(job->isFinished());
+    }
+
+    // Verifies that \a name is registered and can be read from the installer's file system.
+    void verifyRegisteredArchive(DownloadArchivesJob *job, const QString &name,
+        const QByteArray &content)
+    {
+        QVERIFY2(job->isArchiveDownloaded(name), qPrintable(name));
+        QFile file(name);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(name));
+        QCOMPARE(file.readAll(), content);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_tempDir.isValid());
+        m_core = PackageManager::getPackageManagerWithInit(m_tempDir.path()
+            + QLatin1String("/target"), ":///data/repository");
+        QVERIFY(m_core->fetchRemotePackagesTree());
+        QVERIFY(m_core->componentByName(QLatin1String("componentA")));
+        QVERIFY(m_core->componentByName(QLatin1String("componentB")));
+    }
+
+    void testDownloadThroughWindow()
+    {
+        DelayingHttpServer::Log log;
+        DelayingHttpServer first(QLatin1String("first"), &log);
+        DelayingHttpServer second(QLatin1String("second"), &log);
+        QVERIFY(first.listen(QHostAddress::LocalHost));
+        QVERIFY(second.listen(QHostAddress::Any));
+
+        // all archives of the first host are queued in front of the ones of the second host
+        ArchiveList archives = httpArchives(QLatin1String("componentA"), QLatin1String("window"),
+            QLatin1String("127.0.0.1"), first, 6);
+        archives += httpArchives(QLatin1String("componentB"), QLatin1String("window"),
+            QLatin1String("localhost"), second, 6);
+        for (int i = 0; i < 2; ++i) {
+            QFile file(m_tempDir.path() + QString::fromLatin1("/local%1.7z").arg(i));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(QByteArray::number(i));
+            file.close();
+            archives.append(qMakePair(QString::fromLatin1("installer://componentA/local%1.7z")
+                .arg(i), QUrl::fromLocalFile(file.fileName()).toString()));
+        }
+
+        DownloadArchivesJob job(m_core);
+        job.setAutoDelete(false);
+        job.setArchivesToDownload(archives);
+        job.setMaxConcurrentDownloads(3);
+        job.setMaxConcurrentDownloadsPerHost(2);
+        QSignalSpy downloaded(&job, &DownloadArchivesJob::archiveDownloaded);
+        runJob(&job);
+
+        QCOMPARE(job.error(), int(Job::NoError));
+        QCOMPARE(job.numberOfDownloads(), archives.count());
+        QCOMPARE(downloaded.count(), archives.count());
+
+        QCOMPARE(log.order.count(), 12);
+        QCOMPARE(log.running, 0);
+        QVERIFY(log.peak > 1);
+        QVERIFY(log.peak <= 3);
+        QVERIFY(first.peak() <= 2);
+        QVERIFY(second.peak() <= 2);
+        // the second host gets a slot right away instead of after all archives of the first one
+        QVERIFY(log.order.mid(0, 3).contains(QLatin1String("second")));
+
+        for (int i = 0; i < 6; ++i) {
+            const QByteArray fileName = "/window" + QByteArray::number(i) + ".7z";
+            verifyRegisteredArchive(&job, QLatin1String("installer://componentA") + fileName,
+                fileName);
+            verifyRegisteredArchive(&job, QLatin1String("installer://componentB") + fileName,
+                fileName);
+        }
+        for (int i = 0; i < 2; ++i) {
+            verifyRegisteredArchive(&job, QString::fromLatin1("installer://componentA/local%1.7z")
+                .arg(i), QByteArray::number(i));
+        }
+    }
+
+    void testRetryFailedDownloads()
+    {
+        DelayingHttpServer::Log log;
+        DelayingHttpServer server(QLatin1String("server"), &log);
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        server.failOnce("/retry1.7z");
+        server.failOnce("/retry2.7z");
+
+        const ArchiveList archives = httpArchives(QLatin1String("componentA"),
+            QLatin1String("retry"), QLatin1String("127.0.0.1"), server, 4);
+        m_core->setMessageBoxAutomaticAnswer(QLatin1String("archiveDownloadError"),
+            QMessageBox::Retry);
+
+        DownloadArchivesJob job(m_core);
+        job.setAutoDelete(false);
+        job.setArchivesToDownload(archives);
+        runJob(&job);
+
+        QCOMPARE(job.error(), int(Job::NoError));
+        QCOMPARE(job.numberOfDownloads(), archives.count());
+        QCOMPARE(log.order.count(), archives.count() + 2);
+        for (int i = 0; i < archives.count(); ++i) {
+            const QByteArray fileName = "/retry" + QByteArray::number(i) + ".7z";
+            verifyRegisteredArchive(&job, QLatin1String("installer://componentA") + fileName,
+                fileName);
+        }
+    }
+
+    void testCancelFailedDownload()
+    {
+        DelayingHttpServer::Log log;
+        DelayingHttpServer server(QLatin1String("server"), &log);
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        server.failOnce("/cancel0.7z");
+
+        const ArchiveList archives = httpArchives(QLatin1String("componentA"),
+            QLatin1String("cancel"), QLatin1String("127.0.0.1"), server, 8);
+        m_core->setMessageBoxAutomaticAnswer(QLatin1String("archiveDownloadError"),
+            QMessageBox::Cancel);
+
+        DownloadArchivesJob job(m_core);
+        job.setAutoDelete(false);
+        job.setArchivesToDownload(archives);
+        job.setMaxConcurrentDownloadsPerHost(2);
+        runJob(&job);
+
+        QCOMPARE(job.error(), int(Job::Canceled));
+        QVERIFY(!job.isArchiveDownloaded(QLatin1String("installer://componentA/cancel0.7z")));
+        QVERIFY(job.numberOfDownloads() < archives.count());
+    }
+
+    void testHashMismatch()
+    {
+        DelayingHttpServer::Log log;
+        DelayingHttpServer server(QLatin1String("server"), &log);
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        server.breakHash("/hash1.7z");
+
+        const ArchiveList archives = httpArchives(QLatin1String("componentB"),
+            QLatin1String("hash"), QLatin1String("127.0.0.1"), server, 3);
+        m_core->setTestChecksum(true);
+        m_core->setMessageBoxAutomaticAnswer(QLatin1String("DownloadError"), QMessageBox::Cancel);
+
+        DownloadArchivesJob job(m_core);
+        job.setAutoDelete(false);
+        job.setArchivesToDownload(archives);
+        runJob(&job);
+        m_core->setTestChecksum(false);
+
+        QCOMPARE(job.error(), int(QInstaller::DownloadError));
+        QVERIFY(!job.isArchiveDownloaded(QLatin1String("installer://componentB/hash1.7z")));
+    }
+
+    void cleanupTestCase()
+    {
+        delete m_core;
+    }
+
+private:
+    QTemporaryDir m_tempDir;
+    PackageManagerCore *m_core = nullptr;
+};
+
+QTEST_MAIN(tst_DownloadArchivesJob)
+
+#include "tst_downloadarchivesjob.moc"
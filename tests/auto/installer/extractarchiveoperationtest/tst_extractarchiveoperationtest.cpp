@@ -27,10 +27,17 @@
 **************************************************************************/
 
 #include "init.h"
+#include "binaryformatenginehandler.h"
 #include "extractarchiveoperation.h"
+#include "extractedfilesmanifest.h"
+#include "lib7z_create.h"
+#include "lib7z_list.h"
 
+#include <QBuffer>
+#include <QDataStream>
 #include <QDir>
 #include <QObject>
+#include <QTemporaryDir>
 #include <QTest>
 
 using namespace KDUpdater;
@@ -83,6 +90,185 @@ private slots:
         QCOMPARE(op.errorString(), QString("Error while extracting archive \":///data/invalid.7z\": "
                                            "Cannot open archive \":///data/invalid.7z\"."));
     }
+
+    void testUndoRemovesDirectoriesAfterTheirFiles()
+    {
+        QTemporaryDir target;
+        QVERIFY(target.isValid());
+
+        // directories listed before their files still get removed
+        QStringList files;
+        for (int i = 0; i < 10; ++i) {
+            const QString directory = target.path() + QString("/dir%1").arg(i);
+            files << directory << directory + "/sub";
+            QVERIFY(QDir().mkpath(directory + "/sub"));
+            for (int j = 0; j < 50; ++j) {
+                QFile file(directory + (j % 2 ? "/sub" : "") + QString("/file%1").arg(j));
+                QVERIFY(file.open(QIODevice::WriteOnly));
+                files << QDir::toNativeSeparators(file.fileName());
+            }
+        }
+
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << ":///data/valid.7z" << target.path());
+        op.setValue("files", files);
+
+        QVERIFY(op.undoOperation());
+        QVERIFY(QDir(target.path()).entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty());
+    }
+
+    void testManifest()
+    {
+        const QStringList files = QStringList() << "/opt" << "/opt/app" << "/opt/app/bin"
+            << "/opt/app/bin/app" << "/opt/app/lib/libapp.so" << "/opt/app/lib/libapp.so.1"
+            << QString::fromUtf8("/opt/app/share/\xc3\xa4\xf0\x9f\x98\x80")
+            << QString::fromUtf8("/opt/app/share/\xc3\xa4\xf0\x9f\x98\x81");
+
+        ExtractedFilesManifest first("/opt/app");
+        ExtractedFilesManifest second("/opt/app");
+        for (int i = 0; i < files.count(); ++i)
+            (i < 4 ? first : second).append(files.at(i));
+        first.append(second);
+        QCOMPARE(first.count(), files.count());
+
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::ReadWrite));
+        QVERIFY(first.write(&buffer));
+        QVERIFY(buffer.seek(0));
+
+        // paths inside the target directory follow it when it gets moved
+        ExtractedFilesManifestReader reader(&buffer, "/home/user/app");
+        QCOMPARE(reader.count(), files.count());
+        QStringList read;
+        QString path;
+        while (reader.readNext(&path))
+            read.append(path);
+        QVERIFY(!reader.hasError());
+        QCOMPARE(read, QStringList(files).replaceInStrings(QRegExp("^/opt/app"), "/home/user/app"));
+    }
+
+    void testUndoLegacyDataFile()
+    {
+        QTemporaryDir target;
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << ":///data/valid.7z" << target.path());
+        QVERIFY(op.performOperation());
+        QVERIFY(QFileInfo(target.path() + "/valid").isFile());
+
+        // older versions wrote a serialized string list
+        QFile file(op.value("files").toString());
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QDataStream out(&file);
+        out << (QStringList() << "@RELOCATABLE_PATH@/valid");
+        file.close();
+
+        QVERIFY(op.undoOperation());
+        QVERIFY(!QFileInfo::exists(target.path() + "/valid"));
+        QVERIFY(!file.exists());
+    }
+
+    void testConcurrentExtraction()
+    {
+        QTemporaryDir first;
+        QTemporaryDir second;
+        ExtractArchiveOperation op1(nullptr);
+        op1.setArguments(QStringList() << ":///data/valid.7z" << first.path());
+        ExtractArchiveOperation op2(nullptr);
+        op2.setArguments(QStringList() << ":///data/valid.7z" << second.path() + "/sub");
+
+        ConcurrentArchiveExtractor extractor(OperationList() << &op1 << &op2);
+        extractor.start(&op1);
+        extractor.start(&op2);
+
+        QVERIFY(op1.performOperation());
+        QVERIFY(op2.performOperation());
+        QVERIFY(QFileInfo(first.path() + "/valid").isFile());
+        QVERIFY(QFileInfo(second.path() + "/sub/valid").isFile());
+
+        QVERIFY(op1.undoOperation());
+        QVERIFY(op2.undoOperation());
+        QVERIFY(!QFileInfo::exists(first.path() + "/valid"));
+        QVERIFY(!QFileInfo::exists(second.path() + "/sub/valid"));
+    }
+
+    void testConcurrentExtractionInvalidFile()
+    {
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << ":///data/invalid.7z" << QDir::tempPath());
+
+        ConcurrentArchiveExtractor extractor(OperationList() << &op);
+        extractor.start(&op);
+
+        QVERIFY(!op.performOperation());
+        QVERIFY(op.undoOperation());
+
+        QCOMPARE(UpdateOperation::Error(op.error()), UpdateOperation::UserDefinedError);
+        QCOMPARE(op.errorString(), QString("Error while extracting archive \":///data/invalid.7z\": "
+                                           "Cannot open archive \":///data/invalid.7z\"."));
+    }
+
+    void testConcurrentExtractionOfInstallerResource()
+    {
+        QTemporaryDir source;
+        QStringList files;
+        for (int i = 0; i < 4; ++i) {
+            QFile file(source.path() + QString("/file%1.txt").arg(i));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QVERIFY(file.write(QByteArray(4096, char('a' + i))) == 4096);
+            files << file.fileName();
+        }
+        // stored without compression, every file gets a block of its own
+        const QString archivePath = source.path() + "/archive.7z";
+        Lib7z::createArchive(archivePath, files, Lib7z::TmpFile::No, Lib7z::Compression::Non);
+
+        const QString resourcePath = "installer://component/archive.7z";
+        BinaryFormatEngineHandler::instance()->registerResource(resourcePath, archivePath);
+
+        QFile archive(resourcePath);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QSet<int> blocks;
+        foreach (const Lib7z::File &file, Lib7z::listArchive(&archive))
+            blocks.insert(file.block);
+        archive.close();
+        QVERIFY(blocks.count() > 1);
+
+        // the parts of the archive read the same resource at the same time
+        QTemporaryDir target;
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << resourcePath << target.path());
+        ConcurrentArchiveExtractor extractor(OperationList() << &op);
+        extractor.start(&op);
+
+        QVERIFY2(op.performOperation(), qPrintable(op.errorString()));
+        for (int i = 0; i < files.count(); ++i) {
+            QFile file(target.path() + QString("/file%1.txt").arg(i));
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.readAll(), QByteArray(4096, char('a' + i)));
+        }
+
+        QVERIFY(op.undoOperation());
+        QVERIFY(!QFileInfo::exists(target.path() + "/file0.txt"));
+        BinaryFormatEngineHandler::instance()->clear();
+    }
+
+    void testDiscardUnperformedExtraction()
+    {
+        QTemporaryDir target;
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << ":///data/valid.7z" << target.path() + "/sub");
+
+        {
+            ConcurrentArchiveExtractor extractor(OperationList() << &op);
+            extractor.start(&op);
+        }
+        QVERIFY(!QFileInfo::exists(target.path() + "/sub/valid"));
+        QVERIFY(!QFileInfo::exists(target.path() + "/sub"));
+
+        // the operation extracts the archive by itself afterwards
+        QVERIFY(op.performOperation());
+        QVERIFY(QFileInfo(target.path() + "/sub/valid").isFile());
+        QVERIFY(op.undoOperation());
+    }
 };
 
 QTEST_MAIN(tst_extractarchiveoperationtest)
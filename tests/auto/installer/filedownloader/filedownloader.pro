@@ -0,0 +1,6 @@
+include(../../qttest.pri)
+
+QT -= gui
+QT += testlib network
+
+SOURCES += tst_filedownloader.cpp
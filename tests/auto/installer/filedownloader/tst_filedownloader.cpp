@@ -0,0 +1,169 @@
+/**************************************************************************
+**
+** Copyright (C) 2019 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <filedownloader.h>
+#include <filedownloaderfactory.h>
+
+#include <QCryptographicHash>
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTest>
+
+using namespace KDUpdater;
+
+static const qint64 scLargeSize = 64LL * 1024 * 1024;
+
+class tst_FileDownloader : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QByteArray testData(qint64 size)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        for (qint64 i = 0; i < size; ++i)
+            data[int(i)] = char(i * 31 + (i >> 12));
+        return data;
+    }
+
+    static void writeSourceFile(QTemporaryFile *file, qint64 size)
+    {
+        QVERIFY(file->open());
+        const QByteArray block = testData(1024 * 1024);
+        for (qint64 written = 0; written < size; written += block.size())
+            QVERIFY(file->write(block.constData(), qMin(qint64(block.size()), size - written)) > 0);
+        file->close();
+    }
+
+    static FileDownloader *createDownloader(const QString &fileName)
+    {
+        FileDownloader *downloader = FileDownloaderFactory::instance().create(QLatin1String("file"));
+        downloader->setUrl(QUrl::fromLocalFile(fileName));
+        downloader->setAutoRemoveDownloadedFile(true);
+        return downloader;
+    }
+
+private slots:
+    void localFileDownload_data()
+    {
+        QTest::addColumn<qint64>("size");
+        QTest::newRow("empty") << qint64(0);
+        QTest::newRow("small") << qint64(1000);
+        QTest::newRow("several blocks") << qint64(3 * 1024 * 1024 + 17);
+    }
+
+    void localFileDownload()
+    {
+        QFETCH(qint64, size);
+
+        const QByteArray data = testData(size);
+        QTemporaryFile source;
+        QVERIFY(source.open());
+        QCOMPARE(source.write(data), size);
+        source.close();
+
+        QScopedPointer<FileDownloader> downloader(createDownloader(source.fileName()));
+        QVERIFY(downloader->canDownload());
+
+        QSignalSpy completed(downloader.data(), SIGNAL(downloadCompleted()));
+        QSignalSpy aborted(downloader.data(), SIGNAL(downloadAborted(QString)));
+        QSignalSpy progress(downloader.data(), SIGNAL(downloadProgress(double)));
+        downloader->download();
+
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count() + aborted.count(), 1, 30000);
+        QCOMPARE(completed.count(), 1);
+        QVERIFY(downloader->isDownloaded());
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(data, QCryptographicHash::Sha1));
+        if (size > 0)
+            QCOMPARE(progress.last().first().toDouble(), 1.0);
+
+        QFile target(downloader->downloadedFileName());
+        QVERIFY(target.open(QIODevice::ReadOnly));
+        QCOMPARE(target.readAll(), data);
+    }
+
+    void localFileDownloadCheckSumMismatch()
+    {
+        QTemporaryFile source;
+        writeSourceFile(&source, 1024);
+
+        QScopedPointer<FileDownloader> downloader(createDownloader(source.fileName()));
+        downloader->setAssumedSha1Sum(QByteArray(20, '\0'));
+
+        QSignalSpy completed(downloader.data(), SIGNAL(downloadCompleted()));
+        QSignalSpy aborted(downloader.data(), SIGNAL(downloadAborted(QString)));
+        downloader->download();
+
+        QTRY_COMPARE_WITH_TIMEOUT(aborted.count(), 1, 30000);
+        QCOMPARE(completed.count(), 0);
+        QVERIFY(!downloader->isDownloaded());
+    }
+
+    void cancelLocalFileDownload()
+    {
+        QTemporaryFile source;
+        writeSourceFile(&source, scLargeSize);
+
+        QScopedPointer<FileDownloader> downloader(createDownloader(source.fileName()));
+        connect(downloader.data(), &FileDownloader::downloadStarted, downloader.data(),
+            &FileDownloader::cancelDownload);
+
+        QSignalSpy completed(downloader.data(), SIGNAL(downloadCompleted()));
+        QSignalSpy canceled(downloader.data(), SIGNAL(downloadCanceled()));
+        downloader->download();
+
+        QTRY_COMPARE_WITH_TIMEOUT(canceled.count(), 1, 30000);
+        QTest::qWait(100); // the worker thread must not report completion afterwards
+        QCOMPARE(completed.count(), 0);
+        QVERIFY(!downloader->isDownloaded());
+    }
+
+    void benchmarkLocalFileDownload()
+    {
+        // Set IFW_BENCHMARK_FILE_SIZE to the size in MiB to measure with larger files.
+        qint64 size = qEnvironmentVariableIntValue("IFW_BENCHMARK_FILE_SIZE") * 1024LL * 1024LL;
+        if (size <= 0)
+            size = scLargeSize;
+
+        QTemporaryFile source;
+        writeSourceFile(&source, size);
+
+        QBENCHMARK {
+            QScopedPointer<FileDownloader> downloader(createDownloader(source.fileName()));
+            QSignalSpy completed(downloader.data(), SIGNAL(downloadCompleted()));
+            downloader->download();
+            QVERIFY(completed.wait(600000));
+        }
+    }
+};
+
+QTEST_MAIN(tst_FileDownloader)
+
+#include "tst_filedownloader.moc"
@@ -28,6 +28,8 @@ SUBDIRS += \
     cliinterface \
     linereplaceoperation \
     metadatajob \
+    metadatacache \
+    metadatastore \
     appendfileoperation \
     simplemovefileoperation \
     deleteoperation \
@@ -35,7 +37,12 @@ SUBDIRS += \
     commandlineupdate \
     moveoperation \
     environmentvariableoperation \
-    licenseagreement
+    licenseagreement \
+    localpackagehub \
+    updatesinfo \
+    installercalculator \
+    filedownloader \
+    downloadarchivesjob
 
 win32 {
     SUBDIRS += registerfiletypeoperation \
@@ -0,0 +1,219 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <component.h>
+#include <incrementalinstallercalculator.h>
+#include <installercalculator.h>
+#include <packagemanagercore.h>
+
+#include <QTest>
+
+using namespace QInstaller;
+
+class NamedComponent : public Component
+{
+public:
+    NamedComponent(PackageManagerCore *core, const QString &name)
+        : Component(core)
+    {
+        setValue(scName, name);
+        setValue(scVersion, QLatin1String("1.0.0"));
+    }
+};
+
+class tst_InstallerCalculator : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QString name(int index)
+    {
+        return QString::fromLatin1("component%1").arg(index);
+    }
+
+    // Creates components that only depend on components with a lower index, so there are no
+    // cycles. Some components are installed, some automatically depend on others.
+    void createComponents(PackageManagerCore *core, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            NamedComponent *component = new NamedComponent(core, name(i));
+
+            QStringList dependencies;
+            const int dependencyCount = i > 0 ? qrand() % 4 : 0;
+            for (int j = 0; j < dependencyCount; ++j)
+                dependencies.append(name(qrand() % i));
+            component->setValue(scDependencies, dependencies.join(QLatin1Char(',')));
+
+            if (qrand() % 6 == 0) {
+                QStringList autoDependencies;
+                const int autoDependencyCount = 1 + qrand() % 2;
+                for (int j = 0; j < autoDependencyCount; ++j)
+                    autoDependencies.append(name(qrand() % count));
+                autoDependencies.removeAll(name(i));
+                component->setValue(scAutoDependOn, autoDependencies.join(QLatin1Char(',')));
+            }
+
+            if (qrand() % 4 == 0)
+                component->setValue(scCurrentState, scInstalled);
+
+            core->appendRootComponent(component);
+        }
+    }
+
+private slots:
+    void testAutoDependOnChain();
+    void testUnsupportedComponents();
+    void testIncrementalEqualsFull_data();
+    void testIncrementalEqualsFull();
+};
+
+void tst_InstallerCalculator::testAutoDependOnChain()
+{
+    PackageManagerCore core;
+    NamedComponent *a = new NamedComponent(&core, QLatin1String("A"));
+    NamedComponent *c = new NamedComponent(&core, QLatin1String("C"));
+    c->setValue(scAutoDependOn, QLatin1String("A,B"));
+    NamedComponent *b = new NamedComponent(&core, QLatin1String("B"));
+    b->setValue(scAutoDependOn, QLatin1String("A"));
+    NamedComponent *d = new NamedComponent(&core, QLatin1String("D"));
+    d->setValue(scAutoDependOn, QLatin1String("A,E"));
+    NamedComponent *e = new NamedComponent(&core, QLatin1String("E"));
+    core.appendRootComponent(a);
+    core.appendRootComponent(c);
+    core.appendRootComponent(b);
+    core.appendRootComponent(d);
+    core.appendRootComponent(e);
+
+    InstallerCalculator calculator(core.components(
+        PackageManagerCore::ComponentType::AllNoReplacements));
+    QVERIFY(calculator.appendComponentsToInstall(QList<Component *>() << a));
+    QCOMPARE(calculator.orderedComponentsToInstall(), QList<Component *>() << a << b << c);
+    QCOMPARE(calculator.installReasonType(b), InstallerCalculator::Automatic);
+    QCOMPARE(calculator.installReasonType(c), InstallerCalculator::Automatic);
+
+    // D only gets triggered by a later selection
+    QVERIFY(calculator.appendComponentsToInstall(QList<Component *>() << e));
+    QCOMPARE(calculator.orderedComponentsToInstall(), QList<Component *>() << a << b << c << e
+        << d);
+    QCOMPARE(calculator.installReasonType(d), InstallerCalculator::Automatic);
+}
+
+void tst_InstallerCalculator::testUnsupportedComponents()
+{
+    {
+        PackageManagerCore core;
+        NamedComponent *a = new NamedComponent(&core, QLatin1String("A"));
+        NamedComponent *b = new NamedComponent(&core, QLatin1String("B"));
+        a->setValue(scDependencies, QLatin1String("B"));
+        b->setValue(scDependencies, QLatin1String("A"));
+        core.appendRootComponent(a);
+        core.appendRootComponent(b);
+
+        IncrementalInstallerCalculator calculator(core.components(
+            PackageManagerCore::ComponentType::AllNoReplacements));
+        QVERIFY(!calculator.isSupported());
+        QVERIFY(!calculator.setSelectedComponents(QList<Component *>() << a));
+    }
+    {
+        PackageManagerCore core;
+        NamedComponent *a = new NamedComponent(&core, QLatin1String("A"));
+        a->setValue(scDependencies, QLatin1String("Missing"));
+        core.appendRootComponent(a);
+
+        IncrementalInstallerCalculator calculator(core.components(
+            PackageManagerCore::ComponentType::AllNoReplacements));
+        QVERIFY(!calculator.isSupported());
+    }
+    {
+        PackageManagerCore core;
+        NamedComponent *a = new NamedComponent(&core, QLatin1String("A"));
+        a->setUpdateAvailable(true);
+        core.appendRootComponent(a);
+
+        IncrementalInstallerCalculator calculator(core.components(
+            PackageManagerCore::ComponentType::AllNoReplacements));
+        QVERIFY(!calculator.isSupported());
+    }
+}
+
+void tst_InstallerCalculator::testIncrementalEqualsFull_data()
+{
+    QTest::addColumn<uint>("seed");
+    QTest::addColumn<int>("componentCount");
+
+    QTest::newRow("small tree") << 1u << 20;
+    QTest::newRow("medium tree") << 2u << 100;
+    QTest::newRow("large tree") << 3u << 500;
+    QTest::newRow("large tree, other seed") << 4u << 500;
+}
+
+void tst_InstallerCalculator::testIncrementalEqualsFull()
+{
+    QFETCH(uint, seed);
+    QFETCH(int, componentCount);
+
+    qsrand(seed);
+    PackageManagerCore core;
+    createComponents(&core, componentCount);
+
+    const QList<Component *> allComponents =
+        core.components(PackageManagerCore::ComponentType::AllNoReplacements);
+    IncrementalInstallerCalculator incremental(allComponents);
+    QVERIFY(incremental.isSupported());
+
+    QList<Component *> selected;
+    for (int step = 0; step < 300; ++step) {
+        const int operation = qrand() % 20;
+        if (operation == 0) {
+            selected.clear();
+        } else if (operation < 3) {
+            // select or deselect several components at once, like checking a parent item
+            const bool select = qrand() % 2;
+            for (int i = 0; i < 10; ++i) {
+                Component *component = allComponents.at(qrand() % allComponents.count());
+                selected.removeAll(component);
+                if (select)
+                    selected.append(component);
+            }
+        } else {
+            Component *component = allComponents.at(qrand() % allComponents.count());
+            if (!selected.removeAll(component))
+                selected.append(component);
+        }
+
+        QVERIFY(incremental.setSelectedComponents(selected));
+
+        InstallerCalculator full(allComponents);
+        QVERIFY(full.appendComponentsToInstall(selected));
+        QCOMPARE(incremental.componentsToInstall(), full.orderedComponentsToInstall().toSet());
+    }
+}
+
+QTEST_MAIN(tst_InstallerCalculator)
+
+#include "tst_installercalculator.moc"
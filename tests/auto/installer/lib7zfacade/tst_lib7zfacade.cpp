@@ -33,7 +33,9 @@
 
 #include <QDir>
 #include <QObject>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
+#include <QThread>
 #include <QTest>
 
 class tst_lib7zfacade : public QObject
@@ -153,6 +155,218 @@ private slots:
         }
     }
 
+    void testExtractArchiveToMemory()
+    {
+        QFile source(":///data/valid.7z");
+        QVERIFY(source.open(QIODevice::ReadOnly));
+
+        try {
+            const QHash<QString, QByteArray> files = Lib7z::extractArchiveToMemory(&source,
+                source.fileName());
+            QCOMPARE(files.count(), 1);
+            QCOMPARE(quint64(files.value(QLatin1String("valid")).size()), m_file.uncompressedSize);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during extract archive to memory.");
+        }
+
+        QFile invalid(":///data/invalid.7z");
+        QVERIFY(invalid.open(QIODevice::ReadOnly));
+        try {
+            Lib7z::extractArchiveToMemory(&invalid, invalid.fileName());
+            QFAIL("Extracting an invalid archive did not throw.");
+        } catch (const Lib7z::SevenZipException& e) {
+            QCOMPARE(e.message(), QString("Cannot open archive \":///data/invalid.7z\"."));
+        }
+    }
+
+    void testExtractArchiveWriteBehind()
+    {
+        QFile source(":///data/valid.7z");
+        QVERIFY(source.open(QIODevice::ReadOnly));
+        QTemporaryDir target;
+        QVERIFY(target.isValid());
+
+        try {
+            // a small limit makes the decoder wait for the writer
+            Lib7z::ExtractCallback callback;
+            callback.setWriteBehind(2, 1024);
+            Lib7z::extractArchive(&source, target.path(), &callback);
+            QCOMPARE(quint64(QFileInfo(target.path() + "/valid").size()),
+                m_file.uncompressedSize);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during extract archive.");
+        }
+
+        // the file cannot be written over a directory
+        QVERIFY(QFile::remove(target.path() + "/valid"));
+        QVERIFY(QDir(target.path()).mkdir("valid"));
+        try {
+            Lib7z::ExtractCallback callback;
+            callback.setWriteBehind(2);
+            source.seek(0);
+            Lib7z::extractArchive(&source, target.path(), &callback);
+            QFAIL("Extracting over a directory did not throw.");
+        } catch (const Lib7z::SevenZipException& e) {
+            QVERIFY(e.message().startsWith("Cannot open file"));
+        }
+    }
+
+    void testExtractArchiveSharedWriteBehindPool()
+    {
+        QTemporaryDir target;
+        QVERIFY(target.isValid());
+        // the file cannot be written over a directory
+        QVERIFY(QDir(target.path()).mkpath("broken/valid"));
+        const QStringList targets = QStringList() << target.path() + "/ok"
+            << target.path() + "/broken";
+
+        // both callbacks share the writer and the limit, only the broken one fails
+        const QSharedPointer<Lib7z::WriteBehindPool> pool = Lib7z::createWriteBehindPool(1, 1024);
+        QStringList errors = QStringList() << QString() << QString();
+        QList<QThread *> threads;
+        for (int i = 0; i < targets.count(); ++i) {
+            threads.append(QThread::create([&pool, &targets, &errors, i]() {
+                QFile source(":///data/valid.7z");
+                if (!source.open(QIODevice::ReadOnly)) {
+                    errors[i] = source.errorString();
+                    return;
+                }
+                try {
+                    Lib7z::ExtractCallback callback;
+                    callback.setWriteBehind(pool);
+                    Lib7z::extractArchive(&source, targets.at(i), &callback);
+                } catch (const Lib7z::SevenZipException& e) {
+                    errors[i] = e.message();
+                }
+            }));
+            threads.last()->start();
+        }
+        foreach (QThread *thread, threads) {
+            QVERIFY(thread->wait());
+            delete thread;
+        }
+
+        QVERIFY2(errors.at(0).isEmpty(), qPrintable(errors.at(0)));
+        QCOMPARE(quint64(QFileInfo(targets.at(0) + "/valid").size()), m_file.uncompressedSize);
+        QVERIFY2(errors.at(1).startsWith("Cannot open file"), qPrintable(errors.at(1)));
+    }
+
+    void testExtractArchiveBacksUpReplacedFiles()
+    {
+        QTemporaryDir source;
+        QVERIFY(source.isValid());
+        const QString root = source.path() + "/files";
+        foreach (const QString &directory, QStringList() << "old" << "new") {
+            QVERIFY(QDir().mkpath(root + "/" + directory));
+            QFile file(root + "/" + directory + "/file.txt");
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("extracted");
+        }
+
+        QTemporaryFile archive;
+        QVERIFY(archive.open());
+        QTemporaryDir target;
+        QVERIFY(target.isValid());
+        const QString oldFile = target.path() + "/files/old/file.txt";
+        const QString newFile = target.path() + "/files/new/file.txt";
+        QVERIFY(QDir().mkpath(target.path() + "/files/old"));
+        {
+            QFile file(oldFile);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("existing");
+        }
+
+        try {
+            Lib7z::createArchive(&archive, QStringList() << root);
+
+            // the file in the directory that was not empty is backed up, the new one is not
+            Lib7z::BackupExtractCallback callback;
+            Lib7z::extractArchive(&archive, target.path(), &callback);
+            QCOMPARE(callback.backupFiles().count(), 1);
+            QCOMPARE(callback.backupFiles().first().first, oldFile);
+            QFile backup(callback.backupFiles().first().second);
+            QVERIFY(backup.open(QIODevice::ReadOnly));
+            QCOMPARE(backup.readAll(), QByteArray("existing"));
+
+            // files written before are backed up even in a directory created while extracting
+            archive.seek(0);
+            Lib7z::extractArchive(&archive, target.path(), &callback);
+            QCOMPARE(callback.backupFiles().count(), 3);
+            QStringList replaced = QStringList() << callback.backupFiles().at(1).first
+                << callback.backupFiles().at(2).first;
+            replaced.sort();
+            QCOMPARE(replaced, QStringList() << newFile << oldFile);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during extract archive.");
+        }
+
+        foreach (const QString &fileName, QStringList() << oldFile << newFile) {
+            QFile file(fileName);
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.readAll(), QByteArray("extracted"));
+        }
+    }
+
+    void benchmarkExtractManySmallFiles_data()
+    {
+        QTest::addColumn<bool>("freshTarget");
+        QTest::addColumn<int>("writerCount");
+        QTest::newRow("fresh target") << true << 0;
+        QTest::newRow("fresh target, write-behind") << true << 2;
+        QTest::newRow("existing files") << false << 0;
+    }
+
+    void benchmarkExtractManySmallFiles()
+    {
+        QFETCH(bool, freshTarget);
+        QFETCH(int, writerCount);
+
+        QTemporaryDir source;
+        QVERIFY(source.isValid());
+        const QString root = source.path() + "/files";
+        for (int i = 0; i < 20; ++i) {
+            const QString directory = root + QString("/dir%1").arg(i);
+            QVERIFY(QDir().mkpath(directory));
+            for (int j = 0; j < 500; ++j) {
+                QFile file(directory + QString("/file%1.txt").arg(j));
+                QVERIFY(file.open(QIODevice::WriteOnly));
+                file.write(QByteArray::number(i * 500 + j));
+            }
+        }
+
+        QTemporaryFile archive;
+        QVERIFY(archive.open());
+        QTemporaryDir target;
+        QVERIFY(target.isValid());
+
+        try {
+            Lib7z::createArchive(&archive, QStringList() << root);
+            if (!freshTarget) // every item replaces a file
+                Lib7z::extractArchive(&archive, target.path());
+
+            int run = 0;
+            QBENCHMARK {
+                Lib7z::ExtractCallback callback;
+                callback.setWriteBehind(writerCount);
+                archive.seek(0);
+                Lib7z::extractArchive(&archive, freshTarget
+                    ? target.path() + QString("/%1").arg(run++) : target.path(), &callback);
+            }
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during extract archive.");
+        }
+        QVERIFY(QFile::exists(target.path() + (freshTarget ? "/0" : "")
+            + "/files/dir19/file499.txt"));
+    }
+
 private:
     QString tempSourceFile(const QByteArray &data, const QString &templateName = QString())
     {
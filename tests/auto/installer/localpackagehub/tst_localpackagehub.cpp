@@ -0,0 +1,198 @@
+/**************************************************************************
+**
+** Copyright (C) 2019 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <fileutils.h>
+#include <localpackagehub.h>
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+
+using namespace KDUpdater;
+using namespace QInstaller;
+
+class tst_localpackagehub : public QObject
+{
+    Q_OBJECT
+
+private:
+    void addPackage(LocalPackageHub &hub, const QString &name, const QString &version)
+    {
+        hub.addPackage(name, version, name, QString(), QStringList(), QStringList(), false, false,
+            1024, QString(), true, false);
+    }
+
+    void copyFile(const QString &source, const QString &target)
+    {
+        QFile::remove(target);
+        QVERIFY(QFile::copy(source, target));
+    }
+
+private slots:
+    void init()
+    {
+        m_directory = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(m_directory));
+        m_fileName = m_directory + QLatin1String("/components.xml");
+        m_journalFileName = m_fileName + QLatin1String(".journal");
+    }
+
+    void cleanup()
+    {
+        QInstaller::removeDirectory(m_directory, true);
+    }
+
+    void testCommitTransaction()
+    {
+        {
+            LocalPackageHub hub;
+            hub.setFileName(m_fileName);
+            hub.setApplicationName(QLatin1String("Application"));
+            hub.setApplicationVersion(QLatin1String("1.0.0"));
+            addPackage(hub, QLatin1String("A"), QLatin1String("1.0"));
+            hub.writeToDisk();
+
+            hub.beginTransaction();
+            QVERIFY(hub.isInTransaction());
+            addPackage(hub, QLatin1String("B"), QLatin1String("1.0"));
+            hub.writeToDisk();
+            QVERIFY(hub.removePackage(QLatin1String("A")));
+            hub.writeToDisk();
+            QVERIFY(QFile::exists(m_journalFileName));
+
+            hub.commitTransaction();
+            QVERIFY(!hub.isInTransaction());
+            QVERIFY(!QFile::exists(m_journalFileName));
+        }
+
+        LocalPackageHub hub;
+        hub.setFileName(m_fileName);
+        QCOMPARE(hub.error(), LocalPackageHub::NoError);
+        QCOMPARE(hub.applicationName(), QLatin1String("Application"));
+        QCOMPARE(hub.packageNames(), QStringList() << QLatin1String("B"));
+    }
+
+    void testReplayInterruptedTransaction()
+    {
+        const QString crashedFileName = m_directory + QLatin1String("/crashed.xml");
+        {
+            LocalPackageHub hub;
+            hub.setFileName(m_fileName);
+            hub.setApplicationName(QLatin1String("Application"));
+            hub.setApplicationVersion(QLatin1String("1.0.0"));
+            addPackage(hub, QLatin1String("A"), QLatin1String("1.0"));
+            hub.writeToDisk();
+
+            hub.beginTransaction();
+            addPackage(hub, QLatin1String("B"), QLatin1String("1.0"));
+            hub.writeToDisk();
+            addPackage(hub, QLatin1String("A"), QLatin1String("2.0"));
+            hub.writeToDisk();
+
+            // take a snapshot of what a crash at this point would leave behind
+            copyFile(m_fileName, crashedFileName);
+            copyFile(m_journalFileName, crashedFileName + QLatin1String(".journal"));
+        }
+
+        LocalPackageHub hub;
+        hub.setFileName(crashedFileName);
+        QCOMPARE(hub.error(), LocalPackageHub::NoError);
+        QCOMPARE(hub.packageNames(), QStringList() << QLatin1String("A") << QLatin1String("B"));
+        QCOMPARE(hub.packageInfo(QLatin1String("A")).version, QLatin1String("2.0"));
+
+        // the next write folds the journal into the file
+        hub.writeToDisk();
+        QVERIFY(!QFile::exists(crashedFileName + QLatin1String(".journal")));
+    }
+
+    void testReplayWithoutPackageFile()
+    {
+        {
+            LocalPackageHub hub;
+            hub.setFileName(m_fileName);
+            hub.setApplicationName(QLatin1String("Application"));
+            hub.beginTransaction();
+            addPackage(hub, QLatin1String("A"), QLatin1String("1.0"));
+            hub.writeToDisk();
+            QVERIFY(!QFile::exists(m_fileName));
+
+            // simulate a crash, the destructor would otherwise commit
+            QVERIFY(QFile::rename(m_journalFileName, m_journalFileName + QLatin1String(".saved")));
+            hub.refresh();
+        }
+        QVERIFY(!QFile::exists(m_fileName));
+        QVERIFY(QFile::rename(m_journalFileName + QLatin1String(".saved"), m_journalFileName));
+
+        LocalPackageHub hub;
+        hub.setFileName(m_fileName);
+        QCOMPARE(hub.error(), LocalPackageHub::NoError);
+        QCOMPARE(hub.applicationName(), QLatin1String("Application"));
+        QCOMPARE(hub.packageNames(), QStringList() << QLatin1String("A"));
+    }
+
+    void testTornJournalRecord()
+    {
+        {
+            LocalPackageHub hub;
+            hub.setFileName(m_fileName);
+            hub.beginTransaction();
+            addPackage(hub, QLatin1String("A"), QLatin1String("1.0"));
+            hub.writeToDisk();
+            addPackage(hub, QLatin1String("B"), QLatin1String("1.0"));
+            hub.writeToDisk();
+
+            QFile journal(m_journalFileName);
+            QVERIFY(journal.open(QIODevice::ReadOnly));
+            m_journal = journal.readAll();
+        }
+
+        // cut the last record in half, the records before it are still valid
+        QFile journal(m_journalFileName);
+        QVERIFY(journal.open(QIODevice::WriteOnly));
+        journal.write(m_journal.left(m_journal.size() - 10));
+        journal.close();
+        QFile::remove(m_fileName);
+
+        LocalPackageHub hub;
+        hub.setFileName(m_fileName);
+        QCOMPARE(hub.error(), LocalPackageHub::NoError);
+        QCOMPARE(hub.packageNames(), QStringList() << QLatin1String("A"));
+    }
+
+private:
+    QString m_directory;
+    QString m_fileName;
+    QString m_journalFileName;
+    QByteArray m_journal;
+};
+
+QTEST_MAIN(tst_localpackagehub)
+
+#include "tst_localpackagehub.moc"
@@ -0,0 +1,222 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <fileutils.h>
+#include <metadatacache.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_MetadataCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString writeFile(const QString &name, const QByteArray &content)
+    {
+        const QString fileName = m_tempDir + QLatin1Char('/') + name;
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return QString();
+        file.write(content);
+        return fileName;
+    }
+
+    QByteArray readFile(const QString &fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return file.readAll();
+    }
+
+    void setModificationTime(const QString &fileName, const QDateTime &time)
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::Append));
+        QVERIFY(file.setFileTime(time, QFileDevice::FileModificationTime));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_tempDir = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(m_tempDir));
+    }
+
+    void init()
+    {
+        m_cacheDir = QInstaller::generateTemporaryFileName();
+    }
+
+    void cleanup()
+    {
+        QDir(m_cacheDir).removeRecursively();
+    }
+
+    void testDefaultPath()
+    {
+        qputenv("IFW_METADATA_CACHE", m_cacheDir.toLocal8Bit());
+        QCOMPARE(MetadataCache::defaultPath(), m_cacheDir);
+        QCOMPARE(MetadataCache().path(), m_cacheDir);
+
+        qputenv("IFW_METADATA_CACHE", "none");
+        QVERIFY(MetadataCache::defaultPath().isEmpty());
+        QVERIFY(!MetadataCache().isValid());
+
+        qunsetenv("IFW_METADATA_CACHE");
+    }
+
+    void testDisabled()
+    {
+        MetadataCache cache((QString()));
+        QVERIFY(!cache.isValid());
+
+        const QString fileName = writeFile(QLatin1String("disabled.7z"), "content");
+        const QByteArray sha1 = QCryptographicHash::hash("content", QCryptographicHash::Sha1).toHex();
+        QVERIFY(!cache.insertArchive(fileName, sha1));
+        QVERIFY(cache.archive(sha1).isEmpty());
+        QVERIFY(!cache.insertUpdatesXml(QLatin1String("http://example.com/repo"), fileName,
+            "\"etag\"", QByteArray()));
+        QVERIFY(cache.updatesXml(QLatin1String("http://example.com/repo")).isEmpty());
+    }
+
+    void testArchive()
+    {
+        MetadataCache cache(m_cacheDir);
+        const QByteArray content("meta archive content");
+        const QByteArray sha1 = QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+        const QString fileName = writeFile(QLatin1String("meta.7z"), content);
+
+        QVERIFY(cache.archive(sha1).isEmpty());
+        QVERIFY(cache.insertArchive(fileName, sha1));
+        QVERIFY(QFile::exists(fileName));
+
+        const QString cached = cache.archive(sha1);
+        QVERIFY(!cached.isEmpty());
+        QVERIFY(cached.startsWith(m_cacheDir));
+        QCOMPARE(readFile(cached), content);
+
+        // the checksum is case insensitive, but does not accept anything else
+        QCOMPARE(cache.archive(sha1.toUpper()), cached);
+        QVERIFY(cache.archive(QByteArray()).isEmpty());
+        QVERIFY(cache.archive("../" + sha1).isEmpty());
+        QVERIFY(!cache.insertArchive(fileName, "abcdef"));
+
+        QVERIFY(!cache.removeArchive(fileName));
+        QVERIFY(QFile::exists(fileName));
+        QVERIFY(cache.removeArchive(cached));
+        QVERIFY(cache.archive(sha1).isEmpty());
+    }
+
+    void testUpdatesXml()
+    {
+        MetadataCache cache(m_cacheDir);
+        const QString repository = QLatin1String("http://example.com/repo");
+        const QString fileName = writeFile(QLatin1String("Updates.xml"), "<Updates/>");
+
+        QVERIFY(cache.updatesXml(repository).isEmpty());
+        QVERIFY(cache.insertUpdatesXml(repository, fileName, "\"1234\"",
+            "Wed, 21 Oct 2015 07:28:00 GMT"));
+
+        QByteArray eTag, lastModified;
+        const QString cached = cache.updatesXml(repository, &eTag, &lastModified);
+        QVERIFY(!cached.isEmpty());
+        QCOMPARE(readFile(cached), QByteArray("<Updates/>"));
+        QCOMPARE(eTag, QByteArray("\"1234\""));
+        QCOMPARE(lastModified, QByteArray("Wed, 21 Oct 2015 07:28:00 GMT"));
+        QVERIFY(cache.updatesXml(QLatin1String("http://example.com/other")).isEmpty());
+
+        // a newer response replaces file and validators
+        const QString newer = writeFile(QLatin1String("Updates.xml"), "<Updates></Updates>");
+        QVERIFY(cache.insertUpdatesXml(repository, newer, "\"5678\"", QByteArray()));
+        QCOMPARE(cache.updatesXml(repository, &eTag, &lastModified), cached);
+        QCOMPARE(readFile(cached), QByteArray("<Updates></Updates>"));
+        QCOMPARE(eTag, QByteArray("\"5678\""));
+        QVERIFY(lastModified.isEmpty());
+    }
+
+    void testRemoveExpired()
+    {
+        MetadataCache cache(m_cacheDir);
+        const QByteArray oldContent("old archive");
+        const QByteArray newContent("new archive");
+        const QByteArray oldSha1 = QCryptographicHash::hash(oldContent, QCryptographicHash::Sha1).toHex();
+        const QByteArray newSha1 = QCryptographicHash::hash(newContent, QCryptographicHash::Sha1).toHex();
+        QVERIFY(cache.insertArchive(writeFile(QLatin1String("old.7z"), oldContent), oldSha1));
+        QVERIFY(cache.insertArchive(writeFile(QLatin1String("new.7z"), newContent), newSha1));
+
+        const QString repository = QLatin1String("http://example.com/repo");
+        QVERIFY(cache.insertUpdatesXml(repository, writeFile(QLatin1String("Updates.xml"),
+            "<Updates/>"), "\"1234\"", QByteArray()));
+
+        const QDateTime old = QDateTime::currentDateTime().addDays(-40);
+        setModificationTime(m_cacheDir + QLatin1String("/archives/") + QString::fromLatin1(oldSha1)
+            + QLatin1String(".7z"), old);
+        setModificationTime(cache.updatesXml(repository), old);
+
+        cache.removeExpired(30);
+        QVERIFY(cache.archive(oldSha1).isEmpty());
+        QVERIFY(!cache.archive(newSha1).isEmpty());
+        QVERIFY(cache.updatesXml(repository).isEmpty());
+        QCOMPARE(QDir(m_cacheDir + QLatin1String("/updates")).entryList(QDir::Files).count(), 0);
+    }
+
+    void testLookupRefreshesEntry()
+    {
+        MetadataCache cache(m_cacheDir);
+        const QByteArray content("archive");
+        const QByteArray sha1 = QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+        QVERIFY(cache.insertArchive(writeFile(QLatin1String("archive.7z"), content), sha1));
+        setModificationTime(cache.archive(sha1), QDateTime::currentDateTime().addDays(-40));
+
+        // the first lookup still finds the entry and marks it as used
+        QVERIFY(!cache.archive(sha1).isEmpty());
+        cache.removeExpired(30);
+        QVERIFY(!cache.archive(sha1).isEmpty());
+    }
+
+    void cleanupTestCase()
+    {
+        QDir(m_tempDir).removeRecursively();
+    }
+
+private:
+    QString m_tempDir;
+    QString m_cacheDir;
+};
+
+QTEST_MAIN(tst_MetadataCache)
+
+#include "tst_metadatacache.moc"
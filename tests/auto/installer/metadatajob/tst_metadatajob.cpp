@@ -33,9 +33,16 @@
 #include <component.h>
 #include <errors.h>
 #include <fileutils.h>
+#include <init.h>
+#include <lib7z_create.h>
+#include <metadatastore.h>
 #include <packagemanagercore.h>
 #include <progresscoordinator.h>
+#include <scriptengine.h>
 
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QThreadPool>
 #include <QTest>
 
 using namespace QInstaller;
@@ -44,7 +51,55 @@ class tst_MetaDataJob : public QObject
 {
     Q_OBJECT
 
+private:
+    // Writes a repository of \a count components with meta data to \a directory. The meta
+    // archive of the component \a broken, if any, cannot be extracted.
+    void createRepository(const QString &directory, int count, int broken = -1)
+    {
+        QFile updates(directory + "/Updates.xml");
+        QVERIFY(updates.open(QIODevice::WriteOnly));
+        updates.write("<Updates>\n <ApplicationName>{AnyApplication}</ApplicationName>\n"
+            " <ApplicationVersion>1.0.0</ApplicationVersion>\n <Checksum>false</Checksum>\n");
+
+        for (int i = 0; i < count; ++i) {
+            const QString name = QString("A%1").arg(i);
+            updates.write(QString(" <PackageUpdate>\n  <Name>%1</Name>\n"
+                "  <Version>1.0.0</Version>\n  <Script>installscript.qs</Script>\n"
+                " </PackageUpdate>\n").arg(name).toUtf8());
+
+            const QString source = directory + "/source/" + name;
+            QVERIFY(QDir().mkpath(source));
+            QVERIFY(QDir().mkpath(directory + '/' + name));
+            QFile script(source + "/installscript.qs");
+            QVERIFY(script.open(QIODevice::WriteOnly));
+            script.write("function Component() {}\n"
+                "Component.prototype.readHelper = function(directory) {\n"
+                "    return installer.readFile(directory + \"/helper.txt\", \"UTF-8\");\n"
+                "}\n");
+            script.close();
+            QFile helper(source + "/helper.txt");
+            QVERIFY(helper.open(QIODevice::WriteOnly));
+            helper.write(name.toUtf8());
+            helper.close();
+
+            const QString archive = directory + '/' + name + "/1.0.0meta.7z";
+            if (i == broken) {
+                QFile file(archive);
+                QVERIFY(file.open(QIODevice::WriteOnly));
+                file.write("not an archive");
+            } else {
+                Lib7z::createArchive(archive, QStringList() << source, Lib7z::TmpFile::No);
+            }
+        }
+        updates.write("</Updates>\n");
+    }
+
 private slots:
+    void initTestCase()
+    {
+        QInstaller::init();
+    }
+
     void testRepository()
     {
         Settings settings = Settings::fromFileAndPrefix(":///data/config.xml", ":///data");
@@ -100,6 +155,100 @@ private slots:
         metadata.waitForFinished();
         QCOMPARE(metadata.metadata().count(), 1);
     }
+
+    void testMetadataExtractedWhileDownloading()
+    {
+        QTemporaryDir repository;
+        createRepository(repository.path(), 12);
+
+        PackageManagerCore core;
+        core.setInstaller();
+        core.settings().setDefaultRepositories(QSet<Repository>()
+            << Repository::fromUserInput(repository.path()));
+        MetadataJob metadata;
+        metadata.setPackageManagerCore(&core);
+        metadata.start();
+        metadata.waitForFinished();
+
+        // all archives are extracted before the job finishes, no matter when they arrived
+        QCOMPARE(metadata.error(), int(Job::NoError));
+        QCOMPARE(metadata.metadata().count(), 1);
+        const QString directory = metadata.metadata().first().directory;
+        for (int i = 0; i < 12; ++i) {
+            QVERIFY(MetadataStore::instance()->contains(directory
+                + QString("/A%1/installscript.qs").arg(i)));
+        }
+    }
+
+    void testScriptReadsShippedFile()
+    {
+        QTemporaryDir repository;
+        createRepository(repository.path(), 2);
+
+        PackageManagerCore core;
+        core.setInstaller();
+        core.settings().setDefaultRepositories(QSet<Repository>()
+            << Repository::fromUserInput(repository.path()));
+        MetadataJob metadata;
+        metadata.setPackageManagerCore(&core);
+        metadata.start();
+        metadata.waitForFinished();
+        QCOMPARE(metadata.error(), int(Job::NoError));
+
+        // the script is served from memory, the file it opens by path is on disk
+        const QString directory = metadata.metadata().first().directory + "/A1";
+        QVERIFY(MetadataStore::instance()->contains(directory + "/installscript.qs"));
+        QVERIFY(QFileInfo::exists(directory + "/helper.txt"));
+
+        ScriptEngine engine(&core);
+        const QJSValue context = engine.loadInContext("Component",
+            directory + "/installscript.qs");
+        const QJSValue content = engine.callScriptMethod(context, "readHelper",
+            QJSValueList() << directory);
+        QCOMPARE(content.toString(), QString("A1"));
+    }
+
+    void testExtractionErrorWhileDownloading()
+    {
+        QTemporaryDir broken;
+        createRepository(broken.path(), 12, 0);
+        QTemporaryDir valid;
+        createRepository(valid.path(), 2);
+
+        PackageManagerCore core;
+        core.setInstaller();
+        core.settings().setDefaultRepositories(QSet<Repository>()
+            << Repository::fromUserInput(broken.path()));
+        MetadataJob metadata;
+        metadata.setPackageManagerCore(&core);
+        QSignalSpy finished(&metadata, &Job::finished);
+        MetadataStore::instance()->clear();
+        const QStringList tempDirs = QDir::temp().entryList(QStringList("remoterepo-*"),
+            QDir::Dirs);
+        metadata.start();
+        metadata.waitForFinished();
+
+        QCOMPARE(metadata.error(), int(QInstaller::ExtractionError));
+        QCOMPARE(finished.count(), 1);
+
+        // extractions still running when the job gave up leave nothing behind
+        QThreadPool::globalInstance()->waitForDone();
+        QVERIFY(MetadataStore::instance()->isEmpty());
+        QCOMPARE(QDir::temp().entryList(QStringList("remoterepo-*"), QDir::Dirs), tempDirs);
+
+        // the failed run neither finishes twice nor feeds the next one
+        core.settings().setDefaultRepositories(QSet<Repository>()
+            << Repository::fromUserInput(valid.path()));
+        metadata.start();
+        metadata.waitForFinished();
+        QTest::qWait(100);
+
+        QCOMPARE(metadata.error(), int(Job::NoError));
+        QCOMPARE(finished.count(), 2);
+        QCOMPARE(metadata.metadata().count(), 1);
+        QCOMPARE(metadata.metadata().first().repository.url(),
+            Repository::fromUserInput(valid.path()).url());
+    }
 };
 
 
@@ -0,0 +1,144 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <fileutils.h>
+#include <metadatastore.h>
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_MetadataStore : public QObject
+{
+    Q_OBJECT
+
+private:
+    QByteArray readAll(const MetadataStore &store, const QString &fileName)
+    {
+        const std::unique_ptr<QIODevice> device = store.open(fileName);
+        if (!device->open(QIODevice::ReadOnly))
+            return QByteArray();
+        return device->readAll();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_tempDir = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(m_tempDir + QLatin1String("/ondisk")));
+
+        QFile file(m_tempDir + QLatin1String("/ondisk/license.txt"));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("license on disk");
+    }
+
+    void testInsert()
+    {
+        MetadataStore store;
+        QHash<QString, QByteArray> files;
+        files.insert(QLatin1String("A/installscript.qs"), "function Component() {}");
+        files.insert(QLatin1String("A/page.ui"), "<ui/>");
+        files.insert(QLatin1String("A/de.qm"), "qm");
+        files.insert(QLatin1String("B/license.txt"), "license");
+        store.insert(m_tempDir + QLatin1String("/repo"), files);
+
+        const QString script = m_tempDir + QLatin1String("/repo/A/installscript.qs");
+        QVERIFY(store.contains(script));
+        QVERIFY(store.contains(QDir::toNativeSeparators(script)));
+        QVERIFY(store.contains(m_tempDir + QLatin1String("/repo/B/../A/installscript.qs")));
+        QCOMPARE(store.file(script), QByteArray("function Component() {}"));
+        QCOMPARE(readAll(store, script), QByteArray("function Component() {}"));
+        QVERIFY(store.exists(script));
+        QVERIFY(!store.contains(m_tempDir + QLatin1String("/repo/A/missing.qs")));
+
+        QStringList entries = store.entryList(m_tempDir + QLatin1String("/repo/A"),
+            QStringList() << QLatin1String("*.ui") << QLatin1String("*.qm"));
+        entries.sort();
+        QCOMPARE(entries, QStringList() << QLatin1String("de.qm") << QLatin1String("page.ui"));
+        QCOMPARE(store.entryList(m_tempDir + QLatin1String("/repo/B"),
+            QStringList(QLatin1String("*.ui"))), QStringList());
+
+        // replacing a file does not list it twice
+        files.clear();
+        files.insert(QLatin1String("A/page.ui"), "<ui></ui>");
+        store.insert(m_tempDir + QLatin1String("/repo"), files);
+        QCOMPARE(store.file(m_tempDir + QLatin1String("/repo/A/page.ui")), QByteArray("<ui></ui>"));
+        QCOMPARE(store.entryList(m_tempDir + QLatin1String("/repo/A"),
+            QStringList(QLatin1String("*.ui"))), QStringList(QLatin1String("page.ui")));
+    }
+
+    void testFallbackToDisk()
+    {
+        MetadataStore store;
+        const QString license = m_tempDir + QLatin1String("/ondisk/license.txt");
+
+        QVERIFY(!store.contains(license));
+        QVERIFY(store.exists(license));
+        QVERIFY(!store.exists(m_tempDir + QLatin1String("/ondisk/missing.txt")));
+        QCOMPARE(readAll(store, license), QByteArray("license on disk"));
+        QCOMPARE(store.entryList(m_tempDir + QLatin1String("/ondisk"),
+            QStringList(QLatin1String("*.txt"))), QStringList(QLatin1String("license.txt")));
+
+        const std::unique_ptr<QIODevice> missing
+            = store.open(m_tempDir + QLatin1String("/ondisk/missing.txt"));
+        QVERIFY(!missing->open(QIODevice::ReadOnly));
+    }
+
+    void testRemoveDirectory()
+    {
+        MetadataStore store;
+        QHash<QString, QByteArray> files;
+        files.insert(QLatin1String("A/installscript.qs"), "script");
+        store.insert(m_tempDir + QLatin1String("/repo1"), files);
+        store.insert(m_tempDir + QLatin1String("/repo10"), files);
+
+        store.removeDirectory(m_tempDir + QLatin1String("/repo1"));
+        QVERIFY(!store.contains(m_tempDir + QLatin1String("/repo1/A/installscript.qs")));
+        QVERIFY(store.contains(m_tempDir + QLatin1String("/repo10/A/installscript.qs")));
+        QVERIFY(store.entryList(m_tempDir + QLatin1String("/repo1/A"),
+            QStringList(QLatin1String("*.qs"))).isEmpty());
+
+        store.clear();
+        QVERIFY(!store.contains(m_tempDir + QLatin1String("/repo10/A/installscript.qs")));
+    }
+
+    void cleanupTestCase()
+    {
+        QDir(m_tempDir).removeRecursively();
+    }
+
+private:
+    QString m_tempDir;
+};
+
+QTEST_MAIN(tst_MetadataStore)
+
+#include "tst_metadatastore.moc"
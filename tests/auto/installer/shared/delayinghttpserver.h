@@ -0,0 +1,120 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef DELAYINGHTTPSERVER_H
+#define DELAYINGHTTPSERVER_H
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+// Answers GET requests with their path after a short delay, and records how many requests it
+// had to answer at the same time. All servers of a test share one log of the running requests.
+// Requests for a .sha1 file get the hash of the answer for the file without the suffix.
+class DelayingHttpServer : public QTcpServer
+{
+public:
+    struct Log
+    {
+        int running = 0;
+        int peak = 0;
+        QStringList order;
+    };
+
+    DelayingHttpServer(const QString &name, Log *log)
+        : m_name(name)
+        , m_log(log)
+    {
+        connect(this, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket *socket = nextPendingConnection()) {
+                connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                    readRequest(socket);
+                });
+                connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                    m_requests.remove(socket);
+                    socket->deleteLater();
+                });
+            }
+        });
+    }
+
+    int peak() const { return m_peak; }
+
+    // Answers the first request for the path with 404 Not Found.
+    void failOnce(const QByteArray &path) { m_failingOnce.insert(path); }
+
+    // Answers requests for the .sha1 file of the path with a hash that does not match.
+    void breakHash(const QByteArray &path) { m_brokenHashes.insert(path); }
+
+private:
+    void readRequest(QTcpSocket *socket)
+    {
+        QByteArray &request = m_requests[socket];
+        request += socket->readAll();
+        if (!request.contains("\r\n\r\n"))
+            return;
+        const QByteArray path = request.split(' ').value(1);
+        m_requests.remove(socket);
+
+        m_peak = qMax(m_peak, ++m_running);
+        m_log->peak = qMax(m_log->peak, ++m_log->running);
+        m_log->order.append(m_name);
+
+        QByteArray status = "200 OK";
+        QByteArray body = path;
+        if (m_failingOnce.remove(path)) {
+            status = "404 Not Found";
+        } else if (path.endsWith(".sha1")) {
+            const QByteArray archive = path.left(path.size() - 5);
+            body = QCryptographicHash::hash(m_brokenHashes.contains(archive) ? path : archive,
+                QCryptographicHash::Sha1).toHex();
+        }
+
+        QTimer::singleShot(20, socket, [this, socket, status, body]() {
+            // The request stops counting before the client can see the answer and start the next.
+            --m_running;
+            --m_log->running;
+            socket->write("HTTP/1.1 " + status + "\r\nContent-Length: "
+                + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+        });
+    }
+
+    QString m_name;
+    Log *m_log;
+    int m_running = 0;
+    int m_peak = 0;
+    QHash<QTcpSocket *, QByteArray> m_requests;
+    QSet<QByteArray> m_failingOnce;
+    QSet<QByteArray> m_brokenHashes;
+};
+
+#endif // DELAYINGHTTPSERVER_H
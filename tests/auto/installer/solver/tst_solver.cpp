@@ -141,6 +141,69 @@ private slots:
             qPrintable(cycle.first.data()));
     }
 
+    void sortGraphCyclePath()
+    {
+        Graph<QString> graph;
+        graph.addEdge("A", "B");
+        graph.addEdge("B", "C");
+        graph.addEdge("C", "D");
+        graph.addEdge("D", "B");
+        graph.addEdge("D", "E");
+
+        graph.sort();
+        QVERIFY(graph.hasCycle());
+        QCOMPARE(graph.cyclePath(), QList<QString>() << "B" << "C" << "D");
+        QCOMPARE(graph.cycle(), qMakePair(QString("D"), QString("B")));
+    }
+
+    void sortGraphDeepChain()
+    {
+        // a recursive sort would overflow the stack on chains this long
+        const int count = 100000;
+        Graph<int> graph;
+        for (int i = 0; i < count - 1; ++i)
+            graph.addEdge(i, i + 1);
+
+        const QList<int> resolved = graph.sort();
+        QVERIFY(!graph.hasCycle());
+        QCOMPARE(resolved.count(), count);
+        QCOMPARE(resolved.first(), count - 1);
+        QCOMPARE(resolved.last(), 0);
+    }
+
+    void benchmarkSortGraph_data()
+    {
+        QTest::addColumn<int>("nodeCount");
+        QTest::addColumn<int>("edgesPerNode");
+
+        QTest::newRow("100k nodes, chain") << 100000 << 1;
+        QTest::newRow("100k nodes, 8 edges per node") << 100000 << 8;
+    }
+
+    void benchmarkSortGraph()
+    {
+        QFETCH(int, nodeCount);
+        QFETCH(int, edgesPerNode);
+
+        // edges only point to nodes with a higher number, so the graph is acyclic
+        Graph<int> graph;
+        quint32 seed = 42;
+        for (int i = 0; i < nodeCount; ++i) {
+            graph.addNode(i);
+            for (int j = 0; j < edgesPerNode && i + 1 < nodeCount; ++j) {
+                seed = seed * 1103515245 + 12345;
+                graph.addEdge(i, i + 1 + int(seed % quint32(qMin(nodeCount - i - 1, 1000))));
+            }
+        }
+
+        QList<int> resolved;
+        QBENCHMARK {
+            resolved = graph.sort();
+        }
+        QVERIFY(!graph.hasCycle());
+        QCOMPARE(resolved.count(), nodeCount);
+    }
+
     void resolveInstaller_data()
     {
         QTest::addColumn<PackageManagerCore *>("core");
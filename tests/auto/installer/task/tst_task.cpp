@@ -26,12 +26,16 @@
 **
 **************************************************************************/
 
+#include "../shared/delayinghttpserver.h"
+
 #include <copyfiletask.h>
 #include <downloadfiletask.h>
 #include <fileio.h>
 
 #include <QFutureWatcher>
+#include <QSet>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QTest>
 #include <QTemporaryFile>
 
@@ -111,6 +115,95 @@ private slots:
             QCOMPARE(result.checkSum().toHex(), QByteArray("85304f87b8d90554a63c6f6d1e9cc974fbef8d32"));
         }
     }
+
+    void downloadFilesThroughWindow()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        QList<FileTaskItem> items;
+        for (int i = 0; i < 50; ++i) {
+            QFile file(dir.path() + QString::fromLatin1("/source%1").arg(i));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QInstaller::blockingWrite(&file, QByteArray::number(i));
+            file.close();
+            items.append(FileTaskItem(QUrl::fromLocalFile(file.fileName()).toString(),
+                dir.path() + QString::fromLatin1("/target%1").arg(i)));
+        }
+
+        DownloadFileTask fileTask(items);
+        fileTask.setMaxConcurrentDownloads(3);
+        fileTask.setMaxConcurrentDownloadsPerHost(2);
+        QCOMPARE(fileTask.maxConcurrentDownloads(), 3);
+        QCOMPARE(fileTask.maxConcurrentDownloadsPerHost(), 2);
+
+        QFutureWatcher<FileTaskResult> watcher;
+        watcher.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, &fileTask));
+        watcher.waitForFinished();
+
+        QCOMPARE(watcher.future().resultCount(), items.count());
+        QSet<QString> targets;
+        foreach (const FileTaskResult &result, watcher.future().results()) {
+            QFile file(result.target());
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.readAll(), QByteArray::number(result.target().mid(result.target()
+                .lastIndexOf(QLatin1String("target")) + 6).toInt()));
+            targets.insert(result.target());
+        }
+        QCOMPARE(targets.count(), items.count());
+    }
+
+    void downloadFilesThroughWindowFromTwoHosts()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        DelayingHttpServer::Log log;
+        DelayingHttpServer first(QLatin1String("first"), &log);
+        DelayingHttpServer second(QLatin1String("second"), &log);
+        QVERIFY(first.listen(QHostAddress::LocalHost));
+        QVERIFY(second.listen(QHostAddress::Any));
+
+        // all files of the first host are queued in front of the ones of the second host
+        QList<FileTaskItem> items;
+        for (int i = 0; i < 8; ++i) {
+            items.append(FileTaskItem(QString::fromLatin1("http://127.0.0.1:%1/first%2")
+                .arg(first.serverPort()).arg(i),
+                dir.path() + QString::fromLatin1("/first%1").arg(i)));
+        }
+        for (int i = 0; i < 8; ++i) {
+            items.append(FileTaskItem(QString::fromLatin1("http://localhost:%1/second%2")
+                .arg(second.serverPort()).arg(i),
+                dir.path() + QString::fromLatin1("/second%1").arg(i)));
+        }
+
+        DownloadFileTask fileTask(items);
+        fileTask.setMaxConcurrentDownloads(3);
+        fileTask.setMaxConcurrentDownloadsPerHost(2);
+
+        // the servers answer on this thread, so wait through the event loop
+        QFutureWatcher<FileTaskResult> watcher;
+        QSignalSpy finished(&watcher, SIGNAL(finished()));
+        watcher.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, &fileTask));
+        QVERIFY(finished.wait(30000));
+
+        QCOMPARE(log.order.count(), items.count());
+        QCOMPARE(log.running, 0);
+        QVERIFY(log.peak > 1);
+        QVERIFY(log.peak <= 3);
+        QVERIFY(first.peak() <= 2);
+        QVERIFY(second.peak() <= 2);
+        // the second host gets a slot right away instead of after all files of the first one
+        QVERIFY(log.order.mid(0, 3).contains(QLatin1String("second")));
+
+        QCOMPARE(watcher.future().resultCount(), items.count());
+        foreach (const FileTaskResult &result, watcher.future().results()) {
+            QFile file(result.target());
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.readAll(), QByteArray("/") + QFileInfo(result.target()).fileName()
+                .toLatin1());
+        }
+    }
 };
 
 QTEST_MAIN(tst_Task)
@@ -0,0 +1,262 @@
+/**************************************************************************
+**
+** Copyright (C) 2019 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <fileutils.h>
+#include <updatesinfo_p.h>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+
+using namespace KDUpdater;
+using namespace QInstaller;
+
+class tst_UpdatesInfo : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString writeUpdatesXml(const QByteArray &content)
+    {
+        const QString fileName = m_tempDir + QString::fromLatin1("/Updates%1.xml").arg(++m_fileCount);
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return QString();
+        file.write(content);
+        return fileName;
+    }
+
+    QByteArray packageUpdate(int index)
+    {
+        return QString::fromLatin1("<PackageUpdate>"
+            "<Name>org.qt.package%1</Name>"
+            "<DisplayName>Package %1</DisplayName>"
+            "<Description>Description of package %1</Description>"
+            "<Version>1.0.%1</Version>"
+            "<ReleaseDate>2019-01-01</ReleaseDate>"
+            "<Dependencies>org.qt.package%2</Dependencies>"
+            "<Default>false</Default>"
+            "<Script>installscript.qs</Script>"
+            "<UpdateFile CompressedSize=\"%1\" UncompressedSize=\"%3\" OS=\"Any\"/>"
+            "<DownloadableArchives>content.7z</DownloadableArchives>"
+            "<SHA1>0123456789abcdef0123456789abcdef%1</SHA1>"
+            "</PackageUpdate>\n").arg(index).arg(index / 2).arg(index * 2).toUtf8();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_tempDir = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(m_tempDir));
+        m_fileCount = 0;
+    }
+
+    void testParse()
+    {
+        const QString fileName = writeUpdatesXml("<?xml version=\"1.0\"?>\n"
+            "<Updates>\n"
+            "  <ApplicationName>{AnyApplication}</ApplicationName>\n"
+            "  <ApplicationVersion>1.0.0</ApplicationVersion>\n"
+            "  <Checksum>true</Checksum>\n"
+            "  <RepositoryUpdate>\n"
+            "    <Repository action=\"add\" url=\"http://example.com/repo\" displayname=\"Example\"/>\n"
+            "  </RepositoryUpdate>\n"
+            "  <PackageUpdate>\n"
+            "    <Name>A</Name>\n"
+            "    <DisplayName>Component A</DisplayName>\n"
+            "    <Description>Description A</Description>\n"
+            "    <Version inheritVersionFrom=\"B\">1.0.0</Version>\n"
+            "    <ReleaseDate>2019-01-01</ReleaseDate>\n"
+            "    <Licenses>\n"
+            "      <License name=\"License A\" file=\"license.txt\"/>\n"
+            "    </Licenses>\n"
+            "    <UpdateFile CompressedSize=\"10\" UncompressedSize=\"20\"/>\n"
+            "    <SHA1>abcdef</SHA1>\n"
+            "  </PackageUpdate>\n"
+            "</Updates>\n");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QVERIFY2(info.isValid(), qPrintable(info.errorString()));
+        QCOMPARE(info.applicationName(), QLatin1String("{AnyApplication}"));
+        QCOMPARE(info.applicationVersion(), QLatin1String("1.0.0"));
+        QCOMPARE(info.checksum(), QLatin1String("true"));
+        QVERIFY(info.sha1().isNull());
+        QVERIFY(info.metadataName().isNull());
+
+        QCOMPARE(info.repositoryUpdates().count(), 1);
+        const UpdateInfo repository = info.repositoryUpdates().first();
+        QCOMPARE(repository.data.value(QLatin1String("action")).toString(), QLatin1String("add"));
+        QCOMPARE(repository.data.value(QLatin1String("url")).toString(),
+            QLatin1String("http://example.com/repo"));
+        QCOMPARE(repository.data.value(QLatin1String("LineNumber")).toInt(), 7);
+
+        QCOMPARE(info.updateInfoCount(), 1);
+        const UpdateInfo package = info.updateInfo(0);
+        QCOMPARE(package.data.value(QLatin1String("Name")).toString(), QLatin1String("A"));
+        QCOMPARE(package.data.value(QLatin1String("DisplayName")).toString(),
+            QLatin1String("Component A"));
+        QCOMPARE(package.data.value(QLatin1String("Version")).toString(), QLatin1String("1.0.0"));
+        QCOMPARE(package.data.value(QLatin1String("inheritVersionFrom")).toString(),
+            QLatin1String("B"));
+        QCOMPARE(package.data.value(QLatin1String("CompressedSize")).toString(), QLatin1String("10"));
+        QCOMPARE(package.data.value(QLatin1String("UncompressedSize")).toString(),
+            QLatin1String("20"));
+        QCOMPARE(package.data.value(QLatin1String("SHA1")).toString(), QLatin1String("abcdef"));
+        QCOMPARE(package.data.value(QLatin1String("Licenses")).toHash()
+            .value(QLatin1String("License A")).toString(), QLatin1String("license.txt"));
+    }
+
+    void testCompressedRepository()
+    {
+        const QString fileName = writeUpdatesXml("<Updates>"
+            "<ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion>"
+            "<Checksum/>"
+            "<MetadataName>2019-01-01meta.7z</MetadataName>"
+            "<SHA1>abcdef</SHA1>"
+            "</Updates>");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QVERIFY2(info.isValid(), qPrintable(info.errorString()));
+        QVERIFY(!info.checksum().isNull());
+        QVERIFY(info.checksum().isEmpty());
+        QCOMPARE(info.metadataName(), QLatin1String("2019-01-01meta.7z"));
+        QCOMPARE(info.sha1(), QLatin1String("abcdef"));
+        QCOMPARE(info.updateInfoCount(), 0);
+    }
+
+    void testInvalidContent()
+    {
+        // packages are still read for callers that do not need all elements
+        const QString fileName = writeUpdatesXml("<Updates>"
+            "<ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion>"
+            "<PackageUpdate><Name>A</Name><Version>1.0.0</Version></PackageUpdate>"
+            "<PackageUpdate><Name>B</Name><Version>1.0.0</Version></PackageUpdate>"
+            "</Updates>");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QVERIFY(!info.isValid());
+        QCOMPARE(info.error(), UpdatesInfo::InvalidContentError);
+        QCOMPARE(info.updateInfoCount(), 2);
+    }
+
+    void testInvalidXml()
+    {
+        const QString fileName = writeUpdatesXml("<Updates>"
+            "<ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion>"
+            "<PackageUpdate><Name>A</Name></Updates>");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QVERIFY(!info.isValid());
+        QCOMPARE(info.error(), UpdatesInfo::InvalidXmlError);
+
+        UpdatesInfo missing;
+        missing.setFileName(m_tempDir + QLatin1String("/missing.xml"));
+        QCOMPARE(missing.error(), UpdatesInfo::CouldNotReadUpdateInfoFileError);
+    }
+
+    void testKeepForNextRead()
+    {
+        const QByteArray content = "<Updates>"
+            "<ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion>"
+            + packageUpdate(1) + "</Updates>";
+        const QString fileName = writeUpdatesXml(content);
+
+        UpdatesInfo first;
+        first.setFileName(fileName);
+        QVERIFY(first.isValid());
+        UpdatesInfo::keepForNextRead(first);
+
+        // change the content behind its back, but keep size and modification time
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        const QDateTime lastModified = file.fileTime(QFileDevice::FileModificationTime);
+        file.write(QByteArray(content).replace("org.qt.package1", "org.qt.package2"));
+        QVERIFY(file.setFileTime(lastModified, QFileDevice::FileModificationTime));
+        file.close();
+
+        UpdatesInfo second;
+        second.setFileName(fileName);
+        QCOMPARE(second.updateInfo(0).data.value(QLatin1String("Name")).toString(),
+            QLatin1String("org.qt.package1"));
+
+        // the parsed file is handed over only once
+        UpdatesInfo third;
+        third.setFileName(fileName);
+        QCOMPARE(third.updateInfo(0).data.value(QLatin1String("Name")).toString(),
+            QLatin1String("org.qt.package2"));
+    }
+
+    void benchmarkParse_data()
+    {
+        QTest::addColumn<int>("packageCount");
+        QTest::newRow("50k packages") << 50000;
+    }
+
+    void benchmarkParse()
+    {
+        QFETCH(int, packageCount);
+
+        QByteArray content = "<?xml version=\"1.0\"?>\n<Updates>\n"
+            "<ApplicationName>{AnyApplication}</ApplicationName>\n"
+            "<ApplicationVersion>1.0.0</ApplicationVersion>\n<Checksum>true</Checksum>\n";
+        for (int i = 0; i < packageCount; ++i)
+            content += packageUpdate(i);
+        content += "</Updates>\n";
+        const QString fileName = writeUpdatesXml(content);
+
+        QBENCHMARK {
+            UpdatesInfo info;
+            info.setFileName(fileName);
+            QCOMPARE(info.updateInfoCount(), packageCount);
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        QDir dir(m_tempDir);
+        QVERIFY(dir.removeRecursively());
+    }
+
+private:
+    QString m_tempDir;
+    int m_fileCount;
+};
+
+QTEST_MAIN(tst_UpdatesInfo)
+
+#include "tst_updatesinfo.moc"